@@ -0,0 +1,759 @@
+/*
+ * Copyright 2011-2018 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Benchmark application.
+ *
+ * Renders a set of synthetic scenes which stress different parts of the
+ * renderer, and writes timing and memory measurements in a machine-readable
+ * JSON format, so that results of different builds can be compared.
+ *
+ * Scenes are generated as XML documents and loaded through the same reader
+ * as the standalone application. Data which the XML format can not express
+ * (instances sharing a mesh, hair curves) is added afterwards through the
+ * scene API.
+ */
+
+#include <stdio.h>
+
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "device/device.h"
+#include "render/film.h"
+#include "render/mesh.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/session.h"
+#include "render/shader.h"
+#include "render/stats.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_args.h"
+#include "util/util_foreach.h"
+#include "util/util_guarded_allocator.h"
+#include "util/util_hash.h"
+#include "util/util_logging.h"
+#include "util/util_path.h"
+#include "util/util_profiling.h"
+#include "util/util_progress.h"
+#include "util/util_string.h"
+#include "util/util_system.h"
+#include "util/util_time.h"
+#include "util/util_transform.h"
+#include "util/util_version.h"
+
+#include "app/cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct BenchmarkOptions {
+	string scene_names;
+	int width, height;
+	int scale;
+	bool denoise;
+	bool quiet;
+	string output_path;
+	SceneParams scene_params;
+	SessionParams session_params;
+} options;
+
+/* Measurements of a single benchmark scene. */
+
+struct BenchmarkResult {
+	string name;
+
+	double generate_time;
+	double render_time;
+	double denoise_time;
+	double pixel_samples_per_second;
+
+	size_t device_mem_peak;
+	size_t host_mem_peak;
+
+	size_t num_objects;
+	size_t num_meshes;
+	size_t num_lights;
+
+	NamedTimeStats update_stats;
+
+	BenchmarkResult()
+	: generate_time(0.0),
+	  render_time(0.0),
+	  denoise_time(0.0),
+	  pixel_samples_per_second(0.0),
+	  device_mem_peak(0),
+	  host_mem_peak(0),
+	  num_objects(0),
+	  num_meshes(0),
+	  num_lights(0)
+	{
+	}
+};
+
+/* Deterministic random numbers, so every run generates the same scene. */
+
+static float benchmark_random(uint index, uint dimension)
+{
+	return hash_int_01(hash_int_2d(index, dimension));
+}
+
+/* XML Generation Helpers */
+
+static string xml_float3(float3 f)
+{
+	return string_printf("%g %g %g", (double)f.x, (double)f.y, (double)f.z);
+}
+
+static string xml_mesh(const vector<float3>& P, const vector<int>& nverts, const vector<int>& verts, const string& extra = "")
+{
+	string P_str, nverts_str, verts_str;
+
+	foreach(const float3& co, P)
+		P_str += xml_float3(co) + " ";
+	foreach(int n, nverts)
+		nverts_str += string_printf("%d ", n);
+	foreach(int v, verts)
+		verts_str += string_printf("%d ", v);
+
+	return string_printf("<mesh P=\"%s\" nverts=\"%s\" verts=\"%s\" %s/>\n",
+	                     P_str.c_str(),
+	                     nverts_str.c_str(),
+	                     verts_str.c_str(),
+	                     extra.c_str());
+}
+
+/* Quad grid of res x res faces in the XZ plane, centered at the origin. */
+static string xml_grid_mesh(int res, float size, const string& extra = "")
+{
+	vector<float3> P;
+	vector<int> nverts, verts;
+
+	for(int j = 0; j <= res; j++) {
+		for(int i = 0; i <= res; i++) {
+			float u = (float)i / res - 0.5f;
+			float v = (float)j / res - 0.5f;
+			P.push_back(make_float3(u * size, 0.0f, v * size));
+		}
+	}
+
+	for(int j = 0; j < res; j++) {
+		for(int i = 0; i < res; i++) {
+			int v0 = j * (res + 1) + i;
+			nverts.push_back(4);
+			verts.push_back(v0);
+			verts.push_back(v0 + 1);
+			verts.push_back(v0 + res + 2);
+			verts.push_back(v0 + res + 1);
+		}
+	}
+
+	return xml_mesh(P, nverts, verts, extra);
+}
+
+/* Axis aligned box between the given corners. */
+static string xml_box_mesh(float3 lo, float3 hi)
+{
+	vector<float3> P;
+	for(int i = 0; i < 8; i++) {
+		P.push_back(make_float3((i & 1)? hi.x: lo.x,
+		                        (i & 2)? hi.y: lo.y,
+		                        (i & 4)? hi.z: lo.z));
+	}
+
+	static const int faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6},
+	                                {0, 1, 5, 4}, {2, 6, 7, 3},
+	                                {0, 4, 6, 2}, {1, 3, 7, 5}};
+	vector<int> nverts, verts;
+	for(int f = 0; f < 6; f++) {
+		nverts.push_back(4);
+		for(int i = 0; i < 4; i++)
+			verts.push_back(faces[f][i]);
+	}
+
+	return xml_mesh(P, nverts, verts);
+}
+
+/* Cone made of stacked rings along the Y axis, used as a tree. */
+static string xml_cone_mesh(int segments, int rings, float radius, float height)
+{
+	vector<float3> P;
+	vector<int> nverts, verts;
+
+	for(int r = 0; r < rings; r++) {
+		float t = (float)r / rings;
+		for(int s = 0; s < segments; s++) {
+			float phi = M_2PI_F * s / segments;
+			P.push_back(make_float3(cosf(phi) * radius * (1.0f - t),
+			                        t * height,
+			                        sinf(phi) * radius * (1.0f - t)));
+		}
+	}
+	int apex = P.size();
+	P.push_back(make_float3(0.0f, height, 0.0f));
+
+	for(int r = 0; r < rings; r++) {
+		for(int s = 0; s < segments; s++) {
+			int s1 = (s + 1) % segments;
+			if(r + 1 < rings) {
+				nverts.push_back(4);
+				verts.push_back(r * segments + s);
+				verts.push_back(r * segments + s1);
+				verts.push_back((r + 1) * segments + s1);
+				verts.push_back((r + 1) * segments + s);
+			}
+			else {
+				nverts.push_back(3);
+				verts.push_back(r * segments + s);
+				verts.push_back(r * segments + s1);
+				verts.push_back(apex);
+			}
+		}
+	}
+
+	return xml_mesh(P, nverts, verts);
+}
+
+static string xml_diffuse_shader(const char *name, float3 color)
+{
+	return string_printf(
+	        "<shader name=\"%s\">\n"
+	        "  <diffuse_bsdf name=\"bsdf\" color=\"%s\"/>\n"
+	        "  <connect from=\"bsdf bsdf\" to=\"output surface\"/>\n"
+	        "</shader>\n",
+	        name, xml_float3(color).c_str());
+}
+
+static string xml_emission_shader(const char *name, float strength)
+{
+	return string_printf(
+	        "<shader name=\"%s\">\n"
+	        "  <emission name=\"emission\" strength=\"%g\"/>\n"
+	        "  <connect from=\"emission emission\" to=\"output surface\"/>\n"
+	        "</shader>\n",
+	        name, (double)strength);
+}
+
+static string xml_scene_header(float3 camera_location, float fov)
+{
+	return string_printf(
+	        "<cycles>\n"
+	        "<transform translate=\"%s\">\n"
+	        "  <camera type=\"perspective\" fov=\"%g\"/>\n"
+	        "</transform>\n"
+	        "<background>\n"
+	        "  <background name=\"bg\" color=\"0.6 0.7 0.9\" strength=\"0.5\"/>\n"
+	        "  <connect from=\"bg background\" to=\"output surface\"/>\n"
+	        "</background>\n",
+	        xml_float3(camera_location).c_str(),
+	        (double)fov);
+}
+
+static Shader *scene_find_shader(Scene *scene, const char *name)
+{
+	foreach(Shader *shader, scene->shaders) {
+		if(shader->name == name) {
+			return shader;
+		}
+	}
+	return scene->default_surface;
+}
+
+/* Scene Generators */
+
+/* Many instances of a single tree mesh, stresses the top level BVH and
+ * object updates. */
+static void generate_forest(Scene *scene, int scale)
+{
+	string xml = xml_scene_header(make_float3(0.0f, 4.0f, -40.0f), 0.8f);
+	xml += xml_diffuse_shader("ground", make_float3(0.3f, 0.25f, 0.2f));
+	xml += xml_diffuse_shader("leaves", make_float3(0.1f, 0.4f, 0.1f));
+	xml += xml_emission_shader("sun", 3.0f);
+	xml += "<state shader=\"sun\"><light type=\"sun\" dir=\"0.3 -1 0.4\" size=\"0.05\"/></state>\n";
+	xml += "<state shader=\"ground\">" + xml_grid_mesh(1, 200.0f) + "</state>\n";
+	xml += "<state shader=\"leaves\" interpolation=\"smooth\">" + xml_cone_mesh(32, 16, 1.0f, 4.0f) + "</state>\n";
+	xml += "</cycles>\n";
+
+	xml_read_buffer(scene, xml, "");
+
+	Mesh *tree = scene->meshes.back();
+	int num_trees = 2000 * scale;
+	float extent = 10.0f * sqrtf((float)num_trees);
+
+	for(int i = 0; i < num_trees; i++) {
+		float3 co = make_float3((benchmark_random(i, 0) - 0.5f) * extent,
+		                        0.0f,
+		                        benchmark_random(i, 1) * extent);
+		float size = 0.5f + benchmark_random(i, 2);
+
+		Object *object = new Object();
+		object->mesh = tree;
+		object->tfm = transform_translate(co) *
+		              transform_rotate(benchmark_random(i, 3) * M_2PI_F, make_float3(0.0f, 1.0f, 0.0f)) *
+		              transform_scale(make_float3(size, size, size));
+		object->random_id = hash_int(i);
+		scene->objects.push_back(object);
+	}
+}
+
+/* Dense ball of hair curves, stresses curve intersection and unaligned BVH
+ * nodes. */
+static void generate_hair_ball(Scene *scene, int scale)
+{
+	string xml = xml_scene_header(make_float3(0.0f, 0.0f, -5.0f), 0.6f);
+	xml += string_printf(
+	        "<shader name=\"hair\">\n"
+	        "  <principled_hair_bsdf name=\"bsdf\" color=\"0.4 0.25 0.1\"/>\n"
+	        "  <connect from=\"bsdf bsdf\" to=\"output surface\"/>\n"
+	        "</shader>\n");
+	xml += xml_emission_shader("lamp", 200.0f);
+	xml += "<state shader=\"lamp\"><light type=\"point\" co=\"2 3 -3\" size=\"0.5\"/></state>\n";
+	xml += "</cycles>\n";
+
+	xml_read_buffer(scene, xml, "");
+
+	const int num_curves = 50000 * scale;
+	const int num_keys = 8;
+	const float segment_length = 0.08f;
+
+	Mesh *mesh = new Mesh();
+	mesh->used_shaders.push_back(scene_find_shader(scene, "hair"));
+	mesh->reserve_curves(num_curves, num_curves * num_keys);
+
+	for(int i = 0; i < num_curves; i++) {
+		/* Uniformly distributed root on the unit sphere. */
+		float z = 1.0f - 2.0f * benchmark_random(i, 0);
+		float phi = M_2PI_F * benchmark_random(i, 1);
+		float r = sqrtf(max(0.0f, 1.0f - z*z));
+		float3 N = make_float3(r * cosf(phi), r * sinf(phi), z);
+
+		float3 co = N;
+		float3 dir = N;
+		int first_key = mesh->curve_keys.size();
+
+		for(int k = 0; k < num_keys; k++) {
+			float radius = 0.004f * (1.0f - (float)k / num_keys);
+			mesh->add_curve_key(co, radius);
+
+			float3 jitter = make_float3(benchmark_random(i, 2 + k*3) - 0.5f,
+			                            benchmark_random(i, 3 + k*3) - 0.5f,
+			                            benchmark_random(i, 4 + k*3) - 0.5f);
+			dir = normalize(dir + jitter * 0.5f);
+			co += dir * segment_length;
+		}
+
+		mesh->add_curve(first_key, 0);
+	}
+
+	scene->meshes.push_back(mesh);
+
+	Object *object = new Object();
+	object->mesh = mesh;
+	object->tfm = transform_identity();
+	scene->objects.push_back(object);
+}
+
+/* Grid of small point lights over a floor with boxes, stresses light
+ * sampling and the light distribution. */
+static void generate_many_lights(Scene *scene, int scale)
+{
+	string xml = xml_scene_header(make_float3(0.0f, 6.0f, -30.0f), 0.8f);
+	xml += xml_diffuse_shader("floor", make_float3(0.8f, 0.8f, 0.8f));
+	xml += xml_emission_shader("lamp", 20.0f);
+	xml += "<state shader=\"floor\">\n";
+	xml += xml_grid_mesh(1, 100.0f);
+	for(int i = 0; i < 64; i++) {
+		float3 lo = make_float3((benchmark_random(i, 0) - 0.5f) * 40.0f,
+		                        0.0f,
+		                        (benchmark_random(i, 1) - 0.5f) * 40.0f);
+		xml += xml_box_mesh(lo, lo + make_float3(1.0f, 1.0f + 4.0f * benchmark_random(i, 2), 1.0f));
+	}
+	xml += "</state>\n";
+
+	int num_lights = 1024 * scale;
+	int res = max((int)sqrtf((float)num_lights), 1);
+	xml += "<state shader=\"lamp\">\n";
+	for(int i = 0; i < num_lights; i++) {
+		float3 co = make_float3(((float)(i % res) / res - 0.5f) * 40.0f,
+		                        1.0f + 6.0f * benchmark_random(i, 3),
+		                        ((float)(i / res) / res - 0.5f) * 40.0f);
+		xml += "<light type=\"point\" co=\"" + xml_float3(co) + "\" size=\"0.05\"/>\n";
+	}
+	xml += "</state>\n";
+	xml += "</cycles>\n";
+
+	xml_read_buffer(scene, xml, "");
+}
+
+/* Overlapping boxes with heterogeneous volume shaders, stresses volume ray
+ * marching. */
+static void generate_heavy_volumes(Scene *scene, int scale)
+{
+	string xml = xml_scene_header(make_float3(0.0f, 1.0f, -12.0f), 0.8f);
+	xml += "<integrator volume_step_size=\"0.02\" volume_max_steps=\"4096\"/>\n";
+	xml += xml_diffuse_shader("floor", make_float3(0.5f, 0.5f, 0.5f));
+	xml += xml_emission_shader("sun", 4.0f);
+	xml += "<shader name=\"smoke\">\n"
+	       "  <noise_texture name=\"noise\" scale=\"3.0\" detail=\"6.0\"/>\n"
+	       "  <math name=\"density\" type=\"multiply\" value2=\"4.0\"/>\n"
+	       "  <scatter_volume name=\"scatter\" color=\"0.8 0.8 0.8\" anisotropy=\"0.3\"/>\n"
+	       "  <connect from=\"noise fac\" to=\"density value1\"/>\n"
+	       "  <connect from=\"density value\" to=\"scatter density\"/>\n"
+	       "  <connect from=\"scatter volume\" to=\"output volume\"/>\n"
+	       "</shader>\n";
+	xml += "<state shader=\"sun\"><light type=\"sun\" dir=\"-0.4 -1 0.3\" size=\"0.05\"/></state>\n";
+	xml += "<state shader=\"floor\">" + xml_grid_mesh(1, 50.0f) + "</state>\n";
+
+	int num_volumes = 8 * scale;
+	xml += "<state shader=\"smoke\">\n";
+	for(int i = 0; i < num_volumes; i++) {
+		float3 lo = make_float3((benchmark_random(i, 0) - 0.5f) * 6.0f - 1.5f,
+		                        benchmark_random(i, 1) * 2.0f,
+		                        (benchmark_random(i, 2) - 0.5f) * 6.0f - 1.5f);
+		xml += xml_box_mesh(lo, lo + make_float3(3.0f, 3.0f, 3.0f));
+	}
+	xml += "</state>\n";
+	xml += "</cycles>\n";
+
+	xml_read_buffer(scene, xml, "");
+}
+
+/* Adaptively subdivided terrain with true displacement, stresses dicing and
+ * displacement shader evaluation. */
+static void generate_displacement(Scene *scene, int scale)
+{
+	string xml = xml_scene_header(make_float3(0.0f, 3.0f, -12.0f), 0.8f);
+	xml += "<shader name=\"terrain\" displacement_method=\"true\">\n"
+	       "  <diffuse_bsdf name=\"bsdf\" color=\"0.5 0.45 0.4\"/>\n"
+	       "  <noise_texture name=\"noise\" scale=\"2.0\" detail=\"10.0\"/>\n"
+	       "  <displacement name=\"disp\" scale=\"1.5\"/>\n"
+	       "  <connect from=\"bsdf bsdf\" to=\"output surface\"/>\n"
+	       "  <connect from=\"noise fac\" to=\"disp height\"/>\n"
+	       "  <connect from=\"disp displacement\" to=\"output displacement\"/>\n"
+	       "</shader>\n";
+	xml += xml_emission_shader("sun", 4.0f);
+	xml += "<state shader=\"sun\"><light type=\"sun\" dir=\"0.5 -1 0.2\" size=\"0.05\"/></state>\n";
+	xml += string_printf("<state shader=\"terrain\" interpolation=\"smooth\" dicing_rate=\"%g\">",
+	                     (double)(1.0f / scale));
+	xml += xml_grid_mesh(16, 30.0f, "subdivision=\"catmull-clark\"");
+	xml += "</state>\n";
+	xml += "</cycles>\n";
+
+	xml_read_buffer(scene, xml, "");
+}
+
+struct BenchmarkScene {
+	const char *name;
+	void (*generate)(Scene *scene, int scale);
+};
+
+static const BenchmarkScene benchmark_scenes[] = {
+	{"forest", generate_forest},
+	{"hair_ball", generate_hair_ball},
+	{"many_lights", generate_many_lights},
+	{"heavy_volumes", generate_heavy_volumes},
+	{"displacement", generate_displacement},
+};
+
+/* Benchmark Run */
+
+static void benchmark_run(const BenchmarkScene& benchmark, BenchmarkResult& result)
+{
+	result.name = benchmark.name;
+
+	Session *session = new Session(options.session_params);
+	Scene *scene = new Scene(options.scene_params, session->device);
+	scene->update_stats = &result.update_stats;
+
+	{
+		scoped_timer timer(&result.generate_time);
+		benchmark.generate(scene, options.scale);
+	}
+
+	scene->camera->width = options.width;
+	scene->camera->height = options.height;
+	scene->camera->compute_auto_viewplane();
+
+	result.num_objects = scene->objects.size();
+	result.num_meshes = scene->meshes.size();
+	result.num_lights = scene->lights.size();
+
+	BufferParams buffer_params;
+	buffer_params.width = options.width;
+	buffer_params.height = options.height;
+	buffer_params.full_width = options.width;
+	buffer_params.full_height = options.height;
+
+	if(options.denoise) {
+		buffer_params.denoising_data_pass = true;
+		scene->film->denoising_data_pass = true;
+		scene->film->tag_update(scene);
+		session->tile_manager.schedule_denoising = true;
+	}
+
+	session->scene = scene;
+	session->reset(buffer_params, options.session_params.samples);
+	session->start();
+	session->wait();
+
+	double total_time;
+	session->progress.get_time(total_time, result.render_time);
+
+	uint64_t pixel_samples = (uint64_t)options.width * options.height * options.session_params.samples;
+	if(result.render_time > 0.0) {
+		result.pixel_samples_per_second = pixel_samples / result.render_time;
+	}
+
+	/* Profiler samples are taken every millisecond per thread, so this is
+	 * the accumulated time of all threads spent denoising. */
+	if(options.session_params.use_profiling) {
+		result.denoise_time = session->profiler.get_event(PROFILING_DENOISING) * 0.001;
+	}
+
+	result.device_mem_peak = session->stats.mem_peak;
+	result.host_mem_peak = util_guarded_get_mem_peak();
+
+	/* Session owns the scene and frees it. */
+	scene->update_stats = NULL;
+	delete session;
+}
+
+/* Result Output */
+
+static string result_to_json(const BenchmarkResult& result)
+{
+	string update = "";
+	foreach(const NamedTimeEntry& entry, result.update_stats.entries) {
+		if(update != "")
+			update += ",\n";
+		update += string_printf("        \"%s\": %f", entry.name.c_str(), entry.time);
+	}
+
+	double bvh_time = result.update_stats.get_time("Mesh BVH") +
+	                  result.update_stats.get_time("Scene BVH");
+
+	return string_printf(
+	        "    {\n"
+	        "      \"name\": \"%s\",\n"
+	        "      \"num_objects\": %lu,\n"
+	        "      \"num_meshes\": %lu,\n"
+	        "      \"num_lights\": %lu,\n"
+	        "      \"generate_time\": %f,\n"
+	        "      \"device_update_time\": %f,\n"
+	        "      \"bvh_build_time\": %f,\n"
+	        "      \"device_update\": {\n%s\n      },\n"
+	        "      \"render_time\": %f,\n"
+	        "      \"pixel_samples_per_second\": %f,\n"
+	        "      \"denoise_time\": %f,\n"
+	        "      \"device_mem_peak\": %lu,\n"
+	        "      \"host_mem_peak\": %lu\n"
+	        "    }",
+	        result.name.c_str(),
+	        (unsigned long)result.num_objects,
+	        (unsigned long)result.num_meshes,
+	        (unsigned long)result.num_lights,
+	        result.generate_time,
+	        result.update_stats.total_time,
+	        bvh_time,
+	        update.c_str(),
+	        result.render_time,
+	        result.pixel_samples_per_second,
+	        result.denoise_time,
+	        (unsigned long)result.device_mem_peak,
+	        (unsigned long)result.host_mem_peak);
+}
+
+static bool results_write(const vector<BenchmarkResult>& results)
+{
+	string json = "{\n";
+	json += string_printf("  \"version\": \"%s\",\n", CYCLES_VERSION_STRING);
+	json += string_printf("  \"device\": \"%s\",\n", options.session_params.device.description.c_str());
+	json += string_printf("  \"threads\": %d,\n",
+	                      (options.session_params.threads > 0)? options.session_params.threads
+	                                                          : system_cpu_thread_count());
+	json += string_printf("  \"width\": %d,\n", options.width);
+	json += string_printf("  \"height\": %d,\n", options.height);
+	json += string_printf("  \"samples\": %d,\n", options.session_params.samples);
+	json += string_printf("  \"scale\": %d,\n", options.scale);
+	json += string_printf("  \"denoise\": %s,\n", options.denoise? "true": "false");
+	json += string_printf("  \"compact_attributes\": %s,\n", options.scene_params.use_compact_attributes? "true": "false");
+	json += "  \"scenes\": [\n";
+	for(size_t i = 0; i < results.size(); i++) {
+		json += result_to_json(results[i]);
+		json += (i + 1 < results.size())? ",\n": "\n";
+	}
+	json += "  ]\n}\n";
+
+	if(options.output_path == "") {
+		printf("%s", json.c_str());
+		return true;
+	}
+
+	return path_write_text(options.output_path, json);
+}
+
+static void options_parse(int argc, const char **argv)
+{
+	options.scene_names = "";
+	options.width = 640;
+	options.height = 360;
+	options.scale = 1;
+	options.denoise = false;
+	options.quiet = false;
+	options.session_params.samples = 16;
+
+	string devicename = "CPU";
+	bool list = false, help = false, debug = false;
+	int verbosity = 1;
+
+	string scene_names = "";
+	foreach(const BenchmarkScene& benchmark, benchmark_scenes) {
+		if(scene_names != "")
+			scene_names += ", ";
+		scene_names += benchmark.name;
+	}
+
+	ArgParse ap;
+	ap.options ("Usage: cycles_benchmark [options]",
+		"--device %s", &devicename, "Device to use",
+		"--scenes %s", &options.scene_names, ("Comma separated scenes to render: " + scene_names).c_str(),
+		"--scale %d", &options.scale, "Scene complexity multiplier",
+		"--samples %d", &options.session_params.samples, "Number of samples to render",
+		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
+		"--width %d", &options.width, "Image width in pixel",
+		"--height %d", &options.height, "Image height in pixel",
+		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
+		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
+		"--tile-cost-prepass %d", &options.session_params.tile_cost_prepass_samples, "Samples of the tile cost estimation prepass, 0 to disable",
+		"--denoise", &options.denoise, "Denoise the result and measure denoising time",
+		"--compact-attributes", &options.scene_params.use_compact_attributes, "Store normals, UVs and colors at reduced precision",
+		"--output %s", &options.output_path, "File path to write JSON results to, stdout if not set",
+		"--quiet", &options.quiet, "Don't print progress messages",
+		"--list-scenes", &list, "List available benchmark scenes",
+#ifdef WITH_CYCLES_LOGGING
+		"--debug", &debug, "Enable debug logging",
+		"--verbose %d", &verbosity, "Set verbosity of the logger",
+#endif
+		"--help", &help, "Print help message",
+		NULL);
+
+	if(ap.parse(argc, argv) < 0) {
+		fprintf(stderr, "%s\n", ap.geterror().c_str());
+		ap.usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if(debug) {
+		util_logging_start();
+		util_logging_verbosity_set(verbosity);
+	}
+
+	if(help) {
+		ap.usage();
+		exit(EXIT_SUCCESS);
+	}
+	else if(list) {
+		foreach(const BenchmarkScene& benchmark, benchmark_scenes)
+			printf("%s\n", benchmark.name);
+		exit(EXIT_SUCCESS);
+	}
+
+	DeviceType device_type = Device::type_from_string(devicename.c_str());
+	bool device_available = false;
+
+	foreach(DeviceInfo& device, Device::available_devices()) {
+		if(device_type == device.type) {
+			options.session_params.device = device;
+			device_available = true;
+			break;
+		}
+	}
+
+	if(!device_available) {
+		fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
+		exit(EXIT_FAILURE);
+	}
+	else if(options.session_params.samples <= 0) {
+		fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.scale <= 0) {
+		fprintf(stderr, "Invalid scale: %d\n", options.scale);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.width <= 0 || options.height <= 0) {
+		fprintf(stderr, "Invalid resolution: %dx%d\n", options.width, options.height);
+		exit(EXIT_FAILURE);
+	}
+
+	options.session_params.background = true;
+	options.session_params.progressive = false;
+	options.session_params.start_resolution = INT_MAX;
+
+	/* Denoising time is measured with the kernel profiler, which only
+	 * exists for the CPU device. */
+	if(options.denoise) {
+		options.session_params.use_denoising = true;
+		options.session_params.denoising_passes = true;
+		options.session_params.use_profiling = (options.session_params.device.type == DEVICE_CPU);
+	}
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+	util_logging_init(argv[0]);
+	path_init();
+	options_parse(argc, argv);
+
+	vector<string> names;
+	if(options.scene_names != "") {
+		string_split(names, options.scene_names, ", ");
+	}
+
+	vector<BenchmarkResult> results;
+
+	foreach(const BenchmarkScene& benchmark, benchmark_scenes) {
+		if(!names.empty() && std::find(names.begin(), names.end(), benchmark.name) == names.end()) {
+			continue;
+		}
+
+		if(!options.quiet) {
+			fprintf(stderr, "Rendering %s\n", benchmark.name);
+		}
+
+		results.push_back(BenchmarkResult());
+		benchmark_run(benchmark, results.back());
+
+		if(!options.quiet) {
+			fprintf(stderr, "  Device update:\n%s", results.back().update_stats.full_report(2).c_str());
+			fprintf(stderr, "  Render time: %.4fs\n", results.back().render_time);
+		}
+	}
+
+	if(results.empty()) {
+		fprintf(stderr, "No benchmark scenes matched \"%s\"\n", options.scene_names.c_str());
+		return EXIT_FAILURE;
+	}
+
+	if(!results_write(results)) {
+		fprintf(stderr, "Failed to write results to %s\n", options.output_path.c_str());
+		return EXIT_FAILURE;
+	}
+
+	return 0;
+}
@@ -400,6 +400,7 @@ static void options_parse(int argc, const char **argv)
 		"--height %d", &options.height, "Window height in pixel",
 		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
 		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
+		"--tile-cost-prepass %d", &options.session_params.tile_cost_prepass_samples, "Samples of the tile cost estimation prepass, 0 to disable",
 		"--list-devices", &list, "List information about all available devices",
 #ifdef WITH_CYCLES_LOGGING
 		"--debug", &debug, "Enable debug logging",
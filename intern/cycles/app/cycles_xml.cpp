@@ -696,4 +696,30 @@ void xml_read_file(Scene *scene, const char *filepath)
 	scene->params.bvh_type = SceneParams::BVH_STATIC;
 }
 
+void xml_read_buffer(Scene *scene, const string& buffer, const char *base_path)
+{
+	XMLReadState state;
+
+	state.scene = scene;
+	state.tfm = transform_identity();
+	state.shader = scene->default_surface;
+	state.smooth = false;
+	state.dicing_rate = 1.0f;
+	state.base = base_path;
+
+	xml_document doc;
+	xml_parse_result parse_result = doc.load_buffer(buffer.data(), buffer.size());
+
+	if(parse_result) {
+		xml_node cycles = doc.child("cycles");
+		xml_read_scene(state, cycles);
+	}
+	else {
+		fprintf(stderr, "XML buffer read error: %s\n", parse_result.description());
+		exit(EXIT_FAILURE);
+	}
+
+	scene->params.bvh_type = SceneParams::BVH_STATIC;
+}
+
 CCL_NAMESPACE_END
@@ -23,6 +23,10 @@ class Scene;
 
 void xml_read_file(Scene *scene, const char *filepath);
 
+/* Read scene from an in-memory XML document, relative paths in the document
+ * are resolved against base_path. */
+void xml_read_buffer(Scene *scene, const string& buffer, const char *base_path);
+
 /* macros for importing */
 #define RAD2DEGF(_rad) ((_rad) * (float)(180.0 / M_PI))
 #define DEG2RADF(_deg) ((_deg) * (float)(M_PI / 180.0))
@@ -379,6 +379,14 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             min=2, max=65536
         )
 
+        cls.volume_step_max_scale = IntProperty(
+            name="Max Step Scale",
+            description="Maximum factor by which steps through empty parts of the volume are enlarged, "
+            "higher values skip empty space faster but may miss thin details",
+            default=1,
+            min=1, max=64
+        )
+
         cls.dicing_rate = FloatProperty(
             name="Dicing Rate",
             description="Size of a micropolygon in pixels",
@@ -552,6 +560,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             description="Use Embree as ray accelerator",
             default=False,
         )
+        cls.use_compact_attributes = BoolProperty(
+            name="Compact Attributes",
+            description="Store vertex normals, UVs and colors at reduced precision, "
+                        "to reduce memory usage of heavy meshes",
+            default=False,
+        )
         cls.debug_bvh_time_steps = IntProperty(
             name="BVH Time Steps",
             description="Split BVH primitives by this number of time steps to speed up render time in cost of memory",
@@ -565,6 +579,14 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             default='HILBERT_SPIRAL',
             options=set(),  # Not animatable!
         )
+        cls.tile_cost_prepass_samples = IntProperty(
+            name="Cost Prepass Samples",
+            description="Render this many samples of every tile first, to estimate tile cost and "
+            "render the most expensive tiles first (0 to disable)",
+            min=0, max=16,
+            default=0,
+            options=set(),  # Not animatable!
+        )
         cls.use_progressive_refine = BoolProperty(
             name="Progressive Refine",
             description="Instead of rendering each tile until it is finished, "
@@ -695,6 +717,16 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             default='BVH8',
         )
         cls.debug_use_cpu_split_kernel = BoolProperty(name="Split Kernel", default=False)
+        cls.debug_use_cpu_batch_kernel = BoolProperty(
+            name="Batch Kernel",
+            description="Trace camera rays in blocks of pixels and shade them sorted by material",
+            default=False,
+        )
+        cls.debug_use_cpu_numa_replication = BoolProperty(
+            name="NUMA Replication",
+            description="Replicate BVH and triangle data into the memory of every NUMA node",
+            default=False,
+        )
 
         cls.debug_use_cuda_adaptive_compile = BoolProperty(name="Adaptive Compile", default=False)
         cls.debug_use_cuda_split_kernel = BoolProperty(name="Split Kernel", default=False)
@@ -1256,6 +1288,13 @@ class CyclesRenderLayerSettings(bpy.types.PropertyGroup):
             default=False,
             update=update_render_passes,
         )
+        cls.pass_debug_sample_cost = BoolProperty(
+            name="Debug Sample Cost",
+            description="Time in microseconds spent on an average sample of each pixel, "
+                        "measured for every pixel (CPU only)",
+            default=False,
+            update=update_render_passes,
+        )
         cls.use_pass_volume_direct = BoolProperty(
             name="Volume Direct",
             description="Deliver direct volumetric scattering pass",
@@ -1344,6 +1383,12 @@ class CyclesRenderLayerSettings(bpy.types.PropertyGroup):
             default=False,
             update=update_render_passes,
         )
+        cls.use_half_precision_passes = BoolProperty(
+            name="Half Precision Passes",
+            description="Keep auxiliary passes of finished tiles in half float while they wait for denoising, "
+                        "to reduce memory usage",
+            default=False,
+        )
         cls.use_pass_crypto_object = BoolProperty(
                 name="Cryptomatte Object",
                 description="Render cryptomatte object pass, for isolating objects in compositing",
@@ -232,6 +232,8 @@ class CYCLES_RENDER_PT_geometry(CyclesButtonsPanel, Panel):
         row = layout.row()
         row.prop(cscene, "volume_step_size")
         row.prop(cscene, "volume_max_steps")
+        row = layout.row()
+        row.prop(cscene, "volume_step_max_scale")
 
         layout.separator()
 
@@ -411,6 +413,7 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
         sub = col.column(align=True)
         sub.label(text="Tiles:")
         sub.prop(cscene, "tile_order", text="")
+        sub.prop(cscene, "tile_cost_prepass_samples", text="Cost Prepass")
 
         sub.prop(rd, "tile_x", text="X")
         sub.prop(rd, "tile_y", text="Y")
@@ -444,6 +447,7 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
         row = col.row()
         row.active = not cscene.debug_use_spatial_splits and not cscene.use_bvh_embree
         row.prop(cscene, "debug_bvh_time_steps")
+        col.prop(cscene, "use_compact_attributes")
 
         col = layout.column()
         col.label(text="Viewport Resolution:")
@@ -526,6 +530,7 @@ class CYCLES_RENDER_PT_layer_passes(CyclesButtonsPanel, Panel):
         col.prop(crl, "denoising_store_passes", text="Denoising Data")
         col.separator()
         col.prop(rl, "pass_alpha_threshold")
+        col.prop(crl, "use_half_precision_passes")
 
         col = split.column()
         col.label(text="Diffuse:")
@@ -559,6 +564,7 @@ class CYCLES_RENDER_PT_layer_passes(CyclesButtonsPanel, Panel):
 
         col = layout.column()
         col.prop(crl, "pass_debug_render_time")
+        col.prop(crl, "pass_debug_sample_cost")
         if _cycles.with_cycles_debug:
             col.prop(crl, "pass_debug_bvh_traversed_nodes")
             col.prop(crl, "pass_debug_bvh_traversed_instances")
@@ -1644,6 +1650,8 @@ class CYCLES_RENDER_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_bvh_layout")
         col.prop(cscene, "debug_use_cpu_split_kernel")
+        col.prop(cscene, "debug_use_cpu_batch_kernel")
+        col.prop(cscene, "debug_use_cpu_numa_replication")
 
         col.separator()
 
@@ -30,8 +30,10 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_math.h"
+#include "util/util_task.h"
 
 #include "mikktspace.h"
+#include "DNA_meshdata_types.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -833,20 +835,24 @@ static void create_mesh(Scene *scene,
 		return;
 	}
 
-	BL::Mesh::vertices_iterator v;
-	BL::Mesh::tessfaces_iterator f;
-	BL::Mesh::polygons_iterator p;
+	/* Direct access to the derived mesh arrays, this avoids per-element RNA
+	 * lookups and is safe to do from a worker thread since the mesh is not
+	 * modified by anyone else while it is being converted.
+	 */
+	const MVert *mverts = (numverts)? (const MVert*)b_mesh.vertices[0].ptr.data: NULL;
+	const MFace *mfaces = (!subdivision)? (const MFace*)b_mesh.tessfaces[0].ptr.data: NULL;
+	const MPoly *mpolys = (subdivision)? (const MPoly*)b_mesh.polygons[0].ptr.data: NULL;
+	const MLoop *mloops = (subdivision)? (const MLoop*)b_mesh.loops[0].ptr.data: NULL;
 
 	if(!subdivision) {
-		for(b_mesh.tessfaces.begin(f); f != b_mesh.tessfaces.end(); ++f) {
-			int4 vi = get_int4(f->vertices_raw());
-			numtris += (vi[3] == 0)? 1: 2;
+		for(int i = 0; i < numfaces; i++) {
+			numtris += (mfaces[i].v4 == 0)? 1: 2;
 		}
 	}
 	else {
-		for(b_mesh.polygons.begin(p); p != b_mesh.polygons.end(); ++p) {
-			numngons += (p->loop_total() == 4)? 0: 1;
-			numcorners += p->loop_total();
+		for(int i = 0; i < numfaces; i++) {
+			numngons += (mpolys[i].totloop == 4)? 0: 1;
+			numcorners += mpolys[i].totloop;
 		}
 	}
 
@@ -855,16 +861,19 @@ static void create_mesh(Scene *scene,
 	mesh->reserve_subd_faces(numfaces, numngons, numcorners);
 
 	/* create vertex coordinates and normals */
-	for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v)
-		mesh->add_vertex(get_float3(v->co()));
+	for(int i = 0; i < numverts; i++) {
+		const float *co = mverts[i].co;
+		mesh->add_vertex(make_float3(co[0], co[1], co[2]));
+	}
 
 	AttributeSet& attributes = (subdivision)? mesh->subd_attributes: mesh->attributes;
 	Attribute *attr_N = attributes.add(ATTR_STD_VERTEX_NORMAL);
 	float3 *N = attr_N->data_float3();
 
-	for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v, ++N)
-		*N = get_float3(v->normal());
-	N = attr_N->data_float3();
+	for(int i = 0; i < numverts; i++) {
+		const short *no = mverts[i].no;
+		N[i] = make_float3(no[0], no[1], no[2]) * (1.0f / 32767.0f);
+	}
 
 	/* create generated coordinates from undeformed coordinates */
 	const bool need_default_tangent =
@@ -883,6 +892,7 @@ static void create_mesh(Scene *scene,
 		float3 *generated = attr->data_float3();
 		size_t i = 0;
 
+		BL::Mesh::vertices_iterator v;
 		for(b_mesh.vertices.begin(v); v != b_mesh.vertices.end(); ++v) {
 			generated[i++] = get_float3(v->undeformed_co())*size - loc;
 		}
@@ -891,23 +901,14 @@ static void create_mesh(Scene *scene,
 	/* create faces */
 	vector<int> nverts(numfaces);
 	vector<int> face_flags(numfaces, FACE_FLAG_NONE);
-	int fi = 0;
 
 	if(!subdivision) {
-		for(b_mesh.tessfaces.begin(f); f != b_mesh.tessfaces.end(); ++f, ++fi) {
-			int4 vi = get_int4(f->vertices_raw());
+		for(int fi = 0; fi < numfaces; fi++) {
+			const MFace& mf = mfaces[fi];
+			int4 vi = make_int4(mf.v1, mf.v2, mf.v3, mf.v4);
 			int n = (vi[3] == 0)? 3: 4;
-			int shader = clamp(f->material_index(), 0, used_shaders.size()-1);
-			bool smooth = f->use_smooth() || use_loop_normals;
-
-			if(use_loop_normals) {
-				BL::Array<float, 12> loop_normals = f->split_normals();
-				for(int i = 0; i < n; i++) {
-					N[vi[i]] = make_float3(loop_normals[i * 3],
-					                       loop_normals[i * 3 + 1],
-					                       loop_normals[i * 3 + 2]);
-				}
-			}
+			int shader = clamp(mf.mat_nr, 0, used_shaders.size()-1);
+			bool smooth = (mf.flag & ME_SMOOTH) || use_loop_normals;
 
 			/* Create triangles.
 			 *
@@ -933,19 +934,40 @@ static void create_mesh(Scene *scene,
 
 			nverts[fi] = n;
 		}
+
+		/* Split normals are only available through RNA, they are stored in
+		 * a tessellated custom data layer.
+		 */
+		if(use_loop_normals) {
+			BL::Mesh::tessfaces_iterator f;
+			int fi = 0;
+
+			for(b_mesh.tessfaces.begin(f); f != b_mesh.tessfaces.end(); ++f, ++fi) {
+				const MFace& mf = mfaces[fi];
+				const int vi[4] = {(int)mf.v1, (int)mf.v2, (int)mf.v3, (int)mf.v4};
+				BL::Array<float, 12> loop_normals = f->split_normals();
+
+				for(int i = 0; i < nverts[fi]; i++) {
+					N[vi[i]] = make_float3(loop_normals[i * 3],
+					                       loop_normals[i * 3 + 1],
+					                       loop_normals[i * 3 + 2]);
+				}
+			}
+		}
 	}
 	else {
 		vector<int> vi;
 
-		for(b_mesh.polygons.begin(p); p != b_mesh.polygons.end(); ++p) {
-			int n = p->loop_total();
-			int shader = clamp(p->material_index(), 0, used_shaders.size()-1);
-			bool smooth = p->use_smooth() || use_loop_normals;
+		for(int fi = 0; fi < numfaces; fi++) {
+			const MPoly& mp = mpolys[fi];
+			int n = mp.totloop;
+			int shader = clamp(mp.mat_nr, 0, used_shaders.size()-1);
+			bool smooth = (mp.flag & ME_SMOOTH) || use_loop_normals;
 
 			vi.resize(n);
 			for(int i = 0; i < n; i++) {
 				/* NOTE: Autosmooth is already taken care about. */
-				vi[i] = b_mesh.loops[p->loop_start() + i].vertex_index();
+				vi[i] = mloops[mp.loopstart + i].v;
 			}
 
 			/* create subd faces */
@@ -982,15 +1004,10 @@ static void create_mesh(Scene *scene,
 
 static void create_subd_mesh(Scene *scene,
                              Mesh *mesh,
-                             BL::Object& b_ob,
                              BL::Mesh& b_mesh,
                              const vector<Shader*>& used_shaders,
-                             float dicing_rate,
-                             int max_subdivisions)
+                             bool subdivide_uvs)
 {
-	BL::SubsurfModifier subsurf_mod(b_ob.modifiers[b_ob.modifiers.length()-1]);
-	bool subdivide_uvs = subsurf_mod.use_subsurf_uv();
-
 	create_mesh(scene, mesh, b_mesh, used_shaders, true, subdivide_uvs);
 
 	/* export creases */
@@ -1015,7 +1032,14 @@ static void create_subd_mesh(Scene *scene,
 			crease++;
 		}
 	}
+}
 
+static void sync_subd_params(Scene *scene,
+                             Mesh *mesh,
+                             BL::Object& b_ob,
+                             float dicing_rate,
+                             int max_subdivisions)
+{
 	/* set subd params */
 	if(!mesh->subd_params) {
 		mesh->subd_params = new SubdParams(mesh);
@@ -1034,6 +1058,29 @@ static void create_subd_mesh(Scene *scene,
 
 /* Sync */
 
+/* Mesh being synchronized, its data is filled in by the mesh task pool and
+ * the remaining steps which need the filled data or access scene level state
+ * are done by sync_mesh_finish().
+ */
+struct BlenderSync::MeshSync {
+	MeshSync(BL::Object& b_ob, Mesh *mesh)
+	: b_ob(b_ob), b_mesh(PointerRNA_NULL), mesh(mesh),
+	  create_volume(false), create_curves(false)
+	{}
+
+	BL::Object b_ob;
+	BL::Mesh b_mesh;
+	Mesh *mesh;
+	bool create_volume;
+	bool create_curves;
+
+	array<int> oldtriangles;
+	array<Mesh::SubdFace> oldsubd_faces;
+	array<int> oldsubd_face_corners;
+	array<float3> oldcurve_keys;
+	array<float> oldcurve_radius;
+};
+
 static void sync_mesh_fluid_motion(BL::Object& b_ob, Scene *scene, Mesh *mesh)
 {
 	if(scene->need_motion() == Scene::MOTION_NONE)
@@ -1147,19 +1194,15 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 	mesh_synced.insert(mesh);
 
 	/* create derived mesh */
-	array<int> oldtriangles;
-	array<Mesh::SubdFace> oldsubd_faces;
-	array<int> oldsubd_face_corners;
-	oldtriangles.steal_data(mesh->triangles);
-	oldsubd_faces.steal_data(mesh->subd_faces);
-	oldsubd_face_corners.steal_data(mesh->subd_face_corners);
+	MeshSync *sync = new MeshSync(b_ob, mesh);
+	sync->oldtriangles.steal_data(mesh->triangles);
+	sync->oldsubd_faces.steal_data(mesh->subd_faces);
+	sync->oldsubd_face_corners.steal_data(mesh->subd_face_corners);
 
 	/* compares curve_keys rather than strands in order to handle quick hair
 	 * adjustments in dynamic BVH - other methods could probably do this better*/
-	array<float3> oldcurve_keys;
-	array<float> oldcurve_radius;
-	oldcurve_keys.steal_data(mesh->curve_keys);
-	oldcurve_radius.steal_data(mesh->curve_radius);
+	sync->oldcurve_keys.steal_data(mesh->curve_keys);
+	sync->oldcurve_radius.steal_data(mesh->curve_radius);
 
 	mesh->clear();
 	mesh->used_shaders = used_shaders;
@@ -1195,44 +1238,97 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 		                                 mesh->subdivision_type);
 
 		if(b_mesh) {
+			sync->b_mesh = b_mesh;
+
+			/* Conversion of the object to a mesh modifies the main database and
+			 * stays on this thread, filling in vertices, faces and attributes
+			 * only accesses the derived mesh and is done in the task pool.
+			 */
 			if(render_layer.use_surfaces && !hide_tris) {
-				if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE)
-					create_subd_mesh(scene, mesh, b_ob, b_mesh, used_shaders,
-					                 dicing_rate, max_subdivisions);
-				else
-					create_mesh(scene, mesh, b_mesh, used_shaders, false);
+				if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE) {
+					BL::SubsurfModifier subsurf_mod(b_ob.modifiers[b_ob.modifiers.length()-1]);
+					bool subdivide_uvs = subsurf_mod.use_subsurf_uv();
+
+					sync_subd_params(scene, mesh, b_ob, dicing_rate, max_subdivisions);
+					mesh_pool.push(function_bind(&create_subd_mesh,
+					                             scene,
+					                             mesh,
+					                             b_mesh,
+					                             used_shaders,
+					                             subdivide_uvs));
+				}
+				else {
+					mesh_pool.push(function_bind(&create_mesh,
+					                             scene,
+					                             mesh,
+					                             b_mesh,
+					                             used_shaders,
+					                             false,
+					                             true));
+				}
 
-				create_mesh_volume_attributes(scene, b_ob, mesh, b_scene.frame_current());
+				sync->create_volume = true;
 			}
 
 			if(render_layer.use_hair && mesh->subdivision_type == Mesh::SUBDIVISION_NONE)
-				sync_curves(mesh, b_mesh, b_ob, false);
+				sync->create_curves = true;
 
 			if(can_free_caches) {
 				b_ob.cache_release();
 			}
-
-			/* free derived mesh */
-			b_data.meshes.remove(b_mesh, false, true, false);
 		}
 	}
 	mesh->geometry_flags = requested_geometry_flags;
 
-	/* fluid motion */
-	sync_mesh_fluid_motion(b_ob, scene, mesh);
-
-	/* tag update */
-	bool rebuild = (oldtriangles != mesh->triangles) ||
-	               (oldsubd_faces != mesh->subd_faces) ||
-	               (oldsubd_face_corners != mesh->subd_face_corners) ||
-	               (oldcurve_keys != mesh->curve_keys) ||
-	               (oldcurve_radius != mesh->curve_radius);
+	/* The mesh is tagged for update in sync_mesh_finish(), flag it already
+	 * so the object sync sees the mesh as modified.
+	 */
+	mesh->need_update = true;
+	mesh_sync_queue.push_back(sync);
 
-	mesh->tag_update(scene, rebuild);
+	/* Limit the number of derived meshes kept alive at the same time. */
+	if(mesh_sync_queue.size() >= (size_t)max(TaskScheduler::num_threads() * 4, 16))
+		sync_mesh_finish();
 
 	return mesh;
 }
 
+void BlenderSync::sync_mesh_finish()
+{
+	mesh_pool.wait_work();
+
+	foreach(MeshSync *sync, mesh_sync_queue) {
+		Mesh *mesh = sync->mesh;
+
+		if(sync->b_mesh) {
+			if(sync->create_volume)
+				create_mesh_volume_attributes(scene, sync->b_ob, mesh, b_scene.frame_current());
+
+			if(sync->create_curves)
+				sync_curves(mesh, sync->b_mesh, sync->b_ob, false);
+
+			/* free derived mesh */
+			b_data.meshes.remove(sync->b_mesh, false, true, false);
+		}
+
+		/* fluid motion */
+		sync_mesh_fluid_motion(sync->b_ob, scene, mesh);
+
+		/* tag update */
+		bool rebuild = (sync->oldtriangles != mesh->triangles) ||
+		               (sync->oldsubd_faces != mesh->subd_faces) ||
+		               (sync->oldsubd_face_corners != mesh->subd_face_corners) ||
+		               (sync->oldcurve_keys != mesh->curve_keys) ||
+		               (sync->oldcurve_radius != mesh->curve_radius);
+
+		mesh->tag_update(scene, rebuild);
+
+		delete sync;
+	}
+
+	mesh_sync_queue.clear();
+}
+
 void BlenderSync::sync_mesh_motion(BL::Object& b_ob,
                                    Object *object,
                                    float motion_time)
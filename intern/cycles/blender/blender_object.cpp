@@ -660,6 +660,9 @@ void BlenderSync::sync_objects(float motion_time)
 		}
 	}
 
+	/* finish meshes filled in by the task pool */
+	sync_mesh_finish();
+
 	progress.set_sync_status("");
 
 	if(!cancel && !motion) {
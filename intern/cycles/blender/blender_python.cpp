@@ -71,6 +71,8 @@ bool debug_flags_sync_from_scene(BL::Scene b_scene)
 	flags.cpu.sse2 = get_boolean(cscene, "debug_use_cpu_sse2");
 	flags.cpu.bvh_layout = (BVHLayout)get_enum(cscene, "debug_bvh_layout");
 	flags.cpu.split_kernel = get_boolean(cscene, "debug_use_cpu_split_kernel");
+	flags.cpu.batch_kernel = get_boolean(cscene, "debug_use_cpu_batch_kernel");
+	flags.cpu.numa_replication = get_boolean(cscene, "debug_use_cpu_numa_replication");
 	/* Synchronize CUDA flags. */
 	flags.cuda.adaptive_compile = get_boolean(cscene, "debug_use_cuda_adaptive_compile");
 	flags.cuda.split_kernel = get_boolean(cscene, "debug_use_cuda_split_kernel");
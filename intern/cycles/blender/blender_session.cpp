@@ -427,6 +427,7 @@ void BlenderSession::render()
 		session->tile_manager.schedule_denoising = use_denoising;
 		buffer_params.denoising_data_pass = denoising_passes;
 		buffer_params.denoising_clean_pass = (scene->film->denoising_flags & DENOISING_CLEAN_ALL_PASSES);
+		buffer_params.use_half_precision_passes = get_boolean(crl, "use_half_precision_passes");
 
 		session->params.use_denoising = use_denoising;
 		session->params.denoising_passes = denoising_passes;
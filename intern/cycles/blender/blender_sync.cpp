@@ -243,6 +243,7 @@ void BlenderSync::sync_integrator()
 
 	integrator->volume_max_steps = get_int(cscene, "volume_max_steps");
 	integrator->volume_step_size = get_float(cscene, "volume_step_size");
+	integrator->volume_step_max_scale = get_int(cscene, "volume_step_max_scale");
 
 	integrator->caustics_reflective = get_boolean(cscene, "caustics_reflective");
 	integrator->caustics_refractive = get_boolean(cscene, "caustics_refractive");
@@ -519,6 +520,7 @@ PassType BlenderSync::get_pass_type(BL::RenderPass& b_pass)
 	MAP_PASS("Debug Ray Bounces", PASS_RAY_BOUNCES);
 #endif
 	MAP_PASS("Debug Render Time", PASS_RENDER_TIME);
+	MAP_PASS("Debug Sample Cost", PASS_SAMPLE_COST);
 	if(string_startswith(name, cryptomatte_prefix)) {
 		return PASS_CRYPTOMATTE;
 	}
@@ -633,6 +635,10 @@ vector<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		b_engine.add_pass("Debug Render Time", 1, "X", b_srlay.name().c_str());
 		Pass::add(PASS_RENDER_TIME, passes);
 	}
+	if(get_boolean(crp, "pass_debug_sample_cost")) {
+		b_engine.add_pass("Debug Sample Cost", 1, "X", b_srlay.name().c_str());
+		Pass::add(PASS_SAMPLE_COST, passes);
+	}
 	if(get_boolean(crp, "use_pass_volume_direct")) {
 		b_engine.add_pass("VolumeDir", 3, "RGB", b_srlay.name().c_str());
 		Pass::add(PASS_VOLUME_DIRECT, passes);
@@ -721,6 +727,8 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	params.use_compact_attributes = RNA_boolean_get(&cscene, "use_compact_attributes");
+
 	/* TODO(sergey): Once OSL supports per-microarchitecture optimization get
 	 * rid of this.
 	 */
@@ -898,6 +906,10 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine& b_engine,
 		params.tile_order = TILE_BOTTOM_TO_TOP;
 	}
 
+	if(background) {
+		params.tile_cost_prepass_samples = get_int(cscene, "tile_cost_prepass_samples");
+	}
+
 	/* other parameters */
 	params.start_resolution = get_int(cscene, "preview_start_resolution");
 	params.pixel_size = b_engine.get_preview_pixel_size(b_scene);
@@ -29,6 +29,7 @@
 
 #include "util/util_map.h"
 #include "util/util_set.h"
+#include "util/util_task.h"
 #include "util/util_transform.h"
 #include "util/util_vector.h"
 
@@ -114,6 +115,7 @@ private:
 
 	void sync_nodes(Shader *shader, BL::ShaderNodeTree& b_ntree);
 	Mesh *sync_mesh(BL::Object& b_ob, bool object_updated, bool hide_tris);
+	void sync_mesh_finish();
 	void sync_curves(Mesh *mesh,
 	                 BL::Mesh& b_mesh,
 	                 BL::Object& b_ob,
@@ -173,6 +175,11 @@ private:
 	void *world_map;
 	bool world_recalc;
 
+	/* Meshes whose data is being filled in by the task pool. */
+	struct MeshSync;
+	vector<MeshSync*> mesh_sync_queue;
+	TaskPool mesh_pool;
+
 	Scene *scene;
 	bool preview;
 	bool experimental;
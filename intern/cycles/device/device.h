@@ -57,6 +57,7 @@ public:
 	bool display_device;            /* GPU is used as a display device. */
 	bool advanced_shading;          /* Supports full shading system. */
 	bool has_half_images;           /* Support half-float textures. */
+	bool has_sparse_images;         /* Support sparse 3D textures. */
 	bool has_volume_decoupled;      /* Decoupled volume shading. */
 	bool has_osl;                   /* Support Open Shading Language. */
 	bool use_split_kernel;          /* Use split or mega kernel. */
@@ -73,6 +74,7 @@ public:
 		display_device = false;
 		advanced_shading = true;
 		has_half_images = false;
+		has_sparse_images = false;
 		has_volume_decoupled = false;
 		has_osl = false;
 		use_split_kernel = false;
@@ -169,15 +169,26 @@ public:
 	device_vector<TextureInfo> texture_info;
 	bool need_texture_info;
 
+	/* Copies of read-only data textures in the memory of every NUMA node,
+	 * so threads don't have to fetch BVH and triangles from a remote node. */
+	struct NUMAReplica {
+		vector<void*> data;
+		size_t size;
+		size_t width;
+	};
+	map<string, NUMAReplica> numa_replicas;
+
 #ifdef WITH_OSL
 	OSLGlobals osl_globals;
 #endif
 
 	bool use_split_kernel;
+	bool use_batch_kernel;
 
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int, int, int)>   path_trace_batch_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, int, int, int, int, int)>   shader_kernel;
@@ -215,6 +226,7 @@ public:
 	  texture_info(this, "__texture_info", MEM_TEXTURE),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  REGISTER_KERNEL(path_trace_batch),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
@@ -244,6 +256,10 @@ public:
 		if(use_split_kernel) {
 			VLOG(1) << "Will be using split kernel.";
 		}
+		use_batch_kernel = DebugFlags().cpu.batch_kernel;
+		if(use_batch_kernel) {
+			VLOG(1) << "Will be using batch kernel.";
+		}
 		need_texture_info = false;
 
 #define REGISTER_SPLIT_KERNEL(name) split_kernels[#name] = KernelFunctions<void(*)(KernelGlobals*, KernelData*)>(KERNEL_FUNCTIONS(name))
@@ -273,6 +289,10 @@ public:
 	{
 		task_pool.stop();
 		texture_info.free();
+
+		while(!numa_replicas.empty()) {
+			numa_replica_free(numa_replicas.begin()->first);
+		}
 	}
 
 	virtual bool show_samples() const
@@ -402,6 +422,10 @@ public:
 							mem.name,
 							mem.host_pointer,
 							mem.data_size);
+
+			if(use_numa_replication(mem.name)) {
+				numa_replica_alloc(mem);
+			}
 		}
 		else {
 			/* Image Texture. */
@@ -440,6 +464,7 @@ public:
 	void tex_free(device_memory& mem)
 	{
 		if(mem.device_pointer) {
+			numa_replica_free(mem.name);
 			mem.device_pointer = 0;
 			stats.mem_free(mem.device_size);
 			mem.device_size = 0;
@@ -447,6 +472,84 @@ public:
 		}
 	}
 
+	bool use_numa_replication(const char *name)
+	{
+		if(!DebugFlags().cpu.numa_replication || TaskScheduler::num_nodes() < 2) {
+			return false;
+		}
+
+		/* Data which is accessed for every ray traversal step. */
+		static const char *replicated_names[] = {
+			"__bvh_nodes",
+			"__bvh_leaf_nodes",
+			"__prim_tri_verts",
+			"__prim_tri_index",
+			"__prim_type",
+			"__prim_visibility",
+			"__prim_index",
+			"__prim_object",
+			"__tri_shader",
+			"__tri_vnormal",
+			"__tri_vnormal_oct",
+			"__tri_vindex",
+		};
+		const size_t num_names = sizeof(replicated_names) / sizeof(*replicated_names);
+		for(size_t i = 0; i < num_names; i++) {
+			if(strcmp(name, replicated_names[i]) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void numa_replica_alloc(device_memory& mem)
+	{
+		numa_replica_free(mem.name);
+
+		if(mem.memory_size() == 0) {
+			return;
+		}
+
+		NUMAReplica replica;
+		replica.size = mem.memory_size();
+		replica.width = mem.data_size;
+
+		const int num_nodes = TaskScheduler::num_nodes();
+		for(int node = 0; node < num_nodes; node++) {
+			void *data = system_cpu_allocate_on_node(replica.size,
+			                                         TaskScheduler::node_numa_id(node));
+			if(data == NULL) {
+				/* Fall back to the shared data for all nodes. */
+				foreach(void *node_data, replica.data) {
+					system_cpu_free_on_node(node_data, replica.size);
+				}
+				return;
+			}
+			memcpy(data, mem.host_pointer, replica.size);
+			replica.data.push_back(data);
+		}
+
+		VLOG(1) << "Replicated " << mem.name << " to " << num_nodes << " NUMA nodes.";
+
+		stats.mem_alloc(replica.size * num_nodes);
+		numa_replicas[mem.name] = replica;
+	}
+
+	void numa_replica_free(const string& name)
+	{
+		map<string, NUMAReplica>::iterator it = numa_replicas.find(name);
+		if(it == numa_replicas.end()) {
+			return;
+		}
+
+		NUMAReplica& replica = it->second;
+		foreach(void *data, replica.data) {
+			system_cpu_free_on_node(data, replica.size);
+		}
+		stats.mem_free(replica.size * replica.data.size());
+		numa_replicas.erase(it);
+	}
+
 	void *osl_memory()
 	{
 #ifdef WITH_OSL
@@ -456,10 +559,10 @@ public:
 #endif
 	}
 
-	void thread_run(DeviceTask *task)
+	void thread_run(DeviceTask *task, int thread_id)
 	{
 		if(task->type == DeviceTask::RENDER) {
-			thread_render(*task);
+			thread_render(*task, thread_id);
 		}
 		else if(task->type == DeviceTask::FILM_CONVERT)
 			thread_film_convert(*task);
@@ -472,7 +575,7 @@ public:
 		CPUDeviceTask(CPUDevice *device, DeviceTask& task)
 		: DeviceTask(task)
 		{
-			run = function_bind(&CPUDevice::thread_run, device, this);
+			run = function_bind(&CPUDevice::thread_run, device, this, _1);
 		}
 	};
 
@@ -709,6 +812,9 @@ public:
 	void path_trace(DeviceTask &task, RenderTile &tile, KernelGlobals *kg)
 	{
 		const bool use_coverage = kernel_data.film.cryptomatte_passes & CRYPT_ACCURATE;
+		/* Coverage is gathered per pixel, so it needs the regular kernel. */
+		const bool use_batch = use_batch_kernel && !use_coverage;
+		const int batch_size = PATH_BATCH_WIDTH;
 
 		scoped_timer timer(&tile.buffers->render_time);
 
@@ -730,13 +836,25 @@ public:
 					break;
 			}
 
-			for(int y = tile.y; y < tile.y + tile.h; y++) {
-				for(int x = tile.x; x < tile.x + tile.w; x++) {
-					if(use_coverage) {
-						coverage.init_pixel(x, y);
+			if(use_batch) {
+				for(int y = tile.y; y < tile.y + tile.h; y += batch_size) {
+					for(int x = tile.x; x < tile.x + tile.w; x += batch_size) {
+						int w = min(batch_size, tile.x + tile.w - x);
+						int h = min(batch_size, tile.y + tile.h - y);
+						path_trace_batch_kernel()(kg, render_buffer,
+						                          sample, x, y, w, h, tile.offset, tile.stride);
+					}
+				}
+			}
+			else {
+				for(int y = tile.y; y < tile.y + tile.h; y++) {
+					for(int x = tile.x; x < tile.x + tile.w; x++) {
+						if(use_coverage) {
+							coverage.init_pixel(x, y);
+						}
+						path_trace_kernel()(kg, render_buffer,
+						                    sample, x, y, tile.offset, tile.stride);
 					}
-					path_trace_kernel()(kg, render_buffer,
-					                    sample, x, y, tile.offset, tile.stride);
 				}
 			}
 
@@ -770,7 +888,7 @@ public:
 		denoising.run_denoising(&tile);
 	}
 
-	void thread_render(DeviceTask& task)
+	void thread_render(DeviceTask& task, int thread_id)
 	{
 		if(task_pool.canceled()) {
 			if(task.need_finish_queue == false)
@@ -781,7 +899,8 @@ public:
 		device_only_memory<KernelGlobals> kgbuffer(this, "kernel_globals");
 		kgbuffer.alloc_to_device(1);
 
-		KernelGlobals *kg = new ((void*) kgbuffer.device_pointer) KernelGlobals(thread_kernel_globals_init());
+		const int node = TaskScheduler::thread_node(thread_id);
+		KernelGlobals *kg = new ((void*) kgbuffer.device_pointer) KernelGlobals(thread_kernel_globals_init(node));
 
 		profiler.add_state(&kg->profiler);
 
@@ -797,6 +916,7 @@ public:
 		}
 
 		RenderTile tile;
+		tile.numa_node = node;
 		DenoisingTask denoising(this, task);
 		denoising.profiler = &kg->profiler;
 
@@ -916,9 +1036,22 @@ public:
 	}
 
 protected:
-	inline KernelGlobals thread_kernel_globals_init()
+	inline KernelGlobals thread_kernel_globals_init(int node = -1)
 	{
 		KernelGlobals kg = kernel_globals;
+		if(node != -1) {
+			/* Use the copies in the memory of the node the thread runs on. */
+			map<string, NUMAReplica>::iterator it;
+			for(it = numa_replicas.begin(); it != numa_replicas.end(); it++) {
+				const NUMAReplica& replica = it->second;
+				if(node < (int)replica.data.size()) {
+					kernel_tex_copy(&kg,
+					                it->first.c_str(),
+					                replica.data[node],
+					                replica.width);
+				}
+			}
+		}
 		kg.transparent_shadow_intersections = NULL;
 		const int decoupled_count = sizeof(kg.decoupled_volume_steps) /
 		                            sizeof(*kg.decoupled_volume_steps);
@@ -926,6 +1059,7 @@ protected:
 			kg.decoupled_volume_steps[i] = NULL;
 		}
 		kg.decoupled_volume_steps_index = 0;
+		kg.path_batch = NULL;
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
@@ -948,6 +1082,9 @@ protected:
 				free(kg->decoupled_volume_steps[i]);
 			}
 		}
+		if(kg->path_batch != NULL) {
+			free(kg->path_batch);
+		}
 #ifdef WITH_OSL
 		OSLShader::thread_free(kg);
 #endif
@@ -1084,6 +1221,7 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	info.has_volume_decoupled = true;
 	info.has_osl = true;
 	info.has_half_images = true;
+	info.has_sparse_images = true;
 	info.has_profiling = true;
 
 	devices.insert(devices.begin(), info);
@@ -77,6 +77,8 @@ public:
 
 		if(error)
 			error_func.network_error(error.message());
+		else
+			protocol_handshake();
 
 		mem_counter = 0;
 	}
@@ -91,6 +93,25 @@ public:
 		return BVH_LAYOUT_BVH2;
 	}
 
+	void protocol_handshake()
+	{
+		RPCSend snd(socket, &error_func, "hello");
+		snd.add(SERVER_PROTOCOL_VERSION);
+		snd.write();
+
+		RPCReceive rcv(socket, &error_func);
+		int server_version = 0;
+
+		if(rcv.name == "hello")
+			rcv.read(server_version);
+
+		if(server_version != SERVER_PROTOCOL_VERSION) {
+			error_func.network_error(string_printf(
+			        "Network protocol version %d of server doesn't match version %d of client",
+			        server_version, SERVER_PROTOCOL_VERSION));
+		}
+	}
+
 	void mem_alloc(device_memory& mem)
 	{
 		if(mem.name) {
@@ -110,13 +131,35 @@ public:
 
 	void mem_copy_to(device_memory& mem)
 	{
+		size_t data_size = mem.memory_size();
+
+		/* Scene data that is large enough is looked up in the memory cache of
+		 * the server first, which often still has it from a previous frame. */
+		uint64_t hash = 0;
+		if((mem.type == MEM_READ_ONLY || mem.type == MEM_TEXTURE) &&
+		   data_size >= NETWORK_CACHE_MIN_SIZE)
+		{
+			hash = network_hash_data(mem.host_pointer, data_size);
+		}
+
 		thread_scoped_lock lock(rpc_lock);
 
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
+		snd.add(hash);
 		snd.write();
-		snd.write_buffer(mem.host_pointer, mem.memory_size());
+
+		bool cached = false;
+
+		if(hash) {
+			RPCReceive rcv(socket, &error_func);
+			rcv.read(cached);
+		}
+
+		if(!cached) {
+			snd.write_buffer(mem.host_pointer, data_size);
+		}
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
@@ -185,7 +228,6 @@ public:
 
 		RPCSend snd(socket, &error_func, "load_kernels");
 		snd.add(requested_features.experimental);
-		snd.add(requested_features.max_closure);
 		snd.add(requested_features.max_nodes_group);
 		snd.add(requested_features.nodes_features);
 		snd.write();
@@ -315,6 +357,64 @@ void device_network_info(vector<DeviceInfo>& devices)
 	devices.push_back(info);
 }
 
+/* Memory freed by clients, kept by the server by content hash so that it
+ * does not need to be sent again for the next frame or connection. Oldest
+ * memory is dropped first once the cache is full. */
+
+class ServerMemoryCache {
+public:
+	explicit ServerMemoryCache(size_t max_size_)
+	: total_size(0), max_size(max_size_)
+	{
+	}
+
+	void insert(uint64_t hash, DataVector& data)
+	{
+		if(data.size() > max_size) {
+			return;
+		}
+
+		entries.push_back(Entry());
+		entries.back().hash = hash;
+		entries.back().data.swap(data);
+		total_size += entries.back().data.size();
+
+		while(total_size > max_size) {
+			total_size -= entries.front().data.size();
+			entries.pop_front();
+		}
+	}
+
+	bool take(uint64_t hash, DataVector& data)
+	{
+		for(list<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+			if(it->hash == hash && it->data.size() == data.size()) {
+				/* Copy rather than swap, the device may already point to the
+				 * existing data. */
+				if(data.size()) {
+					memcpy(&data[0], &it->data[0], data.size());
+				}
+
+				total_size -= it->data.size();
+				entries.erase(it);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+protected:
+	struct Entry {
+		uint64_t hash;
+		DataVector data;
+	};
+
+	list<Entry> entries;
+	size_t total_size;
+	size_t max_size;
+};
+
 class DeviceServer {
 public:
 	thread_mutex rpc_lock;
@@ -325,8 +425,11 @@ public:
 
 	bool have_error() { return error_func.have_error(); }
 
-	DeviceServer(Device *device_, tcp::socket& socket_)
-	: device(device_), socket(socket_), stop(false), blocked_waiting(false)
+	DeviceServer(Device *device_, tcp::socket& socket_, ServerMemoryCache *mem_cache_)
+	: device(device_), socket(socket_),
+	  acquire_in_flight(0), acquire_done(false), release_acks(0),
+	  mem_cache(mem_cache_),
+	  stop(false), blocked_waiting(false), handshake_done(false)
 	{
 		error_func = NetworkError();
 	}
@@ -350,10 +453,39 @@ protected:
 
 		if(rcv.name == "stop")
 			stop = true;
+		else if(rcv.name == "hello")
+			protocol_handshake(rcv, lock);
+		else if(!handshake_done) {
+			/* Clients that don't send their protocol version first are too
+			 * old to talk to this server. */
+			cout << "Error: client did not send network protocol version\n";
+			stop = true;
+		}
 		else
 			process(rcv, lock);
 	}
 
+	void protocol_handshake(RPCReceive& rcv, thread_scoped_lock &lock)
+	{
+		int client_version;
+		rcv.read(client_version);
+
+		RPCSend snd(socket, &error_func, "hello");
+		snd.add(SERVER_PROTOCOL_VERSION);
+		snd.write();
+		lock.unlock();
+
+		if(client_version == SERVER_PROTOCOL_VERSION) {
+			handshake_done = true;
+		}
+		else {
+			cout << "Error: network protocol version " << client_version
+			     << " of client doesn't match version " << SERVER_PROTOCOL_VERSION
+			     << " of server\n";
+			stop = true;
+		}
+	}
+
 	/* create a memory buffer for a device buffer and insert it into mem_data */
 	DataVector &data_vector_insert(device_ptr client_pointer, size_t data_size)
 	{
@@ -453,28 +585,51 @@ protected:
 		else if(rcv.name == "mem_copy_to") {
 			string name;
 			network_device_memory mem(device);
+			uint64_t hash;
 			rcv.read(mem, name);
-			lock.unlock();
+			rcv.read(hash);
 
 			size_t data_size = mem.memory_size();
 			device_ptr client_pointer = mem.device_pointer;
+			DataVector *data_v;
 
 			if(client_pointer) {
 				/* Lookup existing host side data buffer. */
-				DataVector &data_v = data_vector_find(client_pointer);
-				mem.host_pointer = (void*)&data_v[0];
+				data_v = &data_vector_find(client_pointer);
+				mem.host_pointer = (void*)&(*data_v)[0];
 
 				/* Translate the client pointer to a real device pointer. */
 				mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 			}
 			else {
 				/* Allocate host side data buffer. */
-				DataVector &data_v = data_vector_insert(client_pointer, data_size);
-				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
+				data_v = &data_vector_insert(client_pointer, data_size);
+				mem.host_pointer = (data_size)? (void*)&(*data_v)[0]: 0;
+			}
+
+			/* Reply if the data is in the memory cache, so the client doesn't
+			 * need to send it. */
+			bool cached = false;
+
+			if(hash) {
+				cached = mem_cache->take(hash, *data_v);
+
+				RPCSend snd(socket, &error_func, "mem_copy_to");
+				snd.add(cached);
+				snd.write();
+
+				mem_hash[client_pointer] = hash;
+			}
+			else {
+				mem_hash.erase(client_pointer);
 			}
 
+			lock.unlock();
+
 			/* Copy data from network into memory buffer. */
-			rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
+			if(!cached) {
+				rcv.read_buffer((uint8_t*)mem.host_pointer, data_size);
+			}
 
 			/* Copy the data from the memory buffer to the device buffer. */
 			device->mem_copy_to(mem);
@@ -498,9 +653,12 @@ protected:
 			device_ptr client_pointer = mem.device_pointer;
 			mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 
+			/* Device may have modified the data, it no longer matches its hash. */
+			mem_hash.erase(client_pointer);
+
 			DataVector &data_v = data_vector_find(client_pointer);
 
-			mem.host_pointer = (device_ptr)&(data_v[0]);
+			mem.host_pointer = (void*)&(data_v[0]);
 
 			device->mem_copy_from(mem, y, w, h, elem);
 
@@ -531,11 +689,12 @@ protected:
 			else {
 				/* Allocate host side data buffer. */
 				DataVector &data_v = data_vector_insert(client_pointer, data_size);
-				mem.host_pointer = (void*)? (device_ptr)&(data_v[0]): 0;
+				mem.host_pointer = (data_size)? (void*)&(data_v[0]): 0;
 			}
 
 			/* Zero memory. */
 			device->mem_zero(mem);
+			mem_hash.erase(client_pointer);
 
 			if(!client_pointer) {
 				/* Store a mapping to/from client_pointer and real device pointer. */
@@ -551,9 +710,23 @@ protected:
 
 			device_ptr client_pointer = mem.device_pointer;
 
+			/* Keep data with known content in the memory cache. Swapping keeps
+			 * the data at the same address until the device freed it. */
+			DataVector cache_data;
+			map<device_ptr, uint64_t>::iterator hash_it = mem_hash.find(client_pointer);
+
+			if(hash_it != mem_hash.end()) {
+				cache_data.swap(data_vector_find(client_pointer));
+			}
+
 			mem.device_pointer = device_ptr_from_client_pointer_erase(client_pointer);
 
 			device->mem_free(mem);
+
+			if(hash_it != mem_hash.end()) {
+				mem_cache->insert(hash_it->second, cache_data);
+				mem_hash.erase(hash_it);
+			}
 		}
 		else if(rcv.name == "const_copy_to") {
 			string name_string;
@@ -571,7 +744,6 @@ protected:
 		else if(rcv.name == "load_kernels") {
 			DeviceRequestedFeatures requested_features;
 			rcv.read(requested_features.experimental);
-			rcv.read(requested_features.max_closure);
 			rcv.read(requested_features.max_nodes_group);
 			rcv.read(requested_features.nodes_features);
 
@@ -586,6 +758,13 @@ protected:
 			DeviceTask task;
 
 			rcv.read(task);
+
+			/* Drop replies to tile requests of the previous task that were
+			 * still in flight when it finished. */
+			acquire_queue.clear();
+			acquire_in_flight = 0;
+			acquire_done = false;
+			release_acks = 0;
 			lock.unlock();
 
 			if(task.buffer)
@@ -641,9 +820,7 @@ protected:
 			lock.unlock();
 		}
 		else if(rcv.name == "release_tile") {
-			AcquireEntry entry;
-			entry.name = rcv.name;
-			acquire_queue.push_back(entry);
+			release_acks++;
 			lock.unlock();
 		}
 		else {
@@ -652,25 +829,34 @@ protected:
 		}
 	}
 
+	void acquire_tile_request()
+	{
+		/* Request tiles ahead of the render threads, so that the next tile is
+		 * usually already received when a thread finishes its tile. Note that
+		 * the rpc lock must be acquired. */
+		while(!acquire_done && acquire_in_flight < SERVER_TILES_IN_FLIGHT) {
+			RPCSend snd(socket, &error_func, "acquire_tile");
+			snd.write();
+
+			acquire_in_flight++;
+		}
+	}
+
 	bool task_acquire_tile(Device *, RenderTile& tile)
 	{
 		thread_scoped_lock acquire_lock(acquire_mutex);
 
 		bool result = false;
 
-		RPCSend snd(socket, &error_func, "acquire_tile");
-		snd.write();
-
-		do {
-			if(blocked_waiting)
-				listen_step();
-
-			/* todo: avoid busy wait loop */
+		for(;;) {
 			thread_scoped_lock lock(rpc_lock);
 
+			acquire_tile_request();
+
 			if(!acquire_queue.empty()) {
 				AcquireEntry entry = acquire_queue.front();
 				acquire_queue.pop_front();
+				acquire_in_flight--;
 
 				if(entry.name == "acquire_tile") {
 					tile = entry.tile;
@@ -678,16 +864,28 @@ protected:
 					if(tile.buffer) tile.buffer = ptr_map[tile.buffer];
 
 					result = true;
+
+					/* Replace the tile that was just taken. */
+					acquire_tile_request();
 					break;
 				}
-				else if(entry.name == "acquire_tile_none") {
-					break;
-				}
-				else {
-					cout << "Error: unexpected acquire RPC receive call \"" + entry.name + "\"\n";
-				}
+
+				/* No more tiles are handed out, stop requesting new ones but
+				 * keep draining the replies still in flight, which may carry
+				 * tiles the client already assigned to this server. */
+				acquire_done = true;
+				continue;
 			}
-		} while(acquire_queue.empty() && !stop && !have_error());
+
+			if((acquire_done && acquire_in_flight == 0) || stop || have_error())
+				break;
+
+			lock.unlock();
+
+			/* todo: avoid busy wait loop */
+			if(blocked_waiting)
+				listen_step();
+		}
 
 		return result;
 	}
@@ -716,26 +914,23 @@ protected:
 			lock.unlock();
 		}
 
-		do {
-			if(blocked_waiting)
-				listen_step();
-
-			/* todo: avoid busy wait loop */
+		for(;;) {
 			thread_scoped_lock lock(rpc_lock);
 
-			if(!acquire_queue.empty()) {
-				AcquireEntry entry = acquire_queue.front();
-				acquire_queue.pop_front();
-
-				if(entry.name == "release_tile") {
-					lock.unlock();
-					break;
-				}
-				else {
-					cout << "Error: unexpected release RPC receive call \"" + entry.name + "\"\n";
-				}
+			if(release_acks > 0) {
+				release_acks--;
+				break;
 			}
-		} while(acquire_queue.empty() && !stop);
+
+			if(stop || have_error())
+				break;
+
+			lock.unlock();
+
+			/* todo: avoid busy wait loop */
+			if(blocked_waiting)
+				listen_step();
+		}
 	}
 
 	bool task_get_cancel()
@@ -759,9 +954,18 @@ protected:
 
 	thread_mutex acquire_mutex;
 	list<AcquireEntry> acquire_queue;
+	int acquire_in_flight;
+	bool acquire_done;
+	int release_acks;
+
+	/* memory cache shared between connections, and content hash of client
+	 * memory that may be kept in it when freed */
+	ServerMemoryCache *mem_cache;
+	map<device_ptr, uint64_t> mem_hash;
 
 	bool stop;
 	bool blocked_waiting;
+	bool handshake_done;
 private:
 	NetworkError error_func;
 
@@ -775,6 +979,10 @@ void Device::server_run()
 		/* starts thread that responds to discovery requests */
 		ServerDiscovery discovery;
 
+		/* memory cache is kept across connections, for rendering multiple
+		 * frames of the same scene */
+		ServerMemoryCache mem_cache(SERVER_MEMORY_CACHE_SIZE);
+
 		for(;;) {
 			/* accept connection */
 			boost::asio::io_service io_service;
@@ -786,7 +994,7 @@ void Device::server_run()
 			string remote_address = socket.remote_endpoint().address().to_string();
 			printf("Connected to remote client at: %s\n", remote_address.c_str());
 
-			DeviceServer server(this, socket);
+			DeviceServer server(this, socket, &mem_cache);
 			server.listen();
 
 			printf("Disconnected.\n");
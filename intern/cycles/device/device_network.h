@@ -33,6 +33,8 @@
 #include <sstream>
 #include <deque>
 
+#include <zlib.h>
+
 #include "render/buffers.h"
 
 #include "util/util_foreach.h"
@@ -40,6 +42,7 @@
 #include "util/util_map.h"
 #include "util/util_param.h"
 #include "util/util_string.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -55,6 +58,20 @@ static const int SERVER_PORT = 5120;
 static const int DISCOVER_PORT = 5121;
 static const string DISCOVER_REQUEST_MSG = "REQUEST_RENDER_SERVER_IP";
 static const string DISCOVER_REPLY_MSG = "REPLY_RENDER_SERVER_IP";
+/* Version of the calls between client and server, exchanged when connecting.
+ * Increase it whenever a call changes its arguments or replies. */
+static const int SERVER_PROTOCOL_VERSION = 1;
+
+/* Buffers are compressed in chunks of this size, in parallel. */
+static const size_t NETWORK_COMPRESS_CHUNK_SIZE = 4*1024*1024;
+/* Memory smaller than this is always sent, larger memory is first looked up
+ * by content hash in the memory cache of the server. */
+static const size_t NETWORK_CACHE_MIN_SIZE = 64*1024;
+/* Memory freed by clients that the server keeps around for later reuse. */
+static const size_t SERVER_MEMORY_CACHE_SIZE = (size_t)1024*1024*1024;
+/* Tiles the server requests ahead of its render threads, so that tiles are
+ * already available when a thread finishes rendering. */
+static const int SERVER_TILES_IN_FLIGHT = 4;
 
 #if 0
 typedef boost::archive::text_oarchive o_archive;
@@ -64,6 +81,94 @@ typedef boost::archive::binary_oarchive o_archive;
 typedef boost::archive::binary_iarchive i_archive;
 #endif
 
+/* Content hash of memory, to find data in the server memory cache. Zero is
+ * reserved for memory that is not cached. */
+
+static inline uint64_t network_hash_data(const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t*)data;
+	uint64_t h = 0xcbf29ce484222325ULL ^ size;
+	size_t i = 0;
+
+	for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t k;
+		memcpy(&k, bytes + i, sizeof(k));
+		h = (h ^ k) * 0x100000001b3ULL;
+		h ^= h >> 29;
+	}
+
+	for(; i < size; i++) {
+		h = (h ^ bytes[i]) * 0x100000001b3ULL;
+	}
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+
+	return (h)? h: 1;
+}
+
+/* Lossless compression of buffers, split in chunks that are compressed and
+ * decompressed in parallel. Chunks that don't get smaller are sent as is. */
+
+class NetworkCompressChunk {
+public:
+	NetworkCompressChunk()
+	: data(NULL), size(0), compressed_size(0), failed(false)
+	{
+	}
+
+	void compress()
+	{
+		uLongf dest_size = compressBound(size);
+		compressed.resize(dest_size);
+
+		if(::compress2(&compressed[0], &dest_size,
+		               (const Bytef*)data, size, Z_BEST_SPEED) == Z_OK &&
+		   dest_size < size)
+		{
+			compressed_size = dest_size;
+		}
+		else {
+			compressed_size = size;
+		}
+	}
+
+	void uncompress()
+	{
+		uLongf dest_size = size;
+
+		failed = (::uncompress((Bytef*)data, &dest_size,
+		                       &compressed[0], compressed_size) != Z_OK ||
+		          dest_size != size);
+	}
+
+	bool is_compressed() const
+	{
+		return compressed_size < size;
+	}
+
+	uint8_t *data;
+	size_t size;
+	size_t compressed_size;
+	vector<uint8_t> compressed;
+	bool failed;
+};
+
+static inline void network_compress_chunks_init(vector<NetworkCompressChunk>& chunks,
+                                                void *buffer,
+                                                size_t size)
+{
+	size_t num_chunks = (size + NETWORK_COMPRESS_CHUNK_SIZE - 1) / NETWORK_COMPRESS_CHUNK_SIZE;
+	chunks.resize(num_chunks);
+
+	for(size_t i = 0; i < num_chunks; i++) {
+		size_t offset = i * NETWORK_COMPRESS_CHUNK_SIZE;
+		chunks[i].data = (uint8_t*)buffer + offset;
+		chunks[i].size = (size - offset < NETWORK_COMPRESS_CHUNK_SIZE)? size - offset: NETWORK_COMPRESS_CHUNK_SIZE;
+	}
+}
+
 /* Serialization of device memory */
 
 class network_device_memory : public device_memory
@@ -190,12 +295,42 @@ public:
 	{
 		boost::system::error_code error;
 
-		boost::asio::write(socket,
-			boost::asio::buffer(buffer, size),
-			boost::asio::transfer_all(), error);
+		vector<NetworkCompressChunk> chunks;
+		network_compress_chunks_init(chunks, buffer, size);
 
-		if(error.value())
-			error_func->network_error(error.message());
+		TaskPool pool;
+		foreach(NetworkCompressChunk& chunk, chunks) {
+			pool.push(function_bind(&NetworkCompressChunk::compress, &chunk));
+		}
+		pool.wait_work();
+
+		foreach(NetworkCompressChunk& chunk, chunks) {
+			/* fixed size header with size of the chunk as sent */
+			ostringstream header_stream;
+			header_stream << setw(16) << hex << chunk.compressed_size;
+			string header_str = header_stream.str();
+
+			boost::asio::write(socket,
+				boost::asio::buffer(header_str),
+				boost::asio::transfer_all(), error);
+
+			if(error.value())
+				error_func->network_error(error.message());
+
+			if(chunk.is_compressed()) {
+				boost::asio::write(socket,
+					boost::asio::buffer(&chunk.compressed[0], chunk.compressed_size),
+					boost::asio::transfer_all(), error);
+			}
+			else {
+				boost::asio::write(socket,
+					boost::asio::buffer(chunk.data, chunk.size),
+					boost::asio::transfer_all(), error);
+			}
+
+			if(error.value())
+				error_func->network_error(error.message());
+		}
 	}
 
 protected:
@@ -294,14 +429,59 @@ public:
 	void read_buffer(void *buffer, size_t size)
 	{
 		boost::system::error_code error;
-		size_t len = boost::asio::read(socket, boost::asio::buffer(buffer, size), error);
 
-		if(error.value()) {
-			error_func->network_error(error.message());
+		vector<NetworkCompressChunk> chunks;
+		network_compress_chunks_init(chunks, buffer, size);
+
+		TaskPool pool;
+
+		foreach(NetworkCompressChunk& chunk, chunks) {
+			/* read chunk header with fixed size */
+			vector<char> header(16);
+			size_t len = boost::asio::read(socket, boost::asio::buffer(header), error);
+
+			if(error.value()) {
+				error_func->network_error(error.message());
+			}
+
+			string header_str(&header[0], header.size());
+			istringstream header_stream(header_str);
+
+			if(len != header.size() ||
+			   !(header_stream >> hex >> chunk.compressed_size) ||
+			   chunk.compressed_size > chunk.size)
+			{
+				error_func->network_error("Network receive error: invalid buffer chunk header");
+				break;
+			}
+
+			if(chunk.is_compressed()) {
+				chunk.compressed.resize(chunk.compressed_size);
+				len = boost::asio::read(socket,
+					boost::asio::buffer(&chunk.compressed[0], chunk.compressed_size), error);
+
+				pool.push(function_bind(&NetworkCompressChunk::uncompress, &chunk));
+			}
+			else {
+				len = boost::asio::read(socket, boost::asio::buffer(chunk.data, chunk.size), error);
+			}
+
+			if(error.value()) {
+				error_func->network_error(error.message());
+			}
+
+			if(len != chunk.compressed_size)
+				cout << "Network receive error: buffer size doesn't match expected size\n";
 		}
 
-		if(len != size)
-			cout << "Network receive error: buffer size doesn't match expected size\n";
+		pool.wait_work();
+
+		foreach(NetworkCompressChunk& chunk, chunks) {
+			if(chunk.failed) {
+				error_func->network_error("Network receive error: can't decompress buffer");
+				break;
+			}
+		}
 	}
 
 	void read(DeviceTask& task)
@@ -74,15 +74,25 @@ ccl_device_inline void triangle_vertices(KernelGlobals *kg, int prim, float3 P[3
 	P[2] = float4_to_float3(kernel_tex_fetch(__prim_tri_verts, tri_vindex.w+2));
 }
 
+/* Vertex normal, either stored as float or octahedral encoded */
+
+ccl_device_inline float3 triangle_vertex_normal(KernelGlobals *kg, uint vert)
+{
+	if(kernel_data.bvh.use_compact_normals) {
+		return octahedral_to_float3(kernel_tex_fetch(__tri_vnormal_oct, vert));
+	}
+	return float4_to_float3(kernel_tex_fetch(__tri_vnormal, vert));
+}
+
 /* Interpolate smooth vertex normal from vertices */
 
 ccl_device_inline float3 triangle_smooth_normal(KernelGlobals *kg, float3 Ng, int prim, float u, float v)
 {
 	/* load triangle vertices */
 	const uint4 tri_vindex = kernel_tex_fetch(__tri_vindex, prim);
-	float3 n0 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.x));
-	float3 n1 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.y));
-	float3 n2 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.z));
+	float3 n0 = triangle_vertex_normal(kg, tri_vindex.x);
+	float3 n1 = triangle_vertex_normal(kg, tri_vindex.y);
+	float3 n2 = triangle_vertex_normal(kg, tri_vindex.z);
 
 	float3 N = safe_normalize((1.0f - u - v)*n2 + u*n0 + v*n1);
 
@@ -149,20 +159,33 @@ ccl_device float triangle_attribute_float(KernelGlobals *kg, const ShaderData *s
 	}
 }
 
+/* Attribute value, either stored as float or half float */
+
+ccl_device_inline float3 triangle_attribute_fetch_float3(KernelGlobals *kg, const AttributeDescriptor desc, int index)
+{
+	if(desc.flags & ATTR_HALF_PRECISION) {
+		const ushort4 h = kernel_tex_fetch(__attributes_half3, desc.offset + index);
+		return make_float3(half_bits_to_float(h.x),
+		                   half_bits_to_float(h.y),
+		                   half_bits_to_float(h.z));
+	}
+	return float4_to_float3(kernel_tex_fetch(__attributes_float3, desc.offset + index));
+}
+
 ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData *sd, const AttributeDescriptor desc, float3 *dx, float3 *dy)
 {
 	if(desc.element == ATTR_ELEMENT_FACE) {
 		if(dx) *dx = make_float3(0.0f, 0.0f, 0.0f);
 		if(dy) *dy = make_float3(0.0f, 0.0f, 0.0f);
 
-		return float4_to_float3(kernel_tex_fetch(__attributes_float3, desc.offset + sd->prim));
+		return triangle_attribute_fetch_float3(kg, desc, sd->prim);
 	}
 	else if(desc.element == ATTR_ELEMENT_VERTEX || desc.element == ATTR_ELEMENT_VERTEX_MOTION) {
 		uint4 tri_vindex = kernel_tex_fetch(__tri_vindex, sd->prim);
 
-		float3 f0 = float4_to_float3(kernel_tex_fetch(__attributes_float3, desc.offset + tri_vindex.x));
-		float3 f1 = float4_to_float3(kernel_tex_fetch(__attributes_float3, desc.offset + tri_vindex.y));
-		float3 f2 = float4_to_float3(kernel_tex_fetch(__attributes_float3, desc.offset + tri_vindex.z));
+		float3 f0 = triangle_attribute_fetch_float3(kg, desc, tri_vindex.x);
+		float3 f1 = triangle_attribute_fetch_float3(kg, desc, tri_vindex.y);
+		float3 f2 = triangle_attribute_fetch_float3(kg, desc, tri_vindex.z);
 
 #ifdef __RAY_DIFFERENTIALS__
 		if(dx) *dx = sd->du.dx*f0 + sd->dv.dx*f1 - (sd->du.dx + sd->dv.dx)*f2;
@@ -176,9 +199,10 @@ ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData
 		float3 f0, f1, f2;
 
 		if(desc.element == ATTR_ELEMENT_CORNER) {
-			f0 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 0));
-			f1 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 1));
-			f2 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 2));
+			int corner = sd->prim*3;
+			f0 = triangle_attribute_fetch_float3(kg, desc, corner + 0);
+			f1 = triangle_attribute_fetch_float3(kg, desc, corner + 1);
+			f2 = triangle_attribute_fetch_float3(kg, desc, corner + 2);
 		}
 		else {
 			f0 = color_byte_to_float(kernel_tex_fetch(__attributes_uchar4, tri + 0));
@@ -73,15 +73,9 @@ ccl_device void kernel_film_convert_to_half_float(KernelGlobals *kg,
 	ccl_global float4 *in = (ccl_global float4*)(buffer + index*kernel_data.film.pass_stride);
 	ccl_global half *out = (ccl_global half*)rgba + index*4;
 
+	/* Exposure only applies to the color, do it without branching. */
 	float exposure = kernel_data.film.exposure;
-
-	float4 rgba_in = *in;
-
-	if(exposure != 1.0f) {
-		rgba_in.x *= exposure;
-		rgba_in.y *= exposure;
-		rgba_in.z *= exposure;
-	}
+	float4 rgba_in = *in * make_float4(exposure, exposure, exposure, 1.0f);
 
 	float4_store_half(out, rgba_in, sample_scale);
 }
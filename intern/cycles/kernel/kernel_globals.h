@@ -45,10 +45,19 @@ struct OSLThreadData;
 struct OSLShadingSystem;
 #  endif
 
-typedef unordered_map<float, float> CoverageMap;
+/* Per-pixel coverage for accurate Cryptomatte, a fixed number of (ID, weight)
+ * slots kept sorted by decreasing weight. When all slots are used, the
+ * lightest ID is merged into the leftover weight. */
+typedef struct CoverageMap {
+	float2 *slots;
+	int num_slots;
+	int capacity;
+	float leftover;
+} CoverageMap;
 
 struct Intersection;
 struct VolumeStep;
+struct PathBatchRay;
 
 typedef struct KernelGlobals {
 #  define KERNEL_TEX(type, name) texture<type> name;
@@ -73,6 +82,9 @@ typedef struct KernelGlobals {
 	VolumeStep *decoupled_volume_steps[2];
 	int decoupled_volume_steps_index;
 
+	/* Storage for the camera rays of batched path tracing. */
+	PathBatchRay *path_batch;
+
 	/* A buffer for storing per-pixel coverage for Cryptomatte. */
 	CoverageMap *coverage_object;
 	CoverageMap *coverage_material;
@@ -192,11 +192,48 @@ ccl_device_inline void kernel_write_debug_passes(KernelGlobals *kg,
 #endif  /* __KERNEL_DEBUG__ */
 
 #ifdef __KERNEL_CPU__
+ccl_device_inline void kernel_coverage_add(CoverageMap *map, float id, float weight)
+{
+	float2 *slots = map->slots;
+	int slot = 0;
+
+	while(slot < map->num_slots && slots[slot].x != id) {
+		slot++;
+	}
+
+	if(slot == map->num_slots) {
+		if(map->num_slots < map->capacity) {
+			/* New ID, add it at the end. */
+			slots[map->num_slots++] = make_float2(id, 0.0f);
+		}
+		else {
+			/* No free slot left, the lightest ID is in the last slot. */
+			slot = map->num_slots - 1;
+			if(slots[slot].y >= weight) {
+				map->leftover += weight;
+				return;
+			}
+			map->leftover += slots[slot].y;
+			slots[slot] = make_float2(id, 0.0f);
+		}
+	}
+
+	slots[slot].y += weight;
+
+	/* Only one weight changed, so a few swaps restore the order. */
+	while(slot > 0 && slots[slot].y > slots[slot - 1].y) {
+		float2 swap = slots[slot];
+		slots[slot] = slots[slot - 1];
+		slots[slot - 1] = swap;
+		slot--;
+	}
+}
+
 #define WRITE_ID_SLOT(buffer, depth, id, matte_weight, name) kernel_write_id_pass_cpu(buffer, depth * 2, id, matte_weight, kg->coverage_##name)
 ccl_device_inline size_t kernel_write_id_pass_cpu(float *buffer, size_t depth, float id, float matte_weight, CoverageMap *map)
 {
 	if(map) {
-		(*map)[id] += matte_weight;
+		kernel_coverage_add(map, id, matte_weight);
 		return 0;
 	}
 #else  /* __KERNEL_CPU__ */
@@ -433,4 +470,23 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg,
 #endif
 }
 
+/* Time spent on a sample of a pixel, measured by devices that can time
+ * individual samples. */
+ccl_device_inline void kernel_write_sample_cost(KernelGlobals *kg,
+                                                ccl_global float *buffer,
+                                                int x, int y,
+                                                int offset,
+                                                int stride,
+                                                float cost)
+{
+	if(!(kernel_data.film.pass_flag & PASSMASK(SAMPLE_COST))) {
+		return;
+	}
+
+	int index = offset + x + y*stride;
+	buffer += index*kernel_data.film.pass_stride;
+
+	kernel_write_pass_float(buffer + kernel_data.film.pass_sample_cost, cost);
+}
+
 CCL_NAMESPACE_END
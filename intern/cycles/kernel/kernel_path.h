@@ -576,7 +576,8 @@ ccl_device_forceinline void kernel_path_integrate(
 	Ray *ray,
 	PathRadiance *L,
 	ccl_global float *buffer,
-	ShaderData *emission_sd)
+	ShaderData *emission_sd,
+	const Intersection *first_isect)
 {
 	PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
 
@@ -592,9 +593,18 @@ ccl_device_forceinline void kernel_path_integrate(
 
 	/* path iteration */
 	for(;;) {
-		/* Find intersection with objects in scene. */
+		/* Find intersection with objects in scene, unless the caller
+		 * already traced the first ray. */
 		Intersection isect;
-		bool hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		bool hit;
+		if(first_isect != NULL) {
+			isect = *first_isect;
+			hit = (isect.prim != PRIM_NONE);
+			first_isect = NULL;
+		}
+		else {
+			hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+		}
 
 		/* Find intersection with lamps and compute emission for MIS. */
 		kernel_path_lamp_emission(kg, state, ray, throughput, &isect, &sd, L);
@@ -768,7 +778,8 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	                      &ray,
 	                      &L,
 	                      buffer,
-	                      emission_sd);
+	                      emission_sd,
+	                      NULL);
 
 	kernel_write_result(kg, buffer, sample, &L);
 }
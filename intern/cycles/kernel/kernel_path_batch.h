@@ -0,0 +1,161 @@
+/*
+ * Copyright 2011-2019 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Batched path tracing for the CPU.
+ *
+ * Instead of tracing one pixel's path from start to end before moving on to
+ * the next pixel, the camera rays of a block of pixels are generated and
+ * intersected first, in Morton order so consecutive rays walk through the same
+ * BVH nodes while they are still in cache. The paths are then continued grouped
+ * by the shader their camera ray hit, so pixels seeing the same material run
+ * the same shader program back to back.
+ *
+ * The result is identical to kernel_path_trace(), only the order in which the
+ * work is done changes.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+#ifdef __KERNEL_CPU__
+
+typedef struct PathBatchRay {
+	Ray ray;
+	PathState state;
+	Intersection isect;
+	int x, y;
+	/* Shader of the camera ray hit, used as sort key. */
+	int shader;
+} PathBatchRay;
+
+ccl_device_inline void path_batch_morton_decode(int i, int *x, int *y)
+{
+	*x = 0;
+	*y = 0;
+	for(int bit = 0; bit < PATH_BATCH_WIDTH_LOG2; bit++) {
+		*x |= ((i >> (2*bit)) & 1) << bit;
+		*y |= ((i >> (2*bit + 1)) & 1) << bit;
+	}
+}
+
+ccl_device_inline int path_batch_isect_shader(KernelGlobals *kg,
+                                              const Intersection *isect)
+{
+	if(isect->prim == PRIM_NONE) {
+		return kernel_data.background.surface_shader & SHADER_MASK;
+	}
+
+	int prim = kernel_tex_fetch(__prim_index, isect->prim);
+	int shader;
+
+#ifdef __HAIR__
+	if(isect->type & PRIMITIVE_ALL_CURVE) {
+		float4 str = kernel_tex_fetch(__curves, prim);
+		shader = __float_as_int(str.z);
+	}
+	else
+#endif
+	{
+		shader = kernel_tex_fetch(__tri_shader, prim);
+	}
+
+	return shader & SHADER_MASK;
+}
+
+ccl_device void kernel_path_trace_batch(KernelGlobals *kg,
+	ccl_global float *buffer,
+	int sample, int x, int y, int w, int h, int offset, int stride)
+{
+	kernel_assert(w <= PATH_BATCH_WIDTH && h <= PATH_BATCH_WIDTH);
+
+	PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
+	if(kg->path_batch == NULL) {
+		kg->path_batch = (PathBatchRay*)malloc(sizeof(PathBatchRay)*PATH_BATCH_SIZE);
+	}
+
+	PathBatchRay *batch = kg->path_batch;
+	int order[PATH_BATCH_SIZE];
+	int num_rays = 0;
+
+	ShaderDataTinyStorage emission_sd_storage;
+	ShaderData *emission_sd = AS_SHADER_DATA(&emission_sd_storage);
+
+	/* Generate and intersect all camera rays of the block. */
+	for(int i = 0; i < PATH_BATCH_SIZE; i++) {
+		int px, py;
+		path_batch_morton_decode(i, &px, &py);
+
+		if(px >= w || py >= h) {
+			continue;
+		}
+
+		PathBatchRay *bray = &batch[num_rays];
+		bray->x = x + px;
+		bray->y = y + py;
+
+		uint rng_hash;
+		kernel_path_trace_setup(kg, sample, bray->x, bray->y, &rng_hash, &bray->ray);
+
+		if(bray->ray.t == 0.0f) {
+			continue;
+		}
+
+		path_state_init(kg, emission_sd, &bray->state, rng_hash, sample, &bray->ray);
+
+		/* Radiance is only needed for debug counters, and debug builds use
+		 * the regular path tracing kernel. */
+		if(!kernel_path_scene_intersect(kg, &bray->state, &bray->ray, &bray->isect, NULL)) {
+			bray->isect.prim = PRIM_NONE;
+		}
+		bray->shader = path_batch_isect_shader(kg, &bray->isect);
+
+		/* Stable insertion sort by shader, keeping Morton order for pixels
+		 * with the same shader. */
+		int j = num_rays;
+		while(j > 0 && batch[order[j - 1]].shader > bray->shader) {
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = num_rays;
+		num_rays++;
+	}
+
+	/* Continue the paths. */
+	const int pass_stride = kernel_data.film.pass_stride;
+
+	for(int i = 0; i < num_rays; i++) {
+		PathBatchRay *bray = &batch[order[i]];
+		ccl_global float *pixel_buffer = buffer + (offset + bray->x + bray->y*stride)*pass_stride;
+
+		PathRadiance L;
+		path_radiance_init(&L, kernel_data.film.use_light_pass);
+
+		kernel_path_integrate(kg,
+		                      &bray->state,
+		                      make_float3(1.0f, 1.0f, 1.0f),
+		                      &bray->ray,
+		                      &L,
+		                      pixel_buffer,
+		                      emission_sd,
+		                      &bray->isect);
+
+		kernel_write_result(kg, pixel_buffer, sample, &L);
+	}
+}
+
+#endif  /* __KERNEL_CPU__ */
+
+CCL_NAMESPACE_END
@@ -42,6 +42,7 @@ KERNEL_TEX(DecomposedTransform, __camera_motion)
 /* triangles */
 KERNEL_TEX(uint, __tri_shader)
 KERNEL_TEX(float4, __tri_vnormal)
+KERNEL_TEX(uint, __tri_vnormal_oct)
 KERNEL_TEX(uint4, __tri_vindex)
 KERNEL_TEX(uint, __tri_patch)
 KERNEL_TEX(float2, __tri_patch_uv)
@@ -58,6 +59,7 @@ KERNEL_TEX(uint4, __attributes_map)
 KERNEL_TEX(float, __attributes_float)
 KERNEL_TEX(float4, __attributes_float3)
 KERNEL_TEX(uchar4, __attributes_uchar4)
+KERNEL_TEX(ushort4, __attributes_half3)
 
 /* lights */
 KERNEL_TEX(KernelLightDistribution, __light_distribution)
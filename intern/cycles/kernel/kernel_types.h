@@ -63,6 +63,11 @@ CCL_NAMESPACE_BEGIN
 
 #define VOLUME_STACK_SIZE		32
 
+/* Batched CPU path tracing block size */
+#define PATH_BATCH_WIDTH_LOG2	3
+#define PATH_BATCH_WIDTH		(1 << PATH_BATCH_WIDTH_LOG2)
+#define PATH_BATCH_SIZE			(PATH_BATCH_WIDTH * PATH_BATCH_WIDTH)
+
 /* Split kernel constants */
 #define WORK_POOL_SIZE_GPU 64
 #define WORK_POOL_SIZE_CPU 1
@@ -422,6 +427,7 @@ typedef enum PassType {
 	PASS_RAY_BOUNCES,
 #endif
 	PASS_RENDER_TIME,
+	PASS_SAMPLE_COST,
 	PASS_CRYPTOMATTE,
 	PASS_CATEGORY_MAIN_END = 31,
 
@@ -828,6 +834,8 @@ typedef enum AttributeStandard {
 typedef enum AttributeFlag {
 	ATTR_FINAL_SIZE = (1 << 0),
 	ATTR_SUBDIVIDED = (1 << 1),
+	/* Data is stored as half floats in __attributes_half3. */
+	ATTR_HALF_PRECISION = (1 << 2),
 } AttributeFlag;
 
 typedef struct AttributeDescriptor {
@@ -1291,6 +1299,8 @@ typedef struct KernelFilm {
 	int pass_denoising_data;
 	int pass_denoising_clean;
 	int denoising_flags;
+	int pass_sample_cost;
+	int pad1, pad2, pad3;
 
 	/* XYZ to rendering color space transform. float4 instead of float3 to
 	 * ensure consistent padding/alignment across devices. */
@@ -1389,13 +1399,14 @@ typedef struct KernelIntegrator {
 	int use_volumes;
 	int volume_max_steps;
 	float volume_step_size;
+	int volume_step_max_scale;
 	int volume_samples;
 
 	int start_sample;
 
 	int max_closures;
 
-	int pad1, pad2, pad3;
+	int pad1, pad2;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1419,6 +1430,10 @@ typedef struct KernelBVH {
 	int bvh_layout;
 	int use_bvh_steps;
 
+	/* Vertex normals are stored octahedral encoded in __tri_vnormal_oct. */
+	int use_compact_normals;
+	int pad3, pad4, pad5;
+
 	/* Embree */
 #ifdef __EMBREE__
 	RTCScene scene;
@@ -174,6 +174,17 @@ ccl_device_inline void kernel_volume_step_init(KernelGlobals *kg,
 	*step_offset = path_state_rng_1D_hash(kg, state, 0x1e31d8a4) * step;
 }
 
+/* Empty space skipping: after a step where the shader has no volume closures
+ * the following step is made twice as long, up to volume_step_max_scale times
+ * the initial step size. Any step with closures goes back to the initial size.
+ */
+ccl_device_inline int kernel_volume_step_scale_next(KernelGlobals *kg,
+                                                    int step_scale,
+                                                    bool is_empty)
+{
+	return (is_empty)? min(step_scale * 2, kernel_data.integrator.volume_step_max_scale): 1;
+}
+
 /* Volume Shadows
  *
  * These functions are used to attenuate shadow rays to lights. Both absorption
@@ -211,24 +222,27 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg,
 
 	/* compute extinction at the start */
 	float t = 0.0f;
+	int step_index = 0, step_scale = 1;
 
 	float3 sum = make_float3(0.0f, 0.0f, 0.0f);
 
 	for(int i = 0; i < max_steps; i++) {
 		/* advance to new position */
-		float new_t = min(ray->t, (i+1) * step_size);
+		float new_t = min(ray->t, (step_index + step_scale) * step_size);
 
 		/* use random position inside this segment to sample shader, adjust
 		 * for last step that is shorter than other steps. */
+		float offset = step_offset * step_scale;
 		if(new_t == ray->t) {
-			step_offset *= (new_t - t) / step_size;
+			offset *= (new_t - t) / (step_scale * step_size);
 		}
 
-		float3 new_P = ray->P + ray->D * (t + step_offset);
+		float3 new_P = ray->P + ray->D * (t + offset);
 		float3 sigma_t;
 
 		/* compute attenuation over segment */
-		if(volume_shader_extinction_sample(kg, sd, state, new_P, &sigma_t)) {
+		bool is_empty = !volume_shader_extinction_sample(kg, sd, state, new_P, &sigma_t);
+		if(!is_empty) {
 			/* Compute expf() only for every Nth step, to save some calculations
 			 * because exp(a)*exp(b) = exp(a+b), also do a quick tp_eps check then. */
 
@@ -249,6 +263,9 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg,
 			tp = *throughput * exp3(sum);
 			break;
 		}
+
+		step_index += step_scale;
+		step_scale = kernel_volume_step_scale_next(kg, step_scale, is_empty);
 	}
 
 	*throughput = tp;
@@ -535,23 +552,26 @@ ccl_device VolumeIntegrateResult kernel_volume_integrate_heterogeneous_distance(
 	float xi = path_state_rng_1D(kg, state, PRNG_SCATTER_DISTANCE);
 	float rphase = path_state_rng_1D(kg, state, PRNG_PHASE_CHANNEL);
 	bool has_scatter = false;
+	int step_index = 0, step_scale = 1;
 
 	for(int i = 0; i < max_steps; i++) {
 		/* advance to new position */
-		float new_t = min(ray->t, (i+1) * step_size);
+		float new_t = min(ray->t, (step_index + step_scale) * step_size);
 		float dt = new_t - t;
 
 		/* use random position inside this segment to sample shader,
 		* for last shorter step we remap it to fit within the segment. */
+		float offset = step_offset * step_scale;
 		if(new_t == ray->t) {
-			step_offset *= (new_t - t) / step_size;
+			offset *= (new_t - t) / (step_scale * step_size);
 		}
 
-		float3 new_P = ray->P + ray->D * (t + step_offset);
+		float3 new_P = ray->P + ray->D * (t + offset);
 		VolumeShaderCoefficients coeff;
 
 		/* compute segment */
-		if(volume_shader_sample(kg, sd, state, new_P, &coeff)) {
+		bool is_empty = !volume_shader_sample(kg, sd, state, new_P, &coeff);
+		if(!is_empty) {
 			int closure_flag = sd->flag;
 			float3 new_tp;
 			float3 transmittance;
@@ -639,6 +659,9 @@ ccl_device VolumeIntegrateResult kernel_volume_integrate_heterogeneous_distance(
 		t = new_t;
 		if(t == ray->t)
 			break;
+
+		step_index += step_scale;
+		step_scale = kernel_volume_step_scale_next(kg, step_scale, is_empty);
 	}
 
 	*throughput = tp;
@@ -764,23 +787,26 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg, PathState *sta
 	bool is_last_step_empty = false;
 
 	VolumeStep *step = segment->steps;
+	int step_index = 0, step_scale = 1;
 
 	for(int i = 0; i < max_steps; i++, step++) {
 		/* advance to new position */
-		float new_t = min(ray->t, (i+1) * step_size);
+		float new_t = min(ray->t, (step_index + step_scale) * step_size);
 		float dt = new_t - t;
 
 		/* use random position inside this segment to sample shader,
 		* for last shorter step we remap it to fit within the segment. */
+		float offset = step_offset * step_scale;
 		if(new_t == ray->t) {
-			step_offset *= (new_t - t) / step_size;
+			offset *= (new_t - t) / (step_scale * step_size);
 		}
 
-		float3 new_P = ray->P + ray->D * (t + step_offset);
+		float3 new_P = ray->P + ray->D * (t + offset);
 		VolumeShaderCoefficients coeff;
 
 		/* compute segment */
-		if(volume_shader_sample(kg, sd, state, new_P, &coeff)) {
+		bool is_empty = !volume_shader_sample(kg, sd, state, new_P, &coeff);
+		if(!is_empty) {
 			int closure_flag = sd->flag;
 			float3 sigma_t = coeff.sigma_t;
 
@@ -833,7 +859,7 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg, PathState *sta
 		step->accum_transmittance = accum_transmittance;
 		step->cdf_distance = cdf_distance;
 		step->t = new_t;
-		step->shade_t = t + step_offset;
+		step->shade_t = t + offset;
 
 		/* stop if at the end of the volume */
 		t = new_t;
@@ -843,6 +869,9 @@ ccl_device void kernel_volume_decoupled_record(KernelGlobals *kg, PathState *sta
 		/* stop if nearly all light blocked */
 		if(accum_transmittance.x < tp_eps && accum_transmittance.y < tp_eps && accum_transmittance.z < tp_eps)
 			break;
+
+		step_index += step_scale;
+		step_scale = kernel_volume_step_scale_next(kg, step_scale, is_empty);
 	}
 
 	/* store total emission and transmittance */
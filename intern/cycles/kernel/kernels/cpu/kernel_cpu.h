@@ -23,6 +23,14 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
                                            int offset,
                                            int stride);
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_batch)(KernelGlobals *kg,
+                                                 float *buffer,
+                                                 int sample,
+                                                 int x, int y,
+                                                 int w, int h,
+                                                 int offset,
+                                                 int stride);
+
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
                                                 uchar4 *rgba,
                                                 float *buffer,
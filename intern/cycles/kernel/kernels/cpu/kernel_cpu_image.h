@@ -484,6 +484,156 @@ template<typename T> struct TextureInterpolator  {
 #undef SET_CUBIC_SPLINE_WEIGHTS
 };
 
+/* Sparse 3D textures, see util_texture.h for the storage layout.
+ *
+ * Coordinates are wrapped the same way as for dense textures, after which
+ * voxels are looked up through the tile offsets. Voxels in empty tiles are
+ * zero without touching any voxel data.
+ */
+template<typename T> struct SparseTextureInterpolator {
+	typedef TextureInterpolator<T> Dense;
+
+	static ccl_always_inline float4 read(const TextureInfo& info,
+	                                     int x, int y, int z)
+	{
+		const int tiles_x = tex_sparse_num_tiles((int)info.width);
+		const int tiles_y = tex_sparse_num_tiles((int)info.height);
+		const int tile = (x >> TEX_SPARSE_TILE_SHIFT) +
+		                 tiles_x*((y >> TEX_SPARSE_TILE_SHIFT) +
+		                          tiles_y*(z >> TEX_SPARSE_TILE_SHIFT));
+		const int offset = ((const int*)info.data)[tile];
+
+		if(offset == TEX_SPARSE_TILE_EMPTY) {
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		const int local = (x & TEX_SPARSE_TILE_MASK) +
+		                  TEX_SPARSE_TILE_SIZE*((y & TEX_SPARSE_TILE_MASK) +
+		                                        TEX_SPARSE_TILE_SIZE*(z & TEX_SPARSE_TILE_MASK));
+		const T *data = (const T*)info.data;
+		return Dense::read(data[offset + local]);
+	}
+
+	static ccl_always_inline int wrap(int x, int size, uint extension)
+	{
+		return (extension == EXTENSION_REPEAT)? Dense::wrap_periodic(x, size):
+		                                        Dense::wrap_clamp(x, size);
+	}
+
+	static ccl_always_inline float4 interp_3d_closest(const TextureInfo& info,
+	                                                  float x, float y, float z)
+	{
+		int ix, iy, iz;
+		Dense::frac(x*(float)info.width, &ix);
+		Dense::frac(y*(float)info.height, &iy);
+		Dense::frac(z*(float)info.depth, &iz);
+
+		return read(info,
+		            wrap(ix, info.width, info.extension),
+		            wrap(iy, info.height, info.extension),
+		            wrap(iz, info.depth, info.extension));
+	}
+
+	static ccl_always_inline float4 interp_3d_linear(const TextureInfo& info,
+	                                                 float x, float y, float z)
+	{
+		int ix, iy, iz;
+		const float tx = Dense::frac(x*(float)info.width - 0.5f, &ix);
+		const float ty = Dense::frac(y*(float)info.height - 0.5f, &iy);
+		const float tz = Dense::frac(z*(float)info.depth - 0.5f, &iz);
+
+		const int x0 = wrap(ix, info.width, info.extension);
+		const int y0 = wrap(iy, info.height, info.extension);
+		const int z0 = wrap(iz, info.depth, info.extension);
+		const int x1 = wrap(ix+1, info.width, info.extension);
+		const int y1 = wrap(iy+1, info.height, info.extension);
+		const int z1 = wrap(iz+1, info.depth, info.extension);
+
+		float4 r;
+		r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read(info, x0, y0, z0);
+		r += (1.0f - tz)*(1.0f - ty)*tx*read(info, x1, y0, z0);
+		r += (1.0f - tz)*ty*(1.0f - tx)*read(info, x0, y1, z0);
+		r += (1.0f - tz)*ty*tx*read(info, x1, y1, z0);
+
+		r += tz*(1.0f - ty)*(1.0f - tx)*read(info, x0, y0, z1);
+		r += tz*(1.0f - ty)*tx*read(info, x1, y0, z1);
+		r += tz*ty*(1.0f - tx)*read(info, x0, y1, z1);
+		r += tz*ty*tx*read(info, x1, y1, z1);
+
+		return r;
+	}
+
+	/* Same b-spline weights as SET_CUBIC_SPLINE_WEIGHTS. */
+	static ccl_always_inline void cubic_spline_weights(float u[4], float t)
+	{
+		u[0] = (((-1.0f/6.0f)* t + 0.5f) * t - 0.5f) * t + (1.0f/6.0f);
+		u[1] =  ((      0.5f * t - 1.0f) * t       ) * t + (2.0f/3.0f);
+		u[2] =  ((     -0.5f * t + 0.5f) * t + 0.5f) * t + (1.0f/6.0f);
+		u[3] = (1.0f / 6.0f) * t * t * t;
+	}
+
+	static ccl_never_inline float4 interp_3d_tricubic(const TextureInfo& info,
+	                                                  float x, float y, float z)
+	{
+		int ix, iy, iz;
+		const float tx = Dense::frac(x*(float)info.width - 0.5f, &ix);
+		const float ty = Dense::frac(y*(float)info.height - 0.5f, &iy);
+		const float tz = Dense::frac(z*(float)info.depth - 0.5f, &iz);
+
+		int xc[4], yc[4], zc[4];
+		for(int i = 0; i < 4; i++) {
+			xc[i] = wrap(ix + i - 1, info.width, info.extension);
+			yc[i] = wrap(iy + i - 1, info.height, info.extension);
+			zc[i] = wrap(iz + i - 1, info.depth, info.extension);
+		}
+
+		float u[4], v[4], w[4];
+		cubic_spline_weights(u, tx);
+		cubic_spline_weights(v, ty);
+		cubic_spline_weights(w, tz);
+
+		float4 r = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		for(int k = 0; k < 4; k++) {
+			float4 plane = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+			for(int j = 0; j < 4; j++) {
+				float4 row = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+				for(int i = 0; i < 4; i++) {
+					row += u[i] * read(info, xc[i], yc[j], zc[k]);
+				}
+				plane += v[j] * row;
+			}
+			r += w[k] * plane;
+		}
+
+		return r;
+	}
+
+	static ccl_always_inline float4 interp_3d(const TextureInfo& info,
+	                                          float x, float y, float z,
+	                                          InterpolationType interp)
+	{
+		if(UNLIKELY(!info.data))
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		if(info.extension == EXTENSION_CLIP) {
+			if(x < 0.0f || y < 0.0f || z < 0.0f ||
+			   x > 1.0f || y > 1.0f || z > 1.0f)
+			{
+				return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+			}
+		}
+
+		switch((interp == INTERPOLATION_NONE)? info.interpolation: interp) {
+			case INTERPOLATION_CLOSEST:
+				return interp_3d_closest(info, x, y, z);
+			case INTERPOLATION_LINEAR:
+				return interp_3d_linear(info, x, y, z);
+			default:
+				return interp_3d_tricubic(info, x, y, z);
+		}
+	}
+};
+
 ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, float y)
 {
 	const TextureInfo& info = kernel_tex_fetch(__texture_info, id);
@@ -532,6 +682,10 @@ ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg, int id, float x,
 			return TextureInterpolator<ushort4>::interp_3d(info, x, y, z, interp);
 		case IMAGE_DATA_TYPE_FLOAT4:
 			return TextureInterpolator<float4>::interp_3d(info, x, y, z, interp);
+		case IMAGE_DATA_TYPE_SPARSE_FLOAT:
+			return SparseTextureInterpolator<float>::interp_3d(info, x, y, z, interp);
+		case IMAGE_DATA_TYPE_SPARSE_FLOAT4:
+			return SparseTextureInterpolator<float4>::interp_3d(info, x, y, z, interp);
 		default:
 			assert(0);
 			return make_float4(TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
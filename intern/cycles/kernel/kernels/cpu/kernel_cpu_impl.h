@@ -35,7 +35,10 @@
 #    include "kernel/kernel_film.h"
 #    include "kernel/kernel_path.h"
 #    include "kernel/kernel_path_branched.h"
+#    include "kernel/kernel_path_batch.h"
 #    include "kernel/kernel_bake.h"
+
+#    include "util/util_time.h"
 #  else
 #    include "kernel/split/kernel_split_common.h"
 
@@ -83,6 +86,9 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 #ifdef KERNEL_STUB
 	STUB_ASSERT(KERNEL_ARCH, path_trace);
 #else
+	const bool use_sample_cost = (kernel_data.film.pass_flag & PASSMASK(SAMPLE_COST)) != 0;
+	const double start_time = (use_sample_cost)? time_dt(): 0.0;
+
 #  ifdef __BRANCHED_PATH__
 	if(kernel_data.integrator.branched) {
 		kernel_branched_path_trace(kg,
@@ -97,6 +103,42 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 	{
 		kernel_path_trace(kg, buffer, sample, x, y, offset, stride);
 	}
+
+	if(use_sample_cost) {
+		/* In microseconds. */
+		float cost = (float)((time_dt() - start_time) * 1e6);
+		kernel_write_sample_cost(kg, buffer, x, y, offset, stride, cost);
+	}
+#endif  /* KERNEL_STUB */
+}
+
+void KERNEL_FUNCTION_FULL_NAME(path_trace_batch)(KernelGlobals *kg,
+                                                 float *buffer,
+                                                 int sample,
+                                                 int x, int y,
+                                                 int w, int h,
+                                                 int offset,
+                                                 int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, path_trace_batch);
+#else
+#  ifndef __KERNEL_DEBUG__
+	/* Branched path tracing, per-pixel timing and debug counters are only
+	 * supported by the regular kernel. */
+	const bool use_batch = !kernel_data.integrator.branched &&
+	                       !(kernel_data.film.pass_flag & PASSMASK(SAMPLE_COST));
+	if(use_batch) {
+		kernel_path_trace_batch(kg, buffer, sample, x, y, w, h, offset, stride);
+		return;
+	}
+#  endif
+
+	for(int py = y; py < y + h; py++) {
+		for(int px = x; px < x + w; px++) {
+			KERNEL_FUNCTION_FULL_NAME(path_trace)(kg, buffer, sample, px, py, offset, stride);
+		}
+	}
 #endif  /* KERNEL_STUB */
 }
 
@@ -25,9 +25,25 @@ ccl_device void svm_node_math(KernelGlobals *kg, ShaderData *sd, float *stack, u
 	float f2 = stack_load_float(stack, f2_offset);
 	float f = svm_math(type, f1, f2);
 
-	uint4 node1 = read_node(kg, offset);
+	/* Chained math nodes are evaluated in the same instruction, the
+	 * intermediate results are not stored on the stack. */
+	while(1) {
+		uint4 node1 = read_node(kg, offset);
+
+		if(node1.y & NODE_MATH_FLAG_CLAMP)
+			f = saturate(f);
+		if(stack_valid(node1.x))
+			stack_store_float(stack, node1.x, f);
+		if(!(node1.y & NODE_MATH_FLAG_CHAIN))
+			break;
+
+		float g = (node1.y & NODE_MATH_FLAG_CONSTANT)? __uint_as_float(node1.w): stack_load_float(stack, node1.w);
 
-	stack_store_float(stack, node1.y, f);
+		if(node1.y & NODE_MATH_FLAG_SWAP)
+			f = svm_math((NodeMath)node1.z, g, f);
+		else
+			f = svm_math((NodeMath)node1.z, f, g);
+	}
 }
 
 ccl_device void svm_node_vector_math(KernelGlobals *kg, ShaderData *sd, float *stack, uint itype, uint v1_offset, uint v2_offset, int *offset)
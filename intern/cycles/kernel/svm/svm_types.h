@@ -268,6 +268,17 @@ typedef enum NodeMath {
 	NODE_MATH_CLAMP /* used for the clamp UI option */
 } NodeMath;
 
+/* Flags of the result of a math node, which may be followed by another
+ * math operation in the same instruction. */
+typedef enum NodeMathFlag {
+	NODE_MATH_FLAG_CLAMP = (1 << 0),
+	NODE_MATH_FLAG_CHAIN = (1 << 1),
+	/* The chained value is the second operand of the next operation. */
+	NODE_MATH_FLAG_SWAP = (1 << 2),
+	/* The other operand is a constant rather than a stack offset. */
+	NODE_MATH_FLAG_CONSTANT = (1 << 3),
+} NodeMathFlag;
+
 typedef enum NodeVectorMath {
 	NODE_VECTOR_MATH_ADD,
 	NODE_VECTOR_MATH_SUBTRACT,
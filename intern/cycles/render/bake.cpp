@@ -20,7 +20,9 @@
 #include "render/shader.h"
 #include "render/integrator.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -100,9 +102,62 @@ uint4 BakeData::differentials(int i)
 		  );
 }
 
+BakeJob::BakeJob(BakeData *bake_data, ShaderEvalType shader_type, const int pass_filter, float *result)
+: bake_data(bake_data), shader_type(shader_type), pass_filter(pass_filter), result(result)
+{
+}
+
+/* Range of valid pixels of one job, at some offset in the packed stream of
+ * shader evaluations. */
+struct BakeManager::Segment {
+	const BakeJob *job;
+	const int *pixels;
+	size_t num_pixels;
+	size_t stream_offset;
+};
+
+/* Orders jobs so those that can share shader evaluations are adjacent. */
+struct BakeJobCompare {
+	BakeJobCompare(const vector<BakeJob>& jobs, const vector<int>& num_samples)
+	: jobs(jobs), num_samples(num_samples) {}
+
+	bool operator()(const int a, const int b) const
+	{
+		if(jobs[a].shader_type != jobs[b].shader_type)
+			return jobs[a].shader_type < jobs[b].shader_type;
+		if(jobs[a].pass_filter != jobs[b].pass_filter)
+			return jobs[a].pass_filter < jobs[b].pass_filter;
+		return num_samples[a] < num_samples[b];
+	}
+
+	const vector<BakeJob>& jobs;
+	const vector<int>& num_samples;
+};
+
+static void bake_fill_input(const BakeJob *job, const int *pixels, size_t num_pixels, uint4 *input)
+{
+	for(size_t i = 0; i < num_pixels; i++) {
+		input[i*2 + 0] = job->bake_data->data(pixels[i]);
+		input[i*2 + 1] = job->bake_data->differentials(pixels[i]);
+	}
+}
+
+static void bake_read_output(const BakeJob *job, const int *pixels, size_t num_pixels, const float4 *output)
+{
+	const size_t depth = 4;
+
+	for(size_t i = 0; i < num_pixels; i++) {
+		float *result = job->result + pixels[i] * depth;
+		float4 out = output[i];
+
+		for(size_t j = 0; j < depth; j++) {
+			result[j] = out[j];
+		}
+	}
+}
+
 BakeManager::BakeManager()
 {
-	m_bake_data = NULL;
 	m_is_baking = false;
 	need_update = true;
 	m_shader_limit = 512 * 512;
@@ -110,8 +165,8 @@ BakeManager::BakeManager()
 
 BakeManager::~BakeManager()
 {
-	if(m_bake_data)
-		delete m_bake_data;
+	foreach(BakeData *bake_data, m_bake_data)
+		delete bake_data;
 }
 
 bool BakeManager::get_baking()
@@ -126,8 +181,18 @@ void BakeManager::set_baking(const bool value)
 
 BakeData *BakeManager::init(const int object, const size_t tri_offset, const size_t num_pixels)
 {
-	m_bake_data = new BakeData(object, tri_offset, num_pixels);
-	return m_bake_data;
+	foreach(BakeData *bake_data, m_bake_data)
+		delete bake_data;
+	m_bake_data.clear();
+
+	return add(object, tri_offset, num_pixels);
+}
+
+BakeData *BakeManager::add(const int object, const size_t tri_offset, const size_t num_pixels)
+{
+	BakeData *bake_data = new BakeData(object, tri_offset, num_pixels);
+	m_bake_data.push_back(bake_data);
+	return bake_data;
 }
 
 void BakeManager::set_shader_limit(const size_t x, const size_t y)
@@ -138,96 +203,184 @@ void BakeManager::set_shader_limit(const size_t x, const size_t y)
 
 bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, ShaderEvalType shader_type, const int pass_filter, BakeData *bake_data, float result[])
 {
-	size_t num_pixels = bake_data->size();
+	vector<BakeJob> jobs;
+	jobs.push_back(BakeJob(bake_data, shader_type, pass_filter, result));
 
-	int num_samples = aa_samples(scene, bake_data, shader_type);
+	return bake(device, dscene, scene, progress, jobs);
+}
+
+bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, const vector<BakeJob>& jobs)
+{
+	const size_t num_jobs = jobs.size();
+
+	/* gather the valid pixels of every job, only those are evaluated */
+	vector<int> num_samples(num_jobs);
+	vector<vector<int> > valid_pixels(num_jobs);
+	vector<int> order(num_jobs);
 
-	/* calculate the total pixel samples for the progress bar */
 	total_pixel_samples = 0;
-	for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
-		size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
-		total_pixel_samples += shader_size * num_samples;
+
+	for(size_t i = 0; i < num_jobs; i++) {
+		BakeData *bake_data = jobs[i].bake_data;
+
+		for(size_t j = 0; j < bake_data->size(); j++) {
+			if(bake_data->is_valid(j)) {
+				valid_pixels[i].push_back(j);
+			}
+		}
+
+		num_samples[i] = aa_samples(scene, bake_data, jobs[i].shader_type);
+		total_pixel_samples += valid_pixels[i].size() * num_samples[i];
+		order[i] = i;
 	}
+
+	/* calculate the total pixel samples for the progress bar */
 	progress.reset_sample();
 	progress.set_total_pixel_samples(total_pixel_samples);
 
-	/* needs to be up to date for baking specific AA samples */
-	dscene->data.integrator.aa_samples = num_samples;
-	device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
-
-	for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
-		size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
-
-		/* setup input for device task */
-		device_vector<uint4> d_input(device, "bake_input", MEM_READ_ONLY);
-		uint4 *d_input_data = d_input.alloc(shader_size * 2);
-		size_t d_input_size = 0;
+	std::stable_sort(order.begin(), order.end(), BakeJobCompare(jobs, num_samples));
 
-		for(size_t i = shader_offset; i < (shader_offset + shader_size); i++) {
-			d_input_data[d_input_size++] = bake_data->data(i);
-			d_input_data[d_input_size++] = bake_data->differentials(i);
-		}
+	size_t group_begin = 0;
 
-		if(d_input_size == 0) {
-			m_is_baking = false;
-			return false;
-		}
+	while(group_begin < num_jobs) {
+		const BakeJob& first = jobs[order[group_begin]];
+		const int group_samples = num_samples[order[group_begin]];
 
-		/* run device task */
-		device_vector<float4> d_output(device, "bake_output", MEM_READ_WRITE);
-		d_output.alloc(shader_size);
-		d_output.zero_to_device();
-		d_input.copy_to_device();
-
-		DeviceTask task(DeviceTask::SHADER);
-		task.shader_input = d_input.device_pointer;
-		task.shader_output = d_output.device_pointer;
-		task.shader_eval_type = shader_type;
-		task.shader_filter = pass_filter;
-		task.shader_x = 0;
-		task.offset = shader_offset;
-		task.shader_w = d_output.size();
-		task.num_samples = num_samples;
-		task.get_cancel = function_bind(&Progress::get_cancel, &progress);
-		task.update_progress_sample = function_bind(&Progress::add_samples_update, &progress, _1, _2);
-
-		device->task_add(task);
-		device->task_wait();
-
-		if(progress.get_cancel()) {
-			d_input.free();
-			d_output.free();
-			m_is_baking = false;
-			return false;
+		size_t group_end = group_begin + 1;
+		while(group_end < num_jobs &&
+		      jobs[order[group_end]].shader_type == first.shader_type &&
+		      jobs[order[group_end]].pass_filter == first.pass_filter &&
+		      num_samples[order[group_end]] == group_samples)
+		{
+			group_end++;
 		}
 
-		d_output.copy_from_device(0, 1, d_output.size());
-		d_input.free();
+		/* needs to be up to date for baking specific AA samples */
+		dscene->data.integrator.aa_samples = group_samples;
+		device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+
+		/* split the packed pixels of the group into shader evaluations of
+		 * up to the shader limit, spanning as many jobs as fit */
+		size_t job = group_begin, pixel = 0;
+		size_t shader_offset = 0;
+
+		while(job < group_end) {
+			vector<Segment> segments;
+			size_t shader_size = 0;
+
+			while(job < group_end && shader_size < m_shader_limit) {
+				const vector<int>& pixels = valid_pixels[order[job]];
+				size_t remaining = pixels.size() - pixel;
+				size_t num_pixels = (remaining < m_shader_limit - shader_size)? remaining: m_shader_limit - shader_size;
+
+				if(num_pixels > 0) {
+					Segment segment;
+					segment.job = &jobs[order[job]];
+					segment.pixels = &pixels[pixel];
+					segment.num_pixels = num_pixels;
+					segment.stream_offset = shader_size;
+					segments.push_back(segment);
+				}
 
-		/* read result */
-		int k = 0;
+				shader_size += num_pixels;
+				pixel += num_pixels;
 
-		float4 *offset = d_output.data();
+				if(pixel == pixels.size()) {
+					job++;
+					pixel = 0;
+				}
+			}
 
-		size_t depth = 4;
-		for(size_t i=shader_offset; i < (shader_offset + shader_size); i++) {
-			size_t index = i * depth;
-			float4 out = offset[k++];
+			if(shader_size == 0) {
+				break;
+			}
 
-			if(bake_data->is_valid(i)) {
-				for(size_t j=0; j < 4; j++) {
-					result[index + j] = out[j];
-				}
+			if(!bake_segments(device, progress, first.shader_type, first.pass_filter,
+			                  group_samples, shader_offset, shader_size, segments))
+			{
+				m_is_baking = false;
+				return false;
 			}
+
+			shader_offset += shader_size;
 		}
 
-		d_output.free();
+		group_begin = group_end;
 	}
 
 	m_is_baking = false;
 	return true;
 }
 
+bool BakeManager::bake_segments(Device *device, Progress& progress,
+                                ShaderEvalType shader_type, const int pass_filter,
+                                const int num_samples, const size_t shader_offset,
+                                const size_t shader_size, const vector<Segment>& segments)
+{
+	TaskPool pool;
+
+	/* setup input for device task */
+	device_vector<uint4> d_input(device, "bake_input", MEM_READ_ONLY);
+	uint4 *d_input_data = d_input.alloc(shader_size * 2);
+
+	foreach(const Segment& segment, segments) {
+		pool.push(function_bind(&bake_fill_input,
+		                        segment.job,
+		                        segment.pixels,
+		                        segment.num_pixels,
+		                        d_input_data + segment.stream_offset * 2));
+	}
+
+	pool.wait_work();
+
+	/* run device task */
+	device_vector<float4> d_output(device, "bake_output", MEM_READ_WRITE);
+	d_output.alloc(shader_size);
+	d_output.zero_to_device();
+	d_input.copy_to_device();
+
+	DeviceTask task(DeviceTask::SHADER);
+	task.shader_input = d_input.device_pointer;
+	task.shader_output = d_output.device_pointer;
+	task.shader_eval_type = shader_type;
+	task.shader_filter = pass_filter;
+	task.shader_x = 0;
+	task.offset = shader_offset;
+	task.shader_w = d_output.size();
+	task.num_samples = num_samples;
+	task.get_cancel = function_bind(&Progress::get_cancel, &progress);
+	task.update_progress_sample = function_bind(&Progress::add_samples_update, &progress, _1, _2);
+
+	device->task_add(task);
+	device->task_wait();
+
+	if(progress.get_cancel()) {
+		d_input.free();
+		d_output.free();
+		return false;
+	}
+
+	d_output.copy_from_device(0, 1, d_output.size());
+	d_input.free();
+
+	/* read result */
+	const float4 *output = d_output.data();
+
+	foreach(const Segment& segment, segments) {
+		pool.push(function_bind(&bake_read_output,
+		                        segment.job,
+		                        segment.pixels,
+		                        segment.num_pixels,
+		                        output + segment.stream_offset));
+	}
+
+	pool.wait_work();
+
+	d_output.free();
+
+	return true;
+}
+
 void BakeManager::device_update(Device * /*device*/,
                                 DeviceScene * /*dscene*/,
                                 Scene * /*scene*/,
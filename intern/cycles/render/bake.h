@@ -51,6 +51,17 @@ private:
 	vector<float>m_dvdy;
 };
 
+/* Object and pass to bake as part of a batch. */
+class BakeJob {
+public:
+	BakeJob(BakeData *bake_data, ShaderEvalType shader_type, const int pass_filter, float *result);
+
+	BakeData *bake_data;
+	ShaderEvalType shader_type;
+	int pass_filter;
+	float *result;
+};
+
 class BakeManager {
 public:
 	BakeManager();
@@ -60,11 +71,19 @@ public:
 	void set_baking(const bool value);
 
 	BakeData *init(const int object, const size_t tri_offset, const size_t num_pixels);
+	/* Add bake data for another object in the same batch as init(). */
+	BakeData *add(const int object, const size_t tri_offset, const size_t num_pixels);
 
 	void set_shader_limit(const size_t x, const size_t y);
 
 	bool bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, ShaderEvalType shader_type, const int pass_filter, BakeData *bake_data, float result[]);
 
+	/* Bake many objects and passes at once, sharing the scene update. Jobs
+	 * with the same shader type, pass filter and number of samples are
+	 * packed into a single stream of shader evaluations, which only contains
+	 * the valid pixels of each object. */
+	bool bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, const vector<BakeJob>& jobs);
+
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_free(Device *device, DeviceScene *dscene);
 
@@ -76,7 +95,14 @@ public:
 	size_t total_pixel_samples;
 
 private:
-	BakeData *m_bake_data;
+	struct Segment;
+
+	bool bake_segments(Device *device, Progress& progress,
+	                   ShaderEvalType shader_type, const int pass_filter,
+	                   const int num_samples, const size_t shader_offset,
+	                   const size_t shader_size, const vector<Segment>& segments);
+
+	vector<BakeData*> m_bake_data;
 	bool m_is_baking;
 	size_t m_shader_limit;
 };
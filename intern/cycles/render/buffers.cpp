@@ -42,6 +42,7 @@ BufferParams::BufferParams()
 
 	denoising_data_pass = false;
 	denoising_clean_pass = false;
+	use_half_precision_passes = false;
 
 	Pass::add(PASS_COMBINED, passes);
 }
@@ -88,6 +89,24 @@ int BufferParams::get_denoising_offset()
 	return offset;
 }
 
+void BufferParams::get_half_precision_channels(vector<bool>& channels)
+{
+	/* Denoising data and the padding at the end of a pixel stay in float. */
+	channels.clear();
+	channels.resize(get_passes_size(), false);
+
+	if(!use_half_precision_passes)
+		return;
+
+	int offset = 0;
+
+	for(size_t i = 0; i < passes.size(); i++) {
+		for(int j = 0; j < passes[i].components; j++)
+			channels[offset + j] = passes[i].half_precision;
+		offset += passes[i].components;
+	}
+}
+
 /* Render Buffer Task */
 
 RenderTile::RenderTile()
@@ -105,6 +124,8 @@ RenderTile::RenderTile()
 	offset = 0;
 	stride = 0;
 
+	numa_node = -1;
+
 	buffer = 0;
 
 	buffers = NULL;
@@ -114,7 +135,8 @@ RenderTile::RenderTile()
 
 RenderBuffers::RenderBuffers(Device *device)
 : buffer(device, "RenderBuffers", MEM_READ_WRITE),
-  map_neighbor_copied(false), render_time(0.0f)
+  map_neighbor_copied(false), render_time(0.0f), neighbor_users(0),
+  compacted(false), compacted_sample(0)
 {
 }
 
@@ -127,6 +149,10 @@ void RenderBuffers::reset(BufferParams& params_)
 {
 	params = params_;
 
+	compacted = false;
+	compact_float.clear();
+	compact_half.clear();
+
 	/* re-allocate buffer */
 	buffer.alloc(params.width*params.height*params.get_passes_size());
 	buffer.zero_to_device();
@@ -147,6 +173,82 @@ bool RenderBuffers::copy_from_device()
 	return true;
 }
 
+bool RenderBuffers::compact(int sample)
+{
+	if(compacted || neighbor_users > 0 || !params.use_half_precision_passes)
+		return false;
+
+	vector<bool> half_channels;
+	params.get_half_precision_channels(half_channels);
+
+	int pass_stride = params.get_passes_size();
+	int num_half = 0;
+	for(int i = 0; i < pass_stride; i++)
+		num_half += half_channels[i];
+	int num_float = pass_stride - num_half;
+
+	/* Nothing to gain when all passes stay in float. */
+	if(num_half == 0 || !copy_from_device())
+		return false;
+
+	size_t size = (size_t)params.width*params.height;
+	float *in = buffer.data();
+	float *out_float = compact_float.resize(size*num_float);
+	half *out_half = compact_half.resize(size*num_half);
+
+	/* Filtered passes are accumulated over all samples, normalize them to
+	 * keep the values inside the range of half floats. */
+	float invsample = 1.0f/max(sample, 1);
+
+	for(size_t i = 0; i < size; i++, in += pass_stride) {
+		for(int j = 0; j < pass_stride; j++) {
+			if(half_channels[j])
+				*(out_half++) = float_to_half(in[j]*invsample);
+			else
+				*(out_float++) = in[j];
+		}
+	}
+
+	buffer.free();
+
+	compacted = true;
+	compacted_sample = sample;
+
+	return true;
+}
+
+void RenderBuffers::expand()
+{
+	if(!compacted)
+		return;
+
+	vector<bool> half_channels;
+	params.get_half_precision_channels(half_channels);
+
+	int pass_stride = params.get_passes_size();
+	size_t size = (size_t)params.width*params.height;
+	float *out = buffer.alloc(size*pass_stride);
+	float *in_float = compact_float.data();
+	half *in_half = compact_half.data();
+
+	float sample = (float)max(compacted_sample, 1);
+
+	for(size_t i = 0; i < size; i++, out += pass_stride) {
+		for(int j = 0; j < pass_stride; j++) {
+			if(half_channels[j])
+				out[j] = half_bits_to_float(*(in_half++))*sample;
+			else
+				out[j] = *(in_float++);
+		}
+	}
+
+	buffer.copy_to_device();
+
+	compacted = false;
+	compact_float.clear();
+	compact_half.clear();
+}
+
 bool RenderBuffers::get_denoising_pass_rect(int type, float exposure, int sample, int components, float *pixels)
 {
 	if(buffer.data() == NULL) {
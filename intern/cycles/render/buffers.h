@@ -23,6 +23,7 @@
 
 #include "kernel/kernel_types.h"
 
+#include "util/util_array.h"
 #include "util/util_half.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -54,6 +55,9 @@ public:
 	bool denoising_data_pass;
 	/* If only some light path types should be denoised, an additional pass is needed. */
 	bool denoising_clean_pass;
+	/* Store passes marked as half precision in half float when the buffers
+	 * of a finished tile are compacted. */
+	bool use_half_precision_passes;
 
 	/* functions */
 	BufferParams();
@@ -63,6 +67,7 @@ public:
 	void add_pass(PassType type);
 	int get_passes_size();
 	int get_denoising_offset();
+	void get_half_precision_channels(vector<bool>& channels);
 };
 
 /* Render Buffers */
@@ -76,6 +81,8 @@ public:
 	device_vector<float> buffer;
 	bool map_neighbor_copied;
 	double render_time;
+	/* Number of denoising tasks currently using the buffers as a neighbor. */
+	int neighbor_users;
 
 	explicit RenderBuffers(Device *device);
 	~RenderBuffers();
@@ -83,9 +90,24 @@ public:
 	void reset(BufferParams& params);
 	void zero();
 
+	/* Tiles that finished rendering but are kept for denoising their
+	 * neighbors are compacted: the device buffer is freed and its contents
+	 * kept on the host, with half precision passes stored as half floats
+	 * normalized by the number of samples. Expanding restores the float
+	 * buffer on the device. */
+	bool compact(int sample);
+	void expand();
+	bool is_compacted() { return compacted; }
+
 	bool copy_from_device();
 	bool get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels, const string &name);
 	bool get_denoising_pass_rect(int offset, float exposure, int sample, int components, float *pixels);
+
+protected:
+	bool compacted;
+	int compacted_sample;
+	array<float> compact_float;
+	array<half> compact_half;
 };
 
 /* Display Buffer
@@ -136,6 +158,11 @@ public:
 	int stride;
 	int tile_index;
 
+	/* NUMA node of the thread acquiring the tile, set by the device before
+	 * acquiring so the tile manager can hand out tiles of that node.
+	 * -1 if unknown. */
+	int numa_node;
+
 	device_ptr buffer;
 	int device_size;
 
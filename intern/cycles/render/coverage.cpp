@@ -20,13 +20,10 @@
 #include "kernel/kernel_globals.h"
 #include "kernel/kernel_id_passes.h"
 #include "kernel/kernel_types.h"
-#include "util/util_map.h"
 #include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
-static bool crypomatte_comp(const pair<float, float>& i, const pair<float, float> j) { return i.first > j.first; }
-
 void Coverage::finalize()
 {
 	int pass_offset = 0;
@@ -49,20 +46,35 @@ void Coverage::init_path_trace()
 
 	if(kernel_data.film.cryptomatte_passes & CRYPT_ACCURATE) {
 		if(kernel_data.film.cryptomatte_passes & CRYPT_OBJECT) {
-			coverage_object.clear();
-			coverage_object.resize(tile.w * tile.h);
+			init_buffer(coverage_object, slots_object);
 		}
 		if(kernel_data.film.cryptomatte_passes & CRYPT_MATERIAL) {
-			coverage_material.clear();
-			coverage_material.resize(tile.w * tile.h);
+			init_buffer(coverage_material, slots_material);
 		}
 		if(kernel_data.film.cryptomatte_passes & CRYPT_ASSET) {
-			coverage_asset.clear();
-			coverage_asset.resize(tile.w * tile.h);
+			init_buffer(coverage_asset, slots_asset);
 		}
 	}
 }
 
+void Coverage::init_buffer(vector<CoverageMap> &coverage, vector<float2> &slots)
+{
+	/* Keep more IDs than can be written, so the ones that end up in the
+	 * output are accurate even when a pixel covers many IDs. */
+	const int num_pixels = tile.w * tile.h;
+	const int capacity = 2 * (2 * kernel_data.film.cryptomatte_depth);
+
+	coverage.resize(num_pixels);
+	slots.resize(num_pixels * capacity);
+
+	for(int i = 0; i < num_pixels; i++) {
+		coverage[i].slots = &slots[i * capacity];
+		coverage[i].num_slots = 0;
+		coverage[i].capacity = capacity;
+		coverage[i].leftover = 0.0f;
+	}
+}
+
 void Coverage::init_pixel(int x, int y)
 {
 	if(kernel_data.film.cryptomatte_passes & CRYPT_ACCURATE) {
@@ -91,34 +103,30 @@ void Coverage::finalize_buffer(vector<CoverageMap> & coverage, const int pass_of
 
 void Coverage::flatten_buffer(vector<CoverageMap> &coverage, const int pass_offset)
 {
-	/* Sort the coverage map and write it to the output */
+	/* Write the coverage, which is already sorted, to the output */
 	int pixel_index = 0;
 	int pass_stride = tile.buffers->params.get_passes_size();
+	int num_slots = 2 * (kernel_data.film.cryptomatte_depth);
 	for(int y = 0; y < tile.h; ++y) {
 		for(int x = 0; x < tile.w; ++x) {
 			const CoverageMap& pixel = coverage[pixel_index];
-			if(!pixel.empty()) {
+			if(pixel.num_slots > 0) {
 				/* buffer offset */
 				int index = x + y * tile.stride;
 				float *buffer = (float*)tile.buffer + index*pass_stride;
 
-				/* sort the cryptomatte pixel */
-				vector<pair<float, float> > sorted_pixel;
-				for(CoverageMap::const_iterator it = pixel.begin(); it != pixel.end(); ++it) {
-					sorted_pixel.push_back(std::make_pair(it->second, it->first));
+				/* the weight of IDs that don't fit goes to the last slot */
+				int limit = min(num_slots, pixel.num_slots);
+				float leftover = pixel.leftover;
+				for(int i = limit; i < pixel.num_slots; ++i) {
+					leftover += pixel.slots[i].y;
 				}
-				sort(sorted_pixel.begin(), sorted_pixel.end(), crypomatte_comp);
-				int num_slots = 2 * (kernel_data.film.cryptomatte_depth);
-				if(sorted_pixel.size() > num_slots) {
-					float leftover = 0.0f;
-					for(vector<pair<float, float> >::iterator it = sorted_pixel.begin()+num_slots; it != sorted_pixel.end(); ++it) {
-						leftover += it->first;
-					}
-					sorted_pixel[num_slots-1].first += leftover;
-				}
-				int limit = min(num_slots, sorted_pixel.size());
 				for(int i = 0; i < limit; ++i) {
-					kernel_write_id_slots(buffer + kernel_data.film.pass_cryptomatte + pass_offset, 2 * (kernel_data.film.cryptomatte_depth), sorted_pixel[i].second, sorted_pixel[i].first);
+					float weight = pixel.slots[i].y;
+					if(i == limit - 1) {
+						weight += leftover;
+					}
+					kernel_write_id_slots(buffer + kernel_data.film.pass_cryptomatte + pass_offset, num_slots, pixel.slots[i].x, weight);
 				}
 			}
 			++pixel_index;
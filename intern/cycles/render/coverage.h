@@ -18,7 +18,6 @@
 #include "kernel/kernel_compat_cpu.h"
 #include "kernel/split/kernel_split_data.h"
 #include "kernel/kernel_globals.h"
-#include "util/util_map.h"
 #include "util/util_vector.h"
 
 #ifndef __COVERAGE_H__
@@ -36,8 +35,13 @@ private:
 	vector<CoverageMap>coverage_object;
 	vector<CoverageMap>coverage_material;
 	vector<CoverageMap>coverage_asset;
+	/* Slots of all pixels, allocated once per tile. */
+	vector<float2>slots_object;
+	vector<float2>slots_material;
+	vector<float2>slots_asset;
 	KernelGlobals *kg;
 	RenderTile &tile;
+	void init_buffer(vector<CoverageMap>&coverage, vector<float2>&slots);
 	void finalize_buffer(vector<CoverageMap>&coverage, const int pass_offset);
 	void flatten_buffer(vector<CoverageMap>&coverage, const int pass_offset);
 	void sort_buffer(const int pass_offset);
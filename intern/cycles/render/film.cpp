@@ -52,6 +52,7 @@ void Pass::add(PassType type, vector<Pass>& passes, const char *name)
 	pass.type = type;
 	pass.filter = true;
 	pass.exposure = false;
+	pass.half_precision = false;
 	pass.divide_type = PASS_NONE;
 	if(name) {
 		pass.name = name;
@@ -71,19 +72,24 @@ void Pass::add(PassType type, vector<Pass>& passes, const char *name)
 			break;
 		case PASS_MIST:
 			pass.components = 1;
+			pass.half_precision = true;
 			break;
 		case PASS_NORMAL:
 			pass.components = 4;
+			pass.half_precision = true;
 			break;
 		case PASS_UV:
 			pass.components = 4;
+			pass.half_precision = true;
 			break;
 		case PASS_MOTION:
 			pass.components = 4;
+			pass.half_precision = true;
 			pass.divide_type = PASS_MOTION_WEIGHT;
 			break;
 		case PASS_MOTION_WEIGHT:
 			pass.components = 1;
+			pass.half_precision = true;
 			break;
 		case PASS_OBJECT_ID:
 		case PASS_MATERIAL_ID:
@@ -95,13 +101,16 @@ void Pass::add(PassType type, vector<Pass>& passes, const char *name)
 		case PASS_BACKGROUND:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_precision = true;
 			break;
 		case PASS_AO:
 			pass.components = 4;
+			pass.half_precision = true;
 			break;
 		case PASS_SHADOW:
 			pass.components = 4;
 			pass.exposure = false;
+			pass.half_precision = true;
 			break;
 		case PASS_LIGHT:
 			/* This isn't a real pass, used by baking to see whether
@@ -125,41 +134,51 @@ void Pass::add(PassType type, vector<Pass>& passes, const char *name)
 			/* This pass is handled entirely on the host side. */
 			pass.components = 0;
 			break;
+		case PASS_SAMPLE_COST:
+			pass.components = 1;
+			pass.exposure = false;
+			break;
 
 		case PASS_DIFFUSE_COLOR:
 		case PASS_GLOSSY_COLOR:
 		case PASS_TRANSMISSION_COLOR:
 		case PASS_SUBSURFACE_COLOR:
 			pass.components = 4;
+			pass.half_precision = true;
 			break;
 		case PASS_DIFFUSE_DIRECT:
 		case PASS_DIFFUSE_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_precision = true;
 			pass.divide_type = PASS_DIFFUSE_COLOR;
 			break;
 		case PASS_GLOSSY_DIRECT:
 		case PASS_GLOSSY_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_precision = true;
 			pass.divide_type = PASS_GLOSSY_COLOR;
 			break;
 		case PASS_TRANSMISSION_DIRECT:
 		case PASS_TRANSMISSION_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_precision = true;
 			pass.divide_type = PASS_TRANSMISSION_COLOR;
 			break;
 		case PASS_SUBSURFACE_DIRECT:
 		case PASS_SUBSURFACE_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_precision = true;
 			pass.divide_type = PASS_SUBSURFACE_COLOR;
 			break;
 		case PASS_VOLUME_DIRECT:
 		case PASS_VOLUME_INDIRECT:
 			pass.components = 4;
 			pass.exposure = true;
+			pass.half_precision = true;
 			break;
 		case PASS_CRYPTOMATTE:
 			pass.components = 4;
@@ -445,6 +464,9 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 #endif
 			case PASS_RENDER_TIME:
 				break;
+			case PASS_SAMPLE_COST:
+				kfilm->pass_sample_cost = kfilm->pass_stride;
+				break;
 			case PASS_CRYPTOMATTE:
 				kfilm->pass_cryptomatte = have_cryptomatte ? min(kfilm->pass_cryptomatte, kfilm->pass_stride) : kfilm->pass_stride;
 				have_cryptomatte = true;
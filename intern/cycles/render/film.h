@@ -44,6 +44,10 @@ public:
 	int components;
 	bool filter;
 	bool exposure;
+	/* Auxiliary passes that can be stored as half float while the render
+	 * buffers of a finished tile are kept around on the host. Accumulation
+	 * in the kernels always happens in full float. */
+	bool half_precision;
 	PassType divide_type;
 	string name;
 
@@ -48,7 +48,7 @@ bool isfinite(uint16_t  /*value*/)
 	return true;
 }
 
-/* The lower three bits of a device texture slot number indicate its type.
+/* The lower four bits of a device texture slot number indicate its type.
  * These functions convert the slot ids from ImageManager "images" ones
  * to device ones and vice verse.
  */
@@ -74,6 +74,8 @@ const char* name_from_type(ImageDataType type)
 		case IMAGE_DATA_TYPE_HALF: return "half";
 		case IMAGE_DATA_TYPE_USHORT4: return "ushort4";
 		case IMAGE_DATA_TYPE_USHORT: return "ushort";
+		case IMAGE_DATA_TYPE_SPARSE_FLOAT4: return "sparse_float4";
+		case IMAGE_DATA_TYPE_SPARSE_FLOAT: return "sparse_float";
 		case IMAGE_DATA_NUM_TYPES:
 			assert(!"System enumerator type, should never be used");
 			return "";
@@ -82,6 +84,109 @@ const char* name_from_type(ImageDataType type)
 	return "";
 }
 
+bool voxel_is_zero(float value)
+{
+	return value == 0.0f;
+}
+
+bool voxel_is_zero(float4 value)
+{
+	return value.x == 0.0f && value.y == 0.0f && value.z == 0.0f && value.w == 0.0f;
+}
+
+/* Convert a dense 3D texture to sparse tiles, see util_texture.h for the
+ * storage layout. Dimensions of the texture are kept unchanged.
+ */
+template<typename T>
+void image_make_sparse(device_vector<T>& tex_img)
+{
+	const size_t width = tex_img.data_width;
+	const size_t height = max(tex_img.data_height, (size_t)1);
+	const size_t depth = max(tex_img.data_depth, (size_t)1);
+	const size_t tiles_x = tex_sparse_num_tiles(width);
+	const size_t tiles_y = tex_sparse_num_tiles(height);
+	const size_t tiles_z = tex_sparse_num_tiles(depth);
+	const size_t num_tiles = tiles_x*tiles_y*tiles_z;
+	const size_t header_size = divide_up(num_tiles*sizeof(int), sizeof(T));
+	const T *pixels = tex_img.data();
+
+	/* Find tiles with non-zero voxels. */
+	vector<int> offsets(num_tiles, TEX_SPARSE_TILE_EMPTY);
+	size_t num_active_tiles = 0;
+
+	for(size_t tz = 0, tile = 0; tz < tiles_z; tz++) {
+		for(size_t ty = 0; ty < tiles_y; ty++) {
+			for(size_t tx = 0; tx < tiles_x; tx++, tile++) {
+				const size_t x_end = min((tx + 1)*TEX_SPARSE_TILE_SIZE, width);
+				const size_t y_end = min((ty + 1)*TEX_SPARSE_TILE_SIZE, height);
+				const size_t z_end = min((tz + 1)*TEX_SPARSE_TILE_SIZE, depth);
+				bool is_empty = true;
+
+				for(size_t z = tz*TEX_SPARSE_TILE_SIZE; z < z_end && is_empty; z++) {
+					for(size_t y = ty*TEX_SPARSE_TILE_SIZE; y < y_end && is_empty; y++) {
+						const T *row = pixels + (z*height + y)*width;
+						for(size_t x = tx*TEX_SPARSE_TILE_SIZE; x < x_end; x++) {
+							if(!voxel_is_zero(row[x])) {
+								is_empty = false;
+								break;
+							}
+						}
+					}
+				}
+
+				if(!is_empty) {
+					offsets[tile] = header_size + num_active_tiles*TEX_SPARSE_TILE_VOXELS;
+					num_active_tiles++;
+				}
+			}
+		}
+	}
+
+	/* Offsets are stored as int, which limits the amount of non-empty voxels. */
+	assert(header_size + num_active_tiles*TEX_SPARSE_TILE_VOXELS <= INT_MAX);
+
+	/* Copy active tiles. */
+	array<T> sparse(header_size + num_active_tiles*TEX_SPARSE_TILE_VOXELS);
+	memset(sparse.data(), 0, sparse.size()*sizeof(T));
+	memcpy(sparse.data(), &offsets[0], num_tiles*sizeof(int));
+
+	for(size_t tz = 0, tile = 0; tz < tiles_z; tz++) {
+		for(size_t ty = 0; ty < tiles_y; ty++) {
+			for(size_t tx = 0; tx < tiles_x; tx++, tile++) {
+				if(offsets[tile] == TEX_SPARSE_TILE_EMPTY) {
+					continue;
+				}
+
+				const size_t x_begin = tx*TEX_SPARSE_TILE_SIZE;
+				const size_t x_end = min(x_begin + TEX_SPARSE_TILE_SIZE, width);
+				const size_t y_end = min((ty + 1)*TEX_SPARSE_TILE_SIZE, height);
+				const size_t z_end = min((tz + 1)*TEX_SPARSE_TILE_SIZE, depth);
+				T *tile_pixels = sparse.data() + offsets[tile];
+
+				for(size_t z = tz*TEX_SPARSE_TILE_SIZE; z < z_end; z++) {
+					for(size_t y = ty*TEX_SPARSE_TILE_SIZE; y < y_end; y++) {
+						const size_t local = ((z & TEX_SPARSE_TILE_MASK)*TEX_SPARSE_TILE_SIZE +
+						                      (y & TEX_SPARSE_TILE_MASK))*TEX_SPARSE_TILE_SIZE;
+						memcpy(tile_pixels + local,
+						       pixels + (z*height + y)*width + x_begin,
+						       (x_end - x_begin)*sizeof(T));
+					}
+				}
+			}
+		}
+	}
+
+	VLOG(1) << "Sparse texture " << tex_img.name << ": "
+	        << num_active_tiles << " of " << num_tiles << " tiles used, "
+	        << string_human_readable_size(tex_img.memory_size()) << " dense, "
+	        << string_human_readable_size(sparse.size()*sizeof(T)) << " sparse.";
+
+	tex_img.steal_data(sparse);
+	tex_img.data_width = width;
+	tex_img.data_height = height;
+	tex_img.data_depth = depth;
+}
+
 }  // namespace
 
 ImageManager::ImageManager(const DeviceInfo& info)
@@ -93,6 +198,7 @@ ImageManager::ImageManager(const DeviceInfo& info)
 	/* Set image limits */
 	max_num_images = TEX_NUM_MAX;
 	has_half_images = info.has_half_images;
+	has_sparse_images = info.has_sparse_images;
 
 	for(size_t type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		tex_num_images[type] = 0;
@@ -315,6 +421,16 @@ int ImageManager::add_image(const string& filename,
 		}
 	}
 
+	/* Store float volume grids sparse when the device supports it. */
+	if(has_sparse_images && metadata.depth > 1) {
+		if(type == IMAGE_DATA_TYPE_FLOAT4) {
+			type = IMAGE_DATA_TYPE_SPARSE_FLOAT4;
+		}
+		else if(type == IMAGE_DATA_TYPE_FLOAT) {
+			type = IMAGE_DATA_TYPE_SPARSE_FLOAT;
+		}
+	}
+
 	/* Fnd existing image. */
 	for(slot = 0; slot < images[type].size(); slot++) {
 		img = images[type][slot];
@@ -593,6 +709,7 @@ bool ImageManager::file_load_image(Image *img,
 	 * but device doesn't support single channel textures.
 	 */
 	bool is_rgba = (type == IMAGE_DATA_TYPE_FLOAT4 ||
+	                type == IMAGE_DATA_TYPE_SPARSE_FLOAT4 ||
 	                type == IMAGE_DATA_TYPE_HALF4 ||
 	                type == IMAGE_DATA_TYPE_BYTE4 ||
 					type == IMAGE_DATA_TYPE_USHORT4);
@@ -740,7 +857,60 @@ void ImageManager::device_load_image(Device *device,
 	}
 
 	/* Create new texture. */
-	if(type == IMAGE_DATA_TYPE_FLOAT4) {
+	if(type == IMAGE_DATA_TYPE_SPARSE_FLOAT4) {
+		device_vector<float4> *tex_img
+			= new device_vector<float4>(device, img->mem_name.c_str(), MEM_TEXTURE);
+
+		if(!file_load_image<TypeDesc::FLOAT, float>(img,
+		                                            type,
+		                                            texture_limit,
+		                                            *tex_img))
+		{
+			/* on failure to load, we set a 1x1x1 pixels pink image */
+			thread_scoped_lock device_lock(device_mutex);
+			float *pixels = (float*)tex_img->alloc(1, 1, 1);
+
+			pixels[0] = TEX_IMAGE_MISSING_R;
+			pixels[1] = TEX_IMAGE_MISSING_G;
+			pixels[2] = TEX_IMAGE_MISSING_B;
+			pixels[3] = TEX_IMAGE_MISSING_A;
+		}
+
+		image_make_sparse(*tex_img);
+
+		img->mem = tex_img;
+		img->mem->interpolation = img->interpolation;
+		img->mem->extension = img->extension;
+
+		thread_scoped_lock device_lock(device_mutex);
+		tex_img->copy_to_device();
+	}
+	else if(type == IMAGE_DATA_TYPE_SPARSE_FLOAT) {
+		device_vector<float> *tex_img
+			= new device_vector<float>(device, img->mem_name.c_str(), MEM_TEXTURE);
+
+		if(!file_load_image<TypeDesc::FLOAT, float>(img,
+		                                            type,
+		                                            texture_limit,
+		                                            *tex_img))
+		{
+			/* on failure to load, we set a 1x1x1 pixels pink image */
+			thread_scoped_lock device_lock(device_mutex);
+			float *pixels = (float*)tex_img->alloc(1, 1, 1);
+
+			pixels[0] = TEX_IMAGE_MISSING_R;
+		}
+
+		image_make_sparse(*tex_img);
+
+		img->mem = tex_img;
+		img->mem->interpolation = img->interpolation;
+		img->mem->extension = img->extension;
+
+		thread_scoped_lock device_lock(device_mutex);
+		tex_img->copy_to_device();
+	}
+	else if(type == IMAGE_DATA_TYPE_FLOAT4) {
 		device_vector<float4> *tex_img
 			= new device_vector<float4>(device, img->mem_name.c_str(), MEM_TEXTURE);
 
@@ -135,6 +135,7 @@ private:
 	int tex_num_images[IMAGE_DATA_NUM_TYPES];
 	int max_num_images;
 	bool has_half_images;
+	bool has_sparse_images;
 
 	thread_mutex device_mutex;
 	int animation_frame;
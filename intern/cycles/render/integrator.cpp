@@ -45,6 +45,7 @@ NODE_DEFINE(Integrator)
 
 	SOCKET_INT(volume_max_steps, "Volume Max Steps", 1024);
 	SOCKET_FLOAT(volume_step_size, "Volume Step Size", 0.1f);
+	SOCKET_INT(volume_step_max_scale, "Volume Step Max Scale", 1);
 
 	SOCKET_BOOLEAN(caustics_reflective, "Reflective Caustics", true);
 	SOCKET_BOOLEAN(caustics_refractive, "Refractive Caustics", true);
@@ -132,6 +133,7 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 
 	kintegrator->volume_max_steps = volume_max_steps;
 	kintegrator->volume_step_size = volume_step_size;
+	kintegrator->volume_step_max_scale = max(volume_step_max_scale, 1);
 
 	kintegrator->caustics_reflective = caustics_reflective;
 	kintegrator->caustics_refractive = caustics_refractive;
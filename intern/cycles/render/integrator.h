@@ -44,6 +44,7 @@ public:
 
 	int volume_max_steps;
 	float volume_step_size;
+	int volume_step_max_scale;
 
 	bool caustics_reflective;
 	bool caustics_refractive;
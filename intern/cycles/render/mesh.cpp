@@ -35,6 +35,7 @@
 #include "subd/subd_patch_table.h"
 
 #include "util/util_foreach.h"
+#include "util/util_half.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
@@ -459,6 +460,7 @@ Mesh::Mesh()
 
 	subdivision_type = SUBDIVISION_NONE;
 	subd_params = NULL;
+	subd_split_cache = NULL;
 
 	patch_table = NULL;
 }
@@ -468,6 +470,7 @@ Mesh::~Mesh()
 	delete bvh;
 	delete patch_table;
 	delete subd_params;
+	delete subd_split_cache;
 }
 
 void Mesh::resize_mesh(int numverts, int numtris)
@@ -928,6 +931,30 @@ void Mesh::pack_normals(float4 *vnormal)
 	}
 }
 
+void Mesh::pack_normals_octahedral(uint *vnormal)
+{
+	Attribute *attr_vN = attributes.find(ATTR_STD_VERTEX_NORMAL);
+	if(attr_vN == NULL) {
+		/* Happens on objects with just hair. */
+		return;
+	}
+
+	bool do_transform = transform_applied;
+	Transform ntfm = transform_normal;
+
+	float3 *vN = attr_vN->data_float3();
+	size_t verts_size = verts.size();
+
+	for(size_t i = 0; i < verts_size; i++) {
+		float3 vNi = vN[i];
+
+		if(do_transform)
+			vNi = safe_normalize(transform_direction(&ntfm, vNi));
+
+		vnormal[i] = float3_to_octahedral(vNi);
+	}
+}
+
 void Mesh::pack_verts(const vector<uint>& tri_prim_index,
                       uint4 *tri_vindex,
                       uint *tri_patch,
@@ -1400,12 +1427,35 @@ void MeshManager::update_svm_attributes(Device *, DeviceScene *dscene, Scene *sc
 	dscene->attributes_map.copy_to_device();
 }
 
+/* UVs and colors on triangles can be stored as half floats, other data such
+ * as positions or tangents needs the full precision. */
+static bool attribute_use_half_precision(Attribute *mattr,
+                                         AttributePrimitive prim,
+                                         bool use_compact_attributes)
+{
+	if(!use_compact_attributes ||
+	   prim != ATTR_PRIM_TRIANGLE ||
+	   (mattr->flags & ATTR_SUBDIVIDED))
+	{
+		return false;
+	}
+	if(mattr->element != ATTR_ELEMENT_FACE &&
+	   mattr->element != ATTR_ELEMENT_VERTEX &&
+	   mattr->element != ATTR_ELEMENT_CORNER)
+	{
+		return false;
+	}
+	return mattr->std == ATTR_STD_UV || mattr->type == TypeDesc::TypeColor;
+}
+
 static void update_attribute_element_size(Mesh *mesh,
                                           Attribute *mattr,
                                           AttributePrimitive prim,
+                                          bool use_compact_attributes,
                                           size_t *attr_float_size,
                                           size_t *attr_float3_size,
-                                          size_t *attr_uchar4_size)
+                                          size_t *attr_uchar4_size,
+                                          size_t *attr_half3_size)
 {
 	if(mattr) {
 		size_t size = mattr->element_size(mesh, prim);
@@ -1416,6 +1466,9 @@ static void update_attribute_element_size(Mesh *mesh,
 		else if(mattr->element == ATTR_ELEMENT_CORNER_BYTE) {
 			*attr_uchar4_size += size;
 		}
+		else if(attribute_use_half_precision(mattr, prim, use_compact_attributes)) {
+			*attr_half3_size += size;
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			*attr_float_size += size;
 		}
@@ -1435,8 +1488,11 @@ static void update_attribute_element_offset(Mesh *mesh,
                                             size_t& attr_float3_offset,
                                             device_vector<uchar4>& attr_uchar4,
                                             size_t& attr_uchar4_offset,
+                                            device_vector<ushort4>& attr_half3,
+                                            size_t& attr_half3_offset,
                                             Attribute *mattr,
                                             AttributePrimitive prim,
+                                            bool use_compact_attributes,
                                             TypeDesc& type,
                                             AttributeDescriptor& desc)
 {
@@ -1467,6 +1523,22 @@ static void update_attribute_element_offset(Mesh *mesh,
 			}
 			attr_uchar4_offset += size;
 		}
+		else if(attribute_use_half_precision(mattr, prim, use_compact_attributes)) {
+			float4 *data = mattr->data_float4();
+			offset = attr_half3_offset;
+
+			assert(attr_half3.size() >= offset + size);
+			for(size_t k = 0; k < size; k++) {
+				ushort4 h;
+				h.x = float_to_half(data[k].x);
+				h.y = float_to_half(data[k].y);
+				h.z = float_to_half(data[k].z);
+				h.w = 0;
+				attr_half3[offset+k] = h;
+			}
+			attr_half3_offset += size;
+			desc.flags |= ATTR_HALF_PRECISION;
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			float *data = mattr->data_float();
 			offset = attr_float_offset;
@@ -1560,9 +1632,11 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	/* Pre-allocate attributes to avoid arrays re-allocation which would
 	 * take 2x of overall attribute memory usage.
 	 */
+	const bool use_compact_attributes = scene->params.use_compact_attributes;
 	size_t attr_float_size = 0;
 	size_t attr_float3_size = 0;
 	size_t attr_uchar4_size = 0;
+	size_t attr_half3_size = 0;
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
 		AttributeRequestSet& attributes = mesh_attributes[i];
@@ -1574,31 +1648,39 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			update_attribute_element_size(mesh,
 			                              triangle_mattr,
 			                              ATTR_PRIM_TRIANGLE,
+			                              use_compact_attributes,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half3_size);
 			update_attribute_element_size(mesh,
 			                              curve_mattr,
 			                              ATTR_PRIM_CURVE,
+			                              use_compact_attributes,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half3_size);
 			update_attribute_element_size(mesh,
 			                              subd_mattr,
 			                              ATTR_PRIM_SUBD,
+			                              use_compact_attributes,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half3_size);
 		}
 	}
 
 	dscene->attributes_float.alloc(attr_float_size);
 	dscene->attributes_float3.alloc(attr_float3_size);
 	dscene->attributes_uchar4.alloc(attr_uchar4_size);
+	dscene->attributes_half3.alloc(attr_half3_size);
 
 	size_t attr_float_offset = 0;
 	size_t attr_float3_offset = 0;
 	size_t attr_uchar4_offset = 0;
+	size_t attr_half3_offset = 0;
 
 	/* Fill in attributes. */
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
@@ -1616,8 +1698,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_half3, attr_half3_offset,
 			                                triangle_mattr,
 			                                ATTR_PRIM_TRIANGLE,
+			                                use_compact_attributes,
 			                                req.triangle_type,
 			                                req.triangle_desc);
 
@@ -1625,8 +1709,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_half3, attr_half3_offset,
 			                                curve_mattr,
 			                                ATTR_PRIM_CURVE,
+			                                use_compact_attributes,
 			                                req.curve_type,
 			                                req.curve_desc);
 
@@ -1634,8 +1720,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_half3, attr_half3_offset,
 			                                subd_mattr,
 			                                ATTR_PRIM_SUBD,
+			                                use_compact_attributes,
 			                                req.subd_type,
 			                                req.subd_desc);
 
@@ -1663,6 +1751,9 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	if(dscene->attributes_uchar4.size()) {
 		dscene->attributes_uchar4.copy_to_device();
 	}
+	if(dscene->attributes_half3.size()) {
+		dscene->attributes_half3.copy_to_device();
+	}
 
 	if(progress.get_cancel()) return;
 
@@ -1776,8 +1867,20 @@ void MeshManager::device_update_mesh(Device *,
 		/* normals */
 		progress.set_status("Updating Mesh", "Computing normals");
 
+		const bool use_compact_normals = scene->params.use_compact_attributes;
+		dscene->data.bvh.use_compact_normals = use_compact_normals;
+
 		uint *tri_shader = dscene->tri_shader.alloc(tri_size);
-		float4 *vnormal = dscene->tri_vnormal.alloc(vert_size);
+		float4 *vnormal = NULL;
+		uint *vnormal_oct = NULL;
+		if(use_compact_normals) {
+			vnormal_oct = dscene->tri_vnormal_oct.alloc(vert_size);
+			dscene->tri_vnormal.free();
+		}
+		else {
+			vnormal = dscene->tri_vnormal.alloc(vert_size);
+			dscene->tri_vnormal_oct.free();
+		}
 		uint4 *tri_vindex = dscene->tri_vindex.alloc(tri_size);
 		uint *tri_patch = dscene->tri_patch.alloc(tri_size);
 		float2 *tri_patch_uv = dscene->tri_patch_uv.alloc(vert_size);
@@ -1785,7 +1888,12 @@ void MeshManager::device_update_mesh(Device *,
 		foreach(Mesh *mesh, scene->meshes) {
 			mesh->pack_shaders(scene,
 			                   &tri_shader[mesh->tri_offset]);
-			mesh->pack_normals(&vnormal[mesh->vert_offset]);
+			if(use_compact_normals) {
+				mesh->pack_normals_octahedral(&vnormal_oct[mesh->vert_offset]);
+			}
+			else {
+				mesh->pack_normals(&vnormal[mesh->vert_offset]);
+			}
 			mesh->pack_verts(tri_prim_index,
 			                 &tri_vindex[mesh->tri_offset],
 			                 &tri_patch[mesh->tri_offset],
@@ -1799,7 +1907,12 @@ void MeshManager::device_update_mesh(Device *,
 		progress.set_status("Updating Mesh", "Copying Mesh to device");
 
 		dscene->tri_shader.copy_to_device();
-		dscene->tri_vnormal.copy_to_device();
+		if(use_compact_normals) {
+			dscene->tri_vnormal_oct.copy_to_device();
+		}
+		else {
+			dscene->tri_vnormal.copy_to_device();
+		}
 		dscene->tri_vindex.copy_to_device();
 		dscene->tri_patch.copy_to_device();
 		dscene->tri_patch_uv.copy_to_device();
@@ -2147,8 +2260,15 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 				progress.set_status("Updating Mesh", msg);
 
-				DiagSplit dsplit(*mesh->subd_params);
-				mesh->tessellate(&dsplit);
+				{
+					scoped_named_timer timer(scene->update_stats, "Tessellation");
+					if(!mesh->subd_split_cache) {
+						mesh->subd_split_cache = new DiagSplitCache();
+					}
+
+					DiagSplit dsplit(*mesh->subd_params, mesh->subd_split_cache);
+					mesh->tessellate(&dsplit);
+				}
 
 				i++;
 
@@ -2189,6 +2309,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update) {
+			scoped_named_timer timer(scene->update_stats, "Displacement");
 			if(displace(device, dscene, scene, mesh, progress)) {
 				displacement_done = true;
 			}
@@ -2209,29 +2330,33 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		if(progress.get_cancel()) return;
 	}
 
-	TaskPool pool;
+	{
+		scoped_named_timer timer(scene->update_stats, "Mesh BVH");
 
-	size_t i = 0;
-	foreach(Mesh *mesh, scene->meshes) {
-		if(mesh->need_update) {
-			pool.push(function_bind(&Mesh::compute_bvh,
-			                        mesh,
-			                        device,
-			                        dscene,
-			                        &scene->params,
-			                        &progress,
-			                        i,
-			                        num_bvh));
-			if(mesh->need_build_bvh()) {
-				i++;
+		TaskPool pool;
+
+		size_t i = 0;
+		foreach(Mesh *mesh, scene->meshes) {
+			if(mesh->need_update) {
+				pool.push(function_bind(&Mesh::compute_bvh,
+				                        mesh,
+				                        device,
+				                        dscene,
+				                        &scene->params,
+				                        &progress,
+				                        i,
+				                        num_bvh));
+				if(mesh->need_build_bvh()) {
+					i++;
+				}
 			}
 		}
-	}
 
-	TaskPool::Summary summary;
-	pool.wait_work(&summary);
-	VLOG(2) << "Objects BVH build pool statistics:\n"
-	        << summary.full_report();
+		TaskPool::Summary summary;
+		pool.wait_work(&summary);
+		VLOG(2) << "Objects BVH build pool statistics:\n"
+		        << summary.full_report();
+	}
 
 	foreach(Shader *shader, scene->shaders) {
 		shader->need_update_mesh = false;
@@ -2248,7 +2373,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	if(progress.get_cancel()) return;
 
-	device_update_bvh(device, dscene, scene, progress);
+	{
+		scoped_named_timer timer(scene->update_stats, "Scene BVH");
+		device_update_bvh(device, dscene, scene, progress);
+	}
 	if(progress.get_cancel()) return;
 
 	device_update_mesh(device, dscene, scene, false, progress);
@@ -2281,6 +2409,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->prim_time.free();
 	dscene->tri_shader.free();
 	dscene->tri_vnormal.free();
+	dscene->tri_vnormal_oct.free();
 	dscene->tri_vindex.free();
 	dscene->tri_patch.free();
 	dscene->tri_patch_uv.free();
@@ -2291,6 +2420,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float.free();
 	dscene->attributes_float3.free();
 	dscene->attributes_uchar4.free();
+	dscene->attributes_half3.free();
 
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
@@ -45,6 +45,7 @@ class SceneParams;
 class AttributeRequest;
 struct SubdParams;
 class DiagSplit;
+class DiagSplitCache;
 struct PackedPatchTable;
 
 /* Mesh */
@@ -220,6 +221,7 @@ public:
 	array<SubdEdgeCrease> subd_creases;
 
 	SubdParams *subd_params;
+	DiagSplitCache *subd_split_cache; /* split results of previous tessellation */
 
 	vector<Shader*> used_shaders;
 	AttributeSet attributes;
@@ -283,6 +285,7 @@ public:
 
 	void pack_shaders(Scene *scene, uint *shader);
 	void pack_normals(float4 *vnormal);
+	void pack_normals_octahedral(uint *vnormal);
 	void pack_verts(const vector<uint>& tri_prim_index,
 	                uint4 *tri_vindex,
 	                uint *tri_patch,
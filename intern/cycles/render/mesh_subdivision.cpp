@@ -369,6 +369,30 @@ void Mesh::tessellate(DiagSplit *split)
 	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
 	float3* vN = attr_vN->data_float3();
 
+	/* patches are split and diced together in post_split(), so they must stay
+	 * alive until then */
+	int num_patches = 0;
+
+	for(int f = 0; f < num_faces; f++) {
+		SubdFace& face = subd_faces[f];
+		num_patches += face.is_quad()? 1: face.num_corners;
+	}
+
+	vector<LinearQuadPatch> linear_patches;
+#ifdef WITH_OPENSUBDIV
+	vector<OsdPatch> osd_patches;
+
+	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+		osd_patches.resize(num_patches, OsdPatch(&osd_data));
+	}
+	else
+#endif
+	{
+		linear_patches.resize(num_patches);
+	}
+
+	int next_patch = 0;
+
 	for(int f = 0; f < num_faces; f++) {
 		SubdFace& face = subd_faces[f];
 
@@ -376,11 +400,10 @@ void Mesh::tessellate(DiagSplit *split)
 			/* quad */
 			QuadDice::SubPatch subpatch;
 
-			LinearQuadPatch quad_patch;
 #ifdef WITH_OPENSUBDIV
-			OsdPatch osd_patch(&osd_data);
-
 			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+				OsdPatch& osd_patch = osd_patches[next_patch++];
+
 				osd_patch.patch_index = face.ptex_offset;
 
 				subpatch.patch = &osd_patch;
@@ -388,6 +411,7 @@ void Mesh::tessellate(DiagSplit *split)
 			else
 #endif
 			{
+				LinearQuadPatch& quad_patch = linear_patches[next_patch++];
 				float3 *hull = quad_patch.hull;
 				float3 *normals = quad_patch.normals;
 
@@ -448,11 +472,10 @@ void Mesh::tessellate(DiagSplit *split)
 			/* ngon */
 #ifdef WITH_OPENSUBDIV
 			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				OsdPatch patch(&osd_data);
-
-				patch.shader = face.shader;
-
 				for(int corner = 0; corner < face.num_corners; corner++) {
+					OsdPatch& patch = osd_patches[next_patch++];
+
+					patch.shader = face.shader;
 					patch.patch_index = face.ptex_offset + corner;
 
 					split->split_quad(&patch);
@@ -471,7 +494,7 @@ void Mesh::tessellate(DiagSplit *split)
 				}
 
 				for(int corner = 0; corner < face.num_corners; corner++) {
-					LinearQuadPatch patch;
+					LinearQuadPatch& patch = linear_patches[next_patch++];
 					float3 *hull = patch.hull;
 					float3 *normals = patch.normals;
 
@@ -509,6 +532,8 @@ void Mesh::tessellate(DiagSplit *split)
 		}
 	}
 
+	split->post_split();
+
 	/* interpolate center points for attributes */
 	foreach(Attribute& attr, subd_attributes.attributes) {
 #ifdef WITH_OPENSUBDIV
@@ -21,6 +21,7 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_texture.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -357,8 +358,46 @@ void VolumeMeshBuilder::convert_quads_to_tris(const vector<QuadData> &quads,
 struct VoxelAttributeGrid {
 	float *data;
 	int channels;
+	/* Tile offsets of sparse grids, NULL for dense grids. */
+	const int *tile_offsets;
 };
 
+static bool voxel_grid_tile_is_empty(const VoxelAttributeGrid &voxel_grid,
+                                     const int3 &resolution,
+                                     int tx, int ty, int tz)
+{
+	if(!voxel_grid.tile_offsets) {
+		return false;
+	}
+
+	const int tiles_x = tex_sparse_num_tiles(resolution.x);
+	const int tiles_y = tex_sparse_num_tiles(resolution.y);
+	const int tile = tx + tiles_x*(ty + tiles_y*tz);
+
+	return voxel_grid.tile_offsets[tile] == TEX_SPARSE_TILE_EMPTY;
+}
+
+static const float *voxel_grid_value(const VoxelAttributeGrid &voxel_grid,
+                                     const int3 &resolution,
+                                     int x, int y, int z)
+{
+	if(!voxel_grid.tile_offsets) {
+		size_t voxel_index = compute_voxel_index(resolution, x, y, z);
+		return voxel_grid.data + voxel_index * voxel_grid.channels;
+	}
+
+	const int tiles_x = tex_sparse_num_tiles(resolution.x);
+	const int tiles_y = tex_sparse_num_tiles(resolution.y);
+	const int tile = (x >> TEX_SPARSE_TILE_SHIFT) +
+	                 tiles_x*((y >> TEX_SPARSE_TILE_SHIFT) +
+	                          tiles_y*(z >> TEX_SPARSE_TILE_SHIFT));
+	const int local = (x & TEX_SPARSE_TILE_MASK) +
+	                  TEX_SPARSE_TILE_SIZE*((y & TEX_SPARSE_TILE_MASK) +
+	                                        TEX_SPARSE_TILE_SIZE*(z & TEX_SPARSE_TILE_MASK));
+
+	return voxel_grid.data + ((size_t)voxel_grid.tile_offsets[tile] + local) * voxel_grid.channels;
+}
+
 void MeshManager::create_volume_mesh(Scene *scene,
                                      Mesh *mesh,
                                      Progress& progress)
@@ -391,9 +430,14 @@ void MeshManager::create_volume_mesh(Scene *scene,
 			return;
 		}
 
+		const int image_type = kernel_tex_type(voxel->slot);
+		const bool is_sparse = (image_type == IMAGE_DATA_TYPE_SPARSE_FLOAT ||
+		                        image_type == IMAGE_DATA_TYPE_SPARSE_FLOAT4);
+
 		VoxelAttributeGrid voxel_grid;
 		voxel_grid.data = static_cast<float*>(image_memory->host_pointer);
 		voxel_grid.channels = image_memory->data_elements;
+		voxel_grid.tile_offsets = (is_sparse)? static_cast<const int*>(image_memory->host_pointer): NULL;
 		voxel_grids.push_back(voxel_grid);
 	}
 
@@ -449,19 +493,51 @@ void MeshManager::create_volume_mesh(Scene *scene,
 	VolumeMeshBuilder builder(&volume_params);
 	const float isovalue = mesh->volume_isovalue;
 
-	for(int z = 0; z < resolution.z; ++z) {
-		for(int y = 0; y < resolution.y; ++y) {
-			for(int x = 0; x < resolution.x; ++x) {
-				size_t voxel_index = compute_voxel_index(resolution, x, y, z);
+	/* Voxels are visited per tile, so empty tiles of sparse grids can be
+	 * skipped without looking at their voxels. Empty voxels are zero, they
+	 * can only be active for non-positive isovalues. */
+	const bool skip_empty_tiles = (isovalue > 0.0f);
+
+	for(int tz = 0; tz < tex_sparse_num_tiles(resolution.z); ++tz) {
+		for(int ty = 0; ty < tex_sparse_num_tiles(resolution.y); ++ty) {
+			for(int tx = 0; tx < tex_sparse_num_tiles(resolution.x); ++tx) {
+				bool tile_is_empty = skip_empty_tiles;
 
-				for(size_t i = 0; i < voxel_grids.size(); ++i) {
-					const VoxelAttributeGrid &voxel_grid = voxel_grids[i];
-					const int channels = voxel_grid.channels;
+				for(size_t i = 0; i < voxel_grids.size() && tile_is_empty; ++i) {
+					tile_is_empty = voxel_grid_tile_is_empty(voxel_grids[i], resolution, tx, ty, tz);
+				}
 
-					for(int c = 0; c < channels; c++) {
-						if(voxel_grid.data[voxel_index * channels + c] >= isovalue) {
-							builder.add_node_with_padding(x, y, z);
-							break;
+				if(tile_is_empty) {
+					continue;
+				}
+
+				const int z_end = min((tz + 1) * TEX_SPARSE_TILE_SIZE, resolution.z);
+				const int y_end = min((ty + 1) * TEX_SPARSE_TILE_SIZE, resolution.y);
+				const int x_end = min((tx + 1) * TEX_SPARSE_TILE_SIZE, resolution.x);
+
+				for(int z = tz * TEX_SPARSE_TILE_SIZE; z < z_end; ++z) {
+					for(int y = ty * TEX_SPARSE_TILE_SIZE; y < y_end; ++y) {
+						for(int x = tx * TEX_SPARSE_TILE_SIZE; x < x_end; ++x) {
+							for(size_t i = 0; i < voxel_grids.size(); ++i) {
+								const VoxelAttributeGrid &voxel_grid = voxel_grids[i];
+								const int channels = voxel_grid.channels;
+
+								if(voxel_grid_tile_is_empty(voxel_grid, resolution, tx, ty, tz)) {
+									if(isovalue <= 0.0f) {
+										builder.add_node_with_padding(x, y, z);
+									}
+									continue;
+								}
+
+								const float *value = voxel_grid_value(voxel_grid, resolution, x, y, z);
+
+								for(int c = 0; c < channels; c++) {
+									if(value[c] >= isovalue) {
+										builder.add_node_with_padding(x, y, z);
+										break;
+									}
+								}
+							}
 						}
 					}
 				}
@@ -499,8 +575,16 @@ void MeshManager::create_volume_mesh(Scene *scene,
 	        << ((vertices.size() + face_normals.size())*sizeof(float3) + indices.size()*sizeof(int))/(1024.0*1024.0)
 	        << "Mb.";
 
+	size_t grid_memory = 0;
+	foreach(Attribute& attr, mesh->attributes.attributes) {
+		if(attr.element == ATTR_ELEMENT_VOXEL) {
+			VoxelAttribute *voxel = attr.data_voxel();
+			grid_memory += scene->image_manager->image_memory(voxel->slot)->memory_size();
+		}
+	}
+
 	VLOG(1) << "Memory usage volume grid: "
-	        << (resolution.x*resolution.y*resolution.z*sizeof(float))/(1024.0*1024.0)
+	        << grid_memory/(1024.0*1024.0)
 	        << "Mb.";
 }
 
@@ -5266,19 +5266,54 @@ void MathNode::constant_fold(const ConstantFolder& folder)
 	}
 }
 
+static bool math_chain_input(SVMCompiler& compiler, ShaderInput *input)
+{
+	/* The value of the previous math node is only needed by this node. */
+	return (input->link &&
+	        input->link->parent->type == MathNode::node_type &&
+	        input->link->links.size() == 1 &&
+	        compiler.is_last_compiled(input->link->parent));
+}
+
 void MathNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *value1_in = input("Value1");
 	ShaderInput *value2_in = input("Value2");
 	ShaderOutput *value_out = output("Value");
 
-	compiler.add_node(NODE_MATH, type, compiler.stack_assign(value1_in), compiler.stack_assign(value2_in));
-	compiler.add_node(NODE_MATH, compiler.stack_assign(value_out));
+	ShaderInput *chain_in = NULL;
+	if(math_chain_input(compiler, value1_in))
+		chain_in = value1_in;
+	else if(math_chain_input(compiler, value2_in))
+		chain_in = value2_in;
+
+	if(chain_in) {
+		/* Continue the instruction of the previous math node, its result is
+		 * passed on directly instead of being stored on the stack. The other
+		 * operand must not add nodes, so constants are embedded. */
+		ShaderInput *other_in = (chain_in == value1_in)? value2_in: value1_in;
+		int4& prev = compiler.last_svm_node();
+
+		prev.x = SVM_STACK_INVALID;
+		prev.y |= NODE_MATH_FLAG_CHAIN;
+		if(chain_in == value2_in) {
+			prev.y |= NODE_MATH_FLAG_SWAP;
+		}
+		prev.z = type;
 
-	if(use_clamp) {
-		compiler.add_node(NODE_MATH, NODE_MATH_CLAMP, compiler.stack_assign(value_out));
-		compiler.add_node(NODE_MATH, compiler.stack_assign(value_out));
+		if(other_in->link) {
+			prev.w = compiler.stack_assign(other_in);
+		}
+		else {
+			prev.y |= NODE_MATH_FLAG_CONSTANT;
+			prev.w = __float_as_int(get_float(other_in->socket_type));
+		}
 	}
+	else {
+		compiler.add_node(NODE_MATH, type, compiler.stack_assign(value1_in), compiler.stack_assign(value2_in));
+	}
+
+	compiler.add_node(compiler.stack_assign(value_out), (use_clamp)? NODE_MATH_FLAG_CLAMP: 0);
 }
 
 void MathNode::compile(OSLCompiler& compiler)
@@ -73,6 +73,9 @@ struct UpdateObjectTransformState {
 
 	Scene *scene;
 
+	/* Objects to update, all objects of the scene or only modified ones. */
+	const vector<Object*> *queue_objects;
+
 	/* Some locks to keep everything thread-safe. */
 	thread_spin_lock queue_lock;
 	thread_spin_lock surface_area_lock;
@@ -109,6 +112,8 @@ Object::Object()
 	particle_system = NULL;
 	particle_index = 0;
 	bounds = BoundBox::empty;
+	need_update = true;
+	index = -1;
 }
 
 Object::~Object()
@@ -275,6 +280,8 @@ void Object::apply_transform(bool apply_to_motion)
 
 void Object::tag_update(Scene *scene)
 {
+	need_update = true;
+
 	if(mesh) {
 		if(mesh->transform_applied)
 			mesh->need_update = true;
@@ -346,6 +353,8 @@ ObjectManager::ObjectManager()
 {
 	need_update = true;
 	need_flags_update = true;
+	need_full_update = true;
+	device_motion = Scene::MOTION_NONE;
 }
 
 ObjectManager::~ObjectManager()
@@ -518,7 +527,7 @@ bool ObjectManager::device_update_object_transform_pop_work(
 	static const int OBJECTS_PER_TASK = 32;
 	bool have_work = false;
 	state->queue_lock.lock();
-	int num_scene_objects = state->scene->objects.size();
+	int num_scene_objects = state->queue_objects->size();
 	if(state->queue_start_object < num_scene_objects) {
 		int count = min(OBJECTS_PER_TASK,
 		                num_scene_objects - state->queue_start_object);
@@ -541,7 +550,7 @@ void ObjectManager::device_update_object_transform_task(
 	{
 		for(int i = 0; i < num_objects; ++i) {
 			const int object_index = start_index + i;
-			Object *ob = state->scene->objects[object_index];
+			Object *ob = (*state->queue_objects)[object_index];
 			device_update_object_transform(state, ob);
 		}
 	}
@@ -556,6 +565,7 @@ void ObjectManager::device_update_transforms(DeviceScene *dscene,
 	state.have_motion = false;
 	state.have_curves = false;
 	state.scene = scene;
+	state.queue_objects = &scene->objects;
 	state.queue_start_object = 0;
 
 	state.objects = dscene->objects.alloc(scene->objects.size());
@@ -632,6 +642,113 @@ void ObjectManager::device_update_transforms(DeviceScene *dscene,
 	dscene->data.bvh.have_instancing = true;
 }
 
+void ObjectManager::device_update_modified_transforms(DeviceScene *dscene,
+                                                      Scene *scene,
+                                                      Progress& progress)
+{
+	UpdateObjectTransformState state;
+	state.need_motion = scene->need_motion();
+	state.have_motion = false;
+	state.have_curves = false;
+	state.scene = scene;
+	state.queue_start_object = 0;
+
+	/* Re-pack modified objects in place, the arrays keep their size. */
+	state.objects = dscene->objects.data();
+	state.object_flag = dscene->object_flag.data();
+	state.object_motion = NULL;
+	state.object_motion_pass = NULL;
+
+	if(state.need_motion == Scene::MOTION_PASS) {
+		state.object_motion_pass = dscene->object_motion_pass.data();
+	}
+
+	int numparticles = 1;
+	foreach(ParticleSystem *psys, scene->particle_systems) {
+		state.particle_offset[psys] = numparticles;
+		numparticles += psys->particles.size();
+	}
+
+	vector<Object*> modified_objects;
+	foreach(Object *ob, scene->objects) {
+		if(ob->need_update || ob->mesh->need_update) {
+			modified_objects.push_back(ob);
+		}
+
+		/* Scene wide flags still depend on all objects. */
+		if(ob->mesh->use_motion_blur) {
+			state.have_motion = true;
+		}
+		if(ob->mesh->num_curves()) {
+			state.have_curves = true;
+		}
+	}
+	state.queue_objects = &modified_objects;
+
+	VLOG(1) << "Updating " << modified_objects.size() << " modified objects.";
+
+	if(modified_objects.size() < 64) {
+		foreach(Object *ob, modified_objects) {
+			device_update_object_transform(&state, ob);
+			if(progress.get_cancel()) {
+				return;
+			}
+		}
+	}
+	else {
+		const int num_threads = TaskScheduler::num_threads();
+		TaskPool pool;
+		for(int i = 0; i < num_threads; ++i) {
+			pool.push(function_bind(
+			        &ObjectManager::device_update_object_transform_task,
+			        this,
+			        &state));
+		}
+		pool.wait_work();
+		if(progress.get_cancel()) {
+			return;
+		}
+	}
+
+	if(modified_objects.size()) {
+		dscene->objects.copy_to_device();
+		if(state.need_motion == Scene::MOTION_PASS) {
+			dscene->object_motion_pass.copy_to_device();
+		}
+	}
+
+	dscene->data.bvh.have_motion = state.have_motion;
+	dscene->data.bvh.have_curves = state.have_curves;
+	dscene->data.bvh.have_instancing = true;
+}
+
+bool ObjectManager::can_update_modified(DeviceScene *dscene, Scene *scene)
+{
+	/* Static BVH bakes object transforms into the meshes, and motion blur
+	 * packs all motion steps into a single array with per object offsets. */
+	if(need_full_update ||
+	   scene->params.bvh_type != SceneParams::BVH_DYNAMIC ||
+	   scene->particle_system_manager->need_update ||
+	   scene->need_motion() != device_motion ||
+	   device_motion == Scene::MOTION_BLUR)
+	{
+		return false;
+	}
+
+	/* Objects must not have been added, removed or reordered. */
+	if(scene->objects.size() == 0 || dscene->objects.size() != scene->objects.size()) {
+		return false;
+	}
+
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		if(scene->objects[i]->index != (int)i) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	if(!need_update)
@@ -639,8 +756,27 @@ void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *sc
 
 	VLOG(1) << "Total " << scene->objects.size() << " objects.";
 
+	if(can_update_modified(dscene, scene)) {
+		progress.set_status("Updating Objects", "Copying Modified Transformations to device");
+		device_update_modified_transforms(dscene, scene, progress);
+
+		if(progress.get_cancel()) return;
+
+		foreach(Object *object, scene->objects) {
+			object->need_update = false;
+		}
+		return;
+	}
+
 	device_free(device, dscene);
 
+	need_full_update = false;
+	device_motion = scene->need_motion();
+
+	foreach(Object *object, scene->objects) {
+		object->need_update = false;
+	}
+
 	if(scene->objects.size() == 0)
 		return;
 
@@ -715,6 +851,9 @@ void ObjectManager::device_update_flags(Device *,
 			object_flag[object->index] &= ~SD_OBJECT_SHADOW_CATCHER;
 		}
 
+		/* Cleared since objects that were not modified keep their flags. */
+		object_flag[object->index] &= ~SD_OBJECT_INTERSECTS_VOLUME;
+
 		if(bounds_valid) {
 			foreach(Object *volume_object, volume_objects) {
 				if(object == volume_object) {
@@ -843,6 +982,7 @@ void ObjectManager::apply_static_transforms(DeviceScene *dscene, Scene *scene, P
 void ObjectManager::tag_update(Scene *scene)
 {
 	need_update = true;
+	need_full_update = true;
 	scene->curve_system_manager->need_update = true;
 	scene->mesh_manager->need_update = true;
 	scene->light_manager->need_update = true;
@@ -65,6 +65,10 @@ public:
 	ParticleSystem *particle_system;
 	int particle_index;
 
+	/* Modified since the last device update, so the object manager only
+	 * needs to re-pack this object. */
+	bool need_update;
+
 	Object();
 	~Object();
 
@@ -133,6 +137,17 @@ public:
 	string get_cryptomatte_assets(Scene *scene);
 
 protected:
+	/* Objects were added, removed or changed in a way that requires all
+	 * object data to be rebuilt, rather than only modified objects. */
+	bool need_full_update;
+	/* Motion type the object data was last built for. */
+	Scene::MotionType device_motion;
+
+	bool can_update_modified(DeviceScene *dscene, Scene *scene);
+	void device_update_modified_transforms(DeviceScene *dscene,
+	                                       Scene *scene,
+	                                       Progress& progress);
+
 	void device_update_object_transform(UpdateObjectTransformState *state,
 	                                    Object *ob);
 	void device_update_object_transform_task(UpdateObjectTransformState *state);
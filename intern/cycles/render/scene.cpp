@@ -30,6 +30,7 @@
 #include "render/particles.h"
 #include "render/scene.h"
 #include "render/shader.h"
+#include "render/stats.h"
 #include "render/svm.h"
 #include "render/tables.h"
 
@@ -53,6 +54,7 @@ DeviceScene::DeviceScene(Device *device)
   prim_time(device, "__prim_time", MEM_TEXTURE),
   tri_shader(device, "__tri_shader", MEM_TEXTURE),
   tri_vnormal(device, "__tri_vnormal", MEM_TEXTURE),
+  tri_vnormal_oct(device, "__tri_vnormal_oct", MEM_TEXTURE),
   tri_vindex(device, "__tri_vindex", MEM_TEXTURE),
   tri_patch(device, "__tri_patch", MEM_TEXTURE),
   tri_patch_uv(device, "__tri_patch_uv", MEM_TEXTURE),
@@ -68,6 +70,7 @@ DeviceScene::DeviceScene(Device *device)
   attributes_float(device, "__attributes_float", MEM_TEXTURE),
   attributes_float3(device, "__attributes_float3", MEM_TEXTURE),
   attributes_uchar4(device, "__attributes_uchar4", MEM_TEXTURE),
+  attributes_half3(device, "__attributes_half3", MEM_TEXTURE),
   light_distribution(device, "__light_distribution", MEM_TEXTURE),
   lights(device, "__lights", MEM_TEXTURE),
   light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_TEXTURE),
@@ -83,7 +86,7 @@ DeviceScene::DeviceScene(Device *device)
 }
 
 Scene::Scene(const SceneParams& params_, Device *device)
-: device(device), dscene(device), params(params_)
+: device(device), dscene(device), params(params_), update_stats(NULL)
 {
 	memset((void *)&dscene.data, 0, sizeof(dscene.data));
 
@@ -193,86 +196,137 @@ void Scene::device_update(Device *device_, Progress& progress)
 	 */
 
 	progress.set_status("Updating Shaders");
-	shader_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Shaders");
+		shader_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Background");
-	background->device_update(device, &dscene, this);
+	{
+		scoped_named_timer timer(update_stats, "Background");
+		background->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Camera");
-	camera->device_update(device, &dscene, this);
+	{
+		scoped_named_timer timer(update_stats, "Camera");
+		camera->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
-	mesh_manager->device_update_preprocess(device, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Meshes Preprocess");
+		mesh_manager->device_update_preprocess(device, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Objects");
-	object_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Objects");
+		object_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Hair Systems");
-	curve_system_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Hair Systems");
+		curve_system_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Particle Systems");
-	particle_system_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Particle Systems");
+		particle_system_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Meshes");
-	mesh_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Meshes");
+		mesh_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Objects Flags");
-	object_manager->device_update_flags(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Objects Flags");
+		object_manager->device_update_flags(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Images");
-	image_manager->device_update(device, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Images");
+		image_manager->device_update(device, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Camera Volume");
-	camera->device_update_volume(device, &dscene, this);
+	{
+		scoped_named_timer timer(update_stats, "Camera Volume");
+		camera->device_update_volume(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lookup Tables");
-	lookup_tables->device_update(device, &dscene);
+	{
+		scoped_named_timer timer(update_stats, "Lookup Tables");
+		lookup_tables->device_update(device, &dscene);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lights");
-	light_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Lights");
+		light_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Integrator");
-	integrator->device_update(device, &dscene, this);
+	{
+		scoped_named_timer timer(update_stats, "Integrator");
+		integrator->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Film");
-	film->device_update(device, &dscene, this);
+	{
+		scoped_named_timer timer(update_stats, "Film");
+		film->device_update(device, &dscene, this);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lookup Tables");
-	lookup_tables->device_update(device, &dscene);
+	{
+		scoped_named_timer timer(update_stats, "Lookup Tables");
+		lookup_tables->device_update(device, &dscene);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Baking");
-	bake_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_named_timer timer(update_stats, "Baking");
+		bake_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
@@ -56,6 +56,7 @@ class ShaderManager;
 class Progress;
 class BakeManager;
 class BakeData;
+class NamedTimeStats;
 class RenderStats;
 
 /* Scene Device Data */
@@ -77,6 +78,7 @@ public:
 	/* mesh */
 	device_vector<uint> tri_shader;
 	device_vector<float4> tri_vnormal;
+	device_vector<uint> tri_vnormal_oct;
 	device_vector<uint4> tri_vindex;
 	device_vector<uint> tri_patch;
 	device_vector<float2> tri_patch_uv;
@@ -100,6 +102,7 @@ public:
 	device_vector<float> attributes_float;
 	device_vector<float4> attributes_float3;
 	device_vector<uchar4> attributes_uchar4;
+	device_vector<ushort4> attributes_half3;
 
 	/* lights */
 	device_vector<KernelLightDistribution> light_distribution;
@@ -169,6 +172,10 @@ public:
 	bool persistent_data;
 	int texture_limit;
 
+	/* Store vertex normals octahedral encoded and UVs and colors as half
+	 * floats, trading some precision for a smaller memory footprint. */
+	bool use_compact_attributes;
+
 	SceneParams()
 	{
 		shadingsystem = SHADINGSYSTEM_SVM;
@@ -179,6 +186,7 @@ public:
 		num_bvh_time_steps = 0;
 		persistent_data = false;
 		texture_limit = 0;
+		use_compact_attributes = false;
 	}
 
 	bool modified(const SceneParams& params)
@@ -189,7 +197,8 @@ public:
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& use_compact_attributes == params.use_compact_attributes); }
 };
 
 /* Scene */
@@ -237,6 +246,9 @@ public:
 	/* mutex must be locked manually by callers */
 	thread_mutex mutex;
 
+	/* Optional timing of device update steps, only collected when set. */
+	NamedTimeStats *update_stats;
+
 	Scene(const SceneParams& params, Device *device);
 	~Scene();
 
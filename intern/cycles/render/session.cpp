@@ -54,6 +54,15 @@ Session::Session(const SessionParams& params_)
 
 	TaskScheduler::init(params.threads);
 
+	/* Every CPU thread acquires its own tiles, so the tile manager splits the
+	 * last tiles to keep all of them busy until the end, and hands out tiles
+	 * per NUMA node the threads are pinned to. */
+	if(params.device.type == DEVICE_CPU) {
+		tile_manager.num_workers = TaskScheduler::num_threads();
+		tile_manager.num_nodes = TaskScheduler::num_nodes();
+	}
+	tile_manager.cost_prepass_samples = params.tile_cost_prepass_samples;
+
 	device = Device::create(params.device, stats, profiler, params.background);
 
 	if(params.background && !params.write_render_cb) {
@@ -365,7 +374,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	Tile *tile;
 	int device_num = device->device_number(tile_device);
 
-	if(!tile_manager.next_tile(tile, device_num))
+	if(!tile_manager.next_tile(tile, device_num, rtile.numa_node))
 		return false;
 
 	/* fill render tile */
@@ -379,6 +388,11 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.tile_index = tile->index;
 	rtile.task = (tile->state == Tile::DENOISE)? RenderTile::DENOISE: RenderTile::PATH_TRACE;
 
+	/* Tiles waiting for denoising may have been compacted. */
+	if(tile->buffers) {
+		tile->buffers->expand();
+	}
+
 	tile_lock.unlock();
 
 	/* in case of a permanent buffer, return it, otherwise we will allocate
@@ -441,10 +455,21 @@ void Session::release_tile(RenderTile& rtile)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
 
-	progress.add_finished_tile(rtile.task == RenderTile::DENOISE);
-
 	bool delete_tile;
 
+	if(tile_manager.state.prepass) {
+		/* Result of the cost estimation prepass is not used. */
+		tile_manager.finish_tile(rtile.tile_index, delete_tile);
+
+		if(rtile.buffers != buffers) {
+			delete rtile.buffers;
+			tile_manager.state.tiles[rtile.tile_index].buffers = NULL;
+		}
+		return;
+	}
+
+	progress.add_finished_tile(rtile.task == RenderTile::DENOISE);
+
 	if(tile_manager.finish_tile(rtile.tile_index, delete_tile)) {
 		if(write_render_tile_cb && params.progressive_refine == false) {
 			write_render_tile_cb(rtile);
@@ -461,6 +486,11 @@ void Session::release_tile(RenderTile& rtile)
 		}
 	}
 
+	/* The tile is kept around for denoising its neighbors. */
+	if(!delete_tile && params.progressive_refine == false && rtile.buffers != buffers) {
+		rtile.buffers->compact(tile_manager.state.sample + tile_manager.state.num_samples);
+	}
+
 	update_status_time();
 }
 
@@ -484,12 +514,16 @@ void Session::map_neighbor_tiles(RenderTile *tiles, Device *tile_device)
 				Tile *tile = &tile_manager.state.tiles[tile_index];
 				assert(tile->buffers);
 
+				tile->buffers->expand();
+				tile->buffers->neighbor_users++;
+
 				tiles[i].buffer = tile->buffers->buffer.device_pointer;
 				tiles[i].x = tile_manager.state.buffer.full_x + tile->x;
 				tiles[i].y = tile_manager.state.buffer.full_y + tile->y;
 				tiles[i].w = tile->w;
 				tiles[i].h = tile->h;
 				tiles[i].buffers = tile->buffers;
+				tiles[i].tile_index = tile_index;
 
 				tile->buffers->params.get_offset_stride(tiles[i].offset, tiles[i].stride);
 			}
@@ -514,6 +548,20 @@ void Session::unmap_neighbor_tiles(RenderTile *tiles, Device *tile_device)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
 	device->unmap_neighbor_tiles(tile_device, tiles);
+
+	for(int i = 0; i < 9; i++) {
+		if(!tiles[i].buffers) {
+			continue;
+		}
+
+		tiles[i].buffers->neighbor_users--;
+
+		/* Compact neighbors that are only waiting for other tiles now. */
+		Tile::State state = tile_manager.state.tiles[tiles[i].tile_index].state;
+		if(state == Tile::RENDERED || state == Tile::DENOISED) {
+			tiles[i].buffers->compact(tile_manager.state.sample + tile_manager.state.num_samples);
+		}
+	}
 }
 
 void Session::run_cpu()
@@ -909,7 +957,12 @@ void Session::update_status_time(bool show_pause, bool show_done)
 		const bool rendering_finished = (tile == num_tiles);
 		const bool is_last_tile = (tile + 1) == num_tiles;
 
-		substatus = string_printf("Rendered %d/%d Tiles", tile, num_tiles);
+		if(tile_manager.state.prepass) {
+			substatus = "Estimating Tile Cost";
+		}
+		else {
+			substatus = string_printf("Rendered %d/%d Tiles", tile, num_tiles);
+		}
 
 		if(!rendering_finished && (device->show_samples() || (is_cpu && is_last_tile))) {
 			/* Some devices automatically support showing the sample number:
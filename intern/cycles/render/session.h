@@ -52,6 +52,7 @@ public:
 	int samples;
 	int2 tile_size;
 	TileOrder tile_order;
+	int tile_cost_prepass_samples;
 	int start_resolution;
 	int pixel_size;
 	int threads;
@@ -88,6 +89,7 @@ public:
 		experimental = false;
 		samples = INT_MAX;
 		tile_size = make_int2(64, 64);
+		tile_cost_prepass_samples = 0;
 		start_resolution = INT_MAX;
 		pixel_size = 1;
 		threads = 0;
@@ -120,6 +122,7 @@ public:
 		&& progressive == params.progressive
 		&& experimental == params.experimental
 		&& tile_size == params.tile_size
+		&& tile_cost_prepass_samples == params.tile_cost_prepass_samples
 		&& start_resolution == params.start_resolution
 		&& pixel_size == params.pixel_size
 		&& threads == params.threads
@@ -23,6 +23,8 @@
 CCL_NAMESPACE_BEGIN
 
 static int kIndentNumSpaces = 2;
+/* Number of most expensive shaders and objects listed in the report. */
+static int kMaxCostEntries = 20;
 
 /* Named size entry. */
 
@@ -88,6 +90,66 @@ string NamedSizeStats::full_report(int indent_level)
 	return result;
 }
 
+/* Named time statistics. */
+
+NamedTimeEntry::NamedTimeEntry()
+    : name(""),
+      time(0.0) {
+}
+
+NamedTimeEntry::NamedTimeEntry(const string& name, double time)
+    : name(name),
+      time(time) {
+}
+
+NamedTimeStats::NamedTimeStats()
+    : total_time(0.0), num_running_timers(0) {
+}
+
+void NamedTimeStats::add_entry(const NamedTimeEntry& entry, bool nested) {
+	if(!nested) {
+		total_time += entry.time;
+	}
+	foreach(NamedTimeEntry& existing, entries) {
+		if(existing.name == entry.name) {
+			existing.time += entry.time;
+			return;
+		}
+	}
+	entries.push_back(entry);
+}
+
+void NamedTimeStats::clear() {
+	total_time = 0.0;
+	entries.clear();
+}
+
+double NamedTimeStats::get_time(const string& name) const {
+	foreach(const NamedTimeEntry& entry, entries) {
+		if(entry.name == name) {
+			return entry.time;
+		}
+	}
+	return 0.0;
+}
+
+string NamedTimeStats::full_report(int indent_level)
+{
+	const string indent(indent_level * kIndentNumSpaces, ' ');
+	const string double_indent = indent + indent;
+	string result = "";
+	result += string_printf("%sTotal time: %.4fs\n",
+	                        indent.c_str(),
+	                        total_time);
+	foreach(const NamedTimeEntry& entry, entries) {
+		result += string_printf("%s%-32s %.4fs\n",
+		                        double_indent.c_str(),
+		                        entry.name.c_str(),
+		                        entry.time);
+	}
+	return result;
+}
+
 /* Named time sample statistics. */
 
 NamedNestedSampleStats::NamedNestedSampleStats()
@@ -162,7 +224,7 @@ void NamedSampleCountStats::add(const ustring& name, uint64_t samples, uint64_t
 	entries.emplace(name, NamedSampleCountPair(name, samples, hits));
 }
 
-string NamedSampleCountStats::full_report(int indent_level)
+string NamedSampleCountStats::full_report(int indent_level, int max_entries)
 {
 	const string indent(indent_level * kIndentNumSpaces, ' ');
 
@@ -183,14 +245,34 @@ string NamedSampleCountStats::full_report(int indent_level)
 	sort(sorted_entries.begin(), sorted_entries.end(), namedSampleCountPairComparator);
 
 	string result = "";
+	uint64_t other_samples = total_samples;
+	int num_entries = 0;
 	foreach(const NamedSampleCountPair& entry, sorted_entries) {
+		if(max_entries > 0 && num_entries == max_entries) {
+			break;
+		}
+
 		const double seconds = entry.samples * 0.001;
+		const double percent = 100*((double) entry.samples) / total_samples;
 		const double relative = ((double) entry.samples) / (entry.hits * avg_samples_per_hit);
 
-		result += indent + string_printf("%-32s: %.2fs (Relative cost: %.2f)\n",
+		result += indent + string_printf("%-32s: %.2fs, %3.2f%% (Relative cost: %.2f)\n",
 		                                 entry.name.c_str(),
 		                                 seconds,
+		                                 percent,
 		                                 relative);
+
+		other_samples -= entry.samples;
+		num_entries++;
+	}
+
+	if(num_entries < (int)sorted_entries.size()) {
+		const string name = string_printf("(%d more)", (int)(sorted_entries.size() - num_entries));
+
+		result += indent + string_printf("%-32s: %.2fs, %3.2f%%\n",
+		                                 name.c_str(),
+		                                 other_samples * 0.001,
+		                                 100*((double) other_samples) / total_samples);
 	}
 	return result;
 }
@@ -299,8 +381,8 @@ string RenderStats::full_report()
 	result += "Image statistics:\n" + image.full_report(1);
 	if(has_profiling) {
 		result += "Kernel statistics:\n" + kernel.full_report(1);
-		result += "Shader statistics:\n" + shaders.full_report(1);
-		result += "Object statistics:\n" + objects.full_report(1);
+		result += "Shader statistics:\n" + shaders.full_report(1, kMaxCostEntries);
+		result += "Object statistics:\n" + objects.full_report(1, kMaxCostEntries);
 	}
 	else {
 		result += "Profiling information not available (only works with CPU rendering)";
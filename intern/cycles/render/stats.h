@@ -21,6 +21,7 @@
 
 #include "util/util_stats.h"
 #include "util/util_string.h"
+#include "util/util_time.h"
 #include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -64,6 +65,79 @@ public:
 	vector<NamedSizeEntry> entries;
 };
 
+/* Named statistics entry for a measured wall-clock time, in seconds. */
+class NamedTimeEntry {
+public:
+	NamedTimeEntry();
+	NamedTimeEntry(const string& name, double time);
+
+	string name;
+	double time;
+};
+
+/* Container of named time entries. Used, for example, to store the time spent
+ * in every manager during Scene::device_update().
+ *
+ * Entries keep the order in which they were first added, adding an entry with
+ * a name which already exists accumulates time into the existing entry.
+ */
+class NamedTimeStats {
+public:
+	NamedTimeStats();
+
+	/* Add entry to the statistics. Time of nested entries, measured while
+	 * another entry was being timed, is already part of that entry and is not
+	 * added to the total again.
+	 */
+	void add_entry(const NamedTimeEntry& entry, bool nested = false);
+
+	/* Remove all entries. */
+	void clear();
+
+	/* Time of the entry with the given name, or 0 if there is none. */
+	double get_time(const string& name) const;
+
+	/* Generate full human-readable report. */
+	string full_report(int indent_level = 0);
+
+	/* Total time of all top level entries. */
+	double total_time;
+
+	/* Number of scoped timers currently running. */
+	int num_running_timers;
+
+	vector<NamedTimeEntry> entries;
+};
+
+/* Adds the time spent in the current scope to the given statistics when it
+ * goes out of scope. Statistics might be NULL, in which case nothing is
+ * recorded.
+ */
+class scoped_named_timer {
+public:
+	scoped_named_timer(NamedTimeStats *stats, const string& name)
+	 : stats_(stats), name_(name)
+	{
+		if(stats_ != NULL) {
+			stats_->num_running_timers++;
+		}
+	}
+
+	~scoped_named_timer()
+	{
+		if(stats_ != NULL) {
+			stats_->num_running_timers--;
+			stats_->add_entry(NamedTimeEntry(name_, timer_.get_time()),
+			                  stats_->num_running_timers > 0);
+		}
+	}
+
+protected:
+	NamedTimeStats *stats_;
+	string name_;
+	scoped_timer timer_;
+};
+
 class NamedNestedSampleStats {
 public:
 	NamedNestedSampleStats();
@@ -102,7 +176,9 @@ class NamedSampleCountStats {
 public:
 	NamedSampleCountStats();
 
-	string full_report(int indent_level = 0);
+	/* Generate report sorted by cost, listing at most max_entries entries
+	 * with the rest summed up, or all entries if zero. */
+	string full_report(int indent_level = 0, int max_entries = 0);
 	void add(const ustring& name, uint64_t samples, uint64_t hits);
 
 	typedef unordered_map<ustring, NamedSampleCountPair, ustringHash> entry_map;
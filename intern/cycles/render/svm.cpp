@@ -168,6 +168,8 @@ SVMCompiler::SVMCompiler(ShaderManager *shader_manager_,
 	background = false;
 	mix_weight_offset = SVM_STACK_INVALID;
 	compile_failed = false;
+	last_node = NULL;
+	last_node_end = 0;
 }
 
 int SVMCompiler::stack_size(SocketType::Type type)
@@ -427,12 +429,26 @@ void SVMCompiler::find_dependencies(ShaderNodeSet& dependencies,
 	}
 }
 
+bool SVMCompiler::is_last_compiled(ShaderNode *node)
+{
+	return (node == last_node && current_svm_nodes.size() == last_node_end);
+}
+
+int4& SVMCompiler::last_svm_node()
+{
+	assert(current_svm_nodes.size() > 0);
+	return current_svm_nodes[current_svm_nodes.size() - 1];
+}
+
 void SVMCompiler::generate_node(ShaderNode *node, ShaderNodeSet& done)
 {
 	node->compile(*this);
 	stack_clear_users(node, done);
 	stack_clear_temporary(node);
 
+	last_node = node;
+	last_node_end = current_svm_nodes.size();
+
 	if(current_type == SHADER_TYPE_SURFACE) {
 		if(node->has_spatial_varying())
 			current_shader->has_surface_spatial_varying = true;
@@ -478,6 +494,16 @@ void SVMCompiler::generate_svm_nodes(const ShaderNodeSet& nodes,
 					generate_node(node, done);
 					done.insert(node);
 					done_flag[node->id] = true;
+
+					/* Generate the only user of the node right after it when
+					 * possible, so their instructions can be fused. */
+					ShaderNode *user = find_fused_user(node, nodes, state);
+					while(user) {
+						generate_node(user, done);
+						done.insert(user);
+						done_flag[user->id] = true;
+						user = find_fused_user(user, nodes, state);
+					}
 				}
 				else {
 					nodes_done = false;
@@ -487,6 +513,36 @@ void SVMCompiler::generate_svm_nodes(const ShaderNodeSet& nodes,
 	} while(!nodes_done);
 }
 
+ShaderNode *SVMCompiler::find_fused_user(ShaderNode *node,
+                                         const ShaderNodeSet& nodes,
+                                         CompilerState *state)
+{
+	/* Only chains of math nodes are fused currently. */
+	if(node->type != MathNode::node_type ||
+	   node->outputs.size() != 1 ||
+	   node->outputs[0]->links.size() != 1)
+	{
+		return NULL;
+	}
+
+	ShaderNode *user = node->outputs[0]->links[0]->parent;
+
+	if(user->type != MathNode::node_type ||
+	   state->nodes_done_flag[user->id] ||
+	   nodes.find(user) == nodes.end())
+	{
+		return NULL;
+	}
+
+	foreach(ShaderInput *input, user->inputs) {
+		if(input->link && !state->nodes_done_flag[input->link->parent->id]) {
+			return NULL;
+		}
+	}
+
+	return user;
+}
+
 void SVMCompiler::generate_closure_node(ShaderNode *node,
                                         CompilerState *state)
 {
@@ -728,6 +784,8 @@ void SVMCompiler::compile_type(Shader *shader, ShaderGraph *graph, ShaderType ty
 	/* clear all compiler state */
 	memset((void *)&active_stack, 0, sizeof(active_stack));
 	current_svm_nodes.clear();
+	last_node = NULL;
+	last_node_end = 0;
 
 	foreach(ShaderNode *node_iter, graph->nodes) {
 		foreach(ShaderInput *input, node_iter->inputs)
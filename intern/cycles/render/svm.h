@@ -124,6 +124,11 @@ public:
 	uint encode_uchar4(uint x, uint y = 0, uint z = 0, uint w = 0);
 	uint closure_mix_weight_offset() { return mix_weight_offset; }
 
+	/* Superinstructions: a node can continue the instruction of the node that
+	 * was compiled right before it, instead of going through the stack. */
+	bool is_last_compiled(ShaderNode *node);
+	int4& last_svm_node();
+
 	ShaderType output_type() { return current_type; }
 
 	ImageManager *image_manager;
@@ -201,6 +206,9 @@ protected:
 	                                    const ShaderNodeSet& shared);
 	void generate_svm_nodes(const ShaderNodeSet& nodes,
 	                        CompilerState *state);
+	ShaderNode *find_fused_user(ShaderNode *node,
+	                            const ShaderNodeSet& nodes,
+	                            CompilerState *state);
 
 	/* multi closure */
 	void generate_multi_closure(ShaderNode *root_node,
@@ -214,6 +222,8 @@ protected:
 	ShaderType current_type;
 	Shader *current_shader;
 	ShaderGraph *current_graph;
+	ShaderNode *last_node;
+	size_t last_node_end;
 	Stack active_stack;
 	int max_stack_use;
 	uint mix_weight_offset;
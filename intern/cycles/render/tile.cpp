@@ -18,6 +18,7 @@
 
 #include "util/util_algorithm.h"
 #include "util/util_foreach.h"
+#include "util/util_time.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -61,6 +62,29 @@ protected:
 	Tile *tiles;
 };
 
+/* Orders tiles by their measured cost, most expensive first. */
+class TileCostComparator {
+public:
+	explicit TileCostComparator(const vector<double>& costs_)
+	 :  costs(costs_)
+	{}
+
+	bool operator()(int a, int b)
+	{
+		return costs[a] > costs[b];
+	}
+
+protected:
+	const vector<double>& costs;
+};
+
+/* Tiles are never split into parts smaller than this many pixels. */
+const int TILE_SPLIT_MIN_SIZE = 8;
+
+/* Maximum number of split tiles per worker. Space for them is reserved
+ * up-front, since pointers to tiles are handed out to the devices. */
+const int TILE_SPLIT_MAX_PER_WORKER = 8;
+
 inline int2 hilbert_index_to_pos(int n, int d)
 {
 	int2 r, xy = make_int2(0, 0);
@@ -102,6 +126,9 @@ TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, i
 	preserve_tile_device = preserve_tile_device_;
 	background = background_;
 	schedule_denoising = false;
+	num_workers = 0;
+	cost_prepass_samples = 0;
+	num_nodes = 1;
 
 	range_start_sample = 0;
 	range_num_samples = -1;
@@ -153,6 +180,8 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.resolution_divider = get_divider(params.width, params.height, start_resolution);
 	state.render_tiles.clear();
 	state.denoising_tiles.clear();
+	state.prepass = false;
+	state.tile_costs.clear();
 	device_free();
 }
 
@@ -182,6 +211,9 @@ void TileManager::set_samples(int num_samples_)
 		if(schedule_denoising) {
 			state.total_pixel_samples += params.width*params.height;
 		}
+		if(use_cost_prepass()) {
+			state.total_pixel_samples += (uint64_t)cost_prepass_samples * image_w*image_h;
+		}
 	}
 }
 
@@ -195,6 +227,9 @@ int TileManager::gen_tiles(bool sliced)
 	int2 center = make_int2(image_w/2, image_h/2);
 
 	int num_logical_devices = preserve_tile_device? num_devices: 1;
+	if(use_node_tiles()) {
+		num_logical_devices = num_nodes;
+	}
 	int num = min(image_h, num_logical_devices);
 	int slice_num = sliced? num: 1;
 	int tile_w = (tile_size.x >= image_w) ? 1 : divide_up(image_w, tile_size.x);
@@ -364,6 +399,22 @@ void TileManager::set_tiles()
 
 	state.num_tiles = gen_tiles(!background);
 
+	if(state.prepass) {
+		state.tile_costs.clear();
+		state.tile_costs.resize(state.tiles.size(), 0.0);
+	}
+	else if(state.tile_costs.size() == state.tiles.size()) {
+		/* Start with the most expensive tiles measured by the prepass, so
+		 * the cheap ones fill up the gaps at the end of the render. */
+		foreach(list<int>& tile_list, state.render_tiles) {
+			tile_list.sort(TileCostComparator(state.tile_costs));
+		}
+	}
+
+	if(use_tile_splitting()) {
+		state.tiles.reserve(state.tiles.size() + num_workers * TILE_SPLIT_MAX_PER_WORKER);
+	}
+
 	state.buffer.width = image_w;
 	state.buffer.height = image_h;
 
@@ -416,6 +467,14 @@ bool TileManager::finish_tile(int index, bool &delete_tile)
 		return true;
 	}
 
+	if(state.prepass) {
+		/* Prepass tiles are only rendered to measure their cost. */
+		state.tile_costs[index] = time_dt() - state.tiles[index].start_time;
+		state.tiles[index].state = Tile::DONE;
+		delete_tile = true;
+		return false;
+	}
+
 	switch(state.tiles[index].state) {
 		case Tile::RENDER:
 		{
@@ -462,9 +521,12 @@ bool TileManager::finish_tile(int index, bool &delete_tile)
 	}
 }
 
-bool TileManager::next_tile(Tile* &tile, int device)
+bool TileManager::next_tile(Tile* &tile, int device, int node)
 {
 	int logical_device = preserve_tile_device? device: 0;
+	if(use_node_tiles()) {
+		logical_device = get_node_tiles(node);
+	}
 
 	if(logical_device >= state.render_tiles.size())
 		return false;
@@ -481,7 +543,108 @@ bool TileManager::next_tile(Tile* &tile, int device)
 
 	int idx = state.render_tiles[logical_device].front();
 	state.render_tiles[logical_device].pop_front();
+
+	if(use_tile_splitting()) {
+		int num_remaining = 0;
+		foreach(list<int>& tile_list, state.render_tiles) {
+			num_remaining += tile_list.size();
+		}
+		if(num_remaining + 1 < num_workers) {
+			split_tile(idx, logical_device);
+		}
+	}
+
 	tile = &state.tiles[idx];
+	tile->start_time = time_dt();
+	return true;
+}
+
+bool TileManager::use_cost_prepass()
+{
+	/* Only worth it when the prepass is a small fraction of the render. */
+	return cost_prepass_samples > 0 &&
+	       background && !progressive && !preserve_tile_device &&
+	       get_num_effective_samples() >= 8*cost_prepass_samples;
+}
+
+bool TileManager::use_tile_splitting()
+{
+	/* Denoising relies on the regular tile grid to find neighbors. */
+	return num_workers > 1 &&
+	       background && !progressive && !preserve_tile_device &&
+	       !schedule_denoising && !state.prepass;
+}
+
+bool TileManager::use_node_tiles()
+{
+	return num_nodes > 1 &&
+	       background && !progressive && !preserve_tile_device;
+}
+
+/* Get the tile lists for threads of the given node. Once the node's own
+ * part of the image is done, its threads help out the node with the most
+ * tiles left. */
+int TileManager::get_node_tiles(int node)
+{
+	int num_lists = state.render_tiles.size();
+	if(num_lists == 0) {
+		return 0;
+	}
+
+	int logical_device = clamp(node, 0, num_lists - 1);
+
+	if(state.render_tiles[logical_device].empty() &&
+	   state.denoising_tiles[logical_device].empty())
+	{
+		size_t max_tiles = 0;
+		for(int i = 0; i < num_lists; i++) {
+			size_t num_tiles = state.render_tiles[i].size() + state.denoising_tiles[i].size();
+			if(num_tiles > max_tiles) {
+				max_tiles = num_tiles;
+				logical_device = i;
+			}
+		}
+	}
+
+	return logical_device;
+}
+
+/* Split the tile in half along its longer side. The tile keeps the first
+ * half, the second half is added as a new tile at the front of the queue so
+ * the next idle thread picks it up. */
+bool TileManager::split_tile(int index, int device)
+{
+	/* Growing the tiles beyond the reserved space would invalidate pointers
+	 * to tiles which are currently rendering. */
+	if(state.tiles.size() >= state.tiles.capacity()) {
+		return false;
+	}
+
+	Tile& tile = state.tiles[index];
+	bool split_x = (tile.w >= tile.h);
+	int size = split_x? tile.w: tile.h;
+
+	if(size < 2*TILE_SPLIT_MIN_SIZE) {
+		return false;
+	}
+
+	int half = size/2;
+	int new_index = state.tiles.size();
+	Tile new_tile;
+
+	if(split_x) {
+		new_tile = Tile(new_index, tile.x + half, tile.y, tile.w - half, tile.h, tile.device, Tile::RENDER);
+		tile.w = half;
+	}
+	else {
+		new_tile = Tile(new_index, tile.x, tile.y + half, tile.w, tile.h - half, tile.device, Tile::RENDER);
+		tile.h = half;
+	}
+
+	state.tiles.push_back(new_tile);
+	state.render_tiles[device].push_front(new_index);
+	state.num_tiles++;
+
 	return true;
 }
 
@@ -490,7 +653,8 @@ bool TileManager::done()
 	int end_sample = (range_num_samples == -1)
 	                     ? num_samples
 	                     : range_start_sample + range_num_samples;
-	return (state.resolution_divider == pixel_size) &&
+	return !state.prepass &&
+	       (state.resolution_divider == pixel_size) &&
 	       (state.sample+state.num_samples >= end_sample);
 }
 
@@ -505,7 +669,20 @@ bool TileManager::next()
 		state.num_samples = 1;
 		set_tiles();
 	}
+	else if(use_cost_prepass() && !state.prepass && state.tile_costs.empty()) {
+		state.prepass = true;
+		state.sample = range_start_sample;
+		state.num_samples = cost_prepass_samples;
+		state.resolution_divider = pixel_size;
+		set_tiles();
+	}
 	else {
+		if(state.prepass) {
+			/* Prepass is done, render the actual samples from the start. */
+			state.prepass = false;
+			state.sample = range_start_sample - 1;
+		}
+
 		state.sample++;
 
 		if(progressive)
@@ -39,12 +39,14 @@ public:
 	typedef enum { RENDER = 0, RENDERED, DENOISE, DENOISED, DONE } State;
 	State state;
 	RenderBuffers *buffers;
+	/* Time at which the tile was handed out to a device, used to measure its cost. */
+	double start_time;
 
 	Tile()
 	{}
 
 	Tile(int index_, int x_, int y_, int w_, int h_, int device_, State state_ = RENDER)
-	: index(index_), x(x_), y(y_), w(w_), h(h_), device(device_), state(state_), buffers(NULL) {}
+	: index(index_), x(x_), y(y_), w(w_), h(h_), device(device_), state(state_), buffers(NULL), start_time(0.0) {}
 };
 
 /* Tile order */
@@ -83,6 +85,12 @@ public:
 		 * Each list in each vector is for one logical device. */
 		vector<list<int> > render_tiles;
 		vector<list<int> > denoising_tiles;
+
+		/* True while rendering the cost estimation prepass. */
+		bool prepass;
+
+		/* Render time of every tile in the prepass, indexed by tile index. */
+		vector<double> tile_costs;
 	} state;
 
 	int num_samples;
@@ -95,7 +103,7 @@ public:
 	void reset(BufferParams& params, int num_samples);
 	void set_samples(int num_samples);
 	bool next();
-	bool next_tile(Tile* &tile, int device = 0);
+	bool next_tile(Tile* &tile, int device = 0, int node = -1);
 	bool finish_tile(int index, bool& delete_tile);
 	bool done();
 
@@ -114,6 +122,23 @@ public:
 
 	/* Schedule tiles for denoising after they've been rendered. */
 	bool schedule_denoising;
+
+	/* ** Tail-end load balancing. ** */
+
+	/* Number of threads acquiring tiles. When fewer tiles than this are left,
+	 * the remaining tiles are split so no thread sits idle at the end of the
+	 * render. Zero or one disables splitting. */
+	int num_workers;
+
+	/* Number of samples for a prepass which measures the cost of every tile,
+	 * so that the actual render can start with the most expensive tiles.
+	 * Zero disables the prepass. */
+	int cost_prepass_samples;
+
+	/* Number of NUMA nodes the threads acquiring tiles are spread over.
+	 * Every node gets its own contiguous part of the image, so that the
+	 * threads of one node share the cached scene data of that part. */
+	int num_nodes;
 protected:
 
 	void set_tiles();
@@ -148,6 +173,12 @@ protected:
 	int gen_tiles(bool sliced);
 	void gen_render_tiles();
 
+	bool use_cost_prepass();
+	bool use_tile_splitting();
+	bool use_node_tiles();
+	int get_node_tiles(int node);
+	bool split_tile(int index, int device);
+
 	int get_neighbor_index(int index, int neighbor);
 	bool check_neighbor_state(int index, Tile::State state);
 };
@@ -29,7 +29,15 @@ EdgeDice::EdgeDice(const SubdParams& params_)
 {
 	mesh_P = NULL;
 	mesh_N = NULL;
+	mesh_patch_uv = NULL;
+	mesh_ptex_uv = NULL;
+	mesh_triangles = NULL;
+	mesh_shader = NULL;
+	mesh_smooth = NULL;
+	mesh_triangle_patch = NULL;
+	mesh_ptex_face_id = NULL;
 	vert_offset = 0;
+	tri_offset = 0;
 
 	params.mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
@@ -39,24 +47,28 @@ EdgeDice::EdgeDice(const SubdParams& params_)
 	}
 }
 
-void EdgeDice::reserve(int num_verts)
+void EdgeDice::reserve(int num_verts, int num_triangles)
 {
 	Mesh *mesh = params.mesh;
 
 	vert_offset = mesh->verts.size();
 	tri_offset = mesh->num_triangles();
 
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(vert_offset + num_verts > mesh->verts.capacity()) {
-		mesh->reserve_mesh(size_t((vert_offset + num_verts) * 1.2), mesh->num_triangles());
-	}
-
-	mesh->resize_mesh(vert_offset + num_verts, tri_offset);
-
-	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+	mesh->resize_mesh(vert_offset + num_verts, tri_offset + num_triangles);
+	mesh->num_subd_verts += num_verts;
 
 	mesh_P = mesh->verts.data();
-	mesh_N = attr_vN->data_float3();
+	mesh_N = mesh->attributes.find(ATTR_STD_VERTEX_NORMAL)->data_float3();
+	mesh_patch_uv = mesh->vert_patch_uv.data();
+	mesh_triangles = mesh->triangles.data();
+	mesh_shader = mesh->shader.data();
+	mesh_smooth = mesh->smooth.data();
+	mesh_triangle_patch = mesh->triangle_patch.data();
+
+	if(params.ptex) {
+		mesh_ptex_uv = mesh->attributes.find(ATTR_STD_PTEX_UV)->data_float3();
+		mesh_ptex_face_id = mesh->attributes.find(ATTR_STD_PTEX_FACE_ID)->data_float();
+	}
 }
 
 int EdgeDice::add_vert(Patch *patch, float2 uv)
@@ -69,38 +81,28 @@ int EdgeDice::add_vert(Patch *patch, float2 uv)
 
 	mesh_P[vert_offset] = P;
 	mesh_N[vert_offset] = N;
-	params.mesh->vert_patch_uv[vert_offset] = make_float2(uv.x, uv.y);
+	mesh_patch_uv[vert_offset] = make_float2(uv.x, uv.y);
 
 	if(params.ptex) {
-		Attribute *attr_ptex_uv = params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.resize();
-
-		float3 *ptex_uv = attr_ptex_uv->data_float3();
-		ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
+		mesh_ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
 	}
 
-	params.mesh->num_subd_verts++;
-
 	return vert_offset++;
 }
 
 void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
 {
-	Mesh *mesh = params.mesh;
-
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(mesh->triangles.size() == mesh->triangles.capacity())
-		mesh->reserve_mesh(mesh->verts.size(), size_t(max(mesh->num_triangles() + 1, 1) * 1.2));
+	assert(tri_offset < params.mesh->num_triangles());
 
-	mesh->add_triangle(v0, v1, v2, patch->shader, true);
-	params.mesh->triangle_patch[params.mesh->num_triangles()-1] = patch->patch_index;
+	mesh_triangles[tri_offset*3 + 0] = v0;
+	mesh_triangles[tri_offset*3 + 1] = v1;
+	mesh_triangles[tri_offset*3 + 2] = v2;
+	mesh_shader[tri_offset] = patch->shader;
+	mesh_smooth[tri_offset] = true;
+	mesh_triangle_patch[tri_offset] = patch->patch_index;
 
 	if(params.ptex) {
-		Attribute *attr_ptex_face_id = params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-		params.mesh->attributes.resize();
-
-		float *ptex_face_id = attr_ptex_face_id->data_float();
-		ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
+		mesh_ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
 	}
 
 	tri_offset++;
@@ -150,11 +152,35 @@ QuadDice::QuadDice(const SubdParams& params_)
 {
 }
 
-void QuadDice::reserve(EdgeFactors& ef, int Mu, int Mv)
+void QuadDice::grid_size(SubPatch& sub, EdgeFactors& ef, int *Mu, int *Mv)
 {
+	/* compute inner grid size with scale factor */
+	int tu = max(ef.tu0, ef.tu1);
+	int tv = max(ef.tv0, ef.tv1);
+
+#if 0 /* Doesnt work very well, especially at grazing angles. */
+	float S = scale_factor(sub, ef, tu, tv);
+#else
+	(void)sub;
+	float S = 1.0f;
+#endif
+
+	*Mu = max((int)ceil(S*tu), 2); // XXX handle 0 & 1?
+	*Mv = max((int)ceil(S*tv), 2); // XXX handle 0 & 1?
+}
+
+void QuadDice::count(SubPatch& sub, EdgeFactors& ef, int *num_verts, int *num_triangles)
+{
+	int Mu, Mv;
+	grid_size(sub, ef, &Mu, &Mv);
+
 	/* XXX need to make this also work for edge factor 0 and 1 */
-	int num_verts = (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) + (Mu - 1)*(Mv - 1);
-	EdgeDice::reserve(num_verts);
+	int num_edge = ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1;
+
+	/* corners, edge and inner grid verts */
+	*num_verts = num_edge + (Mu - 1)*(Mv - 1);
+	/* inner grid quads, plus stitching of each side to the inner grid */
+	*num_triangles = 2*(Mu - 2)*(Mv - 2) + 2*(Mu - 2) + 2*(Mv - 2) + num_edge;
 }
 
 float2 QuadDice::map_uv(SubPatch& sub, float u, float v)
@@ -305,22 +331,11 @@ void QuadDice::add_grid(SubPatch& sub, int Mu, int Mv, int offset)
 
 void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 {
-	/* compute inner grid size with scale factor */
-	int Mu = max(ef.tu0, ef.tu1);
-	int Mv = max(ef.tv0, ef.tv1);
+	int Mu, Mv;
+	grid_size(sub, ef, &Mu, &Mv);
 
-#if 0 /* Doesnt work very well, especially at grazing angles. */
-	float S = scale_factor(sub, ef, Mu, Mv);
-#else
-	float S = 1.0f;
-#endif
-
-	Mu = max((int)ceil(S*Mu), 2); // XXX handle 0 & 1?
-	Mv = max((int)ceil(S*Mv), 2); // XXX handle 0 & 1?
-
-	/* reserve space for new verts */
-	int offset = params.mesh->verts.size();
-	reserve(ef, Mu, Mv);
+	/* verts are written into space reserved by the caller, see count() */
+	int offset = vert_offset;
 
 	/* corners and inner grid */
 	add_corners(sub);
@@ -343,8 +358,6 @@ void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 	/* right side */
 	add_side_v(sub, outer, inner, Mu, Mv, ef.tv1, 1, offset);
 	stitch_triangles(sub.patch, outer, inner);
-
-	assert(vert_offset == params.mesh->verts.size());
 }
 
 CCL_NAMESPACE_END
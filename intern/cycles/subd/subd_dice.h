@@ -63,12 +63,23 @@ public:
 	SubdParams params;
 	float3 *mesh_P;
 	float3 *mesh_N;
+	float2 *mesh_patch_uv;
+	float3 *mesh_ptex_uv;
+	int *mesh_triangles;
+	int *mesh_shader;
+	bool *mesh_smooth;
+	int *mesh_triangle_patch;
+	float *mesh_ptex_face_id;
 	size_t vert_offset;
 	size_t tri_offset;
 
 	explicit EdgeDice(const SubdParams& params);
 
-	void reserve(int num_verts);
+	/* Grow the mesh once for all verts and triangles that will be diced, after
+	 * which add_vert and add_triangle only write into the reserved space at
+	 * vert_offset and tri_offset, so multiple EdgeDice copies may fill disjoint
+	 * ranges of the same mesh from different threads. */
+	void reserve(int num_verts, int num_triangles);
 
 	int add_vert(Patch *patch, float2 uv);
 	void add_triangle(Patch *patch, int v0, int v1, int v2);
@@ -109,7 +120,9 @@ public:
 
 	explicit QuadDice(const SubdParams& params);
 
-	void reserve(EdgeFactors& ef, int Mu, int Mv);
+	void grid_size(SubPatch& sub, EdgeFactors& ef, int *Mu, int *Mv);
+	void count(SubPatch& sub, EdgeFactors& ef, int *num_verts, int *num_triangles);
+
 	float3 eval_projected(SubPatch& sub, float u, float v);
 
 	float2 map_uv(SubPatch& sub, float u, float v);
@@ -21,15 +21,52 @@
 #include "subd/subd_patch.h"
 #include "subd/subd_split.h"
 
+#include "util/util_foreach.h"
 #include "util/util_math.h"
+#include "util/util_task.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Number of patches split per task, and approximate number of verts diced
+ * per task. */
+#define DSPLIT_PATCH_BATCH_SIZE 64
+#define DSPLIT_DICE_BATCH_VERTS 16384
+
+/* DiagSplitCache */
+
+DiagSplitCache::DiagSplitCache()
+{
+	clear();
+}
+
+bool DiagSplitCache::valid(const SubdParams& params, size_t num_patches)
+{
+	return test_steps == params.test_steps &&
+	       split_threshold == params.split_threshold &&
+	       dicing_rate == params.dicing_rate &&
+	       max_level == params.max_level &&
+	       patches_quad.size() == num_patches;
+}
+
+void DiagSplitCache::clear()
+{
+	test_steps = 0;
+	split_threshold = 0;
+	dicing_rate = 0.0f;
+	max_level = 0;
+
+	patches_quad.clear();
+	patch_edgefactors.clear();
+	patch_subpatch_offset.clear();
+	subpatches_quad.clear();
+	edgefactors_quad.clear();
+}
+
 /* DiagSplit */
 
-DiagSplit::DiagSplit(const SubdParams& params_)
-: params(params_)
+DiagSplit::DiagSplit(const SubdParams& params_, DiagSplitCache *cache_)
+: params(params_), cache(cache_)
 {
 }
 
@@ -214,13 +251,23 @@ void DiagSplit::split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int de
 	}
 }
 
+void DiagSplit::edge_factors(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef)
+{
+	ef.tu0 = T(sub.patch, sub.P00, sub.P10);
+	ef.tu1 = T(sub.patch, sub.P01, sub.P11);
+	ef.tv0 = T(sub.patch, sub.P00, sub.P01);
+	ef.tv1 = T(sub.patch, sub.P10, sub.P11);
+
+	limit_edge_factors(sub, ef, 1 << params.max_level);
+}
+
 void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 {
 	QuadDice::SubPatch sub_split;
-	QuadDice::EdgeFactors ef_split;
 
 	if(subpatch) {
 		sub_split = *subpatch;
+		sub_split.patch = patch;
 	}
 	else {
 		sub_split.patch = patch;
@@ -230,29 +277,209 @@ void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 		sub_split.P11 = make_float2(1.0f, 1.0f);
 	}
 
-	ef_split.tu0 = T(patch, sub_split.P00, sub_split.P10);
-	ef_split.tu1 = T(patch, sub_split.P01, sub_split.P11);
-	ef_split.tv0 = T(patch, sub_split.P00, sub_split.P01);
-	ef_split.tv1 = T(patch, sub_split.P10, sub_split.P11);
+	patches_quad.push_back(sub_split);
+}
+
+static bool cached_split_reusable(const QuadDice::SubPatch& sub,
+                                  const QuadDice::EdgeFactors& ef,
+                                  const QuadDice::SubPatch& cached_sub,
+                                  const QuadDice::EdgeFactors& cached_ef)
+{
+	/* non-uniform edges are partitioned by evaluating the patch, so only
+	 * uniform edges are guaranteed to be split the same way again */
+	if(ef.tu0 == DSPLIT_NON_UNIFORM || ef.tu1 == DSPLIT_NON_UNIFORM ||
+	   ef.tv0 == DSPLIT_NON_UNIFORM || ef.tv1 == DSPLIT_NON_UNIFORM)
+	{
+		return false;
+	}
+
+	return ef.tu0 == cached_ef.tu0 && ef.tu1 == cached_ef.tu1 &&
+	       ef.tv0 == cached_ef.tv0 && ef.tv1 == cached_ef.tv1 &&
+	       sub.P00 == cached_sub.P00 && sub.P10 == cached_sub.P10 &&
+	       sub.P01 == cached_sub.P01 && sub.P11 == cached_sub.P11;
+}
+
+void DiagSplit::split_patches_task(int start,
+                                   int end,
+                                   vector<QuadDice::EdgeFactors> *patch_edgefactors,
+                                   vector<int> *patch_num_subpatches,
+                                   DiagSplit *result)
+{
+	bool use_cache = (cache && cache->patches_quad.size() == patches_quad.size());
 
-	limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
+	for(int i = start; i < end; i++) {
+		QuadDice::SubPatch& sub = patches_quad[i];
+		QuadDice::EdgeFactors ef;
 
-	split(sub_split, ef_split);
+		edge_factors(sub, ef);
+		(*patch_edgefactors)[i] = ef;
 
-	QuadDice dice(params);
+		size_t num_subpatches = result->subpatches_quad.size();
 
-	for(size_t i = 0; i < subpatches_quad.size(); i++) {
-		QuadDice::SubPatch& sub = subpatches_quad[i];
-		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
+		if(use_cache && cached_split_reusable(sub, ef,
+		                                      cache->patches_quad[i],
+		                                      cache->patch_edgefactors[i]))
+		{
+			for(int j = cache->patch_subpatch_offset[i]; j < cache->patch_subpatch_offset[i+1]; j++) {
+				QuadDice::SubPatch cached_sub = cache->subpatches_quad[j];
+				cached_sub.patch = sub.patch;
 
+				result->subpatches_quad.push_back(cached_sub);
+				result->edgefactors_quad.push_back(cache->edgefactors_quad[j]);
+			}
+		}
+		else {
+			result->split(sub, ef);
+		}
+
+		(*patch_num_subpatches)[i] = (int)(result->subpatches_quad.size() - num_subpatches);
+	}
+
+	foreach(QuadDice::EdgeFactors& ef, result->edgefactors_quad) {
 		ef.tu0 = max(ef.tu0, 1);
 		ef.tu1 = max(ef.tu1, 1);
 		ef.tv0 = max(ef.tv0, 1);
 		ef.tv1 = max(ef.tv1, 1);
+	}
+}
+
+void DiagSplit::dice_subpatches_task(const QuadDice& dice_prototype,
+                                     const vector<int> *vert_offsets,
+                                     const vector<int> *tri_offsets,
+                                     int start,
+                                     int end)
+{
+	QuadDice dice(dice_prototype);
+
+	for(int i = start; i < end; i++) {
+		dice.vert_offset = dice_prototype.vert_offset + (*vert_offsets)[i];
+		dice.tri_offset = dice_prototype.tri_offset + (*tri_offsets)[i];
+
+		dice.dice(subpatches_quad[i], edgefactors_quad[i]);
+
+		assert(dice.vert_offset == dice_prototype.vert_offset + (*vert_offsets)[i+1]);
+		assert(dice.tri_offset == dice_prototype.tri_offset + (*tri_offsets)[i+1]);
+	}
+}
+
+void DiagSplit::post_split()
+{
+	int num_patches = patches_quad.size();
+
+	if(num_patches == 0) {
+		return;
+	}
+
+	if(cache && !cache->valid(params, num_patches)) {
+		cache->clear();
+	}
+
+	/* split patches in batches, subpatches of each batch are gathered in a
+	 * separate list to keep them in patch order */
+	int num_batches = (num_patches + DSPLIT_PATCH_BATCH_SIZE - 1) / DSPLIT_PATCH_BATCH_SIZE;
+	vector<DiagSplit> batches(num_batches, DiagSplit(params));
+	vector<QuadDice::EdgeFactors> patch_edgefactors(num_patches);
+	vector<int> patch_num_subpatches(num_patches, 0);
+
+	TaskPool pool;
+
+	for(int i = 0; i < num_batches; i++) {
+		int start = i * DSPLIT_PATCH_BATCH_SIZE;
+		int end = min(start + DSPLIT_PATCH_BATCH_SIZE, num_patches);
+
+		pool.push(function_bind(&DiagSplit::split_patches_task,
+		                        this,
+		                        start,
+		                        end,
+		                        &patch_edgefactors,
+		                        &patch_num_subpatches,
+		                        &batches[i]));
+	}
+
+	pool.wait_work();
+
+	subpatches_quad.clear();
+	edgefactors_quad.clear();
+
+	foreach(DiagSplit& batch, batches) {
+		subpatches_quad.insert(subpatches_quad.end(),
+		                       batch.subpatches_quad.begin(),
+		                       batch.subpatches_quad.end());
+		edgefactors_quad.insert(edgefactors_quad.end(),
+		                        batch.edgefactors_quad.begin(),
+		                        batch.edgefactors_quad.end());
+	}
+
+	batches.clear();
+
+	/* count verts and triangles of each subpatch, so the mesh can be resized
+	 * once and subpatches diced in parallel into their own range */
+	int num_subpatches = subpatches_quad.size();
+	vector<int> vert_offsets(num_subpatches + 1);
+	vector<int> tri_offsets(num_subpatches + 1);
+
+	QuadDice dice(params);
+
+	vert_offsets[0] = 0;
+	tri_offsets[0] = 0;
+
+	for(int i = 0; i < num_subpatches; i++) {
+		int num_verts, num_triangles;
+		dice.count(subpatches_quad[i], edgefactors_quad[i], &num_verts, &num_triangles);
+
+		vert_offsets[i+1] = vert_offsets[i] + num_verts;
+		tri_offsets[i+1] = tri_offsets[i] + num_triangles;
+	}
+
+	dice.reserve(vert_offsets[num_subpatches], tri_offsets[num_subpatches]);
+
+	int start = 0;
+
+	for(int i = 0; i < num_subpatches; i++) {
+		if(vert_offsets[i+1] - vert_offsets[start] >= DSPLIT_DICE_BATCH_VERTS ||
+		   i+1 == num_subpatches)
+		{
+			pool.push(function_bind(&DiagSplit::dice_subpatches_task,
+			                        this,
+			                        dice,
+			                        &vert_offsets,
+			                        &tri_offsets,
+			                        start,
+			                        i+1));
+			start = i+1;
+		}
+	}
+
+	pool.wait_work();
+
+	/* store split results for the next tessellation */
+	if(cache) {
+		cache->test_steps = params.test_steps;
+		cache->split_threshold = params.split_threshold;
+		cache->dicing_rate = params.dicing_rate;
+		cache->max_level = params.max_level;
+
+		cache->patch_subpatch_offset.resize(num_patches + 1);
+		cache->patch_subpatch_offset[0] = 0;
+
+		for(int i = 0; i < num_patches; i++) {
+			cache->patch_subpatch_offset[i+1] = cache->patch_subpatch_offset[i] + patch_num_subpatches[i];
+		}
+
+		foreach(QuadDice::SubPatch& sub, patches_quad) {
+			sub.patch = NULL;
+		}
+		foreach(QuadDice::SubPatch& sub, subpatches_quad) {
+			sub.patch = NULL;
+		}
 
-		dice.dice(sub, ef);
+		cache->patches_quad.swap(patches_quad);
+		cache->patch_edgefactors.swap(patch_edgefactors);
+		cache->subpatches_quad.swap(subpatches_quad);
+		cache->edgefactors_quad.swap(edgefactors_quad);
 	}
 
+	patches_quad.clear();
 	subpatches_quad.clear();
 	edgefactors_quad.clear();
 }
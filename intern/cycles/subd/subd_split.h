@@ -34,14 +34,41 @@ class Patch;
 
 #define DSPLIT_NON_UNIFORM -1
 
+/* Split results of the previous tessellation of a mesh, kept across frames.
+ * Patches whose edge factors are uniform and unchanged reuse their subpatches
+ * instead of being split again. Edge factors are all that determine how patch
+ * boundaries get partitioned, so reused and freshly split neighbors still
+ * stitch together without cracks. */
+class DiagSplitCache {
+public:
+	DiagSplitCache();
+
+	bool valid(const SubdParams& params, size_t num_patches);
+	void clear();
+
+	int test_steps;
+	int split_threshold;
+	float dicing_rate;
+	int max_level;
+
+	/* per patch domain, edge factors and index of first subpatch */
+	vector<QuadDice::SubPatch> patches_quad;
+	vector<QuadDice::EdgeFactors> patch_edgefactors;
+	vector<int> patch_subpatch_offset;
+
+	vector<QuadDice::SubPatch> subpatches_quad;
+	vector<QuadDice::EdgeFactors> edgefactors_quad;
+};
+
 class DiagSplit {
 public:
 	vector<QuadDice::SubPatch> subpatches_quad;
 	vector<QuadDice::EdgeFactors> edgefactors_quad;
 
 	SubdParams params;
+	DiagSplitCache *cache;
 
-	explicit DiagSplit(const SubdParams& params);
+	explicit DiagSplit(const SubdParams& params, DiagSplitCache *cache = NULL);
 
 	float3 to_world(Patch *patch, float2 uv);
 	int T(Patch *patch, float2 Pstart, float2 Pend);
@@ -51,7 +78,27 @@ public:
 	void dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef);
 	void split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
 
+	/* Queue a patch, it must stay alive until post_split(). */
 	void split_quad(Patch *patch, QuadDice::SubPatch *subpatch=NULL);
+
+	/* Split and dice all queued patches, in parallel per batch of patches. */
+	void post_split();
+
+protected:
+	vector<QuadDice::SubPatch> patches_quad;
+
+	void edge_factors(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef);
+
+	void split_patches_task(int start,
+	                        int end,
+	                        vector<QuadDice::EdgeFactors> *patch_edgefactors,
+	                        vector<int> *patch_num_subpatches,
+	                        DiagSplit *result);
+	void dice_subpatches_task(const QuadDice& dice_prototype,
+	                          const vector<int> *vert_offsets,
+	                          const vector<int> *tri_offsets,
+	                          int start,
+	                          int end);
 };
 
 CCL_NAMESPACE_END
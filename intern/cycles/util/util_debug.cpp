@@ -32,7 +32,9 @@ DebugFlags::CPU::CPU()
     sse3(true),
     sse2(true),
     bvh_layout(BVH_LAYOUT_DEFAULT),
-    split_kernel(false)
+    split_kernel(false),
+    batch_kernel(false),
+    numa_replication(false)
 {
 	reset();
 }
@@ -71,6 +73,8 @@ void DebugFlags::CPU::reset()
 	}
 
 	split_kernel = false;
+	batch_kernel = (getenv("CYCLES_CPU_BATCH_KERNEL") != NULL);
+	numa_replication = (getenv("CYCLES_CPU_NUMA_REPLICATION") != NULL);
 }
 
 DebugFlags::CUDA::CUDA()
@@ -159,7 +163,9 @@ std::ostream& operator <<(std::ostream &os,
 	   << "  SSE3       : " << string_from_bool(debug_flags.cpu.sse3) << "\n"
 	   << "  SSE2       : " << string_from_bool(debug_flags.cpu.sse2) << "\n"
 	   << "  BVH layout : " << bvh_layout_name(debug_flags.cpu.bvh_layout) << "\n"
-	   << "  Split      : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n";
+	   << "  Split      : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n"
+	   << "  Batch      : " << string_from_bool(debug_flags.cpu.batch_kernel) << "\n"
+	   << "  NUMA replic: " << string_from_bool(debug_flags.cpu.numa_replication) << "\n";
 
 	os << "CUDA flags:\n"
 	   << " Adaptive Compile: " << string_from_bool(debug_flags.cuda.adaptive_compile) << "\n";
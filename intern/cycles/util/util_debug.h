@@ -65,6 +65,14 @@ public:
 
 		/* Whether split kernel is used */
 		bool split_kernel;
+
+		/* Whether camera rays are traced in blocks of pixels and their paths
+		 * continued sorted by shader. */
+		bool batch_kernel;
+
+		/* Whether read-only BVH and triangle data is replicated into the
+		 * memory of every NUMA node the render threads are running on. */
+		bool numa_replication;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
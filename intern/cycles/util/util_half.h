@@ -146,6 +146,19 @@ ccl_device_inline half float_to_half(float f)
 
 #endif
 
+/* Decode half float bits stored in an integer, works the same on all
+ * devices. Denormals are flushed to zero. */
+ccl_device_inline float half_bits_to_float(uint h)
+{
+	const uint sign = (h & 0x8000) << 16;
+	const uint exponent = (h >> 10) & 0x1f;
+	const uint mantissa = h & 0x03ff;
+	if(exponent == 0) {
+		return __uint_as_float(sign);
+	}
+	return __uint_as_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
 CCL_NAMESPACE_END
 
 #endif  /* __UTIL_HALF_H__ */
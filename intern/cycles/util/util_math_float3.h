@@ -417,6 +417,43 @@ ccl_device_inline float3 ensure_finite3(float3 v)
 	return v;
 }
 
+/* Octahedral encoding of unit vectors, as two 16 bit signed normalized
+ * values packed into an integer. The otherwise unused value of -32768 for
+ * both components is a zero vector. */
+
+ccl_device_inline uint float3_to_octahedral(float3 n)
+{
+	const float len = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if(len == 0.0f) {
+		return 0x80008000;
+	}
+	n /= len;
+	float x = n.x, y = n.y;
+	if(n.z < 0.0f) {
+		x = (1.0f - fabsf(n.y)) * signf(n.x);
+		y = (1.0f - fabsf(n.x)) * signf(n.y);
+	}
+	const int qx = (int)floorf(clamp(x, -1.0f, 1.0f) * 32767.0f + 0.5f);
+	const int qy = (int)floorf(clamp(y, -1.0f, 1.0f) * 32767.0f + 0.5f);
+	return ((uint)qx & 0xffff) | ((uint)qy << 16);
+}
+
+ccl_device_inline float3 octahedral_to_float3(uint packed)
+{
+	if(packed == 0x80008000) {
+		return make_float3(0.0f, 0.0f, 0.0f);
+	}
+	const float x = (float)((int)(packed << 16) >> 16) * (1.0f / 32767.0f);
+	const float y = (float)((int)packed >> 16) * (1.0f / 32767.0f);
+	const float z = 1.0f - fabsf(x) - fabsf(y);
+	if(z < 0.0f) {
+		return normalize(make_float3((1.0f - fabsf(y)) * signf(x),
+		                             (1.0f - fabsf(x)) * signf(y),
+		                             z));
+	}
+	return normalize(make_float3(x, y, z));
+}
+
 CCL_NAMESPACE_END
 
 #endif  /* __UTIL_MATH_FLOAT3_H__ */
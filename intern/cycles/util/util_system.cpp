@@ -20,6 +20,10 @@
 #include "util/util_types.h"
 #include "util/util_string.h"
 
+#ifdef WITH_CYCLES_NUMA
+#  include "numaapi.h"
+#endif
+
 #ifdef _WIN32
 #  if(!defined(FREE_WINDOWS))
 #    include <intrin.h>
@@ -104,6 +108,102 @@ unsigned short system_cpu_process_groups(unsigned short max_groups,
 #endif
 }
 
+#ifdef WITH_CYCLES_NUMA
+static bool system_numa_ensure_initialized()
+{
+	static bool is_initialized = false;
+	static bool result = false;
+	if(is_initialized) {
+		return result;
+	}
+	is_initialized = true;
+	const NUMAAPI_Result numa_result = numaAPI_Initialize();
+	result = (numa_result == NUMAAPI_SUCCESS);
+	if(!result) {
+		VLOG(1) << "NUMA is not available: "
+		        << numaAPI_ResultAsString(numa_result) << ".";
+	}
+	return result;
+}
+#endif
+
+int system_cpu_num_numa_nodes()
+{
+#ifdef WITH_CYCLES_NUMA
+	if(!system_numa_ensure_initialized()) {
+		return 0;
+	}
+	return numaAPI_GetNumNodes();
+#else
+	return 0;
+#endif
+}
+
+bool system_cpu_is_numa_node_available(int node)
+{
+#ifdef WITH_CYCLES_NUMA
+	if(!system_numa_ensure_initialized()) {
+		return false;
+	}
+	return numaAPI_IsNodeAvailable(node);
+#else
+	(void) node;
+	return false;
+#endif
+}
+
+int system_cpu_num_numa_node_processors(int node)
+{
+#ifdef WITH_CYCLES_NUMA
+	if(!system_numa_ensure_initialized()) {
+		return 0;
+	}
+	return numaAPI_GetNumNodeProcessors(node);
+#else
+	(void) node;
+	return 0;
+#endif
+}
+
+bool system_cpu_run_thread_on_node(int node)
+{
+#ifdef WITH_CYCLES_NUMA
+	if(!system_numa_ensure_initialized()) {
+		return false;
+	}
+	return numaAPI_RunThreadOnNode(node);
+#else
+	(void) node;
+	return false;
+#endif
+}
+
+void *system_cpu_allocate_on_node(size_t size, int node)
+{
+#ifdef WITH_CYCLES_NUMA
+	if(!system_numa_ensure_initialized()) {
+		return NULL;
+	}
+	return numaAPI_AllocateOnNode(size, node);
+#else
+	(void) size;
+	(void) node;
+	return NULL;
+#endif
+}
+
+void system_cpu_free_on_node(void *ptr, size_t size)
+{
+#ifdef WITH_CYCLES_NUMA
+	if(ptr != NULL) {
+		numaAPI_Free(ptr, size);
+	}
+#else
+	(void) ptr;
+	(void) size;
+#endif
+}
+
 #if !defined(_WIN32) || defined(FREE_WINDOWS)
 static void __cpuid(int data[4], int selector)
 {
@@ -34,6 +34,29 @@ int system_cpu_thread_count();
 unsigned short system_cpu_process_groups(unsigned short max_groups,
                                          unsigned short *grpups);
 
+/* Get number of available NUMA nodes.
+ *
+ * This is in fact an index of last node plus one and it's not guaranteed
+ * that all nodes up to this one are available. Returns 0 if NUMA is not
+ * supported on this system. */
+int system_cpu_num_numa_nodes();
+
+/* Returns truth if the given NUMA node is available for compute. */
+bool system_cpu_is_numa_node_available(int node);
+
+/* Get number of available processors on the given NUMA node. */
+int system_cpu_num_numa_node_processors(int node);
+
+/* Runs the current thread and its children on the given NUMA node.
+ * Returns truth if affinity has successfully changed. */
+bool system_cpu_run_thread_on_node(int node);
+
+/* Allocate memory which is physically located on the given NUMA node.
+ * Returns NULL if NUMA is not supported, memory is to be freed with
+ * system_cpu_free_on_node(). */
+void *system_cpu_allocate_on_node(size_t size, int node);
+void system_cpu_free_on_node(void *ptr, size_t size);
+
 string system_cpu_brand_string();
 int system_cpu_bits();
 bool system_cpu_support_sse2();
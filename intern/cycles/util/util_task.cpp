@@ -16,6 +16,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_math.h"
 #include "util/util_system.h"
 #include "util/util_task.h"
 #include "util/util_time.h"
@@ -180,6 +181,8 @@ thread_mutex TaskScheduler::mutex;
 int TaskScheduler::users = 0;
 vector<thread*> TaskScheduler::threads;
 bool TaskScheduler::do_exit = false;
+vector<int> TaskScheduler::nodes;
+vector<int> TaskScheduler::thread_nodes;
 
 list<TaskScheduler::Entry> TaskScheduler::queue;
 thread_mutex TaskScheduler::queue_mutex;
@@ -204,52 +207,78 @@ void TaskScheduler::init(int num_threads)
 		/* launch threads that will be waiting for work */
 		threads.resize(num_threads);
 
+		/* Spread threads over the NUMA nodes, filling one node before moving
+		 * on to the next one, so renders with few threads stay on a single
+		 * node. Memory allocated by a thread is then local to its node. */
+		vector<int> available_nodes;
+		const int num_numa_nodes = system_cpu_num_numa_nodes();
+		for(int node = 0; node < num_numa_nodes; ++node) {
+			if(system_cpu_is_numa_node_available(node) &&
+			   system_cpu_num_numa_node_processors(node) > 0)
+			{
+				available_nodes.push_back(node);
+			}
+		}
+		if(available_nodes.size() > 1) {
+			thread_nodes.resize(num_threads);
+			int thread_index = 0;
+			for(size_t i = 0; i < available_nodes.size() && thread_index < num_threads; ++i) {
+				const int numa_node = available_nodes[i];
+				/* NOTE: That's not really efficient from threading point of view,
+				 * but it is simple to read and it doesn't make sense to use more
+				 * user-specified threads than logical threads anyway.
+				 */
+				int num_node_threads = (i == available_nodes.size() - 1)
+				        ? num_threads - thread_index
+				        : system_cpu_num_numa_node_processors(numa_node);
+				num_node_threads = min(num_node_threads, num_threads - thread_index);
+				for(int node_thread = 0; node_thread < num_node_threads; ++node_thread) {
+					thread_nodes[thread_index++] = nodes.size();
+				}
+				nodes.push_back(numa_node);
+			}
+			VLOG(1) << "Distributed threads over " << nodes.size() << " NUMA nodes.";
+		}
+
+		/* Without NUMA distribution fall back to spreading threads over the
+		 * processor groups, which is needed on Windows to use more than 64
+		 * logical processors. */
+		vector<int> thread_groups(num_threads, -1);
 		const int num_groups = system_cpu_group_count();
-		unsigned short num_process_groups = 0;
-		vector<unsigned short> process_groups;
-		int current_group_threads = 0;
-		if(num_groups > 1) {
-			process_groups.resize(num_groups);
-			num_process_groups = system_cpu_process_groups(num_groups,
-			                                               &process_groups[0]);
+		if(nodes.size() <= 1 && num_groups > 1) {
+			vector<unsigned short> process_groups(num_groups);
+			const unsigned short num_process_groups =
+			        system_cpu_process_groups(num_groups, &process_groups[0]);
+			int current_group_threads = 0;
 			if(num_process_groups == 1) {
 				current_group_threads = system_cpu_group_thread_count(process_groups[0]);
 			}
-		}
-		int thread_index = 0;
-		for(int group = 0; group < num_groups; ++group) {
-			/* NOTE: That's not really efficient from threading point of view,
-			 * but it is simple to read and it doesn't make sense to use more
-			 * user-specified threads than logical threads anyway.
-			 */
-			int num_group_threads = (group == num_groups - 1)
-			        ? (threads.size() - thread_index)
-			        : system_cpu_group_thread_count(group);
-			for(int group_thread = 0;
-				group_thread < num_group_threads && thread_index < threads.size();
-				++group_thread, ++thread_index)
-			{
-				/* NOTE: Thread group of -1 means we would not force thread affinity. */
-				int thread_group;
-				if(num_groups == 1) {
-					/* Use default affinity if there's only one CPU group in the system. */
-					thread_group = -1;
-				}
-				else if(use_auto_threads &&
-				        num_process_groups == 1 &&
-						num_threads <= current_group_threads)
-				{
-					/* If we fit into curent CPU group we also don't force any affinity. */
-					thread_group = -1;
+			/* If we fit into curent CPU group we don't force any affinity. */
+			const bool use_groups = !(use_auto_threads &&
+			                          num_process_groups == 1 &&
+			                          num_threads <= current_group_threads);
+			int thread_index = 0;
+			for(int group = 0; use_groups && group < num_groups; ++group) {
+				int num_group_threads = (group == num_groups - 1)
+				        ? (num_threads - thread_index)
+				        : system_cpu_group_thread_count(group);
+				num_group_threads = min(num_group_threads, num_threads - thread_index);
+				for(int group_thread = 0; group_thread < num_group_threads; ++group_thread) {
+					thread_groups[thread_index++] = group;
 				}
-				else {
-					thread_group = group;
-				}
-				threads[thread_index] = new thread(function_bind(&TaskScheduler::thread_run,
-				                                                 thread_index + 1),
-				                                   thread_group);
 			}
 		}
+
+		for(int thread_index = 0; thread_index < num_threads; ++thread_index) {
+			/* NOTE: Node and group of -1 means we would not force thread affinity. */
+			const int numa_node = (nodes.size() > 1)
+			        ? nodes[thread_nodes[thread_index]]
+			        : -1;
+			threads[thread_index] = new thread(function_bind(&TaskScheduler::thread_run,
+			                                                 thread_index + 1),
+			                                   numa_node,
+			                                   thread_groups[thread_index]);
+		}
 	}
 
 	users++;
@@ -275,6 +304,8 @@ void TaskScheduler::exit()
 		}
 
 		threads.clear();
+		nodes.clear();
+		thread_nodes.clear();
 	}
 }
 
@@ -282,6 +313,32 @@ void TaskScheduler::free_memory()
 {
 	assert(users == 0);
 	threads.free_memory();
+	nodes.free_memory();
+	thread_nodes.free_memory();
+}
+
+int TaskScheduler::num_nodes()
+{
+	return max((int)nodes.size(), 1);
+}
+
+int TaskScheduler::thread_node(int thread_id)
+{
+	if(thread_id == 0) {
+		return -1;
+	}
+	if(thread_id - 1 < (int)thread_nodes.size()) {
+		return thread_nodes[thread_id - 1];
+	}
+	return 0;
+}
+
+int TaskScheduler::node_numa_id(int node)
+{
+	if(node < 0 || node >= (int)nodes.size()) {
+		return -1;
+	}
+	return nodes[node];
 }
 
 bool TaskScheduler::thread_wait_pop(Entry& entry)
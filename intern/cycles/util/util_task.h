@@ -135,6 +135,19 @@ public:
 	/* test if any session is using the scheduler */
 	static bool active() { return users != 0; }
 
+	/* Number of NUMA nodes the threads are spread over, 1 if the system
+	 * has no NUMA or threads are not pinned to nodes. */
+	static int num_nodes();
+
+	/* Index of the node the given thread is pinned to, in the range of
+	 * [0, num_nodes()). Thread ID of 0 denotes the calling thread, which
+	 * is not pinned, so -1 is returned for it. */
+	static int thread_node(int thread_id);
+
+	/* Actual system NUMA node for the node index, -1 if threads are not
+	 * pinned to nodes. */
+	static int node_numa_id(int node);
+
 protected:
 	friend class TaskPool;
 
@@ -148,6 +161,11 @@ protected:
 	static vector<thread*> threads;
 	static bool do_exit;
 
+	/* System NUMA node of every used node index, and node index of
+	 * every thread. Empty when threads are not pinned. */
+	static vector<int> nodes;
+	static vector<int> thread_nodes;
+
 	static list<Entry> queue;
 	static thread_mutex queue_mutex;
 	static thread_condition_variable queue_cond;
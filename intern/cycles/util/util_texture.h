@@ -55,12 +55,29 @@ typedef enum ImageDataType {
 	IMAGE_DATA_TYPE_HALF = 5,
 	IMAGE_DATA_TYPE_USHORT4 = 6,
 	IMAGE_DATA_TYPE_USHORT = 7,
+	IMAGE_DATA_TYPE_SPARSE_FLOAT4 = 8,
+	IMAGE_DATA_TYPE_SPARSE_FLOAT = 9,
 
 	IMAGE_DATA_NUM_TYPES
 } ImageDataType;
 
-#define IMAGE_DATA_TYPE_SHIFT 3
-#define IMAGE_DATA_TYPE_MASK 0x7
+#define IMAGE_DATA_TYPE_SHIFT 4
+#define IMAGE_DATA_TYPE_MASK 0xF
+
+/* Sparse 3D textures.
+ *
+ * Volume grids are split into tiles of TEX_SPARSE_TILE_SIZE^3 voxels, only
+ * tiles with non-zero voxels are stored. The storage starts with one int per
+ * tile, padded to a whole number of elements, holding the element offset of
+ * the tile in the same storage or TEX_SPARSE_TILE_EMPTY. Voxels inside a tile
+ * are stored in x, y, z order, tiles on the border are padded with zeros. */
+#define TEX_SPARSE_TILE_SHIFT 3
+#define TEX_SPARSE_TILE_SIZE (1 << TEX_SPARSE_TILE_SHIFT)
+#define TEX_SPARSE_TILE_MASK (TEX_SPARSE_TILE_SIZE - 1)
+#define TEX_SPARSE_TILE_VOXELS (TEX_SPARSE_TILE_SIZE * TEX_SPARSE_TILE_SIZE * TEX_SPARSE_TILE_SIZE)
+#define TEX_SPARSE_TILE_EMPTY (-1)
+
+#define tex_sparse_num_tiles(size) (((size) + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT)
 
 /* Extension types for textures.
  *
@@ -19,11 +19,14 @@
 #include "util/util_system.h"
 #include "util/util_windows.h"
 
+#include <stdio.h>
+
 CCL_NAMESPACE_BEGIN
 
-thread::thread(function<void()> run_cb, int group)
+thread::thread(function<void()> run_cb, int node, int group)
   : run_cb_(run_cb),
     joined_(false),
+	node_(node),
 	group_(group)
 {
 	thread_ = std::thread(&thread::run, this);
@@ -39,7 +42,12 @@ thread::~thread()
 void *thread::run(void *arg)
 {
 	thread *self = (thread*)(arg);
-	if(self->group_ != -1) {
+	if(self->node_ != -1) {
+		if(!system_cpu_run_thread_on_node(self->node_)) {
+			fprintf(stderr, "Error setting thread affinity.\n");
+		}
+	}
+	else if(self->group_ != -1) {
 #ifdef _WIN32
 		HANDLE thread_handle = GetCurrentThread();
 		GROUP_AFFINITY group_affinity = { 0 };
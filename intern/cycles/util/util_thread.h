@@ -46,7 +46,10 @@ typedef std::condition_variable thread_condition_variable;
 
 class thread {
 public:
-	thread(function<void()> run_cb, int group = -1);
+	/* Node of -1 means the thread is not pinned to any NUMA node. When no
+	 * node is given the thread can still be pinned to a processor group,
+	 * group of -1 means no affinity is forced at all. */
+	thread(function<void()> run_cb, int node = -1, int group = -1);
 	~thread();
 
 	static void *run(void *arg);
@@ -56,6 +59,7 @@ protected:
 	function<void()> run_cb_;
 	std::thread thread_;
 	bool joined_;
+	int node_;
 	int group_;
 };
 
@@ -220,6 +220,9 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Switch allocator to caching small blocks per thread, for heavily threaded workloads. */
+void MEM_use_cached_allocator(void);
+
 #ifdef __cplusplus
 /* alloc funcs for C++ only */
 #define MEM_CXX_CLASS_ALLOC_FUNCS(_id)                                        \
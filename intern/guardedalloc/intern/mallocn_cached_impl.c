@@ -0,0 +1,973 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file guardedalloc/intern/mallocn_cached_impl.c
+ *  \ingroup MEM
+ *
+ * Memory allocation with per-thread caches for small blocks.
+ *
+ * Small blocks are carved from slabs, rounded up to one of a few size classes.
+ * Every thread keeps a list of free blocks per size class, so allocating and
+ * freeing them doesn't touch any shared state most of the time. Only when such
+ * a list runs empty or grows too long, blocks are moved in batches from or to
+ * a central list which is shared by all threads.
+ *
+ * Memory counters are kept per thread as well and summed when they are queried,
+ * so they stay exact. Slab memory is never given back to the system, this is
+ * the same trade-off most thread caching allocators make.
+ *
+ * Large and aligned blocks go to system malloc, same as the lock-free allocator.
+ */
+
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <stdarg.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifndef WIN32
+#  include <pthread.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+typedef struct MemHead {
+	/* Length of allocated memory block. */
+	size_t len;
+} MemHead;
+
+typedef struct MemHeadAligned {
+	short alignment;
+	size_t len;
+} MemHeadAligned;
+
+enum {
+	MEMHEAD_MMAP_FLAG = 1,
+	MEMHEAD_ALIGN_FLAG = 2,
+};
+
+/* Block is carved from a slab. Lengths are aligned to 4 so the low bits are taken,
+ * use the highest bit instead, no allocation can be that large anyway. */
+#define MEMHEAD_SLAB_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define MEMHEAD_FLAGS ((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG) | MEMHEAD_SLAB_FLAG)
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead*) ptr) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned*) ptr) - 1)
+#define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t) MEMHEAD_MMAP_FLAG)
+#define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t) MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_SLAB(memhead) ((memhead)->len & MEMHEAD_SLAB_FLAG)
+
+/* Size classes, including the MemHead. Steps of 16 bytes up to 128,
+ * then four classes per power of two, so at most 25% is wasted. */
+#define SIZE_CLASS_NUM 20
+#define SIZE_CLASS_MAX 1024
+
+static const unsigned int size_class_size[SIZE_CLASS_NUM] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256,
+	320, 384, 448, 512,
+	640, 768, 896, 1024,
+};
+
+/* Memory allocated from the system at once and split into blocks of one class. */
+#define SLAB_SIZE (64 * 1024)
+
+/* Amount of memory moved between a thread cache and the central lists at once.
+ * A thread cache holds at most two batches of free blocks per class. */
+#define BATCH_SIZE (16 * 1024)
+#define BATCH_LEN_MIN 8
+#define BATCH_LEN_MAX 256
+
+#ifdef _MSC_VER
+#  define MEM_THREAD_LOCAL __declspec(thread)
+#else
+#  define MEM_THREAD_LOCAL __thread
+#endif
+
+typedef struct FreeBlock {
+	struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct ThreadBin {
+	FreeBlock *free;
+	unsigned int free_len;
+	/* Number of blocks moved to or from the central list at once. */
+	unsigned int batch_len;
+} ThreadBin;
+
+typedef struct ThreadCache {
+	/* Counters of blocks allocated and freed by this thread. A block can be freed
+	 * by another thread than the one which allocated it, so these can go below zero,
+	 * only the sum over all caches is meaningful. */
+	ptrdiff_t mem_in_use;
+	ptrdiff_t mmap_in_use;
+	ptrdiff_t totblock;
+
+	ThreadBin bins[SIZE_CLASS_NUM];
+
+	/* Zero when the thread which owned the cache has exited,
+	 * so another thread can take it over. */
+	uint32_t in_use;
+	struct ThreadCache *next;
+} ThreadCache;
+
+typedef struct CentralBin {
+	uint32_t lock;
+	FreeBlock *free;
+	/* Part of the current slab which is not yet split into blocks. */
+	char *slab_cur, *slab_end;
+} CentralBin;
+
+/* Pad to avoid false sharing between the locks of different classes. */
+typedef union CentralBinPadded {
+	CentralBin bin;
+	char pad[64];
+} CentralBinPadded;
+
+static CentralBinPadded central_bins[SIZE_CLASS_NUM];
+
+/* All thread caches ever created, they are never freed. */
+static ThreadCache *thread_caches = NULL;
+static MEM_THREAD_LOCAL ThreadCache *thread_cache = NULL;
+
+#ifndef WIN32
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_key_once = PTHREAD_ONCE_INIT;
+#endif
+
+static size_t peak_mem = 0;
+static size_t slab_mem = 0;
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = NULL;
+static void (*thread_lock_callback)(void) = NULL;
+static void (*thread_unlock_callback)(void) = NULL;
+
+#ifdef __GNUC__
+__attribute__ ((format(printf, 1, 2)))
+#endif
+static void print_error(const char *str, ...)
+{
+	char buf[512];
+	va_list ap;
+
+	va_start(ap, str);
+	vsnprintf(buf, sizeof(buf), str, ap);
+	va_end(ap);
+	buf[sizeof(buf) - 1] = '\0';
+
+	if (error_callback) {
+		error_callback(buf);
+	}
+}
+
+#if defined(WIN32)
+static void mem_lock_thread(void)
+{
+	if (thread_lock_callback)
+		thread_lock_callback();
+}
+
+static void mem_unlock_thread(void)
+{
+	if (thread_unlock_callback)
+		thread_unlock_callback();
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+/* Size classes */
+
+/* Size class of a block of given size including the MemHead, in [1, SIZE_CLASS_MAX]. */
+MEM_INLINE unsigned int size_class_index(size_t size)
+{
+	const unsigned int units = (unsigned int)((size + 15) >> 4);
+	unsigned int units_ofs, log2;
+
+	if (units <= 8) {
+		return units - 1;
+	}
+
+	units_ofs = units - 1;
+	for (log2 = 3; (units_ofs >> (log2 + 1)) != 0; log2++) {
+		/* pass */
+	}
+	return 8 + (log2 - 3) * 4 + ((units_ofs - (1u << log2)) >> (log2 - 2));
+}
+
+MEM_INLINE bool size_is_small(size_t len)
+{
+	return len + sizeof(MemHead) <= SIZE_CLASS_MAX;
+}
+
+/* -------------------------------------------------------------------- */
+/* Central lists */
+
+MEM_INLINE void spin_lock(uint32_t *lock)
+{
+	while (atomic_cas_uint32(lock, 0, 1) != 0) {
+		while (*(volatile uint32_t *)lock) {
+			/* pass */
+		}
+	}
+}
+
+MEM_INLINE void spin_unlock(uint32_t *lock)
+{
+	atomic_cas_uint32(lock, 1, 0);
+}
+
+/* Move up to batch_len blocks from the central list into the (empty) thread bin,
+ * splitting a new slab when there are no free blocks left. */
+static bool central_bin_refill(ThreadBin *bin, unsigned int class)
+{
+	CentralBin *central = &central_bins[class].bin;
+	const size_t block_size = size_class_size[class];
+	FreeBlock *first, *last;
+	unsigned int len = 0;
+
+	spin_lock(&central->lock);
+
+	first = last = central->free;
+	if (first) {
+		for (len = 1; len < bin->batch_len && last->next; len++) {
+			last = last->next;
+		}
+		central->free = last->next;
+		last->next = NULL;
+	}
+	else {
+		if ((size_t)(central->slab_end - central->slab_cur) < block_size) {
+			char *slab = malloc(SLAB_SIZE);
+			if (UNLIKELY(slab == NULL)) {
+				spin_unlock(&central->lock);
+				return false;
+			}
+			atomic_add_and_fetch_z(&slab_mem, SLAB_SIZE);
+			central->slab_cur = slab;
+			central->slab_end = slab + SLAB_SIZE;
+		}
+
+		first = last = (FreeBlock *)central->slab_cur;
+		central->slab_cur += block_size;
+		for (len = 1;
+		     len < bin->batch_len && (size_t)(central->slab_end - central->slab_cur) >= block_size;
+		     len++)
+		{
+			last->next = (FreeBlock *)central->slab_cur;
+			last = last->next;
+			central->slab_cur += block_size;
+		}
+		last->next = NULL;
+	}
+
+	spin_unlock(&central->lock);
+
+	bin->free = first;
+	bin->free_len = len;
+	return true;
+}
+
+/* Move len blocks from the thread bin to the central list. */
+static void central_bin_flush(ThreadBin *bin, unsigned int class, unsigned int len)
+{
+	CentralBin *central = &central_bins[class].bin;
+	FreeBlock *first = bin->free, *last = first;
+	unsigned int i;
+
+	for (i = 1; i < len; i++) {
+		last = last->next;
+	}
+	bin->free = last->next;
+	bin->free_len -= len;
+
+	spin_lock(&central->lock);
+	last->next = central->free;
+	central->free = first;
+	spin_unlock(&central->lock);
+}
+
+/* -------------------------------------------------------------------- */
+/* Thread caches */
+
+static void thread_cache_flush(ThreadCache *cache)
+{
+	unsigned int class;
+	for (class = 0; class < SIZE_CLASS_NUM; class++) {
+		ThreadBin *bin = &cache->bins[class];
+		if (bin->free_len) {
+			central_bin_flush(bin, class, bin->free_len);
+		}
+	}
+}
+
+#ifndef WIN32
+static void thread_cache_exit(void *value)
+{
+	ThreadCache *cache = value;
+
+	/* Free blocks go to the central lists, counters stay in the cache,
+	 * they still account for blocks allocated by this thread. */
+	thread_cache_flush(cache);
+	thread_cache = NULL;
+	atomic_cas_uint32(&cache->in_use, 1, 0);
+}
+
+static void thread_cache_key_init(void)
+{
+	pthread_key_create(&thread_cache_key, thread_cache_exit);
+}
+#endif
+
+static ThreadCache *thread_cache_init(void)
+{
+	ThreadCache *cache;
+
+	/* Take over the cache of a thread which exited. */
+	for (cache = thread_caches; cache; cache = cache->next) {
+		if (cache->in_use == 0 && atomic_cas_uint32(&cache->in_use, 0, 1) == 0) {
+			break;
+		}
+	}
+
+	if (cache == NULL) {
+		unsigned int class;
+
+		cache = calloc(1, sizeof(ThreadCache));
+		if (UNLIKELY(cache == NULL)) {
+			return NULL;
+		}
+		for (class = 0; class < SIZE_CLASS_NUM; class++) {
+			unsigned int batch_len = BATCH_SIZE / size_class_size[class];
+			batch_len = (batch_len < BATCH_LEN_MIN) ? BATCH_LEN_MIN : batch_len;
+			batch_len = (batch_len > BATCH_LEN_MAX) ? BATCH_LEN_MAX : batch_len;
+			cache->bins[class].batch_len = batch_len;
+		}
+		cache->in_use = 1;
+
+		/* Caches are only ever prepended, so the list can be traversed without a lock. */
+		do {
+			cache->next = thread_caches;
+		} while (atomic_cas_ptr((void **)&thread_caches, cache->next, cache) != cache->next);
+	}
+
+#ifndef WIN32
+	pthread_once(&thread_cache_key_once, thread_cache_key_init);
+	pthread_setspecific(thread_cache_key, cache);
+#endif
+
+	thread_cache = cache;
+	return cache;
+}
+
+MEM_INLINE ThreadCache *thread_cache_get(void)
+{
+	ThreadCache *cache = thread_cache;
+	if (UNLIKELY(cache == NULL)) {
+		cache = thread_cache_init();
+	}
+	return cache;
+}
+
+typedef struct MemCounters {
+	ptrdiff_t mem_in_use;
+	ptrdiff_t mmap_in_use;
+	ptrdiff_t totblock;
+} MemCounters;
+
+/* Counters of other threads are read while they may be modified, the result is
+ * exact for all blocks which were allocated and freed before the call. */
+static void thread_caches_sum(MemCounters *r_counters)
+{
+	ThreadCache *cache;
+
+	r_counters->mem_in_use = 0;
+	r_counters->mmap_in_use = 0;
+	r_counters->totblock = 0;
+
+	for (cache = thread_caches; cache; cache = cache->next) {
+		r_counters->mem_in_use += *(volatile ptrdiff_t *)&cache->mem_in_use;
+		r_counters->mmap_in_use += *(volatile ptrdiff_t *)&cache->mmap_in_use;
+		r_counters->totblock += *(volatile ptrdiff_t *)&cache->totblock;
+	}
+}
+
+/* Summing all caches is too expensive to do for every allocation, so the peak is
+ * only updated when a thread goes to the central lists or to system malloc. */
+static void update_peak(void)
+{
+	MemCounters counters;
+	thread_caches_sum(&counters);
+	if (counters.mem_in_use > 0) {
+		atomic_fetch_and_update_max_z(&peak_mem, (size_t)counters.mem_in_use);
+	}
+}
+
+static size_t memory_in_use(void)
+{
+	MemCounters counters;
+	thread_caches_sum(&counters);
+	return (counters.mem_in_use > 0) ? (size_t)counters.mem_in_use : 0;
+}
+
+/* -------------------------------------------------------------------- */
+/* Blocks */
+
+static MemHead *slab_block_alloc(ThreadCache *cache, size_t len)
+{
+	const unsigned int class = size_class_index(len + sizeof(MemHead));
+	ThreadBin *bin = &cache->bins[class];
+	FreeBlock *block;
+
+	if (UNLIKELY(bin->free == NULL)) {
+		if (!central_bin_refill(bin, class)) {
+			return NULL;
+		}
+		update_peak();
+	}
+
+	block = bin->free;
+	bin->free = block->next;
+	bin->free_len--;
+	return (MemHead *)block;
+}
+
+static void slab_block_free(ThreadCache *cache, MemHead *memh, size_t len)
+{
+	const unsigned int class = size_class_index(len + sizeof(MemHead));
+	ThreadBin *bin = &cache->bins[class];
+	FreeBlock *block = (FreeBlock *)memh;
+
+	block->next = bin->free;
+	bin->free = block;
+	bin->free_len++;
+
+	if (UNLIKELY(bin->free_len > 2 * bin->batch_len)) {
+		central_bin_flush(bin, class, bin->batch_len);
+	}
+}
+
+/* Allocate a block which is not aligned and not mapped, len must be aligned to 4. */
+static MemHead *block_alloc(size_t len, bool clear)
+{
+	ThreadCache *cache = thread_cache_get();
+	MemHead *memh;
+
+	if (UNLIKELY(cache == NULL)) {
+		return NULL;
+	}
+
+	if (size_is_small(len)) {
+		memh = slab_block_alloc(cache, len);
+		if (UNLIKELY(memh == NULL)) {
+			return NULL;
+		}
+		if (clear) {
+			memset(memh + 1, 0, len);
+		}
+		memh->len = len | MEMHEAD_SLAB_FLAG;
+	}
+	else {
+		memh = (clear) ? calloc(1, len + sizeof(MemHead)) : malloc(len + sizeof(MemHead));
+		if (UNLIKELY(memh == NULL)) {
+			return NULL;
+		}
+		memh->len = len;
+	}
+
+	if (UNLIKELY(malloc_debug_memset && len && !clear)) {
+		memset(memh + 1, 255, len);
+	}
+
+	cache->totblock++;
+	cache->mem_in_use += (ptrdiff_t)len;
+
+	if (!MEMHEAD_IS_SLAB(memh)) {
+		update_peak();
+	}
+
+	return memh;
+}
+
+size_t MEM_cached_allocN_len(const void *vmemh)
+{
+	if (vmemh) {
+		return MEMHEAD_FROM_PTR(vmemh)->len & ~MEMHEAD_FLAGS;
+	}
+	else {
+		return 0;
+	}
+}
+
+void MEM_cached_freeN(void *vmemh)
+{
+	MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+	size_t len = MEM_cached_allocN_len(vmemh);
+	ThreadCache *cache;
+
+	if (vmemh == NULL) {
+		print_error("Attempt to free NULL pointer\n");
+#ifdef WITH_ASSERT_ABORT
+		abort();
+#endif
+		return;
+	}
+
+	cache = thread_cache_get();
+	if (UNLIKELY(cache == NULL)) {
+		/* Out of memory, leak the block rather than corrupting the counters. */
+		return;
+	}
+
+	cache->totblock--;
+	cache->mem_in_use -= (ptrdiff_t)len;
+
+	if (UNLIKELY(malloc_debug_memset && len && !MEMHEAD_IS_MMAP(memh))) {
+		memset(memh + 1, 255, len);
+	}
+
+	if (LIKELY(MEMHEAD_IS_SLAB(memh))) {
+		slab_block_free(cache, memh, len);
+	}
+	else if (MEMHEAD_IS_MMAP(memh)) {
+		cache->mmap_in_use -= (ptrdiff_t)len;
+#if defined(WIN32)
+		/* our windows mmap implementation is not thread safe */
+		mem_lock_thread();
+#endif
+		if (munmap(memh, len + sizeof(MemHead)))
+			printf("Couldn't unmap memory\n");
+#if defined(WIN32)
+		mem_unlock_thread();
+#endif
+	}
+	else if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+		MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+		aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+	}
+	else {
+		free(memh);
+	}
+}
+
+void *MEM_cached_dupallocN(const void *vmemh)
+{
+	void *newp = NULL;
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		const size_t prev_size = MEM_cached_allocN_len(vmemh);
+		if (UNLIKELY(MEMHEAD_IS_MMAP(memh))) {
+			newp = MEM_cached_mapallocN(prev_size, "dupli_mapalloc");
+		}
+		else if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			newp = MEM_cached_mallocN_aligned(
+				prev_size,
+				(size_t)memh_aligned->alignment,
+				"dupli_malloc");
+		}
+		else {
+			newp = MEM_cached_mallocN(prev_size, "dupli_malloc");
+		}
+		memcpy(newp, vmemh, prev_size);
+	}
+	return newp;
+}
+
+/* Resize a slab block without moving it when the new length falls into the same
+ * size class. Returns false when the block has to be moved. */
+static bool slab_block_resize(void *vmemh, size_t len, bool clear)
+{
+	MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+	const size_t old_len = MEM_cached_allocN_len(vmemh);
+	ThreadCache *cache;
+
+	len = SIZET_ALIGN_4(len);
+
+	if (!MEMHEAD_IS_SLAB(memh) || !size_is_small(len) ||
+	    size_class_index(len + sizeof(MemHead)) != size_class_index(old_len + sizeof(MemHead)))
+	{
+		return false;
+	}
+
+	cache = thread_cache_get();
+	if (UNLIKELY(cache == NULL)) {
+		return false;
+	}
+
+	if (clear && len > old_len) {
+		memset((char *)vmemh + old_len, 0, len - old_len);
+	}
+
+	cache->mem_in_use += (ptrdiff_t)len - (ptrdiff_t)old_len;
+	memh->len = len | MEMHEAD_SLAB_FLAG;
+	return true;
+}
+
+void *MEM_cached_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+	void *newp = NULL;
+
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		size_t old_len = MEM_cached_allocN_len(vmemh);
+
+		if (slab_block_resize(vmemh, len, false)) {
+			return vmemh;
+		}
+
+		if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+			newp = MEM_cached_mallocN(len, "realloc");
+		}
+		else {
+			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			newp = MEM_cached_mallocN_aligned(
+			        len,
+			        (size_t)memh_aligned->alignment,
+			        "realloc");
+		}
+
+		if (newp) {
+			if (len < old_len) {
+				/* shrink */
+				memcpy(newp, vmemh, len);
+			}
+			else {
+				/* grow (or remain same size) */
+				memcpy(newp, vmemh, old_len);
+			}
+		}
+
+		MEM_cached_freeN(vmemh);
+	}
+	else {
+		newp = MEM_cached_mallocN(len, str);
+	}
+
+	return newp;
+}
+
+void *MEM_cached_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+	void *newp = NULL;
+
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		size_t old_len = MEM_cached_allocN_len(vmemh);
+
+		if (slab_block_resize(vmemh, len, true)) {
+			return vmemh;
+		}
+
+		if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+			newp = MEM_cached_mallocN(len, "recalloc");
+		}
+		else {
+			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			newp = MEM_cached_mallocN_aligned(
+			        len,
+			        (size_t)memh_aligned->alignment,
+			        "recalloc");
+		}
+
+		if (newp) {
+			if (len < old_len) {
+				/* shrink */
+				memcpy(newp, vmemh, len);
+			}
+			else {
+				memcpy(newp, vmemh, old_len);
+
+				if (len > old_len) {
+					/* grow */
+					/* zero new bytes */
+					memset(((char *)newp) + old_len, 0, len - old_len);
+				}
+			}
+		}
+
+		MEM_cached_freeN(vmemh);
+	}
+	else {
+		newp = MEM_cached_callocN(len, str);
+	}
+
+	return newp;
+}
+
+void *MEM_cached_callocN(size_t len, const char *str)
+{
+	MemHead *memh;
+
+	len = SIZET_ALIGN_4(len);
+
+	memh = block_alloc(len, true);
+
+	if (LIKELY(memh)) {
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) memory_in_use());
+	return NULL;
+}
+
+void *MEM_cached_calloc_arrayN(size_t len, size_t size, const char *str)
+{
+	size_t total_size;
+	if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+		print_error("Calloc array aborted due to integer overflow: "
+		            "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+		            SIZET_ARG(len), SIZET_ARG(size), str,
+		            (unsigned int) memory_in_use());
+		abort();
+		return NULL;
+	}
+
+	return MEM_cached_callocN(total_size, str);
+}
+
+void *MEM_cached_mallocN(size_t len, const char *str)
+{
+	MemHead *memh;
+
+	len = SIZET_ALIGN_4(len);
+
+	memh = block_alloc(len, false);
+
+	if (LIKELY(memh)) {
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) memory_in_use());
+	return NULL;
+}
+
+void *MEM_cached_malloc_arrayN(size_t len, size_t size, const char *str)
+{
+	size_t total_size;
+	if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+		print_error("Malloc array aborted due to integer overflow: "
+		            "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+		            SIZET_ARG(len), SIZET_ARG(size), str,
+		            (unsigned int) memory_in_use());
+		abort();
+		return NULL;
+	}
+
+	return MEM_cached_mallocN(total_size, str);
+}
+
+void *MEM_cached_mallocN_aligned(size_t len, size_t alignment, const char *str)
+{
+	ThreadCache *cache = thread_cache_get();
+	MemHeadAligned *memh;
+
+	/* It's possible that MemHead's size is not properly aligned,
+	 * do extra padding to deal with this.
+	 *
+	 * We only support small alignments which fits into short in
+	 * order to save some bits in MemHead structure.
+	 */
+	size_t extra_padding = MEMHEAD_ALIGN_PADDING(alignment);
+
+	/* Huge alignment values doesn't make sense and they
+	 * wouldn't fit into 'short' used in the MemHead.
+	 */
+	assert(alignment < 1024);
+
+	/* We only support alignment to a power of two. */
+	assert(IS_POW2(alignment));
+
+	len = SIZET_ALIGN_4(len);
+
+	if (UNLIKELY(cache == NULL)) {
+		memh = NULL;
+	}
+	else {
+		memh = (MemHeadAligned *)aligned_malloc(
+			len + extra_padding + sizeof(MemHeadAligned), alignment);
+	}
+
+	if (LIKELY(memh)) {
+		/* We keep padding in the beginning of MemHead,
+		 * this way it's always possible to get MemHead
+		 * from the data pointer.
+		 */
+		memh = (MemHeadAligned *)((char *)memh + extra_padding);
+
+		if (UNLIKELY(malloc_debug_memset && len)) {
+			memset(memh + 1, 255, len);
+		}
+
+		memh->len = len | (size_t) MEMHEAD_ALIGN_FLAG;
+		memh->alignment = (short) alignment;
+		cache->totblock++;
+		cache->mem_in_use += (ptrdiff_t)len;
+		update_peak();
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) memory_in_use());
+	return NULL;
+}
+
+void *MEM_cached_mapallocN(size_t len, const char *str)
+{
+	ThreadCache *cache;
+	MemHead *memh;
+
+	/* on 64 bit, simply use calloc instead, as mmap does not support
+	 * allocating > 4 GB on Windows. the only reason mapalloc exists
+	 * is to get around address space limitations in 32 bit OSes. */
+	if (sizeof(void *) >= 8)
+		return MEM_cached_callocN(len, str);
+
+	cache = thread_cache_get();
+	if (UNLIKELY(cache == NULL)) {
+		return MEM_cached_callocN(len, str);
+	}
+
+	len = SIZET_ALIGN_4(len);
+
+#if defined(WIN32)
+	/* our windows mmap implementation is not thread safe */
+	mem_lock_thread();
+#endif
+	memh = mmap(NULL, len + sizeof(MemHead),
+	            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+#if defined(WIN32)
+	mem_unlock_thread();
+#endif
+
+	if (memh != (MemHead *)-1) {
+		memh->len = len | (size_t) MEMHEAD_MMAP_FLAG;
+		cache->totblock++;
+		cache->mem_in_use += (ptrdiff_t)len;
+		cache->mmap_in_use += (ptrdiff_t)len;
+		update_peak();
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Mapalloc returns null, fallback to regular malloc: "
+	            "len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) MEM_cached_get_mapped_memory_in_use());
+	return MEM_cached_callocN(len, str);
+}
+
+void MEM_cached_printmemlist_pydict(void)
+{
+}
+
+void MEM_cached_printmemlist(void)
+{
+}
+
+/* unused */
+void MEM_cached_callbackmemlist(void (*func)(void *))
+{
+	(void) func;  /* Ignored. */
+}
+
+void MEM_cached_printmemlist_stats(void)
+{
+	printf("\ntotal memory len: %.3f MB\n",
+	       (double)memory_in_use() / (double)(1024 * 1024));
+	printf("peak memory len: %.3f MB\n",
+	       (double)peak_mem / (double)(1024 * 1024));
+	printf("slab memory len: %.3f MB\n",
+	       (double)slab_mem / (double)(1024 * 1024));
+	printf("\nFor more detailed per-block statistics run Blender with memory debugging command line argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+	printf("System Statistics:\n");
+	malloc_stats();
+#endif
+}
+
+void MEM_cached_set_error_callback(void (*func)(const char *))
+{
+	error_callback = func;
+}
+
+bool MEM_cached_consistency_check(void)
+{
+	return true;
+}
+
+void MEM_cached_set_lock_callback(void (*lock)(void), void (*unlock)(void))
+{
+	thread_lock_callback = lock;
+	thread_unlock_callback = unlock;
+}
+
+void MEM_cached_set_memory_debug(void)
+{
+	malloc_debug_memset = true;
+}
+
+size_t MEM_cached_get_memory_in_use(void)
+{
+	return memory_in_use();
+}
+
+size_t MEM_cached_get_mapped_memory_in_use(void)
+{
+	MemCounters counters;
+	thread_caches_sum(&counters);
+	return (counters.mmap_in_use > 0) ? (size_t)counters.mmap_in_use : 0;
+}
+
+unsigned int MEM_cached_get_memory_blocks_in_use(void)
+{
+	MemCounters counters;
+	thread_caches_sum(&counters);
+	return (counters.totblock > 0) ? (unsigned int)counters.totblock : 0;
+}
+
+void MEM_cached_reset_peak_memory(void)
+{
+	peak_mem = memory_in_use();
+}
+
+size_t MEM_cached_get_peak_memory(void)
+{
+	update_peak();
+	return peak_mem;
+}
+
+#ifndef NDEBUG
+const char *MEM_cached_name_ptr(void *vmemh)
+{
+	if (vmemh) {
+		return "unknown block name ptr";
+	}
+	else {
+		return "MEM_cached_name_ptr(NULL)";
+	}
+}
+#endif  /* NDEBUG */
@@ -36,6 +36,7 @@
 
 #include "BLI_compiler_attrs.h"
 
+struct ArmatureDeformBinding;
 struct Lattice;
 struct Main;
 struct Object;
@@ -74,6 +75,12 @@ void armature_deform_verts(struct Object *armOb, struct Object *target,
                            struct DerivedMesh *dm, float (*vertexCos)[3],
                            float (*defMats)[3][3], int numVerts, int deformflag,
                            float (*prevCos)[3], const char *defgrp_name);
+void armature_deform_verts_ex(struct Object *armOb, struct Object *target,
+                              struct DerivedMesh *dm, float (*vertexCos)[3],
+                              float (*defMats)[3][3], int numVerts, int deformflag,
+                              float (*prevCos)[3], const char *defgrp_name,
+                              struct ArmatureDeformBinding **binding_p);
+void armature_deform_binding_free(struct ArmatureDeformBinding *binding);
 
 float (*BKE_lattice_vertexcos_get(struct Object *ob, int *r_numVerts))[3];
 void    BKE_lattice_vertexcos_apply(struct Object *ob, float (*vertexCos)[3]);
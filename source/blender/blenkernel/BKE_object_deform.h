@@ -47,6 +47,14 @@ struct bDeformGroup *BKE_object_defgroup_add(struct Object *ob);
 struct bDeformGroup *BKE_object_defgroup_add_name(struct Object *ob, const char *name);
 struct MDeformVert  *BKE_object_defgroup_data_create(struct ID *id);
 
+/* Mesh.dvert_update and Lattice.dvert_update change whenever the weights may have changed,
+ * data cached from the weights is only valid as long as the counter and dvert pointer match.
+ * Tagging the mesh, lattice or object data for update (DAG_id_tag_update) changes it, code
+ * editing weights without tagging (like the Python API) has to call
+ * BKE_object_defgroup_data_changed(). The counter is runtime only, reset on file read. */
+void BKE_object_defgroup_data_changed(struct ID *id);
+void BKE_object_defgroup_data_tag_update(struct ID *id, short flag);
+
 bool BKE_object_defgroup_clear(struct Object *ob, struct bDeformGroup *dg, const bool use_selection);
 bool BKE_object_defgroup_clear_all(struct Object *ob, const bool use_selection);
 
@@ -53,6 +53,8 @@
 
 /* Add the blendfile name after blendcache_ */
 #define PTCACHE_EXT ".bphys"
+/* All frames in one file, see PTCACHE_DISK_CONTAINER */
+#define PTCACHE_CONTAINER_EXT ".bphyc"
 #define PTCACHE_PATH "blendcache_"
 
 /* File open options, for BKE_ptcache_file_open */
@@ -279,6 +281,8 @@ void BKE_ptcache_ids_from_object(
 
 /***************** Global funcs ****************************/
 void BKE_ptcache_remove(void);
+/* Finish background writing and close all cache containers. */
+void BKE_ptcache_containers_exit(void);
 
 /************ ID specific functions ************************/
 void    BKE_ptcache_id_clear(PTCacheID *id, int mode, unsigned int cfra);
@@ -332,6 +336,10 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Convert the disk cache between one file per frame and a single container file,
+ * after PTCACHE_DISK_CONTAINER was toggled. */
+void BKE_ptcache_toggle_disk_container(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid, const char *name_src, const char *name_dst);
 
@@ -35,6 +35,10 @@
 #include <stdio.h>
 #include <float.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_math.h"
@@ -767,10 +771,10 @@ static void pchan_b_bone_defmats(bPoseChannel *pchan, bPoseChanDeform *pdef_info
 	}
 }
 
-static void b_bone_deform(bPoseChanDeform *pdef_info, Bone *bone, float co[3], DualQuat *dq, float defmat[3][3])
+/* index of the b_bone segment deforming co */
+static int b_bone_segment(const bPoseChanDeform *pdef_info, const Bone *bone, const float co[3])
 {
-	Mat4 *b_bone = pdef_info->b_bone_mats;
-	float (*mat)[4] = b_bone[0].mat;
+	float (*mat)[4] = pdef_info->b_bone_mats[0].mat;
 	float segment, y;
 	int a;
 
@@ -785,6 +789,14 @@ static void b_bone_deform(bPoseChanDeform *pdef_info, Bone *bone, float co[3], D
 	 * straight joints in restpos. */
 	CLAMP(a, 0, bone->segments - 1);
 
+	return a;
+}
+
+static void b_bone_deform(bPoseChanDeform *pdef_info, Bone *bone, float co[3], DualQuat *dq, float defmat[3][3])
+{
+	Mat4 *b_bone = pdef_info->b_bone_mats;
+	const int a = b_bone_segment(pdef_info, bone, co);
+
 	if (dq) {
 		copy_dq_dq(dq, &(pdef_info->b_bone_dual_quats)[a]);
 	}
@@ -909,43 +921,6 @@ static float dist_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info, f
 	return contrib;
 }
 
-static void pchan_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info, float weight, float vec[3], DualQuat *dq,
-                              float mat[3][3], const float co[3], float *contrib)
-{
-	float cop[3], bbonemat[3][3];
-	DualQuat bbonedq;
-
-	if (!weight)
-		return;
-
-	copy_v3_v3(cop, co);
-
-	if (vec) {
-		if (pchan->bone->segments > 1)
-			/* applies on cop and bbonemat */
-			b_bone_deform(pdef_info, pchan->bone, cop, NULL, (mat) ? bbonemat : NULL);
-		else
-			mul_m4_v3(pchan->chan_mat, cop);
-
-		vec[0] += (cop[0] - co[0]) * weight;
-		vec[1] += (cop[1] - co[1]) * weight;
-		vec[2] += (cop[2] - co[2]) * weight;
-
-		if (mat)
-			pchan_deform_mat_add(pchan, weight, bbonemat, mat);
-	}
-	else {
-		if (pchan->bone->segments > 1) {
-			b_bone_deform(pdef_info, pchan->bone, cop, &bbonedq, NULL);
-			add_weighted_dq_dq(dq, &bbonedq, weight);
-		}
-		else
-			add_weighted_dq_dq(dq, pdef_info->dual_quat, weight);
-	}
-
-	(*contrib) += weight;
-}
-
 typedef struct ArmatureBBoneDefmatsData {
 	bPoseChanDeform *pdef_info_array;
 	DualQuat *dualquats;
@@ -972,26 +947,484 @@ static void armature_bbone_defmats_cb(void *userdata, Link *iter, int index)
 	}
 }
 
-void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
-                           float (*defMats)[3][3], int numVerts, int deformflag,
-                           float (*prevCos)[3], const char *defgrp_name)
+/* Vertex group binding
+ *
+ * The deform weights of every vertex resolved to pose channel indices, stored as compressed rows:
+ * the weights of vertex i are [offsets[i], offsets[i + 1]). Non-deforming groups are left out.
+ *
+ * The binding is kept by the caller across evaluations, so playback does not have to walk the
+ * per-vertex weight arrays again. Vertex, group and bone changes are detected on evaluation,
+ * edited weights by comparing the dvert array and its change counter
+ * (see #BKE_object_defgroup_data_changed). */
+
+typedef struct ArmatureDeformBinding {
+	int totvert;
+	int defbase_tot;
+	int totchan;
+	int totweight;
+	int *defnr_to_chan;  /* deform group index to pose channel index, -1 when not deforming */
+	int *offsets;        /* totvert + 1 */
+	int *chan_index;     /* totweight */
+	float *weights;      /* totweight */
+
+	const MDeformVert *dverts;  /* only compared, the weights may be freed since */
+	int dvert_update;
+} ArmatureDeformBinding;
+
+typedef struct ArmatureBindingData {
+	ArmatureDeformBinding *binding;
+	const MDeformVert *dverts;
+} ArmatureBindingData;
+
+BLI_INLINE int armature_binding_dw_chan(const ArmatureDeformBinding *binding, const MDeformWeight *dw)
+{
+	const int index = dw->def_nr;
+	return (index >= 0 && index < binding->defbase_tot) ? binding->defnr_to_chan[index] : -1;
+}
+
+static void armature_binding_map(Object *armOb, Object *target, int *r_defnr_to_chan)
+{
+	/* TODO(sergey): Some considerations here:
+	 *
+	 * - Make it more generic function, maybe even keep together with chanhash.
+	 * - Don't use hash for small armatures.
+	 */
+	GHash *idx_hash = BLI_ghash_ptr_new("pose channel index by name");
+	bPoseChannel *pchan;
+	bDeformGroup *dg;
+	int pchan_index = 0;
+	int i;
+
+	for (pchan = armOb->pose->chanbase.first; pchan != NULL; pchan = pchan->next, ++pchan_index) {
+		BLI_ghash_insert(idx_hash, pchan, POINTER_FROM_INT(pchan_index));
+	}
+	for (i = 0, dg = target->defbase.first; dg; i++, dg = dg->next) {
+		pchan = BKE_pose_channel_find_name(armOb->pose, dg->name);
+		/* exclude non-deforming bones */
+		if (pchan && !(pchan->bone->flag & BONE_NO_DEFORM)) {
+			r_defnr_to_chan[i] = POINTER_AS_INT(BLI_ghash_lookup(idx_hash, pchan));
+		}
+		else {
+			r_defnr_to_chan[i] = -1;
+		}
+	}
+	BLI_ghash_free(idx_hash, NULL, NULL);
+}
+
+static void armature_binding_count_cb(
+        void *__restrict userdata, const int i, const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ArmatureBindingData *data = userdata;
+	ArmatureDeformBinding *binding = data->binding;
+	const MDeformVert *dvert = &data->dverts[i];
+	const MDeformWeight *dw = dvert->dw;
+	int j, tot = 0;
+
+	for (j = dvert->totweight; j != 0; j--, dw++) {
+		if (armature_binding_dw_chan(binding, dw) != -1) {
+			tot++;
+		}
+	}
+
+	binding->offsets[i + 1] = tot;
+}
+
+static void armature_binding_fill_cb(
+        void *__restrict userdata, const int i, const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ArmatureBindingData *data = userdata;
+	ArmatureDeformBinding *binding = data->binding;
+	const MDeformVert *dvert = &data->dverts[i];
+	const MDeformWeight *dw = dvert->dw;
+	int j, k = binding->offsets[i];
+
+	for (j = dvert->totweight; j != 0; j--, dw++) {
+		const int index = armature_binding_dw_chan(binding, dw);
+		if (index != -1) {
+			binding->chan_index[k] = index;
+			binding->weights[k] = dw->weight;
+			k++;
+		}
+	}
+}
+
+static bool armature_binding_is_valid(
+        const ArmatureDeformBinding *binding, const MDeformVert *dverts, const int dvert_update,
+        const int totvert, const int defbase_tot, const int totchan, const int *defnr_to_chan)
 {
+	if (binding->dverts != dverts || binding->dvert_update != dvert_update) {
+		return false;
+	}
+	if (binding->totvert != totvert || binding->defbase_tot != defbase_tot || binding->totchan != totchan) {
+		return false;
+	}
+	if (defbase_tot && memcmp(binding->defnr_to_chan, defnr_to_chan, sizeof(int) * defbase_tot) != 0) {
+		return false;
+	}
+
+	return true;
+}
+
+static ArmatureDeformBinding *armature_binding_create(
+        const MDeformVert *dverts, const int dvert_update, const int totvert,
+        const int defbase_tot, const int totchan, const int *defnr_to_chan)
+{
+	ArmatureDeformBinding *binding = MEM_callocN(sizeof(*binding), "ArmatureDeformBinding");
+	ArmatureBindingData data = {.binding = binding, .dverts = dverts};
+	ParallelRangeSettings settings;
+	int i;
+
+	binding->dverts = dverts;
+	binding->dvert_update = dvert_update;
+	binding->totvert = totvert;
+	binding->defbase_tot = defbase_tot;
+	binding->totchan = totchan;
+	binding->defnr_to_chan = defbase_tot ? MEM_dupallocN(defnr_to_chan) : NULL;
+	binding->offsets = MEM_malloc_arrayN(totvert + 1, sizeof(*binding->offsets), "armature binding offsets");
+	binding->offsets[0] = 0;
+
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (totvert > 1000);
+	BLI_task_parallel_range(0, totvert, &data, armature_binding_count_cb, &settings);
+
+	for (i = 0; i < totvert; i++) {
+		binding->offsets[i + 1] += binding->offsets[i];
+	}
+	binding->totweight = binding->offsets[totvert];
+
+	binding->chan_index = MEM_malloc_arrayN(
+	        max_ii(binding->totweight, 1), sizeof(*binding->chan_index), "armature binding channels");
+	binding->weights = MEM_malloc_arrayN(
+	        max_ii(binding->totweight, 1), sizeof(*binding->weights), "armature binding weights");
+	BLI_task_parallel_range(0, totvert, &data, armature_binding_fill_cb, &settings);
+
+	return binding;
+}
+
+static ArmatureDeformBinding *armature_binding_ensure(
+        const MDeformVert *dverts, const int dvert_update, const int totvert, const int defbase_tot,
+        const int totchan, const int *defnr_to_chan, ArmatureDeformBinding **binding_p)
+{
+	ArmatureDeformBinding *binding = *binding_p;
+
+	if (binding &&
+	    !armature_binding_is_valid(binding, dverts, dvert_update, totvert, defbase_tot, totchan, defnr_to_chan))
+	{
+		armature_deform_binding_free(binding);
+		binding = NULL;
+	}
+
+	if (binding == NULL) {
+		binding = armature_binding_create(dverts, dvert_update, totvert, defbase_tot, totchan, defnr_to_chan);
+	}
+
+	*binding_p = binding;
+
+	return binding;
+}
+
+void armature_deform_binding_free(ArmatureDeformBinding *binding)
+{
+	if (binding->defnr_to_chan) {
+		MEM_freeN(binding->defnr_to_chan);
+	}
+	MEM_freeN(binding->offsets);
+	MEM_freeN(binding->chan_index);
+	MEM_freeN(binding->weights);
+	MEM_freeN(binding);
+}
+
+/* Skinning, each vertex is deformed independently */
+
+typedef struct ArmatureDeformData {
+	const ArmatureDeformBinding *binding;
+	bPoseChannel **chan_array;
+	bPoseChanDeform *pdef_info_array;
+	int totchan;
+
+	const MDeformVert *dverts;
+	int totdvert;
+	const int *defnr_to_chan;  /* NULL when not deforming by vertex groups */
+	int defbase_tot;
+
+	float (*vertexCos)[3];
+	float (*defMats)[3][3];
+	float (*prevCos)[3];
+
+	float premat[4][4];
+	float postmat[4][4];
+
+	int armature_def_nr;
+	bool use_envelope;
+	bool use_quaternion;
+	bool invert_vgroup;
+} ArmatureDeformData;
+
+/* r += m * f, the inner loop of linear blend skinning */
+BLI_INLINE void armature_madd_m4_fl(float r[4][4], float m[4][4], const float f)
+{
+#ifdef __SSE2__
+	const __m128 fac = _mm_set1_ps(f);
+
+	_mm_storeu_ps(r[0], _mm_add_ps(_mm_loadu_ps(r[0]), _mm_mul_ps(_mm_loadu_ps(m[0]), fac)));
+	_mm_storeu_ps(r[1], _mm_add_ps(_mm_loadu_ps(r[1]), _mm_mul_ps(_mm_loadu_ps(m[1]), fac)));
+	_mm_storeu_ps(r[2], _mm_add_ps(_mm_loadu_ps(r[2]), _mm_mul_ps(_mm_loadu_ps(m[2]), fac)));
+	_mm_storeu_ps(r[3], _mm_add_ps(_mm_loadu_ps(r[3]), _mm_mul_ps(_mm_loadu_ps(m[3]), fac)));
+#else
+	int i, j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			r[i][j] += m[i][j] * f;
+		}
+	}
+#endif
+}
+
+/**
+ * Add the deformation of one vertex group weight. For linear skinning the weighted bone matrices
+ * are blended into \a r_mat, so the vertex is transformed once instead of once per bone.
+ * For dual quaternion skinning they are accumulated in \a dq.
+ *
+ * \return the weight used.
+ */
+BLI_INLINE float armature_vert_weight_deform(
+        const ArmatureDeformData *data, const int index, float weight, const float co[3],
+        float r_mat[4][4], DualQuat *dq)
+{
+	bPoseChannel *pchan = data->chan_array[index];
+	bPoseChanDeform *pdef_info = &data->pdef_info_array[index];
+	Bone *bone = pchan->bone;
+
+	if (bone->flag & BONE_MULT_VG_ENV) {
+		weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
+		                             bone->rad_head, bone->rad_tail, bone->dist);
+	}
+
+	if (weight == 0.0f) {
+		return 0.0f;
+	}
+
+	if (dq) {
+		if (bone->segments > 1) {
+			add_weighted_dq_dq(dq, &pdef_info->b_bone_dual_quats[b_bone_segment(pdef_info, bone, co)], weight);
+		}
+		else {
+			add_weighted_dq_dq(dq, pdef_info->dual_quat, weight);
+		}
+	}
+	else {
+		if (bone->segments > 1) {
+			armature_madd_m4_fl(r_mat, pdef_info->b_bone_mats[b_bone_segment(pdef_info, bone, co) + 1].mat, weight);
+		}
+		else {
+			armature_madd_m4_fl(r_mat, pchan->chan_mat, weight);
+		}
+	}
+
+	return weight;
+}
+
+/**
+ * Deform vertex \a i by its vertex groups, from the binding when there is one.
+ *
+ * \return false when none of the groups deforms (like for softbody groups).
+ */
+static bool armature_vert_groups_deform(
+        const ArmatureDeformData *data, const int i, const MDeformVert *dvert, const float co[3],
+        float r_mat[4][4], DualQuat *dq, float *r_contrib)
+{
+	const ArmatureDeformBinding *binding = data->binding;
+	float contrib = 0.0f;
+	bool deformed = false;
+
+	if (r_mat) {
+		zero_m4(r_mat);
+	}
+
+	if (binding) {
+		if (i < binding->totvert) {
+			const int k_end = binding->offsets[i + 1];
+			int k;
+
+			for (k = binding->offsets[i]; k < k_end; k++) {
+				contrib += armature_vert_weight_deform(data, binding->chan_index[k], binding->weights[k], co, r_mat, dq);
+			}
+			deformed = (binding->offsets[i] != k_end);
+		}
+	}
+	else if (dvert) {
+		const MDeformWeight *dw = dvert->dw;
+		int j;
+
+		for (j = dvert->totweight; j != 0; j--, dw++) {
+			const int index = dw->def_nr;
+			if (index >= 0 && index < data->defbase_tot && data->defnr_to_chan[index] != -1) {
+				contrib += armature_vert_weight_deform(data, data->defnr_to_chan[index], dw->weight, co, r_mat, dq);
+				deformed = true;
+			}
+		}
+	}
+
+	*r_contrib = contrib;
+	return deformed;
+}
+
+static void armature_vert_task(void *__restrict userdata, const int i, const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	ArmatureDeformData *data = userdata;
+	const bool use_quaternion = data->use_quaternion;
+	float (*defMats)[3][3] = data->defMats;
+	const MDeformVert *dvert;
+	DualQuat sumdq, *dq = NULL;
+	float *co, dco[3];
+	float sumvec[3], summat[3][3], blendmat[4][4];
+	float *vec = NULL, (*smat)[3] = NULL;
+	float contrib = 0.0f;
+	float armature_weight = 1.0f; /* default to 1 if no overall def group */
+	float prevco_weight = 1.0f;   /* weight for optional cached vertexcos */
+
+	if (use_quaternion) {
+		memset(&sumdq, 0, sizeof(DualQuat));
+		dq = &sumdq;
+	}
+	else {
+		sumvec[0] = sumvec[1] = sumvec[2] = 0.0f;
+		vec = sumvec;
+
+		if (defMats) {
+			zero_m3(summat);
+			smat = summat;
+		}
+	}
+
+	if (data->dverts && i < data->totdvert)
+		dvert = data->dverts + i;
+	else
+		dvert = NULL;
+
+	if (data->armature_def_nr != -1 && dvert) {
+		armature_weight = defvert_find_weight(dvert, data->armature_def_nr);
+
+		if (data->invert_vgroup)
+			armature_weight = 1.0f - armature_weight;
+
+		/* hackish: the blending factor can be used for blending with prevCos too */
+		if (data->prevCos) {
+			prevco_weight = armature_weight;
+			armature_weight = 1.0f;
+		}
+	}
+
+	/* check if there's any  point in calculating for this vert */
+	if (armature_weight == 0.0f)
+		return;
+
+	/* get the coord we work on */
+	co = data->prevCos ? data->prevCos[i] : data->vertexCos[i];
+
+	/* Apply the object's matrix */
+	mul_m4_v3(data->premat, co);
+
+	if (data->defnr_to_chan &&  /* use weight groups ? */
+	    armature_vert_groups_deform(data, i, dvert, co, use_quaternion ? NULL : blendmat, dq, &contrib))
+	{
+		if (!use_quaternion) {
+			/* Make this a delta from the base position */
+			mul_v3_m4v3(vec, blendmat, co);
+			madd_v3_v3fl(vec, co, -contrib);
+
+			if (smat)
+				copy_m3_m4(smat, blendmat);
+		}
+	}
+	/* also when there are vertexgroups but not groups with bones
+	 * (like for softbody groups) */
+	else if (data->use_envelope) {
+		int index;
+
+		for (index = 0; index < data->totchan; index++) {
+			bPoseChannel *pchan = data->chan_array[index];
+			if (!(pchan->bone->flag & BONE_NO_DEFORM))
+				contrib += dist_bone_deform(pchan, &data->pdef_info_array[index], vec, dq, smat, co);
+		}
+	}
+
+	/* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
+	if (contrib > 0.0001f) {
+		if (use_quaternion) {
+			normalize_dq(dq, contrib);
+
+			if (armature_weight != 1.0f) {
+				copy_v3_v3(dco, co);
+				mul_v3m3_dq(dco, (defMats) ? summat : NULL, dq);
+				sub_v3_v3(dco, co);
+				mul_v3_fl(dco, armature_weight);
+				add_v3_v3(co, dco);
+			}
+			else
+				mul_v3m3_dq(co, (defMats) ? summat : NULL, dq);
+
+			smat = summat;
+		}
+		else {
+			mul_v3_fl(vec, armature_weight / contrib);
+			add_v3_v3v3(co, vec, co);
+		}
+
+		if (defMats) {
+			float pre[3][3], post[3][3], tmpmat[3][3];
+
+			copy_m3_m4(pre, data->premat);
+			copy_m3_m4(post, data->postmat);
+			copy_m3_m3(tmpmat, defMats[i]);
+
+			if (!use_quaternion) /* quaternion already is scale corrected */
+				mul_m3_fl(smat, armature_weight / contrib);
+
+			mul_m3_series(defMats[i], post, smat, pre, tmpmat);
+		}
+	}
+
+	/* always, check above code */
+	mul_m4_v3(data->postmat, co);
+
+	/* interpolate with previous modifier position using weight group */
+	if (data->prevCos) {
+		float (*vertexCos)[3] = data->vertexCos;
+		float mw = 1.0f - prevco_weight;
+		vertexCos[i][0] = prevco_weight * vertexCos[i][0] + mw * co[0];
+		vertexCos[i][1] = prevco_weight * vertexCos[i][1] + mw * co[1];
+		vertexCos[i][2] = prevco_weight * vertexCos[i][2] + mw * co[2];
+	}
+}
+
+/**
+ * \param binding_p: Optional storage to keep the vertex group binding across evaluations,
+ * free with #armature_deform_binding_free. The binding is only used when the weights are
+ * the original ones of the mesh or lattice.
+ */
+void armature_deform_verts_ex(Object *armOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
+                              float (*defMats)[3][3], int numVerts, int deformflag,
+                              float (*prevCos)[3], const char *defgrp_name,
+                              ArmatureDeformBinding **binding_p)
+{
+	ArmatureDeformData data = {NULL};
+	ArmatureDeformBinding *binding = NULL;
 	bPoseChanDeform *pdef_info_array;
 	bPoseChanDeform *pdef_info = NULL;
 	bArmature *arm = armOb->data;
-	bPoseChannel *pchan, **defnrToPC = NULL;
-	int *defnrToPCIndex = NULL;
+	bPoseChannel *pchan, **chan_array;
 	MDeformVert *dverts = NULL;
-	bDeformGroup *dg;
 	DualQuat *dualquats = NULL;
-	float obinv[4][4], premat[4][4], postmat[4][4];
-	const bool use_envelope   = (deformflag & ARM_DEF_ENVELOPE) != 0;
+	int *defnr_to_chan = NULL;
+	ParallelRangeSettings settings;
+	float obinv[4][4];
 	const bool use_quaternion = (deformflag & ARM_DEF_QUATERNION) != 0;
-	const bool invert_vgroup  = (deformflag & ARM_DEF_INVERT_VGROUP) != 0;
 	int defbase_tot = 0;       /* safety for vertexgroup index overflow */
 	int i, target_totvert = 0; /* safety for vertexgroup overflow */
+	int dvert_update = 0;
 	bool use_dverts = false;
-	int armature_def_nr;
 	int totchan;
 
 	/* in editmode, or not an armature */
@@ -1005,9 +1438,8 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 	}
 
 	invert_m4_m4(obinv, target->obmat);
-	copy_m4_m4(premat, target->obmat);
-	mul_m4_m4m4(postmat, obinv, armOb->obmat);
-	invert_m4_m4(premat, postmat);
+	mul_m4_m4m4(data.postmat, obinv, armOb->obmat);
+	invert_m4_m4(data.premat, data.postmat);
 
 	/* bone defmats are already in the channels, chan_mat */
 
@@ -1020,13 +1452,18 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 
 	pdef_info_array = MEM_callocN(sizeof(bPoseChanDeform) * totchan, "bPoseChanDeform");
 
-	ArmatureBBoneDefmatsData data = {
+	ArmatureBBoneDefmatsData bbone_data = {
 	    .pdef_info_array = pdef_info_array, .dualquats = dualquats, .use_quaternion = use_quaternion
 	};
-	BLI_task_parallel_listbase(&armOb->pose->chanbase, &data, armature_bbone_defmats_cb, totchan > 512);
+	BLI_task_parallel_listbase(&armOb->pose->chanbase, &bbone_data, armature_bbone_defmats_cb, totchan > 512);
+
+	chan_array = MEM_malloc_arrayN(max_ii(totchan, 1), sizeof(*chan_array), "armature deform channels");
+	for (i = 0, pchan = armOb->pose->chanbase.first; pchan; i++, pchan = pchan->next) {
+		chan_array[i] = pchan;
+	}
 
 	/* get the def_nr for the overall armature vertex group if present */
-	armature_def_nr = defgroup_name_index(target, defgrp_name);
+	data.armature_def_nr = defgroup_name_index(target, defgrp_name);
 
 	if (ELEM(target->type, OB_MESH, OB_LATTICE)) {
 		defbase_tot = BLI_listbase_count(&target->defbase);
@@ -1034,18 +1471,20 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 		if (target->type == OB_MESH) {
 			Mesh *me = target->data;
 			dverts = me->dvert;
+			dvert_update = me->dvert_update;
 			if (dverts)
 				target_totvert = me->totvert;
 		}
 		else {
 			Lattice *lt = target->data;
 			dverts = lt->dvert;
+			dvert_update = lt->dvert_update;
 			if (dverts)
 				target_totvert = lt->pntsu * lt->pntsv * lt->pntsw;
 		}
 	}
 
-	/* get a vertex-deform-index to posechannel array */
+	/* check whether vertex groups deform */
 	if (deformflag & ARM_DEF_VGROUP) {
 		if (ELEM(target->type, OB_MESH, OB_LATTICE)) {
 			/* if we have a DerivedMesh, only use dverts if it has them */
@@ -1055,189 +1494,55 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 			else if (dverts) {
 				use_dverts = true;
 			}
-
-			if (use_dverts) {
-				defnrToPC = MEM_callocN(sizeof(*defnrToPC) * defbase_tot, "defnrToBone");
-				defnrToPCIndex = MEM_callocN(sizeof(*defnrToPCIndex) * defbase_tot, "defnrToIndex");
-				/* TODO(sergey): Some considerations here:
-				 *
-				 * - Make it more generic function, maybe even keep together with chanhash.
-				 * - Check whether keeping this consistent across frames gives speedup.
-				 * - Don't use hash for small armatures.
-				 */
-				GHash *idx_hash = BLI_ghash_ptr_new("pose channel index by name");
-				int pchan_index = 0;
-				for (pchan = armOb->pose->chanbase.first; pchan != NULL; pchan = pchan->next, ++pchan_index) {
-					BLI_ghash_insert(idx_hash, pchan, POINTER_FROM_INT(pchan_index));
-				}
-				for (i = 0, dg = target->defbase.first; dg; i++, dg = dg->next) {
-					defnrToPC[i] = BKE_pose_channel_find_name(armOb->pose, dg->name);
-					/* exclude non-deforming bones */
-					if (defnrToPC[i]) {
-						if (defnrToPC[i]->bone->flag & BONE_NO_DEFORM) {
-							defnrToPC[i] = NULL;
-						}
-						else {
-							defnrToPCIndex[i] = POINTER_AS_INT(BLI_ghash_lookup(idx_hash, defnrToPC[i]));
-						}
-					}
-				}
-				BLI_ghash_free(idx_hash, NULL, NULL);
-			}
 		}
 	}
 
-	for (i = 0; i < numVerts; i++) {
-		MDeformVert *dvert;
-		DualQuat sumdq, *dq = NULL;
-		float *co, dco[3];
-		float sumvec[3], summat[3][3];
-		float *vec = NULL, (*smat)[3] = NULL;
-		float contrib = 0.0f;
-		float armature_weight = 1.0f; /* default to 1 if no overall def group */
-		float prevco_weight = 1.0f;   /* weight for optional cached vertexcos */
-
-		if (use_quaternion) {
-			memset(&sumdq, 0, sizeof(DualQuat));
-			dq = &sumdq;
+	if (use_dverts || data.armature_def_nr != -1) {
+		if (dm) {
+			data.dverts = dm->getVertDataArray(dm, CD_MDEFORMVERT);
+			data.totdvert = data.dverts ? dm->getNumVerts(dm) : 0;
 		}
 		else {
-			sumvec[0] = sumvec[1] = sumvec[2] = 0.0f;
-			vec = sumvec;
-
-			if (defMats) {
-				zero_m3(summat);
-				smat = summat;
-			}
-		}
-
-		if (use_dverts || armature_def_nr != -1) {
-			if (dm)
-				dvert = dm->getVertData(dm, i, CD_MDEFORMVERT);
-			else if (dverts && i < target_totvert)
-				dvert = dverts + i;
-			else
-				dvert = NULL;
-		}
-		else
-			dvert = NULL;
-
-		if (armature_def_nr != -1 && dvert) {
-			armature_weight = defvert_find_weight(dvert, armature_def_nr);
-
-			if (invert_vgroup)
-				armature_weight = 1.0f - armature_weight;
-
-			/* hackish: the blending factor can be used for blending with prevCos too */
-			if (prevCos) {
-				prevco_weight = armature_weight;
-				armature_weight = 1.0f;
-			}
+			data.dverts = dverts;
+			data.totdvert = target_totvert;
 		}
+	}
 
-		/* check if there's any  point in calculating for this vert */
-		if (armature_weight == 0.0f)
-			continue;
-
-		/* get the coord we work on */
-		co = prevCos ? prevCos[i] : vertexCos[i];
-
-		/* Apply the object's matrix */
-		mul_m4_v3(premat, co);
-
-		if (use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
-			MDeformWeight *dw = dvert->dw;
-			int deformed = 0;
-			unsigned int j;
-
-			for (j = dvert->totweight; j != 0; j--, dw++) {
-				const int index = dw->def_nr;
-				if (index >= 0 && index < defbase_tot && (pchan = defnrToPC[index])) {
-					float weight = dw->weight;
-					Bone *bone = pchan->bone;
-					pdef_info = pdef_info_array + defnrToPCIndex[index];
-
-					deformed = 1;
-
-					if (bone && bone->flag & BONE_MULT_VG_ENV) {
-						weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
-						                             bone->rad_head, bone->rad_tail, bone->dist);
-					}
-					pchan_bone_deform(pchan, pdef_info, weight, vec, dq, smat, co, &contrib);
-				}
-			}
-			/* if there are vertexgroups but not groups with bones
-			 * (like for softbody groups) */
-			if (deformed == 0 && use_envelope) {
-				pdef_info = pdef_info_array;
-				for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
-					if (!(pchan->bone->flag & BONE_NO_DEFORM))
-						contrib += dist_bone_deform(pchan, pdef_info, vec, dq, smat, co);
-				}
-			}
-		}
-		else if (use_envelope) {
-			pdef_info = pdef_info_array;
-			for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
-				if (!(pchan->bone->flag & BONE_NO_DEFORM))
-					contrib += dist_bone_deform(pchan, pdef_info, vec, dq, smat, co);
-			}
-		}
-
-		/* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
-		if (contrib > 0.0001f) {
-			if (use_quaternion) {
-				normalize_dq(dq, contrib);
-
-				if (armature_weight != 1.0f) {
-					copy_v3_v3(dco, co);
-					mul_v3m3_dq(dco, (defMats) ? summat : NULL, dq);
-					sub_v3_v3(dco, co);
-					mul_v3_fl(dco, armature_weight);
-					add_v3_v3(co, dco);
-				}
-				else
-					mul_v3m3_dq(co, (defMats) ? summat : NULL, dq);
-
-				smat = summat;
-			}
-			else {
-				mul_v3_fl(vec, armature_weight / contrib);
-				add_v3_v3v3(co, vec, co);
-			}
-
-			if (defMats) {
-				float pre[3][3], post[3][3], tmpmat[3][3];
-
-				copy_m3_m4(pre, premat);
-				copy_m3_m4(post, postmat);
-				copy_m3_m3(tmpmat, defMats[i]);
-
-				if (!use_quaternion) /* quaternion already is scale corrected */
-					mul_m3_fl(smat, armature_weight / contrib);
+	/* get a vertex-deform-index to posechannel index array */
+	if (use_dverts && defbase_tot) {
+		defnr_to_chan = MEM_malloc_arrayN(defbase_tot, sizeof(*defnr_to_chan), "defnrToChan");
+		armature_binding_map(armOb, target, defnr_to_chan);
 
-				mul_m3_series(defMats[i], post, smat, pre, tmpmat);
-			}
+		/* weights coming from the modifier stack (or edit-mesh) can change on every evaluation,
+		 * only the original ones are bound */
+		if (binding_p && data.dverts == dverts) {
+			binding = armature_binding_ensure(data.dverts, dvert_update, min_ii(numVerts, data.totdvert),
+			                                  defbase_tot, totchan, defnr_to_chan, binding_p);
 		}
+	}
 
-		/* always, check above code */
-		mul_m4_v3(postmat, co);
+	data.binding = binding;
+	data.defnr_to_chan = defnr_to_chan;
+	data.defbase_tot = defbase_tot;
+	data.chan_array = chan_array;
+	data.pdef_info_array = pdef_info_array;
+	data.totchan = totchan;
+	data.vertexCos = vertexCos;
+	data.defMats = defMats;
+	data.prevCos = prevCos;
+	data.use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
+	data.use_quaternion = use_quaternion;
+	data.invert_vgroup = (deformflag & ARM_DEF_INVERT_VGROUP) != 0;
 
-		/* interpolate with previous modifier position using weight group */
-		if (prevCos) {
-			float mw = 1.0f - prevco_weight;
-			vertexCos[i][0] = prevco_weight * vertexCos[i][0] + mw * co[0];
-			vertexCos[i][1] = prevco_weight * vertexCos[i][1] + mw * co[1];
-			vertexCos[i][2] = prevco_weight * vertexCos[i][2] + mw * co[2];
-		}
-	}
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (numVerts > 1000);
+	BLI_task_parallel_range(0, numVerts, &data, armature_vert_task, &settings);
 
+	if (defnr_to_chan)
+		MEM_freeN(defnr_to_chan);
 	if (dualquats)
 		MEM_freeN(dualquats);
-	if (defnrToPC)
-		MEM_freeN(defnrToPC);
-	if (defnrToPCIndex)
-		MEM_freeN(defnrToPCIndex);
+	MEM_freeN(chan_array);
 
 	/* free B_bone matrices */
 	pdef_info = pdef_info_array;
@@ -1251,6 +1556,14 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 	MEM_freeN(pdef_info_array);
 }
 
+void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
+                           float (*defMats)[3][3], int numVerts, int deformflag,
+                           float (*prevCos)[3], const char *defgrp_name)
+{
+	armature_deform_verts_ex(armOb, target, dm, vertexCos, defMats, numVerts, deformflag,
+	                         prevCos, defgrp_name, NULL);
+}
+
 /* ************ END Armature Deform ******************* */
 
 void get_objectspace_bone_matrix(struct Bone *bone, float M_accumulatedMatrix[4][4], int UNUSED(root),
@@ -58,6 +58,7 @@
 #include "BKE_image.h"
 #include "BKE_library.h"
 #include "BKE_node.h"
+#include "BKE_pointcache.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
@@ -79,6 +80,9 @@ char versionstr[48] = "";
 /* only to be called on exit blender */
 void BKE_blender_free(void)
 {
+	/* finish writing disk caches in the background */
+	BKE_ptcache_containers_exit();
+
 	/* samples are in a global list..., also sets G_MAIN->sound->sample NULL */
 	BKE_main_free(G_MAIN);
 	G_MAIN = NULL;
@@ -830,6 +830,9 @@ static bool data_transfer_layersmapping_generate(
 
 			/* Mesh stores its dvert in a specific pointer too. :( */
 			me_dst->dvert = CustomData_get_layer(&me_dst->vdata, CD_MDEFORMVERT);
+			if (dm_dst == NULL) {
+				me_dst->dvert_update++;
+			}
 			return ret;
 		}
 		else if (cddata_type == CD_FAKE_SHAPEKEY) {
@@ -81,6 +81,7 @@
 #include "BKE_mball.h"
 #include "BKE_modifier.h"
 #include "BKE_object.h"
+#include "BKE_object_deform.h"
 #include "BKE_paint.h"
 #include "BKE_particle.h"
 #include "BKE_pointcache.h"
@@ -3001,6 +3002,8 @@ void DAG_ids_clear_recalc(Main *bmain)
 
 void DAG_id_tag_update_ex(Main *bmain, ID *id, short flag)
 {
+	BKE_object_defgroup_data_tag_update(id, flag);
+
 	if (!DEG_depsgraph_use_legacy()) {
 		DEG_id_tag_update_ex(bmain, id, flag);
 		return;
@@ -3700,11 +3703,12 @@ void DAG_ids_check_recalc(Main *bmain, Scene *scene, bool time)
 
 void DAG_id_tag_update(ID *id, short flag)
 {
-	DEG_id_tag_update_ex(G.main, id, flag);
+	DAG_id_tag_update_ex(G.main, id, flag);
 }
 
 void DAG_id_tag_update_ex(Main *bmain, ID *id, short flag)
 {
+	BKE_object_defgroup_data_tag_update(id, flag);
 	DEG_id_tag_update_ex(bmain, id, flag);
 }
 
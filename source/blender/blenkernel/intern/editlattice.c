@@ -144,4 +144,6 @@ void BKE_editlattice_load(Object *obedit)
 		lt->dvert = MEM_mallocN(sizeof(MDeformVert) * tot, "Lattice MDeformVert");
 		BKE_defvert_array_copy(lt->dvert, editlt->dvert, tot);
 	}
+
+	lt->dvert_update++;
 }
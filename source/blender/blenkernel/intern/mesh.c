@@ -396,6 +396,8 @@ void BKE_mesh_update_customdata_pointers(Mesh *me, const bool do_ensure_tess_cd)
 
 	me->mvert = CustomData_get_layer(&me->vdata, CD_MVERT);
 	me->dvert = CustomData_get_layer(&me->vdata, CD_MDEFORMVERT);
+	/* a new layer can be allocated at the address of the old one */
+	me->dvert_update++;
 
 	me->medge = CustomData_get_layer(&me->edata, CD_MEDGE);
 
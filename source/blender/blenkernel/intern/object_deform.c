@@ -145,16 +145,57 @@ MDeformVert *BKE_object_defgroup_data_create(ID *id)
 	if (GS(id->name) == ID_ME) {
 		Mesh *me = (Mesh *)id;
 		me->dvert = CustomData_add_layer(&me->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, me->totvert);
+		BKE_object_defgroup_data_changed(id);
 		return me->dvert;
 	}
 	else if (GS(id->name) == ID_LT) {
 		Lattice *lt = (Lattice *)id;
 		lt->dvert = MEM_callocN(sizeof(MDeformVert) * lt->pntsu * lt->pntsv * lt->pntsw, "lattice deformVert");
+		BKE_object_defgroup_data_changed(id);
 		return lt->dvert;
 	}
 
 	return NULL;
 }
+
+/**
+ * Tag the MDeformVert data of given ID as changed, call after editing weights in place.
+ * Data built from the weights (like the armature modifier binding) is compared against
+ * this counter and rebuilt when it differs.
+ */
+void BKE_object_defgroup_data_changed(ID *id)
+{
+	if (id == NULL) {
+		return;
+	}
+
+	if (GS(id->name) == ID_ME) {
+		((Mesh *)id)->dvert_update++;
+	}
+	else if (GS(id->name) == ID_LT) {
+		((Lattice *)id)->dvert_update++;
+	}
+}
+
+/**
+ * Called for every ID tagged for update, weights are assumed to be changed whenever the
+ * mesh or lattice, or the data of an object using it is tagged.
+ */
+void BKE_object_defgroup_data_tag_update(ID *id, short flag)
+{
+	if (id == NULL) {
+		return;
+	}
+
+	if (GS(id->name) == ID_OB) {
+		if (flag & OB_RECALC_DATA) {
+			BKE_object_defgroup_data_changed(((Object *)id)->data);
+		}
+	}
+	else {
+		BKE_object_defgroup_data_changed(id);
+	}
+}
 /** \} */
 
 
@@ -234,6 +275,10 @@ bool BKE_object_defgroup_clear(Object *ob, bDeformGroup *dg, const bool use_sele
 		}
 	}
 
+	if (changed) {
+		BKE_object_defgroup_data_changed(ob->data);
+	}
+
 	return changed;
 }
 
@@ -337,6 +382,8 @@ static void object_defgroup_remove_object_mode(Object *ob, bDeformGroup *dg)
 			}
 			/* done */
 		}
+
+		BKE_object_defgroup_data_changed(ob->data);
 	}
 
 	object_defgroup_remove_common(ob, dg, def_nr);
@@ -47,6 +47,7 @@
 #include "DNA_smoke_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 #include "BLI_threads.h"
 #include "BLI_math.h"
 #include "BLI_string.h"
@@ -104,6 +105,7 @@
 /* needed for directory lookup */
 #ifndef WIN32
 #  include <dirent.h>
+#  include <sys/mman.h>
 #else
 #  include "BLI_winstuff.h"
 #endif
@@ -2284,12 +2286,1480 @@ static void ptcache_find_frames_around(PTCacheID *pid, unsigned int frame, int *
 	}
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Disk Cache Container
+ *
+ * With #PTCACHE_DISK_CONTAINER all frames of a point cache are stored in one
+ * "name_index.bphyc" file, instead of one file per frame.
+ *
+ * The file is a small header followed by records, which are only ever appended.
+ * A record holds one frame, or removes a range of frames stored before it. A frame
+ * that is written again shadows its older record. The index is rebuilt from the
+ * record headers when the file is opened.
+ *
+ * Removed and shadowed records stay in the file until the unused part is larger than
+ * the used part, then the used records are copied to a new file. A removed record
+ * which delta records still depend on is kept, marked as #PTCACHE_RECORD_BASE.
+ *
+ * Each data stream of a frame is stored as a byte shuffled and compressed blob. Most
+ * records store the XOR difference to the record written before them, which compresses
+ * much better than the data itself since little changes between frames. A whole record
+ * is stored every #PTCACHE_CONTAINER_KEYFRAME_INTERVAL records, to bound decoding work.
+ *
+ * Compressing and appending runs on background threads, the simulation only pays
+ * for the XOR. Reading goes through a memory mapping of the file, and during playback
+ * the next frames are decoded ahead of time.
+ * \{ */
+
+#define PTCACHE_CONTAINER_MAGIC "BPHYSCON"
+#define PTCACHE_CONTAINER_VERSION 1
+#define PTCACHE_CONTAINER_HEADER_LEN (8 + sizeof(unsigned int))
+#define PTCACHE_CONTAINER_KEYFRAME_INTERVAL 8
+/* Number of frames decoded ahead during playback. */
+#define PTCACHE_CONTAINER_PREFETCH 4
+#define PTCACHE_CONTAINER_THREADS_MAX 4
+/* Offset of a record that is still being written. */
+#define PTCACHE_CONTAINER_PENDING ((uint64_t)-1)
+/* Offset of a record that failed to be written, it's not in the file. */
+#define PTCACHE_CONTAINER_INVALID ((uint64_t)-2)
+
+#ifdef WIN32
+#  define ptcache_fseek(fp, offset, whence) _fseeki64(fp, (__int64)(offset), whence)
+#  define ptcache_ftell(fp) ((uint64_t)_ftelli64(fp))
+#else
+#  define ptcache_fseek(fp, offset, whence) fseeko(fp, (off_t)(offset), whence)
+#  define ptcache_ftell(fp) ((uint64_t)ftello(fp))
+#endif
+
+/* PTCacheRecordHeader.flag */
+enum {
+	PTCACHE_RECORD_DELTA     = (1 << 0),
+	PTCACHE_RECORD_EXTRADATA = (1 << 1),
+	/* Removes the frames [frame, frame_end] of all records before it. */
+	PTCACHE_RECORD_REMOVE    = (1 << 2),
+	/* Frame was removed, only kept as the base of delta records. */
+	PTCACHE_RECORD_BASE      = (1 << 3),
+};
+
+typedef struct PTCacheRecordHeader {
+	int frame, frame_end;
+	/* Records are numbered in the order they were added, which can differ
+	 * from the order in the file since they are written from several threads. */
+	unsigned int serial;
+	/* The record PTCACHE_RECORD_DELTA data is relative to. */
+	unsigned int base_serial;
+	unsigned int flag;
+	unsigned int totpoint, data_types;
+	/* Size of the data following the header. */
+	unsigned int data_len;
+} PTCacheRecordHeader;
+
+typedef struct PTCacheBlobHeader {
+	unsigned char compression;
+	/* Element size the bytes are shuffled by. */
+	unsigned char shuffle;
+	unsigned char pad[2];
+	unsigned int raw_len, stored_len;
+} PTCacheBlobHeader;
+
+typedef struct PTCacheContainerEntry {
+	PTCacheRecordHeader head;
+	uint64_t offset;
+} PTCacheContainerEntry;
+
+/* Uncompressed data of one record, the base for the delta of the next record. */
+typedef struct PTCacheStreams {
+	unsigned int serial;
+	unsigned int totpoint, data_types;
+	/* Number of delta records since the last whole record. */
+	int chain;
+	void *data[BPHYS_TOT_DATA];
+} PTCacheStreams;
+
+typedef struct PTCacheContainer {
+	char filepath[MAX_PTCACHE_FILE];
+	FILE *fp;
+	/* End of the last complete record. */
+	uint64_t file_len;
+
+	/* Sorted by serial. Only added to by the thread using the cache,
+	 * while no prefetching runs. */
+	PTCacheContainerEntry *entries;
+	unsigned int entries_len, entries_alloc;
+	unsigned int serial_next;
+	/* Frame -> serial of the record holding it. */
+	GHash *frames;
+
+	PTCacheStreams write_base;
+	PTCacheStreams read_base;
+
+	const unsigned char *map;
+	size_t map_len;
+
+	/* Guards the file, the entry offsets and the members below. */
+	ThreadMutex mutex;
+	ThreadCondition jobs_cond;
+	int writes_pending;
+	int prefetch_pending;
+	int prefetch_start, prefetch_end;
+	bool prefetch_cancel;
+	/* PTCacheMem decoded ahead of playback. */
+	ListBase prefetched;
+} PTCacheContainer;
+
+typedef struct PTCacheContainerJob {
+	PTCacheContainer *con;
+	bool is_prefetch;
+
+	/* Writing. */
+	PTCacheRecordHeader head;
+	void *data[BPHYS_TOT_DATA];
+	ListBase extradata;
+	int compression;
+
+	/* Prefetching. */
+	int frame_start, frame_end;
+} PTCacheContainerJob;
+
+/* Containers by file path, and the I/O threads shared by all of them. */
+static ThreadMutex ptcache_containers_lock = BLI_MUTEX_INITIALIZER;
+static GHash *ptcache_containers = NULL;
+static ThreadQueue *ptcache_container_jobs = NULL;
+static ListBase ptcache_container_threads = {NULL, NULL};
+
+static void ptcache_streams_clear(PTCacheStreams *streams)
+{
+	int i;
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (streams->data[i])
+			MEM_freeN(streams->data[i]);
+	}
+
+	memset(streams, 0, sizeof(*streams));
+}
+
+static void ptcache_streams_set(
+        PTCacheStreams *streams, unsigned int serial, unsigned int totpoint, unsigned int data_types,
+        void *data[BPHYS_TOT_DATA], int chain)
+{
+	int i;
+
+	ptcache_streams_clear(streams);
+
+	streams->serial = serial;
+	streams->totpoint = totpoint;
+	streams->data_types = data_types;
+	streams->chain = chain;
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (data_types & (1 << i)) {
+			const size_t len = (size_t)totpoint * ptcache_data_size[i];
+			streams->data[i] = MEM_mallocN(len, "PTCacheStreams data");
+			memcpy(streams->data[i], data[i], len);
+		}
+	}
+}
+
+static void ptcache_xor(unsigned char *data, const unsigned char *base, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] ^= base[i];
+}
+
+/* Group the n-th bytes of all elements, the high bytes of floats that barely
+ * change end up next to each other and compress well. */
+static void ptcache_shuffle(unsigned char *dst, const unsigned char *src, size_t len, int elem_size)
+{
+	const size_t tot = len / elem_size;
+	size_t i;
+	int b;
+
+	for (i = 0; i < tot; i++) {
+		for (b = 0; b < elem_size; b++)
+			dst[b * tot + i] = src[i * elem_size + b];
+	}
+}
+
+static void ptcache_unshuffle(unsigned char *dst, const unsigned char *src, size_t len, int elem_size)
+{
+	const size_t tot = len / elem_size;
+	size_t i;
+	int b;
+
+	for (i = 0; i < tot; i++) {
+		for (b = 0; b < elem_size; b++)
+			dst[i * elem_size + b] = src[b * tot + i];
+	}
+}
+
+/* Upper bound of the size ptcache_blob_encode() writes. */
+static size_t ptcache_blob_encode_len(unsigned int raw_len)
+{
+	return sizeof(PTCacheBlobHeader) + LZO_OUT_LEN(raw_len) + 16;
+}
+
+/* Writes the blob header and data to out, returns the number of bytes written. */
+static size_t ptcache_blob_encode(unsigned char *out, const void *raw, unsigned int raw_len, int mode)
+{
+	PTCacheBlobHeader blob = {0};
+	unsigned char *stored = out + sizeof(blob);
+	unsigned char *shuffled = MEM_mallocN(MAX2(raw_len, 1), "pointcache_shuffle_buffer");
+
+	(void)mode; /* unused when building w/o compression */
+
+	blob.shuffle = (raw_len % sizeof(float) == 0) ? sizeof(float) : 1;
+	blob.raw_len = raw_len;
+	ptcache_shuffle(shuffled, raw, raw_len, blob.shuffle);
+
+#ifdef WITH_LZO
+	if (mode == PTCACHE_COMPRESS_LZO) {
+		LZO_HEAP_ALLOC(wrkmem, LZO1X_MEM_COMPRESS);
+		lzo_uint out_len = LZO_OUT_LEN(raw_len);
+
+		if (lzo1x_1_compress(shuffled, (lzo_uint)raw_len, stored, &out_len, wrkmem) == LZO_E_OK &&
+		    out_len < raw_len)
+		{
+			blob.compression = PTCACHE_COMPRESS_LZO;
+			blob.stored_len = (unsigned int)out_len;
+		}
+	}
+#endif
+#ifdef WITH_LZMA
+	if (mode == PTCACHE_COMPRESS_LZMA && raw_len > LZMA_PROPS_SIZE) {
+		size_t out_len = raw_len - LZMA_PROPS_SIZE;
+		size_t props_len = LZMA_PROPS_SIZE;
+		unsigned int dict_size = 1 << 12;
+
+		/* No need for a dictionary larger than the data, it takes memory on every thread. */
+		while (dict_size < raw_len && dict_size < (1 << 24))
+			dict_size <<= 1;
+
+		if (LzmaCompress(stored + LZMA_PROPS_SIZE, &out_len, shuffled, raw_len,
+		                 stored, &props_len, 5, dict_size, 3, 0, 2, 32, 1) == SZ_OK)
+		{
+			blob.compression = PTCACHE_COMPRESS_LZMA;
+			blob.stored_len = (unsigned int)(out_len + LZMA_PROPS_SIZE);
+		}
+	}
+#endif
+
+	if (blob.compression == PTCACHE_COMPRESS_NO) {
+		memcpy(stored, shuffled, raw_len);
+		blob.stored_len = raw_len;
+	}
+
+	memcpy(out, &blob, sizeof(blob));
+	MEM_freeN(shuffled);
+
+	return sizeof(blob) + blob.stored_len;
+}
+
+static bool ptcache_blob_decode(const unsigned char **p, const unsigned char *end, void *raw, unsigned int raw_len)
+{
+	PTCacheBlobHeader blob;
+	unsigned char *shuffled;
+	const unsigned char *stored;
+	bool ok = false;
+
+	if ((size_t)(end - *p) < sizeof(blob))
+		return false;
+
+	memcpy(&blob, *p, sizeof(blob));
+	stored = *p + sizeof(blob);
+
+	if (blob.raw_len != raw_len || blob.stored_len > (size_t)(end - stored) ||
+	    blob.shuffle == 0 || raw_len % blob.shuffle)
+	{
+		return false;
+	}
+
+	shuffled = (blob.shuffle > 1) ? MEM_mallocN(MAX2(raw_len, 1), "pointcache_shuffle_buffer") : raw;
+
+	switch (blob.compression) {
+		case PTCACHE_COMPRESS_NO:
+			if (blob.stored_len == raw_len) {
+				memcpy(shuffled, stored, raw_len);
+				ok = true;
+			}
+			break;
+#ifdef WITH_LZO
+		case PTCACHE_COMPRESS_LZO:
+		{
+			lzo_uint out_len = raw_len;
+			ok = (lzo1x_decompress_safe(stored, (lzo_uint)blob.stored_len, shuffled, &out_len, NULL) == LZO_E_OK &&
+			      out_len == raw_len);
+			break;
+		}
+#endif
+#ifdef WITH_LZMA
+		case PTCACHE_COMPRESS_LZMA:
+			if (blob.stored_len > LZMA_PROPS_SIZE) {
+				size_t out_len = raw_len;
+				size_t in_len = blob.stored_len - LZMA_PROPS_SIZE;
+				ok = (LzmaUncompress(shuffled, &out_len, stored + LZMA_PROPS_SIZE, &in_len,
+				                     stored, LZMA_PROPS_SIZE) == SZ_OK &&
+				      out_len == raw_len);
+			}
+			break;
+#endif
+	}
+
+	if (shuffled != raw) {
+		if (ok)
+			ptcache_unshuffle(raw, shuffled, raw_len, blob.shuffle);
+		MEM_freeN(shuffled);
+	}
+
+	*p = stored + blob.stored_len;
+
+	return ok;
+}
+
+static int ptcache_container_entry_cmp(const void *a_v, const void *b_v)
+{
+	const PTCacheContainerEntry *a = a_v, *b = b_v;
+
+	if (a->head.serial < b->head.serial) return -1;
+	else if (a->head.serial > b->head.serial) return 1;
+	return 0;
+}
+
+static PTCacheContainerEntry *ptcache_container_entry_find(PTCacheContainer *con, unsigned int serial)
+{
+	PTCacheContainerEntry key;
+
+	key.head.serial = serial;
+
+	return bsearch(&key, con->entries, con->entries_len, sizeof(*con->entries), ptcache_container_entry_cmp);
+}
+
+static const PTCacheContainerEntry *ptcache_container_entry_from_frame(PTCacheContainer *con, int frame)
+{
+	const unsigned int serial = POINTER_AS_UINT(BLI_ghash_lookup(con->frames, POINTER_FROM_INT(frame)));
+
+	return serial ? ptcache_container_entry_find(con, serial) : NULL;
+}
+
+/* False when the record doesn't exist or failed to be written. */
+static bool ptcache_container_entry_valid(PTCacheContainer *con, const PTCacheContainerEntry *entry)
+{
+	bool valid;
+
+	if (entry == NULL)
+		return false;
+
+	BLI_mutex_lock(&con->mutex);
+	valid = (entry->offset != PTCACHE_CONTAINER_INVALID);
+	BLI_mutex_unlock(&con->mutex);
+
+	return valid;
+}
+
+/* Removes frames from the index, returns the number of frames removed. */
+static int ptcache_container_frames_remove(PTCacheContainer *con, int frame, int frame_end, PointCache *cache)
+{
+	GHashIterator gh_iter;
+	int *frames = MEM_mallocN(sizeof(*frames) * MAX2(BLI_ghash_len(con->frames), 1), __func__);
+	int i, tot = 0;
+
+	GHASH_ITER (gh_iter, con->frames) {
+		const int fra = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+		if (fra >= frame && fra <= frame_end)
+			frames[tot++] = fra;
+	}
+
+	for (i = 0; i < tot; i++) {
+		BLI_ghash_remove(con->frames, POINTER_FROM_INT(frames[i]), NULL, NULL);
+
+		if (cache && cache->cached_frames && frames[i] >= cache->startframe && frames[i] <= cache->endframe)
+			cache->cached_frames[frames[i] - cache->startframe] = 0;
+	}
+
+	MEM_freeN(frames);
+
+	return tot;
+}
+
+static void ptcache_container_frames_apply(PTCacheContainer *con, const PTCacheRecordHeader *head)
+{
+	if (head->flag & PTCACHE_RECORD_REMOVE)
+		ptcache_container_frames_remove(con, head->frame, head->frame_end, NULL);
+	else if ((head->flag & PTCACHE_RECORD_BASE) == 0)
+		BLI_ghash_reinsert(con->frames, POINTER_FROM_INT(head->frame), POINTER_FROM_UINT(head->serial), NULL, NULL);
+}
+
+static void ptcache_container_entry_add(PTCacheContainer *con, const PTCacheRecordHeader *head, uint64_t offset)
+{
+	PTCacheContainerEntry *entry;
+
+	if (con->entries_len == con->entries_alloc) {
+		con->entries_alloc = MAX2(64, con->entries_alloc * 2);
+		con->entries = MEM_reallocN(con->entries, sizeof(*con->entries) * con->entries_alloc);
+	}
+
+	entry = &con->entries[con->entries_len++];
+	entry->head = *head;
+	entry->offset = offset;
+}
+
+/* Rebuild the index from the record headers. */
+static void ptcache_container_scan(PTCacheContainer *con)
+{
+	PTCacheRecordHeader head;
+	uint64_t offset = PTCACHE_CONTAINER_HEADER_LEN, file_len;
+	unsigned int i;
+
+	ptcache_fseek(con->fp, 0, SEEK_END);
+	file_len = ptcache_ftell(con->fp);
+	ptcache_fseek(con->fp, offset, SEEK_SET);
+
+	while (fread(&head, sizeof(head), 1, con->fp) == 1) {
+		/* Stop at the end of the last complete record, there could be
+		 * a partially written one when Blender was closed while writing. */
+		if (head.serial == 0 || offset + sizeof(head) + head.data_len > file_len)
+			break;
+
+		ptcache_container_entry_add(con, &head, offset);
+		offset += sizeof(head) + head.data_len;
+
+		if (ptcache_fseek(con->fp, offset, SEEK_SET) != 0)
+			break;
+	}
+
+	con->file_len = offset;
+
+	if (con->entries_len) {
+		qsort(con->entries, con->entries_len, sizeof(*con->entries), ptcache_container_entry_cmp);
+
+		for (i = 0; i < con->entries_len; i++)
+			ptcache_container_frames_apply(con, &con->entries[i].head);
+
+		con->serial_next = con->entries[con->entries_len - 1].head.serial + 1;
+	}
+}
+
+static PTCacheContainer *ptcache_container_open(const char *filepath, const bool create)
+{
+	PTCacheContainer *con;
+	FILE *fp = BLI_fopen(filepath, "rb+");
+	unsigned int version = 0;
+	char magic[8];
+
+	if (fp) {
+		if (fread(magic, sizeof(char), 8, fp) != 8 || !STREQLEN(magic, PTCACHE_CONTAINER_MAGIC, 8) ||
+		    fread(&version, sizeof(version), 1, fp) != 1 || version != PTCACHE_CONTAINER_VERSION)
+		{
+			/* Not a container this version can read, only overwrite it when writing. */
+			fclose(fp);
+			fp = NULL;
+
+			if (!create)
+				return NULL;
+		}
+	}
+
+	if (fp == NULL) {
+		if (!create)
+			return NULL;
+
+		BLI_make_existing_file(filepath);
+		fp = BLI_fopen(filepath, "wb+");
+
+		if (fp == NULL)
+			return NULL;
+
+		version = PTCACHE_CONTAINER_VERSION;
+
+		if (fwrite(PTCACHE_CONTAINER_MAGIC, sizeof(char), 8, fp) != 8 ||
+		    fwrite(&version, sizeof(version), 1, fp) != 1 ||
+		    fflush(fp) != 0)
+		{
+			fclose(fp);
+			return NULL;
+		}
+	}
+
+	con = MEM_callocN(sizeof(PTCacheContainer), "PTCacheContainer");
+	BLI_strncpy(con->filepath, filepath, sizeof(con->filepath));
+	con->fp = fp;
+	con->file_len = PTCACHE_CONTAINER_HEADER_LEN;
+	con->serial_next = 1;
+	con->frames = BLI_ghash_int_new(__func__);
+
+	BLI_mutex_init(&con->mutex);
+	BLI_condition_init(&con->jobs_cond);
+
+	ptcache_container_scan(con);
+
+	return con;
+}
+
+static void ptcache_container_flush(PTCacheContainer *con)
+{
+	BLI_mutex_lock(&con->mutex);
+	while (con->writes_pending)
+		BLI_condition_wait(&con->jobs_cond, &con->mutex);
+	BLI_mutex_unlock(&con->mutex);
+}
+
+static void ptcache_container_prefetch_stop(PTCacheContainer *con)
+{
+	BLI_mutex_lock(&con->mutex);
+
+	con->prefetch_cancel = true;
+	while (con->prefetch_pending)
+		BLI_condition_wait(&con->jobs_cond, &con->mutex);
+	con->prefetch_cancel = false;
+
+	BKE_ptcache_free_mem(&con->prefetched);
+
+	BLI_mutex_unlock(&con->mutex);
+}
+
+static void ptcache_container_close(PTCacheContainer *con)
+{
+	ptcache_container_prefetch_stop(con);
+	ptcache_container_flush(con);
+
+#ifndef WIN32
+	if (con->map)
+		munmap((void *)con->map, con->map_len);
+#endif
+
+	if (con->fp)
+		fclose(con->fp);
+
+	ptcache_streams_clear(&con->write_base);
+	ptcache_streams_clear(&con->read_base);
+	BLI_ghash_free(con->frames, NULL, NULL);
+	MEM_SAFE_FREE(con->entries);
+
+	BLI_mutex_end(&con->mutex);
+	BLI_condition_end(&con->jobs_cond);
+
+	MEM_freeN(con);
+}
+
+/* Close the container of a file, so it can be deleted or renamed. */
+static void ptcache_container_release(const char *filepath)
+{
+	PTCacheContainer *con = NULL;
+
+	BLI_mutex_lock(&ptcache_containers_lock);
+	if (ptcache_containers)
+		con = BLI_ghash_popkey(ptcache_containers, filepath, NULL);
+	BLI_mutex_unlock(&ptcache_containers_lock);
+
+	if (con)
+		ptcache_container_close(con);
+}
+
+static bool ptcache_container_use(const PTCacheID *pid)
+{
+	const int flag = pid->cache->flag;
+
+	return ((flag & PTCACHE_DISK_CACHE) && (flag & PTCACHE_DISK_CONTAINER) && (flag & PTCACHE_EXTERNAL) == 0 &&
+	        pid->file_type == PTCACHE_FILE_PTCACHE && pid->write_point != NULL);
+}
+
+static bool ptcache_container_filepath(PTCacheID *pid, char *filepath)
+{
+	int len = ptcache_filename(pid, filepath, 0, 1, 0);
+
+	if (len == 0)
+		return false;
+
+	if (pid->cache->index < 0)
+		pid->cache->index = pid->stack_index = BKE_object_insert_ptcache(pid->ob);
+
+	BLI_snprintf(filepath + len, MAX_PTCACHE_FILE - len, "_%02u%s", pid->stack_index, PTCACHE_CONTAINER_EXT);
+
+	return true;
+}
+
+static void ptcache_container_write_job(PTCacheContainerJob *job)
+{
+	PTCacheContainer *con = job->con;
+	PTCacheRecordHeader *head = &job->head;
+	PTCacheContainerEntry *entry;
+	PTCacheExtra *extra;
+	unsigned char *buf;
+	size_t len = sizeof(*head), pos = sizeof(*head);
+	bool ok;
+	int i;
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (job->data[i])
+			len += ptcache_blob_encode_len(head->totpoint * ptcache_data_size[i]);
+	}
+	if (head->flag & PTCACHE_RECORD_EXTRADATA) {
+		len += sizeof(unsigned int);
+		for (extra = job->extradata.first; extra; extra = extra->next)
+			len += 2 * sizeof(unsigned int) + ptcache_blob_encode_len(extra->totdata * ptcache_extra_datasize[extra->type]);
+	}
+
+	buf = MEM_mallocN(len, "pointcache_record_buffer");
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (job->data[i])
+			pos += ptcache_blob_encode(buf + pos, job->data[i], head->totpoint * ptcache_data_size[i], job->compression);
+	}
+	if (head->flag & PTCACHE_RECORD_EXTRADATA) {
+		const unsigned int totextra = BLI_listbase_count(&job->extradata);
+
+		memcpy(buf + pos, &totextra, sizeof(totextra));
+		pos += sizeof(totextra);
+
+		for (extra = job->extradata.first; extra; extra = extra->next) {
+			memcpy(buf + pos, &extra->type, sizeof(unsigned int));
+			memcpy(buf + pos + sizeof(unsigned int), &extra->totdata, sizeof(unsigned int));
+			pos += 2 * sizeof(unsigned int);
+			pos += ptcache_blob_encode(buf + pos, extra->data, extra->totdata * ptcache_extra_datasize[extra->type],
+			                           job->compression);
+		}
+	}
+
+	head->data_len = (unsigned int)(pos - sizeof(*head));
+	memcpy(buf, head, sizeof(*head));
+
+	BLI_mutex_lock(&con->mutex);
+
+	ok = (con->fp &&
+	      ptcache_fseek(con->fp, con->file_len, SEEK_SET) == 0 &&
+	      fwrite(buf, pos, 1, con->fp) == 1 &&
+	      fflush(con->fp) == 0);
+
+	entry = ptcache_container_entry_find(con, head->serial);
+
+	if (ok) {
+		entry->head.data_len = head->data_len;
+		entry->offset = con->file_len;
+		con->file_len += pos;
+	}
+	else {
+		/* Records based on this one fail to decode as well, instead of waiting for it. */
+		entry->offset = PTCACHE_CONTAINER_INVALID;
+
+		if (G.debug & G_DEBUG)
+			printf("Error writing to disk cache container %s\n", con->filepath);
+	}
+
+	con->writes_pending--;
+	BLI_condition_notify_all(&con->jobs_cond);
+
+	BLI_mutex_unlock(&con->mutex);
+
+	MEM_freeN(buf);
+}
+
+static void ptcache_container_prefetch_job(PTCacheContainerJob *job);
+
+static void *ptcache_container_thread(void *UNUSED(data))
+{
+	PTCacheContainerJob *job;
+
+	while ((job = BLI_thread_queue_pop(ptcache_container_jobs))) {
+		int i;
+
+		if (job->is_prefetch) {
+			ptcache_container_prefetch_job(job);
+		}
+		else {
+			ptcache_container_write_job(job);
+		}
+
+		for (i = 0; i < BPHYS_TOT_DATA; i++) {
+			if (job->data[i])
+				MEM_freeN(job->data[i]);
+		}
+		if (job->extradata.first) {
+			PTCacheMem pm = {NULL};
+			pm.extradata = job->extradata;
+			ptcache_extra_free(&pm);
+		}
+
+		MEM_freeN(job);
+	}
+
+	return NULL;
+}
+
+static void ptcache_container_job_push(PTCacheContainerJob *job)
+{
+	BLI_mutex_lock(&ptcache_containers_lock);
+
+	if (ptcache_container_jobs == NULL) {
+		const int tot = CLAMPIS(BLI_system_thread_count(), 1, PTCACHE_CONTAINER_THREADS_MAX);
+		int i;
+
+		ptcache_container_jobs = BLI_thread_queue_init();
+		BLI_threadpool_init(&ptcache_container_threads, ptcache_container_thread, tot);
+
+		for (i = 0; i < tot; i++)
+			BLI_threadpool_insert(&ptcache_container_threads, NULL);
+	}
+
+	BLI_thread_queue_push(ptcache_container_jobs, job);
+
+	BLI_mutex_unlock(&ptcache_containers_lock);
+}
+
+/* Add a record to the index and write it in the background. */
+static void ptcache_container_record_push(PTCacheContainer *con, PTCacheContainerJob *job)
+{
+	job->con = con;
+	job->head.serial = con->serial_next++;
+
+	BLI_mutex_lock(&con->mutex);
+	ptcache_container_entry_add(con, &job->head, PTCACHE_CONTAINER_PENDING);
+	con->writes_pending++;
+	BLI_mutex_unlock(&con->mutex);
+
+	ptcache_container_frames_apply(con, &job->head);
+
+	ptcache_container_job_push(job);
+}
+
+static PTCacheContainer *ptcache_container_get(PTCacheID *pid, const bool create)
+{
+	char filepath[MAX_PTCACHE_FILE];
+	PTCacheContainer *con;
+
+	if (!ptcache_container_filepath(pid, filepath))
+		return NULL;
+
+	BLI_mutex_lock(&ptcache_containers_lock);
+
+	if (ptcache_containers == NULL)
+		ptcache_containers = BLI_ghash_str_new(__func__);
+
+	con = BLI_ghash_lookup(ptcache_containers, filepath);
+
+	if (con == NULL && (create || BLI_exists(filepath))) {
+		con = ptcache_container_open(filepath, create);
+
+		if (con)
+			BLI_ghash_insert(ptcache_containers, con->filepath, con);
+	}
+
+	BLI_mutex_unlock(&ptcache_containers_lock);
+
+	return con;
+}
+
+static void ptcache_container_map_ensure(PTCacheContainer *con)
+{
+#ifndef WIN32
+	if (con->fp && con->file_len > con->map_len) {
+		void *map;
+
+		if (con->map)
+			munmap((void *)con->map, con->map_len);
+
+		map = mmap(NULL, (size_t)con->file_len, PROT_READ, MAP_SHARED, fileno(con->fp), 0);
+
+		if (map == MAP_FAILED) {
+			con->map = NULL;
+			con->map_len = 0;
+		}
+		else {
+			con->map = map;
+			con->map_len = (size_t)con->file_len;
+		}
+	}
+#else
+	UNUSED_VARS(con);
+#endif
+}
+
+/* Returns the data of a record, from the memory mapping when possible.
+ * Otherwise it's read into r_buffer, which has to be freed. */
+static const unsigned char *ptcache_container_record_data(
+        PTCacheContainer *con, const PTCacheContainerEntry *entry, void **r_buffer)
+{
+	const uint64_t offset = entry->offset + sizeof(PTCacheRecordHeader);
+	unsigned char *buffer;
+	bool ok;
+
+	*r_buffer = NULL;
+
+	if (entry->offset == PTCACHE_CONTAINER_PENDING || entry->offset == PTCACHE_CONTAINER_INVALID)
+		return NULL;
+
+	if (con->map && offset + entry->head.data_len <= con->map_len)
+		return con->map + offset;
+
+	buffer = MEM_mallocN(MAX2(entry->head.data_len, 1), "pointcache_record_buffer");
+
+	BLI_mutex_lock(&con->mutex);
+	ok = (con->fp &&
+	      ptcache_fseek(con->fp, offset, SEEK_SET) == 0 &&
+	      fread(buffer, entry->head.data_len, 1, con->fp) == 1);
+	BLI_mutex_unlock(&con->mutex);
+
+	if (!ok) {
+		MEM_freeN(buffer);
+		return NULL;
+	}
+
+	*r_buffer = buffer;
+	return buffer;
+}
+
+static bool ptcache_container_record_decode(
+        PTCacheContainer *con, const PTCacheContainerEntry *entry, void *data[BPHYS_TOT_DATA], ListBase *extradata);
+
+/* Make read_base hold the data of a record, to apply a delta to. */
+static bool ptcache_container_read_base_ensure(PTCacheContainer *con, unsigned int serial)
+{
+	const PTCacheContainerEntry *entry;
+	void *data[BPHYS_TOT_DATA] = {NULL};
+	bool ok;
+	int i;
+
+	if (con->read_base.serial == serial)
+		return true;
+
+	entry = ptcache_container_entry_find(con, serial);
+
+	if (entry == NULL)
+		return false;
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (entry->head.data_types & (1 << i))
+			data[i] = MEM_mallocN(MAX2(entry->head.totpoint * ptcache_data_size[i], 1), "PTCacheStreams data");
+	}
+
+	ok = ptcache_container_record_decode(con, entry, data, NULL);
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (data[i])
+			MEM_freeN(data[i]);
+	}
+
+	return ok;
+}
+
+/* Decode a record into data (allocated by the caller) and extradata. Not thread safe
+ * for the same container, read_base is updated to this record. */
+static bool ptcache_container_record_decode(
+        PTCacheContainer *con, const PTCacheContainerEntry *entry, void *data[BPHYS_TOT_DATA], ListBase *extradata)
+{
+	const PTCacheRecordHeader *head = &entry->head;
+	const unsigned char *p, *end;
+	void *buffer;
+	bool ok = true;
+	int i;
+
+	if (head->flag & PTCACHE_RECORD_DELTA) {
+		/* The base always comes first, this also rules out cycles in a damaged file. */
+		if (head->base_serial >= head->serial || !ptcache_container_read_base_ensure(con, head->base_serial))
+			return false;
+
+		if (con->read_base.totpoint != head->totpoint || con->read_base.data_types != head->data_types)
+			return false;
+	}
+
+	p = ptcache_container_record_data(con, entry, &buffer);
+
+	if (p == NULL)
+		return false;
+
+	end = p + head->data_len;
+
+	for (i = 0; i < BPHYS_TOT_DATA && ok; i++) {
+		if (head->data_types & (1 << i)) {
+			const unsigned int len = head->totpoint * ptcache_data_size[i];
+
+			ok = ptcache_blob_decode(&p, end, data[i], len);
+
+			if (ok && (head->flag & PTCACHE_RECORD_DELTA))
+				ptcache_xor(data[i], con->read_base.data[i], len);
+		}
+	}
+
+	if (ok && extradata && (head->flag & PTCACHE_RECORD_EXTRADATA)) {
+		unsigned int totextra = 0;
+
+		if ((size_t)(end - p) >= sizeof(totextra)) {
+			memcpy(&totextra, p, sizeof(totextra));
+			p += sizeof(totextra);
+		}
+
+		for (; totextra && ok; totextra--) {
+			PTCacheExtra *extra;
+			unsigned int type_totdata[2];
+
+			if ((size_t)(end - p) < sizeof(type_totdata) ||
+			    (memcpy(type_totdata, p, sizeof(type_totdata)), type_totdata[0] >= ARRAY_SIZE(ptcache_extra_datasize)))
+			{
+				ok = false;
+				break;
+			}
+			p += sizeof(type_totdata);
+
+			extra = MEM_callocN(sizeof(PTCacheExtra), "Pointcache extradata");
+			extra->type = type_totdata[0];
+			extra->totdata = type_totdata[1];
+			extra->data = MEM_callocN(MAX2(extra->totdata * ptcache_extra_datasize[extra->type], 1),
+			                          "Pointcache extradata->data");
+			BLI_addtail(extradata, extra);
+
+			ok = ptcache_blob_decode(&p, end, extra->data, extra->totdata * ptcache_extra_datasize[extra->type]);
+		}
+	}
+
+	if (buffer)
+		MEM_freeN(buffer);
+
+	if (ok)
+		ptcache_streams_set(&con->read_base, head->serial, head->totpoint, head->data_types, data, 0);
+
+	return ok;
+}
+
+static PTCacheMem *ptcache_container_entry_to_mem(PTCacheContainer *con, const PTCacheContainerEntry *entry)
+{
+	PTCacheMem *pm = MEM_callocN(sizeof(PTCacheMem), "Pointcache mem");
+
+	pm->totpoint = entry->head.totpoint;
+	pm->data_types = entry->head.data_types;
+	pm->frame = entry->head.frame;
+
+	ptcache_data_alloc(pm);
+
+	if (!ptcache_container_record_decode(con, entry, pm->data, &pm->extradata)) {
+		ptcache_data_free(pm);
+		ptcache_extra_free(pm);
+		MEM_freeN(pm);
+		pm = NULL;
+	}
+
+	return pm;
+}
+
+static PTCacheMem *ptcache_container_prefetched_find(PTCacheContainer *con, int frame)
+{
+	PTCacheMem *pm;
+
+	for (pm = con->prefetched.first; pm; pm = pm->next) {
+		if ((int)pm->frame == frame)
+			return pm;
+	}
+
+	return NULL;
+}
+
+static void ptcache_container_prefetch_job(PTCacheContainerJob *job)
+{
+	PTCacheContainer *con = job->con;
+	int frame;
+
+	for (frame = job->frame_start; frame <= job->frame_end; frame++) {
+		const PTCacheContainerEntry *entry;
+		PTCacheMem *pm;
+		bool skip;
+
+		BLI_mutex_lock(&con->mutex);
+		skip = con->prefetch_cancel;
+		BLI_mutex_unlock(&con->mutex);
+
+		if (skip)
+			break;
+
+		entry = ptcache_container_entry_from_frame(con, frame);
+
+		if (entry == NULL)
+			continue;
+
+		BLI_mutex_lock(&con->mutex);
+		skip = (ptcache_container_prefetched_find(con, frame) != NULL);
+		BLI_mutex_unlock(&con->mutex);
+
+		if (skip)
+			continue;
+
+		pm = ptcache_container_entry_to_mem(con, entry);
+
+		if (pm) {
+			BLI_mutex_lock(&con->mutex);
+			BLI_addtail(&con->prefetched, pm);
+			BLI_mutex_unlock(&con->mutex);
+		}
+	}
+
+	BLI_mutex_lock(&con->mutex);
+	con->prefetch_pending--;
+	BLI_condition_notify_all(&con->jobs_cond);
+	BLI_mutex_unlock(&con->mutex);
+}
+
+/* Decode the frames after cfra in the background. */
+static void ptcache_container_prefetch_start(PTCacheContainer *con, int cfra, int step)
+{
+	PTCacheContainerJob *job;
+	const int frame_end = cfra + PTCACHE_CONTAINER_PREFETCH * MAX2(step, 1);
+	int frame;
+
+	for (frame = cfra + 1; frame <= frame_end; frame++) {
+		if (BLI_ghash_haskey(con->frames, POINTER_FROM_INT(frame)) &&
+		    ptcache_container_prefetched_find(con, frame) == NULL)
+		{
+			break;
+		}
+	}
+
+	/* Everything ahead is decoded already. */
+	if (frame > frame_end)
+		return;
+
+	job = MEM_callocN(sizeof(PTCacheContainerJob), "PTCacheContainerJob");
+	job->con = con;
+	job->is_prefetch = true;
+	job->frame_start = frame;
+	job->frame_end = frame_end;
+
+	BLI_mutex_lock(&con->mutex);
+	con->prefetch_pending++;
+	con->prefetch_start = job->frame_start;
+	con->prefetch_end = job->frame_end;
+	BLI_mutex_unlock(&con->mutex);
+
+	ptcache_container_job_push(job);
+}
+
+static PTCacheMem *ptcache_container_frame_to_mem(PTCacheID *pid, int cfra)
+{
+	PointCache *cache = pid->cache;
+	PTCacheContainer *con = ptcache_container_get(pid, false);
+	const PTCacheContainerEntry *entry;
+	PTCacheMem *pm, *pm_next;
+
+	if (con == NULL)
+		return NULL;
+
+	/* Take the frame when it was decoded ahead, drop what isn't ahead anymore. */
+	BLI_mutex_lock(&con->mutex);
+
+	if (cfra < con->prefetch_start || cfra > con->prefetch_end)
+		con->prefetch_cancel = true;
+	while (con->prefetch_pending)
+		BLI_condition_wait(&con->jobs_cond, &con->mutex);
+	con->prefetch_cancel = false;
+
+	pm = ptcache_container_prefetched_find(con, cfra);
+	if (pm)
+		BLI_remlink(&con->prefetched, pm);
+
+	for (pm_next = con->prefetched.first; pm_next; ) {
+		PTCacheMem *pm_iter = pm_next;
+		pm_next = pm_next->next;
+
+		if ((int)pm_iter->frame < cfra) {
+			BLI_remlink(&con->prefetched, pm_iter);
+			ptcache_data_free(pm_iter);
+			ptcache_extra_free(pm_iter);
+			MEM_freeN(pm_iter);
+		}
+	}
+
+	BLI_mutex_unlock(&con->mutex);
+
+	/* Records and the mapping only change while no prefetching runs. */
+	ptcache_container_flush(con);
+	ptcache_container_map_ensure(con);
+
+	if (pm == NULL) {
+		entry = ptcache_container_entry_from_frame(con, cfra);
+
+		if (entry)
+			pm = ptcache_container_entry_to_mem(con, entry);
+
+		if (entry && pm == NULL && G.debug & G_DEBUG)
+			printf("Error reading from disk cache container %s\n", con->filepath);
+	}
+
+	if (pm && (cache->flag & PTCACHE_BAKING) == 0)
+		ptcache_container_prefetch_start(con, cfra, cache->step);
+
+	return pm;
+}
+
+static int ptcache_container_write(PTCacheID *pid, PTCacheMem *pm)
+{
+	PTCacheContainer *con = ptcache_container_get(pid, true);
+	PTCacheStreams *base;
+	PTCacheContainerJob *job;
+	PTCacheExtra *extra;
+	bool use_delta;
+	int i;
+
+	if (con == NULL) {
+		if (G.debug & G_DEBUG)
+			printf("Error opening disk cache container for writing\n");
+		return 0;
+	}
+
+	ptcache_container_prefetch_stop(con);
+
+	base = &con->write_base;
+	use_delta = (base->serial != 0 &&
+	             base->totpoint == pm->totpoint &&
+	             base->data_types == pm->data_types &&
+	             base->chain + 1 < PTCACHE_CONTAINER_KEYFRAME_INTERVAL &&
+	             ptcache_container_entry_valid(con, ptcache_container_entry_find(con, base->serial)));
+
+	job = MEM_callocN(sizeof(PTCacheContainerJob), "PTCacheContainerJob");
+	job->compression = pid->cache->compression;
+	job->head.frame = job->head.frame_end = pm->frame;
+	job->head.totpoint = pm->totpoint;
+	job->head.data_types = pm->data_types;
+
+	if (use_delta) {
+		job->head.flag |= PTCACHE_RECORD_DELTA;
+		job->head.base_serial = base->serial;
+	}
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (pm->data_types & (1 << i)) {
+			const size_t len = (size_t)pm->totpoint * ptcache_data_size[i];
+
+			job->data[i] = MEM_mallocN(MAX2(len, 1), "PTCacheContainerJob data");
+			memcpy(job->data[i], pm->data[i], len);
+
+			if (use_delta)
+				ptcache_xor(job->data[i], base->data[i], len);
+		}
+	}
+
+	for (extra = pm->extradata.first; extra; extra = extra->next) {
+		if (extra->data && extra->totdata) {
+			PTCacheExtra *extra_copy = MEM_dupallocN(extra);
+			extra_copy->data = MEM_dupallocN(extra->data);
+			BLI_addtail(&job->extradata, extra_copy);
+			job->head.flag |= PTCACHE_RECORD_EXTRADATA;
+		}
+	}
+
+	ptcache_container_record_push(con, job);
+
+	/* The next record is a delta against this one. */
+	ptcache_streams_set(base, job->head.serial, pm->totpoint, pm->data_types, pm->data,
+	                    use_delta ? base->chain + 1 : 0);
+
+	return 1;
+}
+
+static bool ptcache_container_exist(PTCacheID *pid, int cfra)
+{
+	PTCacheContainer *con = ptcache_container_get(pid, false);
+
+	return con && ptcache_container_entry_valid(con, ptcache_container_entry_from_frame(con, cfra));
+}
+
+/* Mark a record and the records its data is based on as used. */
+static void ptcache_container_live_mark(PTCacheContainer *con, unsigned int serial, bool *live)
+{
+	const PTCacheContainerEntry *entry;
+
+	while ((entry = ptcache_container_entry_find(con, serial)) && !live[entry - con->entries]) {
+		live[entry - con->entries] = true;
+
+		if ((entry->head.flag & PTCACHE_RECORD_DELTA) == 0)
+			break;
+
+		serial = entry->head.base_serial;
+	}
+}
+
+/* Find the used records, returns the number of bytes they take in the file. */
+static uint64_t ptcache_container_live_find(PTCacheContainer *con, bool *live)
+{
+	GHashIterator gh_iter;
+	uint64_t live_len = 0;
+	unsigned int i;
+
+	memset(live, 0, sizeof(*live) * con->entries_len);
+
+	GHASH_ITER (gh_iter, con->frames) {
+		ptcache_container_live_mark(con, POINTER_AS_UINT(BLI_ghashIterator_getValue(&gh_iter)), live);
+	}
+	/* The next record written may be based on it. */
+	ptcache_container_live_mark(con, con->write_base.serial, live);
+
+	BLI_mutex_lock(&con->mutex);
+	for (i = 0; i < con->entries_len; i++) {
+		const PTCacheContainerEntry *entry = &con->entries[i];
+
+		if (live[i] && entry->offset != PTCACHE_CONTAINER_PENDING && entry->offset != PTCACHE_CONTAINER_INVALID)
+			live_len += sizeof(entry->head) + entry->head.data_len;
+	}
+	BLI_mutex_unlock(&con->mutex);
+
+	return live_len;
+}
+
+/* Copy the used records to a new file which replaces the container file.
+ * No writes or prefetching may be running. */
+static bool ptcache_container_compact(PTCacheContainer *con, const bool *live)
+{
+	char filepath_tmp[sizeof(con->filepath) + 4];
+	const unsigned int version = PTCACHE_CONTAINER_VERSION;
+	uint64_t *offsets = MEM_mallocN(sizeof(*offsets) * MAX2(con->entries_len, 1), __func__);
+	uint64_t file_len = PTCACHE_CONTAINER_HEADER_LEN;
+	unsigned int i, tot;
+	FILE *fp;
+	bool ok;
+
+	BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s.tmp", con->filepath);
+
+	ptcache_container_map_ensure(con);
+
+	fp = BLI_fopen(filepath_tmp, "wb");
+	ok = (fp &&
+	      fwrite(PTCACHE_CONTAINER_MAGIC, sizeof(char), 8, fp) == 8 &&
+	      fwrite(&version, sizeof(version), 1, fp) == 1);
+
+	for (i = 0; i < con->entries_len && ok; i++) {
+		PTCacheContainerEntry *entry = &con->entries[i];
+		const unsigned char *data;
+		void *buffer;
+
+		offsets[i] = entry->offset;
+
+		if (!live[i] || entry->offset == PTCACHE_CONTAINER_INVALID)
+			continue;
+
+		if (POINTER_AS_UINT(BLI_ghash_lookup(con->frames, POINTER_FROM_INT(entry->head.frame))) != entry->head.serial)
+			entry->head.flag |= PTCACHE_RECORD_BASE;
+
+		data = ptcache_container_record_data(con, entry, &buffer);
+		ok = (data &&
+		      fwrite(&entry->head, sizeof(entry->head), 1, fp) == 1 &&
+		      (entry->head.data_len == 0 || fwrite(data, entry->head.data_len, 1, fp) == 1));
+
+		if (buffer)
+			MEM_freeN(buffer);
+
+		offsets[i] = file_len;
+		file_len += sizeof(entry->head) + entry->head.data_len;
+	}
+
+	if (fp && fclose(fp) != 0)
+		ok = false;
+
+	if (ok) {
+		/* The open file can't be replaced on Windows. */
+#ifndef WIN32
+		if (con->map)
+			munmap((void *)con->map, con->map_len);
+#endif
+		con->map = NULL;
+		con->map_len = 0;
+
+		fclose(con->fp);
+		ok = (BLI_rename(filepath_tmp, con->filepath) == 0);
+		con->fp = BLI_fopen(con->filepath, "rb+");
+	}
+
+	if (!ok)
+		BLI_delete(filepath_tmp, false, false);
+
+	if (ok && con->fp) {
+		for (i = 0, tot = 0; i < con->entries_len; i++) {
+			if (live[i]) {
+				con->entries[tot] = con->entries[i];
+				con->entries[tot].offset = offsets[i];
+				tot++;
+			}
+		}
+		con->entries_len = tot;
+		con->file_len = file_len;
+	}
+	else if (con->fp == NULL) {
+		/* Neither file can be opened anymore. */
+		for (i = 0; i < con->entries_len; i++)
+			con->entries[i].offset = PTCACHE_CONTAINER_INVALID;
+		BLI_ghash_clear(con->frames, NULL, NULL);
+		con->file_len = PTCACHE_CONTAINER_HEADER_LEN;
+	}
+
+	MEM_freeN(offsets);
+
+	return ok;
+}
+
+static void ptcache_container_clear(PTCacheID *pid, int mode, int cfra)
+{
+	PointCache *cache = pid->cache;
+	PTCacheContainer *con;
+	PTCacheContainerJob *job;
+	const PTCacheContainerEntry *entry;
+	uint64_t live_len, dead_len;
+	bool *live, compacted = false;
+	int frame = cfra, frame_end = cfra;
+
+	if (mode == PTCACHE_CLEAR_ALL) {
+		char filepath[MAX_PTCACHE_FILE];
+
+		if (!ptcache_container_filepath(pid, filepath))
+			return;
+
+		ptcache_container_release(filepath);
+
+		if (BLI_exists(filepath)) {
+			cache->last_exact = MIN2(cache->startframe, 0);
+			BLI_delete(filepath, false, false);
+		}
+
+		if (cache->cached_frames)
+			memset(cache->cached_frames, 0, MEM_allocN_len(cache->cached_frames));
+
+		return;
+	}
+
+	con = ptcache_container_get(pid, false);
+
+	if (con == NULL)
+		return;
+
+	if (mode == PTCACHE_CLEAR_BEFORE) {
+		frame = INT_MIN;
+		frame_end = cfra - 1;
+	}
+	else if (mode == PTCACHE_CLEAR_AFTER) {
+		frame = cfra + 1;
+		frame_end = INT_MAX;
+	}
+
+	ptcache_container_prefetch_stop(con);
+
+	if (ptcache_container_frames_remove(con, frame, frame_end, cache) == 0)
+		return;
+
+	/* Don't base new records on a removed frame, it would have to be kept. */
+	entry = ptcache_container_entry_find(con, con->write_base.serial);
+	if (entry && entry->head.frame >= frame && entry->head.frame <= frame_end)
+		ptcache_streams_clear(&con->write_base);
+
+	/* Rewrite the file once unused records take up more of it than used ones, the
+	 * removed frames aren't copied so no record is needed to remove them. */
+	live = MEM_mallocN(sizeof(*live) * MAX2(con->entries_len, 1), __func__);
+	live_len = ptcache_container_live_find(con, live);
+
+	BLI_mutex_lock(&con->mutex);
+	dead_len = con->file_len - PTCACHE_CONTAINER_HEADER_LEN - live_len;
+	BLI_mutex_unlock(&con->mutex);
+
+	if (dead_len > live_len) {
+		ptcache_container_flush(con);
+		compacted = ptcache_container_compact(con, live);
+	}
+	MEM_freeN(live);
+
+	if (compacted)
+		return;
+
+	job = MEM_callocN(sizeof(PTCacheContainerJob), "PTCacheContainerJob");
+	job->head.frame = frame;
+	job->head.frame_end = frame_end;
+	job->head.flag = PTCACHE_RECORD_REMOVE;
+
+	ptcache_container_record_push(con, job);
+}
+
+static void ptcache_container_cached_frames(PTCacheID *pid, char *cached_frames, int sta, int end)
+{
+	PTCacheContainer *con = ptcache_container_get(pid, false);
+	GHashIterator gh_iter;
+
+	if (con == NULL)
+		return;
+
+	GHASH_ITER (gh_iter, con->frames) {
+		const int frame = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+
+		if (frame >= sta && frame <= end)
+			cached_frames[frame - sta] = 1;
+	}
+}
+
+static void ptcache_container_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
+{
+	char filepath_src[MAX_PTCACHE_FILE], filepath_dst[MAX_PTCACHE_FILE];
+	char name[64];
+
+	BLI_strncpy(name, pid->cache->name, sizeof(name));
+
+	BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
+	if (ptcache_container_filepath(pid, filepath_src)) {
+		BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
+
+		if (ptcache_container_filepath(pid, filepath_dst) && BLI_exists(filepath_src)) {
+			ptcache_container_release(filepath_src);
+			ptcache_container_release(filepath_dst);
+			BLI_rename(filepath_src, filepath_dst);
+		}
+	}
+
+	BLI_strncpy(pid->cache->name, name, sizeof(pid->cache->name));
+}
+
+static uint64_t ptcache_container_size(PTCacheID *pid)
+{
+	PTCacheContainer *con = ptcache_container_get(pid, false);
+	uint64_t file_len = 0;
+
+	if (con) {
+		BLI_mutex_lock(&con->mutex);
+		file_len = con->file_len;
+		BLI_mutex_unlock(&con->mutex);
+	}
+
+	return file_len;
+}
+
+void BKE_ptcache_containers_exit(void)
+{
+	BLI_mutex_lock(&ptcache_containers_lock);
+
+	if (ptcache_containers) {
+		GHashIterator gh_iter;
+
+		GHASH_ITER (gh_iter, ptcache_containers) {
+			ptcache_container_close(BLI_ghashIterator_getValue(&gh_iter));
+		}
+
+		BLI_ghash_free(ptcache_containers, NULL, NULL);
+		ptcache_containers = NULL;
+	}
+
+	if (ptcache_container_jobs) {
+		BLI_thread_queue_nowait(ptcache_container_jobs);
+		BLI_threadpool_end(&ptcache_container_threads);
+		BLI_thread_queue_free(ptcache_container_jobs);
+		ptcache_container_jobs = NULL;
+	}
+
+	BLI_mutex_unlock(&ptcache_containers_lock);
+}
+
+/** \} */
+
 static PTCacheMem *ptcache_disk_frame_to_mem(PTCacheID *pid, int cfra)
 {
-	PTCacheFile *pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
+	PTCacheFile *pf;
 	PTCacheMem *pm = NULL;
 	unsigned int i, error = 0;
 
+	if (ptcache_container_use(pid))
+		return ptcache_container_frame_to_mem(pid, cfra);
+
+	pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
+
 	if (pf == NULL)
 		return NULL;
 
@@ -2370,6 +3840,10 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
 	PTCacheFile *pf = NULL;
 	unsigned int i, error = 0;
 
+	/* A frame written again shadows the previous one in the container. */
+	if (ptcache_container_use(pid))
+		return ptcache_container_write(pid, pm);
+
 	BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
 
 	pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
@@ -2980,7 +4454,10 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 		case PTCACHE_CLEAR_ALL:
 		case PTCACHE_CLEAR_BEFORE:
 		case PTCACHE_CLEAR_AFTER:
-			if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+			if (ptcache_container_use(pid)) {
+				ptcache_container_clear(pid, mode, cfra);
+			}
+			else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 				ptcache_path(pid, path);
 
 				dir = opendir(path);
@@ -3066,7 +4543,10 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 			break;
 
 		case PTCACHE_CLEAR_FRAME:
-			if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+			if (ptcache_container_use(pid)) {
+				ptcache_container_clear(pid, mode, cfra);
+			}
+			else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 				if (BKE_ptcache_id_exist(pid, cfra)) {
 					ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
 					BLI_delete(filename, false, false);
@@ -3102,7 +4582,10 @@ int  BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
 	if (pid->cache->cached_frames &&	pid->cache->cached_frames[cfra-pid->cache->startframe]==0)
 		return 0;
 
-	if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+	if (ptcache_container_use(pid)) {
+		return ptcache_container_exist(pid, cfra);
+	}
+	else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 		char filename[MAX_PTCACHE_FILE];
 
 		ptcache_filename(pid, filename, cfra, 1, 1);
@@ -3180,7 +4663,10 @@ void BKE_ptcache_id_time(PTCacheID *pid, Scene *scene, float cfra, int *startfra
 
 		cache->cached_frames = MEM_callocN(sizeof(char) * (cache->endframe-cache->startframe+1), "cached frames array");
 
-		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		if (ptcache_container_use(pid)) {
+			ptcache_container_cached_frames(pid, cache->cached_frames, sta, end);
+		}
+		else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			/* mode is same as fopen's modes */
 			DIR *dir;
 			struct dirent *de;
@@ -3366,6 +4852,9 @@ void BKE_ptcache_remove(void)
 	char path_full[MAX_PTCACHE_PATH];
 	int rmdir = 1;
 
+	/* Finish writing before the files are removed. */
+	BKE_ptcache_containers_exit();
+
 	ptcache_path(NULL, path);
 
 	if (BLI_exists(path)) {
@@ -3382,7 +4871,7 @@ void BKE_ptcache_remove(void)
 			if (FILENAME_IS_CURRPAR(de->d_name)) {
 				/* do nothing */
 			}
-			else if (strstr(de->d_name, PTCACHE_EXT)) { /* do we have the right extension?*/
+			else if (strstr(de->d_name, PTCACHE_EXT) || strstr(de->d_name, PTCACHE_CONTAINER_EXT)) { /* do we have the right extension?*/
 				BLI_join_dirfile(path_full, sizeof(path_full), path, de->d_name);
 				BLI_delete(path_full, false, false);
 			}
@@ -3841,6 +5330,52 @@ void BKE_ptcache_toggle_disk_cache(PTCacheID *pid)
 	}
 }
 
+void BKE_ptcache_toggle_disk_container(PTCacheID *pid)
+{
+	PointCache *cache = pid->cache;
+	PTCacheMem *pm;
+	int last_exact = cache->last_exact;
+	int baked = cache->flag & PTCACHE_BAKED;
+	int cfra;
+
+	if ((cache->flag & PTCACHE_DISK_CACHE) == 0 || !G.relbase_valid)
+		return;
+
+	if (cache->cached_frames) {
+		MEM_freeN(cache->cached_frames);
+		cache->cached_frames = NULL;
+	}
+
+	/* Read the frames in the format they were written in. */
+	cache->flag ^= PTCACHE_DISK_CONTAINER;
+
+	BKE_ptcache_free_mem(&cache->mem_cache);
+
+	for (cfra = cache->startframe; cfra <= cache->endframe; cfra++) {
+		pm = ptcache_disk_frame_to_mem(pid, cfra);
+
+		if (pm)
+			BLI_addtail(&cache->mem_cache, pm);
+	}
+
+	/* Remove possible bake flag to allow clear */
+	cache->flag &= ~PTCACHE_BAKED;
+	BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_ALL, 0);
+	cache->flag |= baked;
+
+	/* And write them in the new one. */
+	cache->flag ^= PTCACHE_DISK_CONTAINER;
+
+	BKE_ptcache_mem_to_disk(pid);
+	BKE_ptcache_free_mem(&cache->mem_cache);
+
+	cache->last_exact = last_exact;
+
+	BKE_ptcache_id_time(pid, NULL, 0.0f, NULL, NULL, NULL);
+
+	BKE_ptcache_update_info(pid);
+}
+
 void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
 {
 	char old_name[80];
@@ -3854,6 +5389,9 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
 	char old_path_full[MAX_PTCACHE_FILE];
 	char ext[MAX_PTCACHE_PATH];
 
+	if (ptcache_container_use(pid))
+		ptcache_container_rename(pid, name_src, name_dst);
+
 	/* save old name */
 	BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
 
@@ -4042,7 +5580,15 @@ void BKE_ptcache_update_info(PTCacheID *pid)
 					totframes++;
 			}
 
-			BLI_snprintf(mem_info, sizeof(mem_info), IFACE_("%i frames on disk"), totframes);
+			if (ptcache_container_use(pid)) {
+				char formatted_mem[15];
+
+				BLI_str_format_byte_unit(formatted_mem, (long long int)ptcache_container_size(pid), true);
+				BLI_snprintf(mem_info, sizeof(mem_info), IFACE_("%i frames on disk (%s)"), totframes, formatted_mem);
+			}
+			else {
+				BLI_snprintf(mem_info, sizeof(mem_info), IFACE_("%i frames on disk"), totframes);
+			}
 		}
 	}
 	else {
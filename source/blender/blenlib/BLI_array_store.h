@@ -29,6 +29,15 @@
 typedef struct BArrayStore BArrayStore;
 typedef struct BArrayState BArrayState;
 
+typedef enum eBArrayStoreFlag {
+	/** Split new data at boundaries defined by its content instead of at a fixed size,
+	 * so inserting or removing elements doesn't change all chunks after the edit. */
+	BLI_ARRAY_STORE_CHUNK_BY_CONTENT = (1 << 0),
+} eBArrayStoreFlag;
+
+BArrayStore *BLI_array_store_create_ex(
+        unsigned int stride, unsigned int chunk_count,
+        const int flag);
 BArrayStore *BLI_array_store_create(
         unsigned int stride, unsigned int chunk_count);
 void BLI_array_store_destroy(
@@ -52,6 +61,8 @@ void BLI_array_store_state_remove(
 
 size_t BLI_array_store_state_size_get(
         BArrayState *state);
+size_t BLI_array_store_state_size_unique_get(
+        const BArrayState *state);
 void BLI_array_store_state_data_get(
         BArrayState *state,
         void *data);
@@ -30,6 +30,8 @@ struct BArrayStore;
 struct BArrayStore_AtSize {
 	struct BArrayStore **stride_table;
 	int                  stride_table_len;
+	/* eBArrayStoreFlag, used when creating stores */
+	int                  flag;
 };
 
 BArrayStore *BLI_array_store_at_size_ensure(
@@ -75,6 +75,10 @@ typedef struct GHashIterState {
 enum {
 	GHASH_FLAG_ALLOW_DUPES  = (1 << 0),  /* Only checked for in debug mode */
 	GHASH_FLAG_ALLOW_SHRINK = (1 << 1),  /* Allow to shrink buckets' size. */
+	/* Use flat open addressing storage instead of bucket chains, can only be set while empty.
+	 * Faster lookups, but insertions may move entries, so pointers to keys and values
+	 * (from #BLI_ghash_lookup_p, #BLI_ghash_ensure_p & co.) are only valid until the next insertion. */
+	GHASH_FLAG_FLAT         = (1 << 2),
 
 #ifdef GHASH_INTERNAL_API
 	/* Internal usage only */
@@ -138,6 +138,10 @@ float BLI_bvhtree_get_epsilon(const BVHTree *tree);
 int BLI_bvhtree_find_nearest(
         BVHTree *tree, const float co[3], BVHTreeNearest *nearest,
         BVHTree_NearestPointCallback callback, void *userdata);
+/* threaded version of the above for many points, 'nearest' is an array of 'co_len' initialized items */
+void BLI_bvhtree_find_nearest_batch(
+        BVHTree *tree, const float (*co)[3], const int co_len, BVHTreeNearest *nearest,
+        BVHTree_NearestPointCallback callback, void *userdata);
 
 int BLI_bvhtree_ray_cast_ex(
         BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
@@ -147,6 +151,17 @@ int BLI_bvhtree_ray_cast(
         BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
         BVHTree_RayCastCallback callback, void *userdata);
 
+/* threaded versions of the above for many rays, 'hit' is an array of 'rays_len' initialized items */
+void BLI_bvhtree_ray_cast_batch_ex(
+        BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int rays_len,
+        float radius, BVHTreeRayHit *hit,
+        BVHTree_RayCastCallback callback, void *userdata,
+        int flag);
+void BLI_bvhtree_ray_cast_batch(
+        BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int rays_len,
+        float radius, BVHTreeRayHit *hit,
+        BVHTree_RayCastCallback callback, void *userdata);
+
 void BLI_bvhtree_ray_cast_all_ex(
         BVHTree *tree, const float co[3], const float dir[3], float radius, float hit_dist,
         BVHTree_RayCastCallback callback, void *userdata,
@@ -66,6 +66,17 @@ void BLI_kdtree_range_search_cb(
         const KDTree *tree, const float co[3], float range,
         bool (*search_cb)(void *user_data, int index, const float co[3], float dist_sq), void *user_data);
 
+/* batch queries, threaded over 'co' */
+typedef void (*KDTreeRangeSearchBatchFn)(
+        void *user_data, unsigned int co_index, const KDTreeNearest *nearest, unsigned int nearest_len);
+
+void BLI_kdtree_find_nearest_n_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_len,
+        KDTreeNearest *r_nearest, int *r_found, unsigned int n) ATTR_NONNULL(1, 2, 4, 5);
+void BLI_kdtree_range_search_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_len, float range,
+        KDTreeRangeSearchBatchFn fn, void *user_data) ATTR_NONNULL(1, 2, 5);
+
 int BLI_kdtree_calc_duplicates_fast(
         const KDTree *tree, const float range, bool use_index_order,
         int *doubles);
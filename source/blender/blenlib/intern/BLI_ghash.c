@@ -30,6 +30,7 @@
  *
  * A general (pointer -> pointer) chaining hash table
  * for 'Abstract Data Types' (known as an ADT Hash Table).
+ * Tables can optionally use flat open addressing storage instead, see #GHASH_FLAG_FLAT.
  *
  * \note edgehash.c is based on this, make sure they stay in sync.
  */
@@ -44,6 +45,11 @@
 #include "BLI_sys_types.h"  /* for intptr_t support */
 #include "BLI_utildefines.h"
 #include "BLI_mempool.h"
+#include "BLI_math_bits.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
 
 #define GHASH_INTERNAL_API
 #include "BLI_ghash.h"  /* own include */
@@ -87,6 +93,19 @@ BLI_STATIC_ASSERT(ARRAY_SIZE(hashsizes) == GHASH_MAX_SIZE, "Invalid 'hashsizes'
 #define GHASH_LIMIT_GROW(_nbkt)   (((_nbkt) * 3) /  4)
 #define GHASH_LIMIT_SHRINK(_nbkt) (((_nbkt) * 3) / 16)
 
+/**
+ * Flat storage: slots are probed in groups of #GHASH_FLAT_GROUP_SIZE control bytes.
+ * Open addressing degrades quickly when nearly full, max load (used and deleted slots) is 7/8.
+ */
+#define GHASH_FLAT_GROUP_SIZE 16
+#define GHASH_FLAT_SIZE_MAX (1u << 31)
+#define GHASH_FLAT_LIMIT_GROW(_nslots)   (((_nslots) * 7) /  8)
+#define GHASH_FLAT_LIMIT_SHRINK(_nslots) (((_nslots) * 7) / 32)
+
+/* Control byte values, used slots store the 7 high bits of their (mixed) hash. */
+#define GHASH_FLAT_CTRL_EMPTY   0x80
+#define GHASH_FLAT_CTRL_DELETED 0xfe
+
 /* WARNING! Keep in sync with ugly _gh_Entry in header!!! */
 typedef struct Entry {
 	struct Entry *next;
@@ -121,6 +140,12 @@ struct GHash {
 
 	uint nentries;
 	uint flag;
+
+	/* Flat storage (#GHASH_FLAG_FLAT), in which case 'nbuckets' is the number of slots. */
+	uchar *flat_ctrl;
+	char *flat_entries;
+	uint flat_ndeleted;
+	uint flat_nslots_min;
 };
 
 /** \} */
@@ -166,6 +191,10 @@ BLI_INLINE uint ghash_entryhash(GHash *gh, const Entry *e)
  */
 BLI_INLINE uint ghash_bucket_index(GHash *gh, const uint hash)
 {
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		/* Flat storage probes slots starting from the full hash. */
+		return hash;
+	}
 #ifdef GHASH_USE_MODULO_BUCKETS
 	return hash % gh->nbuckets;
 #else
@@ -385,6 +414,295 @@ BLI_INLINE void ghash_buckets_reset(GHash *gh, const uint nentries)
 	ghash_buckets_expand(gh, nentries, (nentries != 0));
 }
 
+/* -------------------------------------------------------------------- */
+/* Flat storage.
+ *
+ * All entries are stored in a single array of slots, with one control byte per slot telling
+ * whether it is empty, deleted, or used by a key with the given 7 bits of hash.
+ * Lookups compare a whole group of control bytes at once (SSE2 when available),
+ * and only call the compare callback for the few slots matching those hash bits.
+ *
+ * Slots only store the key (and value), without the 'next' pointer of #Entry.
+ * Entry pointers are offset so that #Entry.key lands on the slot,
+ * which keeps iterators and the rest of the entry-level code working unchanged,
+ * as long as 'next' is never accessed for flat storage.
+ */
+
+BLI_INLINE uint ghash_flat_slot_size(GHash *gh)
+{
+	return (uint)(GHASH_ENTRY_SIZE(gh->flag & GHASH_FLAG_IS_GSET) - sizeof(Entry *));
+}
+
+BLI_INLINE Entry *ghash_flat_entry(GHash *gh, const uint index)
+{
+	return (Entry *)(gh->flat_entries + (size_t)index * ghash_flat_slot_size(gh));
+}
+
+BLI_INLINE uint ghash_flat_entry_index(GHash *gh, const Entry *e)
+{
+	return (uint)((size_t)((const char *)e - gh->flat_entries) / ghash_flat_slot_size(gh));
+}
+
+/**
+ * Mix the user hash, many hash functions (pointers, integers) have poor high or low bits,
+ * while we use low bits for the first group to probe and high bits for the control byte.
+ */
+BLI_INLINE uint ghash_flat_hash_mix(uint hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+BLI_INLINE uchar ghash_flat_hash_ctrl(const uint hash_mix)
+{
+	return (uchar)(hash_mix >> 25);
+}
+
+/**
+ * \return bit-mask of slots in the group matching \a ctrl_value.
+ */
+BLI_INLINE uint ghash_flat_group_match(const uchar *group, const uchar ctrl_value)
+{
+#ifdef __SSE2__
+	const __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)ctrl_value)));
+#else
+	uint mask = 0;
+	for (uint i = 0; i < GHASH_FLAT_GROUP_SIZE; i++) {
+		if (group[i] == ctrl_value) {
+			mask |= (1u << i);
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * \return bit-mask of empty or deleted slots in the group (both have the high bit set).
+ */
+BLI_INLINE uint ghash_flat_group_match_free(const uchar *group)
+{
+#ifdef __SSE2__
+	return (uint)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+	uint mask = 0;
+	for (uint i = 0; i < GHASH_FLAT_GROUP_SIZE; i++) {
+		if (group[i] & 0x80) {
+			mask |= (1u << i);
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * Smallest number of slots able to hold \a nentries.
+ */
+static uint ghash_flat_nslots_for(const uint nentries)
+{
+	uint nslots = GHASH_FLAT_GROUP_SIZE;
+	while ((GHASH_FLAT_LIMIT_GROW(nslots) <= nentries) && (nslots < GHASH_FLAT_SIZE_MAX)) {
+		nslots <<= 1;
+	}
+	return nslots;
+}
+
+/**
+ * Groups are probed with triangular steps, visiting all groups since their number is a power of two.
+ * The table always has empty slots, so probing stops at the first group containing one.
+ */
+BLI_INLINE Entry *ghash_flat_lookup_entry(GHash *gh, const void *key, const uint hash)
+{
+	const uint hash_mix = ghash_flat_hash_mix(hash);
+	const uchar ctrl_value = ghash_flat_hash_ctrl(hash_mix);
+	const uint group_mask = (gh->nbuckets / GHASH_FLAT_GROUP_SIZE) - 1;
+	uint group = hash_mix & group_mask;
+
+	for (uint probe = 1; ; probe++) {
+		const uchar *ctrl = &gh->flat_ctrl[group * GHASH_FLAT_GROUP_SIZE];
+		uint match = ghash_flat_group_match(ctrl, ctrl_value);
+		while (match) {
+			const uint index = group * GHASH_FLAT_GROUP_SIZE + bitscan_forward_clear_uint(&match);
+			Entry *e = ghash_flat_entry(gh, index);
+			if (LIKELY(gh->cmpfp(key, e->key) == false)) {
+				return e;
+			}
+		}
+		if (ghash_flat_group_match(ctrl, GHASH_FLAT_CTRL_EMPTY)) {
+			return NULL;
+		}
+		group = (group + probe) & group_mask;
+	}
+}
+
+/**
+ * Find the first empty or deleted slot for \a hash and mark it as used.
+ */
+BLI_INLINE uint ghash_flat_claim_slot(GHash *gh, const uint hash)
+{
+	const uint hash_mix = ghash_flat_hash_mix(hash);
+	const uint group_mask = (gh->nbuckets / GHASH_FLAT_GROUP_SIZE) - 1;
+	uint group = hash_mix & group_mask;
+
+	for (uint probe = 1; ; probe++) {
+		uchar *ctrl = &gh->flat_ctrl[group * GHASH_FLAT_GROUP_SIZE];
+		uint match = ghash_flat_group_match_free(ctrl);
+		if (match) {
+			const uint index = group * GHASH_FLAT_GROUP_SIZE + bitscan_forward_uint(match);
+			if (gh->flat_ctrl[index] == GHASH_FLAT_CTRL_DELETED) {
+				gh->flat_ndeleted--;
+			}
+			gh->flat_ctrl[index] = ghash_flat_hash_ctrl(hash_mix);
+			return index;
+		}
+		group = (group + probe) & group_mask;
+	}
+}
+
+/**
+ * Re-allocate flat storage with \a nslots, re-inserting all entries (this also drops deleted slots).
+ */
+static void ghash_flat_resize(GHash *gh, const uint nslots)
+{
+	uchar *ctrl_old = gh->flat_ctrl;
+	char *entries_old = gh->flat_entries;
+	const uint nslots_old = gh->nbuckets;
+	const uint slot_size = ghash_flat_slot_size(gh);
+
+	BLI_assert((nslots % GHASH_FLAT_GROUP_SIZE) == 0 && (nslots & (nslots - 1)) == 0);
+	BLI_assert(gh->nentries < GHASH_FLAT_LIMIT_GROW(nslots));
+
+	gh->nbuckets = nslots;
+	gh->limit_grow = GHASH_FLAT_LIMIT_GROW(nslots);
+	gh->limit_shrink = GHASH_FLAT_LIMIT_SHRINK(nslots);
+	gh->flat_ndeleted = 0;
+
+	gh->flat_ctrl = MEM_mallocN(sizeof(*gh->flat_ctrl) * nslots, __func__);
+	memset(gh->flat_ctrl, GHASH_FLAT_CTRL_EMPTY, sizeof(*gh->flat_ctrl) * nslots);
+	/* Leading pointer is the (never accessed) 'next' member of the first entry. */
+	gh->flat_entries = MEM_mallocN(sizeof(Entry *) + (size_t)slot_size * nslots, __func__);
+
+	if (ctrl_old) {
+		for (uint i = 0; i < nslots_old; i++) {
+			if ((ctrl_old[i] & 0x80) == 0) {
+				Entry *e_old = (Entry *)(entries_old + (size_t)i * slot_size);
+				const uint index = ghash_flat_claim_slot(gh, ghash_entryhash(gh, e_old));
+				memcpy(&ghash_flat_entry(gh, index)->key, &e_old->key, slot_size);
+			}
+		}
+		MEM_freeN(ctrl_old);
+		MEM_freeN(entries_old);
+	}
+}
+
+/**
+ * Grow (or clean up deleted slots) before adding an entry.
+ */
+BLI_INLINE void ghash_flat_expand(GHash *gh)
+{
+	if (UNLIKELY(gh->nentries + gh->flat_ndeleted + 1 >= gh->limit_grow)) {
+		uint nslots = ghash_flat_nslots_for(gh->nentries + 1);
+		if ((gh->flag & GHASH_FLAG_ALLOW_SHRINK) == 0) {
+			nslots = MAX2(nslots, gh->nbuckets);
+		}
+		ghash_flat_resize(gh, MAX2(nslots, gh->flat_nslots_min));
+	}
+}
+
+static void ghash_flat_contract(GHash *gh)
+{
+	if ((gh->flag & GHASH_FLAG_ALLOW_SHRINK) &&
+	    (gh->nentries < gh->limit_shrink) &&
+	    (gh->nbuckets > gh->flat_nslots_min))
+	{
+		const uint nslots = MAX2(ghash_flat_nslots_for(gh->nentries), gh->flat_nslots_min);
+		if (nslots < gh->nbuckets) {
+			ghash_flat_resize(gh, nslots);
+		}
+	}
+}
+
+/**
+ * Add a new entry (key is not set).
+ */
+static Entry *ghash_flat_insert_entry(GHash *gh, const uint hash)
+{
+	ghash_flat_expand(gh);
+	const uint index = ghash_flat_claim_slot(gh, hash);
+	gh->nentries++;
+	return ghash_flat_entry(gh, index);
+}
+
+/**
+ * Mark the slot of \a e as free, the entry data stays valid until the table is resized.
+ */
+static void ghash_flat_remove_entry(GHash *gh, Entry *e)
+{
+	const uint index = ghash_flat_entry_index(gh, e);
+	const uchar *group = &gh->flat_ctrl[index & ~(uint)(GHASH_FLAT_GROUP_SIZE - 1)];
+
+	/* When the group still has an empty slot, no probe sequence ever continued past it,
+	 * so the slot can become empty again instead of deleted. */
+	if (ghash_flat_group_match(group, GHASH_FLAT_CTRL_EMPTY)) {
+		gh->flat_ctrl[index] = GHASH_FLAT_CTRL_EMPTY;
+	}
+	else {
+		gh->flat_ctrl[index] = GHASH_FLAT_CTRL_DELETED;
+		gh->flat_ndeleted++;
+	}
+	gh->nentries--;
+}
+
+/**
+ * Find the index of next used slot, starting from \a curr_slot (\a gh is assumed non-empty).
+ */
+BLI_INLINE uint ghash_flat_find_next_slot_index(GHash *gh, uint curr_slot)
+{
+	if (curr_slot >= gh->nbuckets) {
+		curr_slot = 0;
+	}
+	for (uint i = 0; i < gh->nbuckets; i++, curr_slot++) {
+		if (curr_slot == gh->nbuckets) {
+			curr_slot = 0;
+		}
+		if ((gh->flat_ctrl[curr_slot] & 0x80) == 0) {
+			return curr_slot;
+		}
+	}
+	BLI_assert(0);
+	return 0;
+}
+
+/**
+ * Clear and reset flat storage, reserving slots for given number of entries.
+ */
+static void ghash_flat_reset(GHash *gh, const uint nentries)
+{
+	MEM_SAFE_FREE(gh->flat_ctrl);
+	MEM_SAFE_FREE(gh->flat_entries);
+	gh->nentries = 0;
+	gh->flat_nslots_min = ghash_flat_nslots_for(nentries);
+	ghash_flat_resize(gh, gh->flat_nslots_min);
+}
+
+/**
+ * Free an entry once the caller is done with it.
+ */
+BLI_INLINE void ghash_entry_free(GHash *gh, Entry *e)
+{
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		/* Deferred until here since shrinking moves entries. */
+		ghash_flat_contract(gh);
+	}
+	else {
+		BLI_mempool_free(gh->entrypool, e);
+	}
+}
+
 /**
  * Internal lookup function.
  * Takes hash and bucket_index arguments to avoid calling #ghash_keyhash and #ghash_bucket_index multiple times.
@@ -393,6 +711,9 @@ BLI_INLINE Entry *ghash_lookup_entry_ex(
         GHash *gh, const void *key, const uint bucket_index)
 {
 	Entry *e;
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		return ghash_flat_lookup_entry(gh, key, bucket_index);
+	}
 	/* If we do not store GHash, not worth computing it for each entry here!
 	 * Typically, comparison function will be quicker, and since it's needed in the end anyway... */
 	for (e = gh->buckets[bucket_index]; e; e = e->next) {
@@ -447,47 +768,57 @@ static GHash *ghash_new(
 
 	gh->buckets = NULL;
 	gh->flag = flag;
-
-	ghash_buckets_reset(gh, nentries_reserve);
-	gh->entrypool = BLI_mempool_create(GHASH_ENTRY_SIZE(flag & GHASH_FLAG_IS_GSET), 64, 64, BLI_MEMPOOL_NOP);
+	gh->flat_ctrl = NULL;
+	gh->flat_entries = NULL;
+	gh->flat_ndeleted = 0;
+	gh->flat_nslots_min = 0;
+
+	if (flag & GHASH_FLAG_FLAT) {
+		gh->entrypool = NULL;
+		ghash_flat_reset(gh, nentries_reserve);
+	}
+	else {
+		ghash_buckets_reset(gh, nentries_reserve);
+		gh->entrypool = BLI_mempool_create(GHASH_ENTRY_SIZE(flag & GHASH_FLAG_IS_GSET), 64, 64, BLI_MEMPOOL_NOP);
+	}
 
 	return gh;
 }
 
 /**
- * Internal insert function.
- * Takes hash and bucket_index arguments to avoid calling #ghash_keyhash and #ghash_bucket_index multiple times.
+ * Internal insert function, adds an entry for \a key and returns it (value is not set).
+ * Takes bucket_index argument to avoid calling #ghash_keyhash and #ghash_bucket_index multiple times.
  */
-BLI_INLINE void ghash_insert_ex(
-        GHash *gh, void *key, void *val, const uint bucket_index)
+BLI_INLINE Entry *ghash_insert_ex_keyonly_entry(
+        GHash *gh, void *key, const uint bucket_index)
 {
-	GHashEntry *e = BLI_mempool_alloc(gh->entrypool);
+	Entry *e;
 
 	BLI_assert((gh->flag & GHASH_FLAG_ALLOW_DUPES) || (BLI_ghash_haskey(gh, key) == 0));
-	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 
-	e->e.next = gh->buckets[bucket_index];
-	e->e.key = key;
-	e->val = val;
-	gh->buckets[bucket_index] = (Entry *)e;
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		e = ghash_flat_insert_entry(gh, bucket_index);
+		e->key = key;
+	}
+	else {
+		e = BLI_mempool_alloc(gh->entrypool);
+		e->next = gh->buckets[bucket_index];
+		e->key = key;
+		gh->buckets[bucket_index] = e;
 
-	ghash_buckets_expand(gh, ++gh->nentries, false);
+		ghash_buckets_expand(gh, ++gh->nentries, false);
+	}
+
+	return e;
 }
 
-/**
- * Insert function that takes a pre-allocated entry.
- */
-BLI_INLINE void ghash_insert_ex_keyonly_entry(
-        GHash *gh, void *key, const uint bucket_index,
-        Entry *e)
+BLI_INLINE void ghash_insert_ex(
+        GHash *gh, void *key, void *val, const uint bucket_index)
 {
-	BLI_assert((gh->flag & GHASH_FLAG_ALLOW_DUPES) || (BLI_ghash_haskey(gh, key) == 0));
-
-	e->next = gh->buckets[bucket_index];
-	e->key = key;
-	gh->buckets[bucket_index] = e;
+	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 
-	ghash_buckets_expand(gh, ++gh->nentries, false);
+	GHashEntry *e = (GHashEntry *)ghash_insert_ex_keyonly_entry(gh, key, bucket_index);
+	e->val = val;
 }
 
 /**
@@ -496,16 +827,9 @@ BLI_INLINE void ghash_insert_ex_keyonly_entry(
 BLI_INLINE void ghash_insert_ex_keyonly(
         GHash *gh, void *key, const uint bucket_index)
 {
-	Entry *e = BLI_mempool_alloc(gh->entrypool);
-
-	BLI_assert((gh->flag & GHASH_FLAG_ALLOW_DUPES) || (BLI_ghash_haskey(gh, key) == 0));
 	BLI_assert((gh->flag & GHASH_FLAG_IS_GSET) != 0);
 
-	e->next = gh->buckets[bucket_index];
-	e->key = key;
-	gh->buckets[bucket_index] = e;
-
-	ghash_buckets_expand(gh, ++gh->nentries, false);
+	ghash_insert_ex_keyonly_entry(gh, key, bucket_index);
 }
 
 BLI_INLINE void ghash_insert(GHash *gh, void *key, void *val)
@@ -571,15 +895,17 @@ BLI_INLINE bool ghash_insert_safe_keyonly(
 }
 
 /**
- * Remove the entry and return it, caller must free from gh->entrypool.
+ * Remove the entry and return it, caller must free it with #ghash_entry_free.
  */
 static Entry *ghash_remove_ex(
         GHash *gh, const void *key,
         GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
         const uint bucket_index)
 {
-	Entry *e_prev;
-	Entry *e = ghash_lookup_entry_prev_ex(gh, key, &e_prev, bucket_index);
+	Entry *e_prev = NULL;
+	Entry *e = (gh->flag & GHASH_FLAG_FLAT) ?
+	           ghash_flat_lookup_entry(gh, key, bucket_index) :
+	           ghash_lookup_entry_prev_ex(gh, key, &e_prev, bucket_index);
 
 	BLI_assert(!valfreefp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
@@ -591,21 +917,26 @@ static Entry *ghash_remove_ex(
 			valfreefp(((GHashEntry *)e)->val);
 		}
 
-		if (e_prev) {
-			e_prev->next = e->next;
+		if (gh->flag & GHASH_FLAG_FLAT) {
+			ghash_flat_remove_entry(gh, e);
 		}
 		else {
-			gh->buckets[bucket_index] = e->next;
-		}
+			if (e_prev) {
+				e_prev->next = e->next;
+			}
+			else {
+				gh->buckets[bucket_index] = e->next;
+			}
 
-		ghash_buckets_contract(gh, --gh->nentries, false, false);
+			ghash_buckets_contract(gh, --gh->nentries, false, false);
+		}
 	}
 
 	return e;
 }
 
 /**
- * Remove a random entry and return it (or NULL if empty), caller must free from gh->entrypool.
+ * Remove a random entry and return it (or NULL if empty), caller must free it with #ghash_entry_free.
  */
 static Entry *ghash_pop(GHash *gh, GHashIterState *state)
 {
@@ -614,6 +945,16 @@ static Entry *ghash_pop(GHash *gh, GHashIterState *state)
 		return NULL;
 	}
 
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		curr_bucket = ghash_flat_find_next_slot_index(gh, curr_bucket);
+
+		Entry *e = ghash_flat_entry(gh, curr_bucket);
+		ghash_flat_remove_entry(gh, e);
+
+		state->curr_bucket = curr_bucket;
+		return e;
+	}
+
 	/* Note: using first_bucket_index here allows us to avoid potential huge number of loops over buckets,
 	 *       in case we are popping from a large ghash with few items in it... */
 	curr_bucket = ghash_find_next_bucket_index(gh, curr_bucket);
@@ -639,6 +980,21 @@ static void ghash_free_cb(
 	BLI_assert(keyfreefp  || valfreefp);
 	BLI_assert(!valfreefp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		for (i = 0; i < gh->nbuckets; i++) {
+			if ((gh->flat_ctrl[i] & 0x80) == 0) {
+				Entry *e = ghash_flat_entry(gh, i);
+				if (keyfreefp) {
+					keyfreefp(e->key);
+				}
+				if (valfreefp) {
+					valfreefp(((GHashEntry *)e)->val);
+				}
+			}
+		}
+		return;
+	}
+
 	for (i = 0; i < gh->nbuckets; i++) {
 		Entry *e;
 
@@ -665,6 +1021,24 @@ static GHash *ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP val
 
 	BLI_assert(!valcopyfp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		/* Same slots layout, entries keep their index. */
+		gh_new = ghash_new(gh->hashfp, gh->cmpfp, __func__, 0, gh->flag);
+		if (gh_new->nbuckets != gh->nbuckets) {
+			ghash_flat_resize(gh_new, gh->nbuckets);
+		}
+		gh_new->flat_nslots_min = gh->flat_nslots_min;
+		memcpy(gh_new->flat_ctrl, gh->flat_ctrl, sizeof(*gh->flat_ctrl) * gh->nbuckets);
+		for (i = 0; i < gh->nbuckets; i++) {
+			if ((gh->flat_ctrl[i] & 0x80) == 0) {
+				ghash_entry_copy(gh_new, ghash_flat_entry(gh_new, i), gh, ghash_flat_entry(gh, i), keycopyfp, valcopyfp);
+			}
+		}
+		gh_new->flat_ndeleted = gh->flat_ndeleted;
+		gh_new->nentries = gh->nentries;
+		return gh_new;
+	}
+
 	gh_new = ghash_new(gh->hashfp, gh->cmpfp, __func__, 0, gh->flag);
 	ghash_buckets_expand(gh_new, reserve_nentries_new, false);
 
@@ -735,6 +1109,16 @@ GHash *BLI_ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP valcop
  */
 void BLI_ghash_reserve(GHash *gh, const uint nentries_reserve)
 {
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		gh->flat_nslots_min = ghash_flat_nslots_for(nentries_reserve);
+		if (gh->flat_nslots_min > gh->nbuckets) {
+			ghash_flat_resize(gh, gh->flat_nslots_min);
+		}
+		else {
+			ghash_flat_contract(gh);
+		}
+		return;
+	}
 	ghash_buckets_expand(gh, nentries_reserve, true);
 	ghash_buckets_contract(gh, nentries_reserve, true, false);
 }
@@ -858,8 +1242,7 @@ bool BLI_ghash_ensure_p(GHash *gh, void *key, void ***r_val)
 	const bool haskey = (e != NULL);
 
 	if (!haskey) {
-		e = BLI_mempool_alloc(gh->entrypool);
-		ghash_insert_ex_keyonly_entry(gh, key, bucket_index, (Entry *)e);
+		e = (GHashEntry *)ghash_insert_ex_keyonly_entry(gh, key, bucket_index);
 	}
 
 	*r_val = &e->val;
@@ -882,8 +1265,7 @@ bool BLI_ghash_ensure_p_ex(
 
 	if (!haskey) {
 		/* pass 'key' incase we resize */
-		e = BLI_mempool_alloc(gh->entrypool);
-		ghash_insert_ex_keyonly_entry(gh, (void *)key, bucket_index, (Entry *)e);
+		e = (GHashEntry *)ghash_insert_ex_keyonly_entry(gh, (void *)key, bucket_index);
 		e->e.key = NULL;  /* caller must re-assign */
 	}
 
@@ -906,7 +1288,7 @@ bool BLI_ghash_remove(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp, GHas
 	const uint bucket_index = ghash_bucket_index(gh, hash);
 	Entry *e = ghash_remove_ex(gh, key, keyfreefp, valfreefp, bucket_index);
 	if (e) {
-		BLI_mempool_free(gh->entrypool, e);
+		ghash_entry_free(gh, (Entry *)e);
 		return true;
 	}
 	else {
@@ -931,7 +1313,7 @@ void *BLI_ghash_popkey(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp)
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 	if (e) {
 		void *val = e->val;
-		BLI_mempool_free(gh->entrypool, e);
+		ghash_entry_free(gh, (Entry *)e);
 		return val;
 	}
 	else {
@@ -967,7 +1349,7 @@ bool BLI_ghash_pop(
 		*r_key = e->e.key;
 		*r_val = e->val;
 
-		BLI_mempool_free(gh->entrypool, e);
+		ghash_entry_free(gh, (Entry *)e);
 		return true;
 	}
 	else {
@@ -990,6 +1372,11 @@ void BLI_ghash_clear_ex(
 	if (keyfreefp || valfreefp)
 		ghash_free_cb(gh, keyfreefp, valfreefp);
 
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		ghash_flat_reset(gh, nentries_reserve);
+		return;
+	}
+
 	ghash_buckets_reset(gh, nentries_reserve);
 	BLI_mempool_clear_ex(gh->entrypool, nentries_reserve ? (int)nentries_reserve : -1);
 }
@@ -1011,29 +1398,53 @@ void BLI_ghash_clear(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfree
  */
 void BLI_ghash_free(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
-	BLI_assert((int)gh->nentries == BLI_mempool_len(gh->entrypool));
+	BLI_assert((gh->flag & GHASH_FLAG_FLAT) || ((int)gh->nentries == BLI_mempool_len(gh->entrypool)));
 	if (keyfreefp || valfreefp)
 		ghash_free_cb(gh, keyfreefp, valfreefp);
 
-	MEM_freeN(gh->buckets);
-	BLI_mempool_destroy(gh->entrypool);
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		MEM_freeN(gh->flat_ctrl);
+		MEM_freeN(gh->flat_entries);
+	}
+	else {
+		MEM_freeN(gh->buckets);
+		BLI_mempool_destroy(gh->entrypool);
+	}
 	MEM_freeN(gh);
 }
 
 /**
  * Sets a GHash flag.
+ *
+ * \note #GHASH_FLAG_FLAT switches storage, so \a gh must be empty.
  */
 void BLI_ghash_flag_set(GHash *gh, uint flag)
 {
+	if ((flag & GHASH_FLAG_FLAT) && !(gh->flag & GHASH_FLAG_FLAT)) {
+		BLI_assert(gh->nentries == 0);
+		/* Keep the reserved size, if any. */
+		const uint nentries_reserve = (gh->size_min != 0) ? gh->limit_grow : 0;
+
+		MEM_freeN(gh->buckets);
+		gh->buckets = NULL;
+		BLI_mempool_destroy(gh->entrypool);
+		gh->entrypool = NULL;
+
+		gh->flag |= GHASH_FLAG_FLAT;
+		ghash_flat_reset(gh, nentries_reserve);
+	}
 	gh->flag |= flag;
 }
 
 /**
  * Clear a GHash flag.
+ *
+ * \note #GHASH_FLAG_FLAT can't be cleared.
  */
 void BLI_ghash_flag_clear(GHash *gh, uint flag)
 {
-	gh->flag &= ~flag;
+	BLI_assert((flag & GHASH_FLAG_FLAT) == 0);
+	gh->flag &= ~(flag & ~(uint)GHASH_FLAG_FLAT);
 }
 
 /** \} */
@@ -1042,6 +1453,21 @@ void BLI_ghash_flag_clear(GHash *gh, uint flag)
 /** \name GHash Iterator API
  * \{ */
 
+/**
+ * Advance to the next used slot after 'curBucket' for flat storage.
+ */
+static void ghash_flat_iterator_step(GHashIterator *ghi)
+{
+	GHash *gh = ghi->gh;
+	ghi->curEntry = NULL;
+	for (ghi->curBucket++; ghi->curBucket < gh->nbuckets; ghi->curBucket++) {
+		if ((gh->flat_ctrl[ghi->curBucket] & 0x80) == 0) {
+			ghi->curEntry = ghash_flat_entry(gh, ghi->curBucket);
+			break;
+		}
+	}
+}
+
 /**
  * Create a new GHashIterator. The hash table must not be mutated
  * while the iterator is in use, and the iterator will step exactly
@@ -1070,6 +1496,10 @@ void BLI_ghashIterator_init(GHashIterator *ghi, GHash *gh)
 	ghi->gh = gh;
 	ghi->curEntry = NULL;
 	ghi->curBucket = UINT_MAX;  /* wraps to zero */
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		ghash_flat_iterator_step(ghi);
+		return;
+	}
 	if (gh->nentries) {
 		do {
 			ghi->curBucket++;
@@ -1087,6 +1517,12 @@ void BLI_ghashIterator_init(GHashIterator *ghi, GHash *gh)
  */
 void BLI_ghashIterator_step(GHashIterator *ghi)
 {
+	if (ghi->gh->flag & GHASH_FLAG_FLAT) {
+		if (ghi->curEntry) {
+			ghash_flat_iterator_step(ghi);
+		}
+		return;
+	}
 	if (ghi->curEntry) {
 		ghi->curEntry = ghi->curEntry->next;
 		while (!ghi->curEntry) {
@@ -1228,8 +1664,7 @@ bool BLI_gset_ensure_p_ex(GSet *gs, const void *key, void ***r_key)
 
 	if (!haskey) {
 		/* pass 'key' incase we resize */
-		e = BLI_mempool_alloc(((GHash *)gs)->entrypool);
-		ghash_insert_ex_keyonly_entry((GHash *)gs, (void *)key, bucket_index, (Entry *)e);
+		e = ghash_insert_ex_keyonly_entry((GHash *)gs, (void *)key, bucket_index);
 		e->key = NULL;  /* caller must re-assign */
 	}
 
@@ -1287,7 +1722,7 @@ bool BLI_gset_pop(
 	if (e) {
 		*r_key = e->key;
 
-		BLI_mempool_free(((GHash *)gs)->entrypool, e);
+		ghash_entry_free((GHash *)gs, e);
 		return true;
 	}
 	else {
@@ -1317,12 +1752,12 @@ void BLI_gset_free(GSet *gs, GSetKeyFreeFP keyfreefp)
 
 void BLI_gset_flag_set(GSet *gs, uint flag)
 {
-	((GHash *)gs)->flag |= flag;
+	BLI_ghash_flag_set((GHash *)gs, flag);
 }
 
 void BLI_gset_flag_clear(GSet *gs, uint flag)
 {
-	((GHash *)gs)->flag &= ~flag;
+	BLI_ghash_flag_clear((GHash *)gs, flag);
 }
 
 /** \} */
@@ -1354,7 +1789,7 @@ void *BLI_gset_pop_key(GSet *gs, const void *key)
 	Entry *e = ghash_remove_ex((GHash *)gs, key, NULL, NULL, bucket_index);
 	if (e) {
 		void *key_ret = e->key;
-		BLI_mempool_free(((GHash *)gs)->entrypool, e);
+		ghash_entry_free((GHash *)gs, e);
 		return key_ret;
 	}
 	else {
@@ -1382,6 +1817,69 @@ int BLI_gset_buckets_len(GSet *gs)
 	return BLI_ghash_buckets_len((GHash *)gs);
 }
 
+/**
+ * Flat storage version of #BLI_ghash_calc_quality_ex, groups are considered as buckets.
+ *
+ * \return the average number of groups probed to find an entry (1.0 being the best).
+ */
+static double ghash_flat_calc_quality_ex(
+        GHash *gh, double *r_load, double *r_variance,
+        double *r_prop_empty_buckets, double *r_prop_overloaded_buckets, int *r_biggest_bucket)
+{
+	const uint ngroups = gh->nbuckets / GHASH_FLAT_GROUP_SIZE;
+	const uint group_mask = ngroups - 1;
+	const double mean = (double)gh->nentries / (double)ngroups;
+	uint64_t sum_probes = 0;
+	uint64_t sum_overloaded = 0;
+	uint64_t sum_empty = 0;
+	double sum_variance = 0.0;
+	int biggest_group = 0;
+
+	for (uint group = 0; group < ngroups; group++) {
+		int count = 0;
+		for (uint i = 0; i < GHASH_FLAT_GROUP_SIZE; i++) {
+			const uint index = group * GHASH_FLAT_GROUP_SIZE + i;
+			if (gh->flat_ctrl[index] & 0x80) {
+				continue;
+			}
+			count++;
+
+			/* Walk the probe sequence of this entry until we reach its group. */
+			uint probe_group = ghash_flat_hash_mix(ghash_entryhash(gh, ghash_flat_entry(gh, index))) & group_mask;
+			uint probe;
+			for (probe = 1; probe_group != group; probe++) {
+				probe_group = (probe_group + probe) & group_mask;
+			}
+			sum_probes += probe;
+		}
+		biggest_group = max_ii(biggest_group, count);
+		if (count == GHASH_FLAT_GROUP_SIZE) {
+			sum_overloaded++;
+		}
+		if (count == 0) {
+			sum_empty++;
+		}
+		sum_variance += ((double)count - mean) * ((double)count - mean);
+	}
+
+	if (r_load) {
+		*r_load = mean;
+	}
+	if (r_variance) {
+		*r_variance = (ngroups > 1) ? sum_variance / (double)(ngroups - 1) : 0.0;
+	}
+	if (r_prop_empty_buckets) {
+		*r_prop_empty_buckets = (double)sum_empty / (double)ngroups;
+	}
+	if (r_prop_overloaded_buckets) {
+		*r_prop_overloaded_buckets = (double)sum_overloaded / (double)ngroups;
+	}
+	if (r_biggest_bucket) {
+		*r_biggest_bucket = biggest_group;
+	}
+	return (double)sum_probes / (double)gh->nentries;
+}
+
 /**
  * Measure how well the hash function performs (1.0 is approx as good as random distribution),
  * and return a few other stats like load, variance of the distribution of the entries in the buckets, etc.
@@ -1415,6 +1913,11 @@ double BLI_ghash_calc_quality_ex(
 		return 0.0;
 	}
 
+	if (gh->flag & GHASH_FLAG_FLAT) {
+		return ghash_flat_calc_quality_ex(
+		        gh, r_load, r_variance, r_prop_empty_buckets, r_prop_overloaded_buckets, r_biggest_bucket);
+	}
+
 	mean = (double)gh->nentries / (double)gh->nbuckets;
 	if (r_load) {
 		*r_load = mean;
@@ -59,6 +59,10 @@
 
 #include "BLI_strict_flags.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 /* used for iterative_raycast */
 // #define USE_SKIP_LINKS
 
@@ -80,6 +84,10 @@
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
 #endif
 
+/* Number of queries handled at once by a thread in the batch functions,
+ * consecutive queries tend to visit the same nodes. */
+#define KDOPBVH_BATCH_CHUNK_SIZE 256
+
 
 /* -------------------------------------------------------------------- */
 
@@ -167,6 +175,25 @@ typedef struct BVHRayCastData {
 	BVHTreeRayHit hit;
 } BVHRayCastData;
 
+typedef struct BVHNearestBatchData {
+	BVHTree *tree;
+	const float (*co)[3];
+	BVHTreeNearest *nearest;
+	BVHTree_NearestPointCallback callback;
+	void *userdata;
+} BVHNearestBatchData;
+
+typedef struct BVHRayCastBatchData {
+	BVHTree *tree;
+	const float (*co)[3];
+	const float (*dir)[3];
+	float radius;
+	BVHTreeRayHit *hit;
+	BVHTree_RayCastCallback callback;
+	void *userdata;
+	int flag;
+} BVHRayCastBatchData;
+
 /** \} */
 
 
@@ -1181,6 +1208,20 @@ static bool tree_overlap_test(const BVHNode *node1, const BVHNode *node2, axis_t
 	const float *bv2     = node2->bv + (start_axis << 1);
 	const float *bv1_end = node1->bv + (stop_axis  << 1);
 
+#ifdef __SSE2__
+	/* Test two axes at a time, comparing (min, max) of one node with (max, min) of the other. */
+	for (; bv1_end - bv1 >= 4; bv1 += 4, bv2 += 4) {
+		const __m128 a = _mm_loadu_ps(bv1);
+		const __m128 b = _mm_loadu_ps(bv2);
+		const __m128 b_swap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+		const int separated = (_mm_movemask_ps(_mm_cmpgt_ps(a, b_swap)) & 0x5) |
+		                      (_mm_movemask_ps(_mm_cmplt_ps(a, b_swap)) & 0xa);
+		if (separated) {
+			return 0;
+		}
+	}
+#endif
+
 	/* test all axis if min + max overlap */
 	for (; bv1 != bv1_end; bv1 += 2, bv2 += 2) {
 		if ((bv1[0] > bv2[1]) || (bv2[0] > bv1[1])) {
@@ -1390,21 +1431,39 @@ BVHTreeOverlap *BLI_bvhtree_overlap(
 /** \name BLI_bvhtree_find_nearest
  * \{ */
 
-/* Determines the nearest point of the given node BV. Returns the squared distance to that point. */
+/* Determines the nearest point of the given node BV. Returns the squared distance to that point.
+ *
+ * \note \a proj may be a caller's 3 float coordinate (see #RangeQueryData.center), so only 3 floats are read. */
 static float calc_nearest_point_squared(const float proj[3], BVHNode *node, float nearest[3])
 {
-	int i;
 	const float *bv = node->bv;
 
 	/* nearest on AABB hull */
-	for (i = 0; i != 3; i++, bv += 2) {
-		if (bv[0] > proj[i])
-			nearest[i] = bv[0];
-		else if (bv[1] < proj[i])
-			nearest[i] = bv[1];
-		else
-			nearest[i] = proj[i];
+#ifdef __SSE2__
+	{
+		const __m128 bv_a = _mm_loadu_ps(bv);      /* x_min, x_max, y_min, y_max */
+		const __m128 bv_b = _mm_loadu_ps(bv + 2);  /* y_min, y_max, z_min, z_max */
+		const __m128 bv_min = _mm_shuffle_ps(bv_a, bv_b, _MM_SHUFFLE(2, 2, 2, 0));
+		const __m128 bv_max = _mm_shuffle_ps(bv_a, bv_b, _MM_SHUFFLE(3, 3, 3, 1));
+		const __m128 co = _mm_set_ps(0.0f, proj[2], proj[1], proj[0]);
+		float nearest_v4[4];
+
+		_mm_storeu_ps(nearest_v4, _mm_min_ps(_mm_max_ps(co, bv_min), bv_max));
+		copy_v3_v3(nearest, nearest_v4);
+	}
+#else
+	{
+		int i;
+		for (i = 0; i != 3; i++, bv += 2) {
+			if (bv[0] > proj[i])
+				nearest[i] = bv[0];
+			else if (bv[1] < proj[i])
+				nearest[i] = bv[1];
+			else
+				nearest[i] = proj[i];
+		}
 	}
+#endif
 
 #if 0
 	/* nearest on a general hull */
@@ -1605,6 +1664,41 @@ int BLI_bvhtree_find_nearest(
 	return data.nearest.index;
 }
 
+static void bvhtree_find_nearest_batch_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	BVHNearestBatchData *data = userdata;
+	BLI_bvhtree_find_nearest(data->tree, data->co[i], &data->nearest[i], data->callback, data->userdata);
+}
+
+/**
+ * Find the nearest node for each point of \a co, threaded over the points.
+ *
+ * \param nearest: Array of \a co_len items, each one is used as input (search distance & index)
+ * and output, like the \a nearest argument of #BLI_bvhtree_find_nearest, so it must be initialized.
+ * \param callback: Must be thread-safe.
+ */
+void BLI_bvhtree_find_nearest_batch(
+        BVHTree *tree, const float (*co)[3], const int co_len, BVHTreeNearest *nearest,
+        BVHTree_NearestPointCallback callback, void *userdata)
+{
+	BVHNearestBatchData data = {
+		.tree = tree,
+		.co = co,
+		.nearest = nearest,
+		.callback = callback,
+		.userdata = userdata,
+	};
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (co_len > KDOPBVH_THREAD_LEAF_THRESHOLD);
+	settings.min_iter_per_thread = KDOPBVH_BATCH_CHUNK_SIZE;
+	BLI_task_parallel_range(0, co_len, &data, bvhtree_find_nearest_batch_cb, &settings);
+}
+
 /** \} */
 
 
@@ -1931,6 +2025,57 @@ void BLI_bvhtree_ray_cast_all(
 	BLI_bvhtree_ray_cast_all_ex(tree, co, dir, radius, hit_dist, callback, userdata, BVH_RAYCAST_DEFAULT);
 }
 
+static void bvhtree_ray_cast_batch_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	BVHRayCastBatchData *data = userdata;
+	BLI_bvhtree_ray_cast_ex(
+	        data->tree, data->co[i], data->dir[i], data->radius, &data->hit[i],
+	        data->callback, data->userdata, data->flag);
+}
+
+/**
+ * Cast a ray for each item of \a co & \a dir, threaded over the rays.
+ *
+ * \param hit: Array of \a rays_len items, each one is used as input (max distance & index)
+ * and output, like the \a hit argument of #BLI_bvhtree_ray_cast_ex, so it must be initialized.
+ * \param callback: Must be thread-safe.
+ */
+void BLI_bvhtree_ray_cast_batch_ex(
+        BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int rays_len,
+        float radius, BVHTreeRayHit *hit,
+        BVHTree_RayCastCallback callback, void *userdata,
+        int flag)
+{
+	BVHRayCastBatchData data = {
+		.tree = tree,
+		.co = co,
+		.dir = dir,
+		.radius = radius,
+		.hit = hit,
+		.callback = callback,
+		.userdata = userdata,
+		.flag = flag,
+	};
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (rays_len > KDOPBVH_THREAD_LEAF_THRESHOLD);
+	settings.min_iter_per_thread = KDOPBVH_BATCH_CHUNK_SIZE;
+	BLI_task_parallel_range(0, rays_len, &data, bvhtree_ray_cast_batch_cb, &settings);
+}
+
+void BLI_bvhtree_ray_cast_batch(
+        BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int rays_len,
+        float radius, BVHTreeRayHit *hit,
+        BVHTree_RayCastCallback callback, void *userdata)
+{
+	BLI_bvhtree_ray_cast_batch_ex(
+	        tree, co, dir, rays_len, radius, hit, callback, userdata, BVH_RAYCAST_DEFAULT);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
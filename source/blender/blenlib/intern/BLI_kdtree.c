@@ -29,6 +29,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -61,6 +62,14 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/* Balancing: sub-trees smaller than this are balanced by a single thread. */
+#define KD_BALANCE_THREAD_THRESHOLD 10000
+/* Balancing: number of levels split before balancing sub-trees in parallel (up to 64 tasks). */
+#define KD_BALANCE_SPLIT_DEPTH 6
+
+/* Batch queries: minimum number of queries handled by a thread. */
+#define KD_BATCH_CHUNK_SIZE 256
+
 /**
  * Creates or free a kdtree
  */
@@ -113,17 +122,14 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uint ofs)
+/**
+ * Partition \a nodes around the median along \a axis, returns the median.
+ */
+static uint kdtree_balance_partition(KDTreeNode *nodes, uint totnode, uint axis)
 {
-	KDTreeNode *node;
 	float co;
 	uint left, right, median, i, j;
 
-	if (totnode <= 0)
-		return KD_NODE_UNSET;
-	else if (totnode == 1)
-		return 0 + ofs;
-
 	/* quicksort style sorting around median */
 	left = 0;
 	right = totnode - 1;
@@ -151,6 +157,21 @@ static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uin
 			left = i + 1;
 	}
 
+	return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uint ofs)
+{
+	KDTreeNode *node;
+	uint median;
+
+	if (totnode <= 0)
+		return KD_NODE_UNSET;
+	else if (totnode == 1)
+		return 0 + ofs;
+
+	median = kdtree_balance_partition(nodes, totnode, axis);
+
 	/* set node and sort subnodes */
 	node = &nodes[median];
 	node->d = axis;
@@ -161,9 +182,81 @@ static uint kdtree_balance(KDTreeNode *nodes, uint totnode, uint axis, const uin
 	return median + ofs;
 }
 
+/* A sub-tree left to be balanced, the result is written into 'r_root'. */
+typedef struct KDTreeBalanceTask {
+	uint *r_root;
+	uint totnode, axis, ofs;
+} KDTreeBalanceTask;
+
+typedef struct KDTreeBalanceData {
+	KDTreeNode *nodes;
+	KDTreeBalanceTask tasks[1 << KD_BALANCE_SPLIT_DEPTH];
+	uint tasks_len;
+} KDTreeBalanceData;
+
+/**
+ * Same as #kdtree_balance for the first \a depth levels,
+ * but deeper sub-trees are stored as tasks instead of being balanced.
+ */
+static void kdtree_balance_split(
+        KDTreeBalanceData *data, uint *r_root,
+        uint totnode, uint axis, const uint ofs, const uint depth)
+{
+	KDTreeNode *nodes = data->nodes + ofs;
+	KDTreeNode *node;
+	uint median;
+
+	if (depth == 0 || totnode <= KD_BALANCE_THREAD_THRESHOLD) {
+		KDTreeBalanceTask *task = &data->tasks[data->tasks_len++];
+		task->r_root = r_root;
+		task->totnode = totnode;
+		task->axis = axis;
+		task->ofs = ofs;
+		return;
+	}
+
+	median = kdtree_balance_partition(nodes, totnode, axis);
+
+	node = &nodes[median];
+	node->d = axis;
+	*r_root = median + ofs;
+	axis = (axis + 1) % 3;
+	kdtree_balance_split(data, &node->left, median, axis, ofs, depth - 1);
+	kdtree_balance_split(data, &node->right, (totnode - (median + 1)), axis, (median + 1) + ofs, depth - 1);
+}
+
+static void kdtree_balance_task_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	KDTreeBalanceData *data = userdata;
+	const KDTreeBalanceTask *task = &data->tasks[i];
+	*task->r_root = kdtree_balance(data->nodes + task->ofs, task->totnode, task->axis, task->ofs);
+}
+
 void BLI_kdtree_balance(KDTree *tree)
 {
-	tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	if (tree->totnode <= KD_BALANCE_THREAD_THRESHOLD) {
+		tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	}
+	else {
+		/* Sub-trees don't share any nodes once their parent is partitioned,
+		 * so split the first levels and balance the resulting sub-trees in parallel.
+		 * The resulting tree is the same as when balancing on a single thread. */
+		KDTreeBalanceData *data = MEM_mallocN(sizeof(*data), __func__);
+		data->nodes = tree->nodes;
+		data->tasks_len = 0;
+
+		kdtree_balance_split(data, &tree->root, tree->totnode, 0, 0, KD_BALANCE_SPLIT_DEPTH);
+
+		ParallelRangeSettings settings;
+		BLI_parallel_range_settings_defaults(&settings);
+		settings.use_threading = (data->tasks_len > 1);
+		BLI_task_parallel_range(0, (int)data->tasks_len, data, kdtree_balance_task_cb, &settings);
+
+		MEM_freeN(data);
+	}
 
 #ifdef DEBUG
 	tree->is_balanced = true;
@@ -545,19 +638,17 @@ static void add_in_range(
 }
 
 /**
- * Range search returns number of points found, with results in nearest
- * Normal is optional, but if given will limit results to points in normal direction from co.
- * Remember to free nearest after use!
+ * Range search collecting results into \a r_foundstack, which is re-allocated when it's too small,
+ * so it can be reused between searches.
  */
-int BLI_kdtree_range_search__normal(
-        const KDTree *tree, const float co[3], const float nor[3],
-        KDTreeNearest **r_nearest, float range)
+static uint kdtree_range_search_ex(
+        const KDTree *tree, const float co[3], const float nor[3], float range,
+        KDTreeNearest **r_foundstack, uint *r_foundstack_tot_alloc)
 {
 	const KDTreeNode *nodes = tree->nodes;
 	uint *stack, defaultstack[KD_STACK_INIT];
-	KDTreeNearest *foundstack = NULL;
 	float range_sq = range * range, dist_sq;
-	uint totstack, cur = 0, found = 0, totfoundstack = 0;
+	uint totstack, cur = 0, found = 0;
 
 #ifdef DEBUG
 	BLI_assert(tree->is_balanced == true);
@@ -585,7 +676,7 @@ int BLI_kdtree_range_search__normal(
 		else {
 			dist_sq = squared_distance(node->co, co, nor);
 			if (dist_sq <= range_sq) {
-				add_in_range(&foundstack, &totfoundstack, found++, node->index, dist_sq, node->co);
+				add_in_range(r_foundstack, r_foundstack_tot_alloc, found++, node->index, dist_sq, node->co);
 			}
 
 			if (node->left != KD_NODE_UNSET)
@@ -603,7 +694,23 @@ int BLI_kdtree_range_search__normal(
 		MEM_freeN(stack);
 
 	if (found)
-		qsort(foundstack, found, sizeof(KDTreeNearest), range_compare);
+		qsort(*r_foundstack, found, sizeof(KDTreeNearest), range_compare);
+
+	return found;
+}
+
+/**
+ * Range search returns number of points found, with results in nearest
+ * Normal is optional, but if given will limit results to points in normal direction from co.
+ * Remember to free nearest after use!
+ */
+int BLI_kdtree_range_search__normal(
+        const KDTree *tree, const float co[3], const float nor[3],
+        KDTreeNearest **r_nearest, float range)
+{
+	KDTreeNearest *foundstack = NULL;
+	uint totfoundstack = 0;
+	const uint found = kdtree_range_search_ex(tree, co, nor, range, &foundstack, &totfoundstack);
 
 	*r_nearest = foundstack;
 
@@ -804,3 +911,120 @@ int BLI_kdtree_calc_duplicates_fast(
 }
 
 /** \} */
+
+
+/* -------------------------------------------------------------------- */
+/** \name BLI_kdtree batch queries
+ *
+ * Queries over arrays of coordinates, threaded over the coordinates.
+ * Results are written to buffers allocated once (by the caller or per thread),
+ * not for every query.
+ * \{ */
+
+typedef struct KDTreeNearestBatchData {
+	const KDTree *tree;
+	const float (*co)[3];
+	KDTreeNearest *r_nearest;
+	int *r_found;
+	uint n;
+} KDTreeNearestBatchData;
+
+static void kdtree_find_nearest_n_batch_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	KDTreeNearestBatchData *data = userdata;
+	data->r_found[i] = BLI_kdtree_find_nearest_n(
+	        data->tree, data->co[i], &data->r_nearest[(uint)i * data->n], data->n);
+}
+
+/**
+ * Find the \a n nearest points of every coordinate in \a co.
+ *
+ * \param r_nearest: An array sized at least `co_len * n`,
+ * the results of `co[i]` are stored from `r_nearest[i * n]`.
+ * \param r_found: An array of \a co_len, the number of points found for each coordinate.
+ */
+void BLI_kdtree_find_nearest_n_batch(
+        const KDTree *tree, const float (*co)[3], uint co_len,
+        KDTreeNearest *r_nearest, int *r_found, uint n)
+{
+	KDTreeNearestBatchData data = {
+		.tree = tree,
+		.co = co,
+		.r_nearest = r_nearest,
+		.r_found = r_found,
+		.n = n,
+	};
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = KD_BATCH_CHUNK_SIZE;
+	BLI_task_parallel_range(0, (int)co_len, &data, kdtree_find_nearest_n_batch_cb, &settings);
+}
+
+typedef struct KDTreeRangeBatchData {
+	const KDTree *tree;
+	const float (*co)[3];
+	float range;
+	KDTreeRangeSearchBatchFn fn;
+	void *user_data;
+} KDTreeRangeBatchData;
+
+/* Per thread buffer, reused for all queries of the thread. */
+typedef struct KDTreeRangeBatchTLS {
+	KDTreeNearest *foundstack;
+	uint totfoundstack;
+} KDTreeRangeBatchTLS;
+
+static void kdtree_range_search_batch_cb(
+        void *__restrict userdata,
+        const int i,
+        const ParallelRangeTLS *__restrict tls)
+{
+	KDTreeRangeBatchData *data = userdata;
+	KDTreeRangeBatchTLS *data_tls = tls->userdata_chunk;
+	const uint found = kdtree_range_search_ex(
+	        data->tree, data->co[i], NULL, data->range, &data_tls->foundstack, &data_tls->totfoundstack);
+
+	data->fn(data->user_data, (uint)i, data_tls->foundstack, found);
+}
+
+static void kdtree_range_search_batch_finalize(
+        void *__restrict UNUSED(userdata),
+        void *__restrict userdata_chunk)
+{
+	KDTreeRangeBatchTLS *data_tls = userdata_chunk;
+	MEM_SAFE_FREE(data_tls->foundstack);
+}
+
+/**
+ * Range search for every coordinate in \a co.
+ *
+ * \param fn: Called (from any thread) with the results of each coordinate, sorted by distance.
+ * The results are only valid during the call.
+ */
+void BLI_kdtree_range_search_batch(
+        const KDTree *tree, const float (*co)[3], uint co_len, float range,
+        KDTreeRangeSearchBatchFn fn, void *user_data)
+{
+	KDTreeRangeBatchData data = {
+		.tree = tree,
+		.co = co,
+		.range = range,
+		.fn = fn,
+		.user_data = user_data,
+	};
+	KDTreeRangeBatchTLS data_tls = {NULL};
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.min_iter_per_thread = KD_BATCH_CHUNK_SIZE;
+	settings.userdata_chunk = &data_tls;
+	settings.userdata_chunk_size = sizeof(data_tls);
+	settings.func_finalize = kdtree_range_search_batch_finalize;
+	BLI_task_parallel_range(0, (int)co_len, &data, kdtree_range_search_batch_cb, &settings);
+}
+
+/** \} */
@@ -103,6 +103,20 @@
  * Once a match is found, there is a high chance next chunks match too,
  * so this is checked to avoid performing so many hash-lookups.
  * Otherwise new chunks are created.
+ *
+ * For large arrays the hash values are calculated on multiple threads
+ * (see: BCHUNK_HASH_PARALLEL_MIN).
+ *
+ *
+ * Content Defined Chunks
+ * ----------------------
+ *
+ * By default new data is split into chunks of a fixed size,
+ * so inserting or removing elements shifts the boundaries of all chunks that follow.
+ *
+ * When created with #BLI_ARRAY_STORE_CHUNK_BY_CONTENT,
+ * chunk boundaries are placed where a rolling hash of the data matches a bit-mask,
+ * so boundaries follow the content and an edit only changes the chunks around it.
  */
 
 #include <stdlib.h>
@@ -112,6 +126,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLI_strict_flags.h"
 
@@ -167,6 +182,12 @@
 #  define BCHUNK_HASH_LEN 4
 #endif
 
+/* Calculate hashes for arrays with at least this many elements on multiple threads,
+ * each task handles BCHUNK_HASH_PARALLEL_STEP elements.
+ */
+#define BCHUNK_HASH_PARALLEL_MIN  (1 << 16)
+#define BCHUNK_HASH_PARALLEL_STEP (1 << 14)
+
 /* Calculate the key once and reuse it
  */
 #define USE_HASH_TABLE_KEY_CACHE
@@ -235,6 +256,12 @@ typedef struct BArrayInfo {
 	size_t accum_steps;
 	size_t accum_read_ahead_len;
 #endif
+
+#ifdef USE_MERGE_CHUNKS
+	/* when non-zero, split new data at content defined boundaries
+	 * (see: #BLI_ARRAY_STORE_CHUNK_BY_CONTENT) */
+	uint64_t chunk_boundary_mask;
+#endif
 } BArrayInfo;
 
 typedef struct BArrayMemory {
@@ -275,6 +302,8 @@ struct BArrayState {
 
 	struct BChunkList *chunk_list;  /* BChunkList's */
 
+	/** size of chunks which were created for this state (not shared with the reference). */
+	size_t size_unique;
 };
 
 typedef struct BChunkList {
@@ -323,6 +352,7 @@ typedef struct BTableRef {
 
 
 static size_t bchunk_list_size(const BChunkList *chunk_list);
+static uint hash_data(const uchar *key, size_t n);
 
 
 /** \name Internal BChunk API
@@ -573,6 +603,70 @@ static void bchunk_list_calc_trim_len(
 	*r_data_last_chunk_len = data_last_chunk_len;
 }
 
+#ifdef USE_MERGE_CHUNKS
+
+/* Number of elements which influence a content defined boundary,
+ * older elements are shifted out of the rolling hash. */
+#define BCHUNK_BOUNDARY_WINDOW_LEN 64
+
+BLI_INLINE uint64_t bchunk_boundary_hash_step(
+        const BArrayInfo *info, const uint64_t hash, const uchar *data)
+{
+	const uint h = (info->chunk_stride == 1) ? (uint)data[0] : hash_data(data, info->chunk_stride);
+	return (hash << 1) + ((uint64_t)h * 0x9e3779b97f4a7c15ull);
+}
+
+/**
+ * Find the end of the chunk which starts at \a offset, using content defined boundaries.
+ *
+ * The returned chunk is always within #BArrayInfo.chunk_byte_size_min & #BArrayInfo.chunk_byte_size_max,
+ * and never leaves a trailing chunk smaller than #BArrayInfo.chunk_byte_size_min.
+ */
+static size_t bchunk_boundary_next(
+        const BArrayInfo *info, const uchar *data, const size_t data_len, const size_t offset)
+{
+	const size_t data_left_len = data_len - offset;
+
+	/* too small to split without creating chunks below the minimum size */
+	if (data_left_len < info->chunk_byte_size_min * 2) {
+		return data_len;
+	}
+
+	const size_t i_first = offset + info->chunk_byte_size_min;
+	const size_t i_last = MIN2(offset + info->chunk_byte_size_max, data_len - info->chunk_byte_size_min);
+	const size_t window_bytes = BCHUNK_BOUNDARY_WINDOW_LEN * info->chunk_stride;
+
+	/* only the last elements influence the hash, skip the rest */
+	size_t i = (info->chunk_byte_size_min > window_bytes) ? (i_first - window_bytes) : offset;
+	uint64_t hash = 0;
+	for (; i < i_first; i += info->chunk_stride) {
+		hash = bchunk_boundary_hash_step(info, hash, &data[i]);
+	}
+
+	for (; i < i_last; i += info->chunk_stride) {
+		if ((hash & info->chunk_boundary_mask) == 0) {
+			return i;
+		}
+		hash = bchunk_boundary_hash_step(info, hash, &data[i]);
+	}
+	if ((hash & info->chunk_boundary_mask) == 0) {
+		return i_last;
+	}
+
+	/* no boundary found */
+	if (data_left_len <= info->chunk_byte_size_max) {
+		return data_len;
+	}
+	else {
+		/* the remainder is larger than the regular chunk size, so never too small */
+		return offset + info->chunk_byte_size;
+	}
+}
+
+#undef BCHUNK_BOUNDARY_WINDOW_LEN
+
+#endif  /* USE_MERGE_CHUNKS */
+
 /**
  * Append and don't manage merging small chunks.
  */
@@ -640,6 +734,20 @@ static void bchunk_list_append_data(
 #endif
 }
 
+static void bchunk_list_append(
+        const BArrayInfo *info, BArrayMemory *bs_mem,
+        BChunkList *chunk_list,
+        BChunk *chunk)
+{
+	bchunk_list_append_only(bs_mem, chunk_list, chunk);
+
+#ifdef USE_MERGE_CHUNKS
+	bchunk_list_ensure_min_size_last(info, bs_mem, chunk_list);
+#else
+	UNUSED_VARS(info);
+#endif
+}
+
 /**
  * Similar to #bchunk_list_append_data, but handle multiple chunks.
  * Use for adding arrays of arbitrary sized memory at once.
@@ -652,6 +760,25 @@ static void bchunk_list_append_data_n(
         BChunkList *chunk_list,
         const uchar *data, size_t data_len)
 {
+#ifdef USE_MERGE_CHUNKS
+	if (info->chunk_boundary_mask) {
+		size_t i_prev = 0;
+		while (i_prev != data_len) {
+			const size_t i = bchunk_boundary_next(info, data, data_len, i_prev);
+			BChunk *chunk = bchunk_new_copydata(bs_mem, &data[i_prev], i - i_prev);
+			if (i_prev == 0) {
+				/* the first chunk may need merging with the last chunk in the list */
+				bchunk_list_append(info, bs_mem, chunk_list, chunk);
+			}
+			else {
+				bchunk_list_append_only(bs_mem, chunk_list, chunk);
+			}
+			i_prev = i;
+		}
+		return;
+	}
+#endif
+
 	size_t data_trim_len, data_last_chunk_len;
 	bchunk_list_calc_trim_len(info, data_len, &data_trim_len, &data_last_chunk_len);
 
@@ -693,20 +820,6 @@ static void bchunk_list_append_data_n(
 #endif
 }
 
-static void bchunk_list_append(
-        const BArrayInfo *info, BArrayMemory *bs_mem,
-        BChunkList *chunk_list,
-        BChunk *chunk)
-{
-	bchunk_list_append_only(bs_mem, chunk_list, chunk);
-
-#ifdef USE_MERGE_CHUNKS
-	bchunk_list_ensure_min_size_last(info, bs_mem, chunk_list);
-#else
-	UNUSED_VARS(info);
-#endif
-}
-
 static void bchunk_list_fill_from_array(
         const BArrayInfo *info, BArrayMemory *bs_mem,
         BChunkList *chunk_list,
@@ -715,6 +828,16 @@ static void bchunk_list_fill_from_array(
 {
 	BLI_assert(BLI_listbase_is_empty(&chunk_list->chunk_refs));
 
+#ifdef USE_MERGE_CHUNKS
+	if (info->chunk_boundary_mask) {
+		/* there is nothing to merge with, so this doesn't perform any redundant re-allocation */
+		bchunk_list_append_data_n(info, bs_mem, chunk_list, data, data_len);
+		ASSERT_CHUNKLIST_SIZE(chunk_list, data_len);
+		ASSERT_CHUNKLIST_DATA(chunk_list, data);
+		return;
+	}
+#endif
+
 	size_t data_trim_len, data_last_chunk_len;
 	bchunk_list_calc_trim_len(info, data_len, &data_trim_len, &data_last_chunk_len);
 
@@ -872,6 +995,101 @@ static void hash_accum_single(hash_key *hash_array, const size_t hash_array_len,
 	}
 }
 
+typedef struct HashArrayThreadData {
+	const BArrayInfo *info;
+	const uchar *data;
+	hash_key *hash_array;
+	size_t hash_array_len;
+	/* only for accumulating */
+	hash_key *hash_array_dst;
+	size_t hash_array_search_len;
+	size_t hash_offset;
+} HashArrayThreadData;
+
+static void hash_array_from_data_cb(
+        void *__restrict userdata,
+        const int iter,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	const HashArrayThreadData *data = userdata;
+	const size_t i_start = (size_t)iter * BCHUNK_HASH_PARALLEL_STEP;
+	const size_t i_end = MIN2(i_start + BCHUNK_HASH_PARALLEL_STEP, data->hash_array_len);
+	const size_t stride = data->info->chunk_stride;
+	hash_array_from_data(
+	        data->info, &data->data[i_start * stride], (i_end - i_start) * stride,
+	        &data->hash_array[i_start]);
+}
+
+static void hash_accum_cb(
+        void *__restrict userdata,
+        const int iter,
+        const ParallelRangeTLS *__restrict UNUSED(tls))
+{
+	const HashArrayThreadData *data = userdata;
+	const size_t i_start = (size_t)iter * BCHUNK_HASH_PARALLEL_STEP;
+	const size_t i_end = MIN2(i_start + BCHUNK_HASH_PARALLEL_STEP, data->hash_array_len);
+	const hash_key *src = data->hash_array;
+	hash_key *dst = data->hash_array_dst;
+	for (size_t i = i_start; i < i_end; i++) {
+		if (i < data->hash_array_search_len) {
+			dst[i] = src[i] + (src[i + data->hash_offset]) * ((src[i] & 0xff) + 1);
+		}
+		else {
+			dst[i] = src[i];
+		}
+	}
+}
+
+/**
+ * Calculate and accumulate hashes for the whole array,
+ * the equivalent of #hash_array_from_data followed by #hash_accum,
+ * using multiple threads for large arrays.
+ */
+static void hash_array_from_data_accum(
+        const BArrayInfo *info, const uchar *data_slice, const size_t data_slice_len,
+        hash_key *hash_array)
+{
+	const size_t hash_array_len = data_slice_len / info->chunk_stride;
+
+	if (hash_array_len < BCHUNK_HASH_PARALLEL_MIN) {
+		hash_array_from_data(info, data_slice, data_slice_len, hash_array);
+		hash_accum(hash_array, hash_array_len, info->accum_steps);
+		return;
+	}
+
+	HashArrayThreadData data = {
+		.info = info,
+		.data = data_slice,
+		.hash_array = hash_array,
+		.hash_array_len = hash_array_len,
+	};
+	const int tasks_len = (int)((hash_array_len + (BCHUNK_HASH_PARALLEL_STEP - 1)) / BCHUNK_HASH_PARALLEL_STEP);
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+
+	BLI_task_parallel_range(0, tasks_len, &data, hash_array_from_data_cb, &settings);
+
+	/* Accumulating reads values ahead of the one being written,
+	 * so write into a second array, swapping each step. */
+	hash_key *hash_array_tmp = MEM_mallocN(sizeof(*hash_array_tmp) * hash_array_len, __func__);
+	data.hash_array_dst = hash_array_tmp;
+
+	size_t iter_steps = MIN2(info->accum_steps, hash_array_len);
+	data.hash_array_search_len = hash_array_len - iter_steps;
+	while (iter_steps != 0) {
+		data.hash_offset = iter_steps;
+		BLI_task_parallel_range(0, tasks_len, &data, hash_accum_cb, &settings);
+		SWAP(hash_key *, data.hash_array, data.hash_array_dst);
+		iter_steps -= 1;
+	}
+
+	if (data.hash_array != hash_array) {
+		memcpy(hash_array, data.hash_array, sizeof(*hash_array) * hash_array_len);
+	}
+	MEM_freeN(hash_array_tmp);
+}
+
 static hash_key key_from_chunk_ref(
         const BArrayInfo *info, const BChunkRef *cref,
         /* avoid reallocating each time */
@@ -1212,9 +1430,7 @@ static BChunkList *bchunk_list_from_data_merge(
 		size_t i_table_start = i_prev;
 		const size_t table_hash_array_len = (data_len - i_prev) / info->chunk_stride;
 		hash_key  *table_hash_array = MEM_mallocN(sizeof(*table_hash_array) * table_hash_array_len, __func__);
-		hash_array_from_data(info, &data[i_prev], data_len - i_prev, table_hash_array);
-
-		hash_accum(table_hash_array, table_hash_array_len, info->accum_steps);
+		hash_array_from_data_accum(info, &data[i_prev], data_len - i_prev, table_hash_array);
 #else
 		/* dummy vars */
 		uint i_table_start = 0;
@@ -1423,11 +1639,14 @@ static BChunkList *bchunk_list_from_data_merge(
  * - Larger values reduce the *book keeping* overhead,
  *   but increase the chance a small, isolated change will cause a larger amount of data to be duplicated.
  *
+ * \param flag: Options from #eBArrayStoreFlag.
+ *
  * \return A new array store, to be freed with #BLI_array_store_destroy.
  */
-BArrayStore *BLI_array_store_create(
+BArrayStore *BLI_array_store_create_ex(
         uint stride,
-        uint chunk_count)
+        uint chunk_count,
+        const int flag)
 {
 	BArrayStore *bs = MEM_callocN(sizeof(BArrayStore), __func__);
 
@@ -1450,6 +1669,23 @@ BArrayStore *BLI_array_store_create(
 	bs->info.accum_read_ahead_bytes = BCHUNK_HASH_LEN  * stride;
 #endif
 
+#ifdef USE_MERGE_CHUNKS
+	if (flag & BLI_ARRAY_STORE_CHUNK_BY_CONTENT) {
+		/* Chunks average the minimum size plus the distance between boundaries,
+		 * use the largest power of two which keeps this below the regular chunk size. */
+		const uint chunk_count_min = MAX2(1u, chunk_count / BCHUNK_SIZE_MIN_DIV);
+		if (chunk_count >= chunk_count_min + 2) {
+			uint bits = 0;
+			while ((2u << bits) <= chunk_count - chunk_count_min) {
+				bits++;
+			}
+			bs->info.chunk_boundary_mask = ~(UINT64_MAX >> bits);
+		}
+	}
+#else
+	UNUSED_VARS(flag);
+#endif
+
 	bs->memory.chunk_list   = BLI_mempool_create(sizeof(BChunkList), 0, 512, BLI_MEMPOOL_NOP);
 	bs->memory.chunk_ref    = BLI_mempool_create(sizeof(BChunkRef),  0, 512, BLI_MEMPOOL_NOP);
 	/* allow iteration to simplify freeing, otherwise its not needed
@@ -1459,6 +1695,13 @@ BArrayStore *BLI_array_store_create(
 	return bs;
 }
 
+BArrayStore *BLI_array_store_create(
+        uint stride,
+        uint chunk_count)
+{
+	return BLI_array_store_create_ex(stride, chunk_count, 0);
+}
+
 static void array_store_free_data(BArrayStore *bs)
 {
 	/* free chunk data */
@@ -1592,11 +1835,20 @@ BArrayState *BLI_array_store_state_add(
 		        (const uchar *)data, data_len);
 	}
 
-	chunk_list->users += 1;
-
 	BArrayState *state = MEM_callocN(sizeof(BArrayState), __func__);
 	state->chunk_list = chunk_list;
 
+	/* when the list is new, chunks only it uses were created for this state */
+	if (chunk_list->users == 0) {
+		for (const BChunkRef *cref = chunk_list->chunk_refs.first; cref; cref = cref->next) {
+			if (cref->link->users == 1) {
+				state->size_unique += cref->link->data_len;
+			}
+		}
+	}
+
+	chunk_list->users += 1;
+
 	BLI_addtail(&bs->states, state);
 
 #ifdef USE_PARANOID_CHECKS
@@ -1641,6 +1893,19 @@ size_t BLI_array_store_state_size_get(
 	return state->chunk_list->total_size;
 }
 
+/**
+ * \return the memory which was allocated when adding \a state,
+ * this excludes chunks shared with the reference state.
+ *
+ * Use this to account for the memory used by each state,
+ * so callers can apply a memory limit by removing the oldest states.
+ */
+size_t BLI_array_store_state_size_unique_get(
+        const BArrayState *state)
+{
+	return state->size_unique;
+}
+
 /**
  * Fill in existing allocated memory with the contents of \a state.
  */
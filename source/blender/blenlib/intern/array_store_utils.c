@@ -56,7 +56,7 @@ BArrayStore *BLI_array_store_at_size_ensure(
 		}
 #endif
 
-		(*bs_p) = BLI_array_store_create(stride, chunk_count);
+		(*bs_p) = BLI_array_store_create_ex(stride, chunk_count, bs_stride->flag);
 	}
 	return *bs_p;
 }
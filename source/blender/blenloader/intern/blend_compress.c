@@ -0,0 +1,581 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenloader/intern/blend_compress.c
+ *  \ingroup blenloader
+ *
+ * Block compressed .blend files.
+ *
+ * The data is split into blocks which are compressed independently, so they can
+ * be compressed and decompressed on multiple threads. Every block is stored as a
+ * complete gzip member (RFC 1952), a file made of several members is still a valid
+ * gzip file, so these files can be read by older Blender versions and other tools.
+ *
+ * The gzip header of each member has an extra field with the size of the member
+ * and of the uncompressed data, so blocks can be found without decompressing the
+ * ones before them. The same is done by the BGZF format used for genome data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+
+#ifdef WIN32
+#  include <io.h>       // read, open
+#  include "BLI_winstuff.h"
+#else // ! WIN32
+#  include <unistd.h>       // read
+#endif
+
+#include "zlib.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "blend_compress.h"
+
+/* Size of the uncompressed data of a block, a bigger size compresses
+ * slightly better but needs more memory per thread. */
+#define BLOCK_SIZE (1 << 20)
+/* Larger blocks are not written, used to detect corrupt files. */
+#define BLOCK_SIZE_MAX (1 << 26)
+
+/* Maximum number of blocks which are compressed or decompressed at once. Two batches
+ * are kept in memory, one is processed while the other is written or read. */
+#define BATCH_LEN_MAX 32
+
+#define MEMBER_HEADER_SIZE 24
+#define MEMBER_TRAILER_SIZE 8
+#define MEMBER_EXTRA_LEN 12
+#define MEMBER_FLAG_EXTRA 0x04
+
+typedef struct CompressBlock {
+	/* Uncompressed data. */
+	char *data;
+	uint data_len, data_alloc;
+	/* Compressed data, including the gzip header and trailer. */
+	uchar *member;
+	uint member_len, member_alloc;
+	bool error;
+} CompressBlock;
+
+typedef struct CompressBatch {
+	CompressBlock *blocks;
+	int blocks_len, blocks_used;
+	TaskPool *pool;
+	/* Tasks were pushed and not waited for yet. */
+	bool pending;
+} CompressBatch;
+
+static void compress_batches_init(CompressBatch batches[2], void *userdata)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	const int blocks_len = CLAMPIS(BLI_task_scheduler_num_threads(scheduler), 1, BATCH_LEN_MAX);
+
+	for (int i = 0; i < 2; i++) {
+		batches[i].blocks = MEM_callocN(sizeof(CompressBlock) * (size_t)blocks_len, __func__);
+		batches[i].blocks_len = blocks_len;
+		batches[i].blocks_used = 0;
+		batches[i].pool = BLI_task_pool_create(scheduler, userdata);
+		batches[i].pending = false;
+	}
+}
+
+static void compress_batches_free(CompressBatch batches[2])
+{
+	for (int i = 0; i < 2; i++) {
+		if (batches[i].pending) {
+			BLI_task_pool_work_and_wait(batches[i].pool);
+		}
+		BLI_task_pool_free(batches[i].pool);
+
+		for (int j = 0; j < batches[i].blocks_len; j++) {
+			MEM_SAFE_FREE(batches[i].blocks[j].data);
+			MEM_SAFE_FREE(batches[i].blocks[j].member);
+		}
+		MEM_freeN(batches[i].blocks);
+	}
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Gzip Members
+ * \{ */
+
+static void write_u16(uchar *buf, uint value)
+{
+	buf[0] = (uchar)(value);
+	buf[1] = (uchar)(value >> 8);
+}
+
+static void write_u32(uchar *buf, uint value)
+{
+	buf[0] = (uchar)(value);
+	buf[1] = (uchar)(value >> 8);
+	buf[2] = (uchar)(value >> 16);
+	buf[3] = (uchar)(value >> 24);
+}
+
+static uint read_u16(const uchar *buf)
+{
+	return (uint)buf[0] | ((uint)buf[1] << 8);
+}
+
+static uint read_u32(const uchar *buf)
+{
+	return (uint)buf[0] | ((uint)buf[1] << 8) | ((uint)buf[2] << 16) | ((uint)buf[3] << 24);
+}
+
+static void member_header_write(uchar header[MEMBER_HEADER_SIZE], uint member_len, uint data_len)
+{
+	/* ID1, ID2, CM, FLG, MTIME (4), XFL, OS (unknown). */
+	const uchar gzip_header[10] = {0x1f, 0x8b, Z_DEFLATED, MEMBER_FLAG_EXTRA, 0, 0, 0, 0, 0, 0xff};
+
+	memcpy(header, gzip_header, sizeof(gzip_header));
+	write_u16(header + 10, MEMBER_EXTRA_LEN);
+	/* Subfield ID, length, then the data. */
+	header[12] = 'B';
+	header[13] = 'L';
+	write_u16(header + 14, 8);
+	write_u32(header + 16, member_len);
+	write_u32(header + 20, data_len);
+}
+
+static bool member_header_read(const uchar header[MEMBER_HEADER_SIZE], uint *r_member_len, uint *r_data_len)
+{
+	if (header[0] != 0x1f || header[1] != 0x8b || header[2] != Z_DEFLATED || header[3] != MEMBER_FLAG_EXTRA ||
+	    read_u16(header + 10) != MEMBER_EXTRA_LEN ||
+	    header[12] != 'B' || header[13] != 'L' || read_u16(header + 14) != 8)
+	{
+		return false;
+	}
+
+	*r_member_len = read_u32(header + 16);
+	*r_data_len = read_u32(header + 20);
+
+	return (*r_member_len >= MEMBER_HEADER_SIZE + MEMBER_TRAILER_SIZE &&
+	        *r_member_len <= BLOCK_SIZE_MAX &&
+	        *r_data_len <= BLOCK_SIZE_MAX);
+}
+
+static void block_compress_task(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	CompressBlock *block = taskdata;
+	const int level = *(const int *)BLI_task_pool_userdata(pool);
+	z_stream strm = {NULL};
+	uint member_alloc;
+	int ret;
+
+	block->error = true;
+
+	if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return;
+	}
+
+	member_alloc = (uint)deflateBound(&strm, block->data_len) + MEMBER_HEADER_SIZE + MEMBER_TRAILER_SIZE;
+	if (block->member_alloc < member_alloc) {
+		MEM_SAFE_FREE(block->member);
+		block->member = MEM_mallocN(member_alloc, __func__);
+		block->member_alloc = member_alloc;
+	}
+
+	strm.next_in = (Bytef *)block->data;
+	strm.avail_in = block->data_len;
+	strm.next_out = block->member + MEMBER_HEADER_SIZE;
+	strm.avail_out = block->member_alloc - MEMBER_HEADER_SIZE - MEMBER_TRAILER_SIZE;
+
+	ret = deflate(&strm, Z_FINISH);
+	deflateEnd(&strm);
+
+	if (ret != Z_STREAM_END) {
+		return;
+	}
+
+	block->member_len = MEMBER_HEADER_SIZE + (uint)strm.total_out + MEMBER_TRAILER_SIZE;
+	member_header_write(block->member, block->member_len, block->data_len);
+	write_u32(block->member + block->member_len - 8, (uint)crc32(0, (const Bytef *)block->data, block->data_len));
+	write_u32(block->member + block->member_len - 4, block->data_len);
+
+	block->error = false;
+}
+
+static void block_decompress_task(TaskPool *__restrict UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	CompressBlock *block = taskdata;
+	const uchar *trailer = block->member + block->member_len - MEMBER_TRAILER_SIZE;
+	z_stream strm = {NULL};
+	int ret;
+
+	block->error = true;
+
+	if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+		return;
+	}
+
+	strm.next_in = block->member + MEMBER_HEADER_SIZE;
+	strm.avail_in = block->member_len - MEMBER_HEADER_SIZE - MEMBER_TRAILER_SIZE;
+	strm.next_out = (Bytef *)block->data;
+	strm.avail_out = block->data_len;
+
+	ret = inflate(&strm, Z_FINISH);
+	inflateEnd(&strm);
+
+	if (ret != Z_STREAM_END || strm.total_out != block->data_len) {
+		return;
+	}
+	if (read_u32(trailer) != (uint)crc32(0, (const Bytef *)block->data, block->data_len) ||
+	    read_u32(trailer + 4) != block->data_len)
+	{
+		return;
+	}
+
+	block->error = false;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ * \{ */
+
+struct CompressWriter {
+	/* First member, read by the compression tasks. */
+	int level;
+	int filedes;
+	CompressBatch batches[2];
+	/* Batch which is being filled. */
+	int batch_cur;
+	bool error;
+};
+
+CompressWriter *blo_compress_writer_open(const char *filepath, int level)
+{
+	CompressWriter *writer;
+	const int filedes = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+	if (filedes == -1) {
+		return NULL;
+	}
+
+	writer = MEM_callocN(sizeof(*writer), __func__);
+	writer->level = level;
+	writer->filedes = filedes;
+	compress_batches_init(writer->batches, &writer->level);
+
+	return writer;
+}
+
+/* Wait for a batch to be compressed and write it to the file. */
+static void writer_batch_finish(CompressWriter *writer, CompressBatch *batch)
+{
+	if (!batch->pending) {
+		return;
+	}
+
+	BLI_task_pool_work_and_wait(batch->pool);
+	batch->pending = false;
+
+	for (int i = 0; i < batch->blocks_used; i++) {
+		CompressBlock *block = &batch->blocks[i];
+
+		if (!writer->error) {
+			if (block->error || write(writer->filedes, block->member, block->member_len) != (int)block->member_len) {
+				writer->error = true;
+			}
+		}
+		block->data_len = 0;
+	}
+	batch->blocks_used = 0;
+}
+
+/* Start compressing the current batch, and write the previous batch meanwhile. */
+static void writer_batch_submit(CompressWriter *writer)
+{
+	CompressBatch *batch = &writer->batches[writer->batch_cur];
+
+	for (int i = 0; i < batch->blocks_used; i++) {
+		BLI_task_pool_push(batch->pool, block_compress_task, &batch->blocks[i], false, TASK_PRIORITY_HIGH);
+	}
+	batch->pending = true;
+
+	writer->batch_cur = !writer->batch_cur;
+	writer_batch_finish(writer, &writer->batches[writer->batch_cur]);
+}
+
+bool blo_compress_writer_write(CompressWriter *writer, const void *data, size_t data_len)
+{
+	const char *data_src = data;
+
+	while (data_len > 0 && !writer->error) {
+		CompressBatch *batch = &writer->batches[writer->batch_cur];
+		CompressBlock *block = &batch->blocks[batch->blocks_used];
+		const uint len = (uint)MIN2(data_len, (size_t)(BLOCK_SIZE - block->data_len));
+
+		if (block->data == NULL) {
+			block->data = MEM_mallocN(BLOCK_SIZE, __func__);
+			block->data_alloc = BLOCK_SIZE;
+		}
+
+		memcpy(block->data + block->data_len, data_src, len);
+		block->data_len += len;
+		data_src += len;
+		data_len -= len;
+
+		if (block->data_len == BLOCK_SIZE) {
+			batch->blocks_used++;
+			if (batch->blocks_used == batch->blocks_len) {
+				writer_batch_submit(writer);
+			}
+		}
+	}
+
+	return !writer->error;
+}
+
+/**
+ * Write remaining data and close the file.
+ * \return Success, writing errors are only known here.
+ */
+bool blo_compress_writer_close(CompressWriter *writer)
+{
+	CompressBatch *batch = &writer->batches[writer->batch_cur];
+	bool ok;
+
+	/* Last block is only partially filled. */
+	if (batch->blocks_used < batch->blocks_len && batch->blocks[batch->blocks_used].data_len != 0) {
+		batch->blocks_used++;
+	}
+	if (batch->blocks_used != 0) {
+		writer_batch_submit(writer);
+	}
+	writer_batch_finish(writer, &writer->batches[!writer->batch_cur]);
+
+	ok = !writer->error;
+	if (close(writer->filedes) == -1) {
+		ok = false;
+	}
+
+	compress_batches_free(writer->batches);
+	MEM_freeN(writer);
+
+	return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ * \{ */
+
+struct CompressReader {
+	int filedes;
+	/* There are no members after the last one read. */
+	bool eof;
+
+	CompressBatch batches[2];
+	/* Batch containing the current block, the other one is read ahead. */
+	int batch_cur;
+	/* Current block in the batch, and the read position in its data. */
+	int block_cur;
+	uint block_offset;
+
+	bool error;
+};
+
+/* Read the next member of the file, false at the end of the file or on errors. */
+static bool reader_block_read(CompressReader *reader, CompressBlock *block)
+{
+	uchar header[MEMBER_HEADER_SIZE];
+	uint member_len, data_len;
+	const int readsize = read(reader->filedes, header, sizeof(header));
+
+	if (readsize == 0) {
+		reader->eof = true;
+		return false;
+	}
+	if (readsize != sizeof(header) || !member_header_read(header, &member_len, &data_len)) {
+		reader->error = true;
+		return false;
+	}
+
+	if (block->member_alloc < member_len) {
+		MEM_SAFE_FREE(block->member);
+		block->member = MEM_mallocN(member_len, __func__);
+		block->member_alloc = member_len;
+	}
+	if (block->data_alloc < data_len) {
+		MEM_SAFE_FREE(block->data);
+		block->data = MEM_mallocN(data_len, __func__);
+		block->data_alloc = data_len;
+	}
+
+	memcpy(block->member, header, sizeof(header));
+	if (read(reader->filedes, block->member + MEMBER_HEADER_SIZE, member_len - MEMBER_HEADER_SIZE) !=
+	    (int)(member_len - MEMBER_HEADER_SIZE))
+	{
+		reader->error = true;
+		return false;
+	}
+	block->member_len = member_len;
+	block->data_len = data_len;
+
+	return true;
+}
+
+/* Wait for a batch to be decompressed. */
+static void reader_batch_finish(CompressReader *reader, CompressBatch *batch)
+{
+	if (!batch->pending) {
+		return;
+	}
+
+	BLI_task_pool_work_and_wait(batch->pool);
+	batch->pending = false;
+
+	for (int i = 0; i < batch->blocks_used; i++) {
+		if (batch->blocks[i].error) {
+			reader->error = true;
+		}
+	}
+}
+
+/* Read the next compressed blocks, and start decompressing them. */
+static void reader_batch_load(CompressReader *reader, CompressBatch *batch)
+{
+	reader_batch_finish(reader, batch);
+
+	batch->blocks_used = 0;
+
+	while (batch->blocks_used < batch->blocks_len && !reader->eof && !reader->error) {
+		CompressBlock *block = &batch->blocks[batch->blocks_used];
+
+		if (!reader_block_read(reader, block)) {
+			break;
+		}
+
+		BLI_task_pool_push(batch->pool, block_decompress_task, block, false, TASK_PRIORITY_HIGH);
+		batch->blocks_used++;
+	}
+
+	batch->pending = (batch->blocks_used != 0);
+}
+
+/* Decompressed block with data left to read, NULL at the end of the file. */
+static const CompressBlock *reader_block_get(CompressReader *reader)
+{
+	CompressBatch *batch = &reader->batches[reader->batch_cur];
+
+	while (!reader->error) {
+		if (reader->block_cur < batch->blocks_used) {
+			const CompressBlock *block = &batch->blocks[reader->block_cur];
+			if (reader->block_offset < block->data_len) {
+				return block;
+			}
+			reader->block_cur++;
+			reader->block_offset = 0;
+		}
+		else {
+			/* Batch is used up, continue with the one which was read ahead. */
+			batch->blocks_used = 0;
+			reader->batch_cur = !reader->batch_cur;
+			reader->block_cur = 0;
+			batch = &reader->batches[reader->batch_cur];
+
+			reader_batch_finish(reader, batch);
+			if (batch->blocks_used == 0) {
+				return NULL;
+			}
+
+			/* Read ahead, so the next blocks are decompressed while this batch is used. */
+			reader_batch_load(reader, &reader->batches[!reader->batch_cur]);
+		}
+	}
+
+	return NULL;
+}
+
+CompressReader *blo_compress_reader_open(const char *filepath)
+{
+	uchar header[MEMBER_HEADER_SIZE];
+	uint member_len, data_len;
+	CompressReader *reader;
+	const int filedes = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+
+	if (filedes == -1) {
+		return NULL;
+	}
+
+	if (read(filedes, header, sizeof(header)) != sizeof(header) ||
+	    !member_header_read(header, &member_len, &data_len) ||
+	    lseek(filedes, 0, SEEK_SET) == -1)
+	{
+		close(filedes);
+		return NULL;
+	}
+
+	reader = MEM_callocN(sizeof(*reader), __func__);
+	reader->filedes = filedes;
+	compress_batches_init(reader->batches, reader);
+
+	/* Start decompressing the first batch, it's used as the read ahead batch by the first read. */
+	reader->batch_cur = 1;
+	reader_batch_load(reader, &reader->batches[0]);
+
+	return reader;
+}
+
+/**
+ * \return The number of bytes read, less than \a buffer_len at the end of the file, or -1 on errors.
+ */
+int blo_compress_reader_read(CompressReader *reader, void *buffer, size_t buffer_len)
+{
+	char *buffer_dst = buffer;
+	size_t read_len = 0;
+
+	while (read_len < buffer_len) {
+		const CompressBlock *block = reader_block_get(reader);
+		size_t len;
+
+		if (block == NULL) {
+			break;
+		}
+
+		len = MIN2(buffer_len - read_len, (size_t)(block->data_len - reader->block_offset));
+
+		memcpy(buffer_dst + read_len, block->data + reader->block_offset, len);
+		read_len += len;
+		reader->block_offset += (uint)len;
+	}
+
+	return (reader->error) ? -1 : (int)read_len;
+}
+
+void blo_compress_reader_close(CompressReader *reader)
+{
+	compress_batches_free(reader->batches);
+	close(reader->filedes);
+	MEM_freeN(reader);
+}
+
+/** \} */
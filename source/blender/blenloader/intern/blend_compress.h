@@ -0,0 +1,44 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ * blenloader block compressed file reading and writing
+ */
+
+/** \file blender/blenloader/intern/blend_compress.h
+ *  \ingroup blenloader
+ */
+
+#ifndef __BLEND_COMPRESS_H__
+#define __BLEND_COMPRESS_H__
+
+#include <stddef.h>
+
+typedef struct CompressWriter CompressWriter;
+typedef struct CompressReader CompressReader;
+
+/* Writing, blocks are compressed in the background while more data is written. */
+CompressWriter *blo_compress_writer_open(const char *filepath, int level);
+bool blo_compress_writer_write(CompressWriter *writer, const void *data, size_t data_len);
+bool blo_compress_writer_close(CompressWriter *writer);
+
+/* Reading, returns NULL when the file is not block compressed (e.g. plain gzip). */
+CompressReader *blo_compress_reader_open(const char *filepath);
+int blo_compress_reader_read(CompressReader *reader, void *buffer, size_t buffer_len);
+void blo_compress_reader_close(CompressReader *reader);
+
+#endif  /* __BLEND_COMPRESS_H__ */
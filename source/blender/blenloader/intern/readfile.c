@@ -46,6 +46,7 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
@@ -163,6 +164,7 @@
 #include "RE_engine.h"
 
 #include "readfile.h"
+#include "blend_compress.h"
 
 
 #include <errno.h>
@@ -220,6 +222,12 @@
 /* use GHash for BHead name-based lookups (speeds up linking) */
 #define USE_GHASH_BHEAD
 
+/* memory map uncompressed files, only the blocks which are used are read from disk
+ * (speeds up linking from large libraries) */
+#ifndef WIN32
+#  define USE_BHEAD_MMAP
+#endif
+
 /* Use GHash for restoring pointers by name */
 #define USE_GHASH_RESTORE_POINTER
 
@@ -808,10 +816,26 @@ static BHeadN *get_bhead(FileData *fd)
 			/* bhead now contains the (converted) bhead structure. Now read
 			 * the associated data and put everything in a BHeadN (creative naming !)
 			 */
-			if (!fd->eof) {
+			if (!fd->eof && fd->mmap_data && bhead.code == DATA) {
+				/* Data of memory mapped files isn't copied, most of it is never used
+				 * when only some data-blocks are linked from a library. */
+				if ((size_t)bhead.len <= fd->mmap_size - fd->mmap_offset) {
+					new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
+					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->data = fd->mmap_data + fd->mmap_offset;
+					new_bhead->bhead = bhead;
+
+					fd->mmap_offset += (size_t)bhead.len;
+				}
+				else {
+					fd->eof = 1;
+				}
+			}
+			else if (!fd->eof) {
 				new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
 				if (new_bhead) {
 					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->data = new_bhead + 1;
 					new_bhead->bhead = bhead;
 
 					readsize = fd->read(fd, new_bhead + 1, bhead.len);
@@ -893,6 +917,17 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	return(bhead);
 }
 
+/**
+ * Data following the block header, use instead of (bhead + 1) for DATA blocks,
+ * which aren't stored after the header when reading from a memory mapped file.
+ */
+void *blo_bhead_data(BHead *thisblock)
+{
+	BHeadN *bheadn = (BHeadN *)POINTER_OFFSET(thisblock, -offsetof(BHeadN, bhead));
+
+	return bheadn->data;
+}
+
 /* Warning! Caller's responsibility to ensure given bhead **is** and ID one! */
 const char *bhead_id_name(const FileData *fd, const BHead *bhead)
 {
@@ -1043,6 +1078,33 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
 	return (readsize);
 }
 
+static int fd_read_compress_from_file(FileData *filedata, void *buffer, uint size)
+{
+	int readsize = blo_compress_reader_read(filedata->compress_reader, buffer, size);
+
+	if (readsize < 0) {
+		readsize = EOF;
+	}
+	else {
+		filedata->seek += readsize;
+	}
+
+	return readsize;
+}
+
+#ifdef USE_BHEAD_MMAP
+static int fd_read_from_mmap(FileData *filedata, void *buffer, uint size)
+{
+	/* don't read more bytes then there are available in the mapping */
+	const size_t readsize = MIN2((size_t)size, filedata->mmap_size - filedata->mmap_offset);
+
+	memcpy(buffer, filedata->mmap_data + filedata->mmap_offset, readsize);
+	filedata->mmap_offset += readsize;
+
+	return (int)readsize;
+}
+#endif
+
 static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
 {
 	/* don't read more bytes then there are available in the buffer */
@@ -1154,29 +1216,88 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 	return fd;
 }
 
+#ifdef USE_BHEAD_MMAP
+/**
+ * Map uncompressed files into memory, returns NULL for other files.
+ */
+static FileData *blo_openblenderfile_mmap(const char *filepath)
+{
+	FileData *fd;
+	BLI_stat_t st;
+	char header[7];
+	char *data;
+	int file;
+
+	file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file == -1) {
+		return NULL;
+	}
+
+	if (read(file, header, sizeof(header)) != sizeof(header) || !STREQLEN(header, "BLENDER", sizeof(header)) ||
+	    fstat(file, &st) == -1)
+	{
+		close(file);
+		return NULL;
+	}
+
+	/* Private mapping, data is modified in place when switching endian. */
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	fd = filedata_new();
+	fd->mmap_data = data;
+	fd->mmap_size = (size_t)st.st_size;
+	fd->read = fd_read_from_mmap;
+
+	return fd;
+}
+#endif
+
 /* cannot be called with relative paths anymore! */
 /* on each new library added, it now checks for the current FileData and expands relativeness */
 FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 {
-	gzFile gzfile;
-	errno = 0;
-	gzfile = BLI_gzopen(filepath, "rb");
+	CompressReader *compress_reader;
+	FileData *fd;
 
-	if (gzfile == (gzFile)Z_NULL) {
-		BKE_reportf(reports, RPT_WARNING, "Unable to open '%s': %s",
-		            filepath, errno ? strerror(errno) : TIP_("unknown error reading file"));
-		return NULL;
+	/* Block compressed files are decompressed on multiple threads, uncompressed files
+	 * are memory mapped, other files (plain gzip) are read through zlib. */
+	compress_reader = blo_compress_reader_open(filepath);
+
+	if (compress_reader != NULL) {
+		fd = filedata_new();
+		fd->compress_reader = compress_reader;
+		fd->read = fd_read_compress_from_file;
+	}
+#ifdef USE_BHEAD_MMAP
+	else if ((fd = blo_openblenderfile_mmap(filepath))) {
+		/* pass */
 	}
+#endif
 	else {
-		FileData *fd = filedata_new();
+		gzFile gzfile;
+		errno = 0;
+		gzfile = BLI_gzopen(filepath, "rb");
+
+		if (gzfile == (gzFile)Z_NULL) {
+			BKE_reportf(reports, RPT_WARNING, "Unable to open '%s': %s",
+			            filepath, errno ? strerror(errno) : TIP_("unknown error reading file"));
+			return NULL;
+		}
+
+		fd = filedata_new();
 		fd->gzfiledes = gzfile;
 		fd->read = fd_read_gzip_from_file;
+	}
 
-		/* needed for library_append and read_libraries */
-		BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+	/* needed for library_append and read_libraries */
+	BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
 
-		return blo_decode_and_check(fd, reports);
-	}
+	return blo_decode_and_check(fd, reports);
 }
 
 /**
@@ -1216,6 +1337,14 @@ static int fd_read_gzip_from_memory(FileData *filedata, void *buffer, uint size)
 	// Inflate another chunk.
 	err = inflate(&filedata->strm, Z_SYNC_FLUSH);
 
+	/* Compressed files can consist of multiple gzip members, see: blend_compress.c */
+	while (err == Z_STREAM_END && filedata->strm.avail_out != 0 && filedata->strm.avail_in != 0) {
+		err = inflateReset(&filedata->strm);
+		if (err == Z_OK) {
+			err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+		}
+	}
+
 	if (err == Z_STREAM_END) {
 		return 0;
 	}
@@ -1304,6 +1433,16 @@ void blo_freefiledata(FileData *fd)
 			gzclose(fd->gzfiledes);
 		}
 
+		if (fd->compress_reader != NULL) {
+			blo_compress_reader_close(fd->compress_reader);
+		}
+
+#ifdef USE_BHEAD_MMAP
+		if (fd->mmap_data != NULL) {
+			munmap(fd->mmap_data, fd->mmap_size);
+		}
+#endif
+
 		if (fd->strm.next_in) {
 			if (inflateEnd(&fd->strm) != Z_OK) {
 				printf("close gzip stream error\n");
@@ -1900,7 +2039,7 @@ static void switch_endian_structs(const struct SDNA *filesdna, BHead *bhead)
 	int blocksize, nblocks;
 	char *data;
 
-	data = (char *)(bhead + 1);
+	data = blo_bhead_data(bhead);
 	blocksize = filesdna->typelens[filesdna->structs[bhead->SDNAnr][0]];
 
 	nblocks = bhead->nr;
@@ -1922,12 +2061,12 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 
 		if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
 			if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
-				temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh + 1));
+				temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, blo_bhead_data(bh));
 			}
 			else {
 				/* SDNA_CMP_EQUAL */
 				temp = MEM_mallocN(bh->len, blockname);
-				memcpy(temp, (bh + 1), bh->len);
+				memcpy(temp, blo_bhead_data(bh), bh->len);
 			}
 		}
 	}
@@ -4734,6 +4873,7 @@ static void direct_link_mesh(FileData *fd, Mesh *mesh)
 
 	mesh->bb = NULL;
 	mesh->edit_btmesh = NULL;
+	mesh->dvert_update = 0;
 
 	/* happens with old files */
 	if (mesh->mselect == NULL) {
@@ -4822,6 +4962,7 @@ static void direct_link_latt(FileData *fd, Lattice *lt)
 
 	lt->dvert = newdataadr(fd, lt->dvert);
 	direct_link_dverts(fd, lt->pntsu * lt->pntsv * lt->pntsw, lt->dvert);
+	lt->dvert_update = 0;
 
 	lt->editlatt = NULL;
 
@@ -5213,6 +5354,7 @@ static void direct_link_modifiers(FileData *fd, ListBase *lb)
 			ArmatureModifierData *amd = (ArmatureModifierData *)md;
 
 			amd->prevCos = NULL;
+			amd->bindcache = NULL;
 		}
 		else if (md->type == eModifierType_Cloth) {
 			ClothModifierData *clmd = (ClothModifierData *)md;
@@ -58,9 +58,16 @@ typedef struct FileData {
 	// variables needed for reading from memfile (undo)
 	struct MemFile *memfile;
 
+	// variables needed for reading from a memory mapped file,
+	// data of DATA blocks isn't copied but used from the mapping when needed
+	char *mmap_data;
+	size_t mmap_size;
+	size_t mmap_offset;
+
 	// variables needed for reading from file
 	int filedes;
 	gzFile gzfiledes;
+	struct CompressReader *compress_reader;
 
 	// now only in use for library appending
 	char relabase[FILE_MAX];
@@ -109,6 +116,8 @@ typedef struct FileData {
 
 typedef struct BHeadN {
 	struct BHeadN *next, *prev;
+	/* Data of the block, directly after the BHeadN or in the memory mapped file. */
+	void *data;
 	struct BHead bhead;
 } BHeadN;
 
@@ -152,6 +161,7 @@ BHead *blo_firstbhead(FileData *fd);
 BHead *blo_nextbhead(FileData *fd, BHead *thisblock);
 BHead *blo_prevbhead(FileData *fd, BHead *thisblock);
 
+void *blo_bhead_data(BHead *thisblock);
 const char *bhead_id_name(const FileData *fd, const BHead *bhead);
 
 /* do versions stuff */
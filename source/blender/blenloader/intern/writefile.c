@@ -186,6 +186,7 @@
 #include "BLO_blend_defs.h"
 
 #include "readfile.h"
+#include "blend_compress.h"
 
 /* for SDNA_TYPE_FROM_STRUCT() macro */
 #include "dna_type_offsets.h"
@@ -220,7 +221,7 @@ struct WriteWrap {
 	/* internal */
 	union {
 		int file_handle;
-		gzFile gz_handle;
+		CompressWriter *compress_writer;
 	} _user_data;
 };
 
@@ -252,18 +253,18 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
+/* zlib, compressed in blocks on multiple threads, see: blend_compress.c */
 #define FILE_HANDLE(ww) \
-	(ww)->_user_data.gz_handle
+	(ww)->_user_data.compress_writer
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-	gzFile file;
+	CompressWriter *writer;
 
-	file = BLI_gzopen(filepath, "wb1");
+	writer = blo_compress_writer_open(filepath, 1);
 
-	if (file != Z_NULL) {
-		FILE_HANDLE(ww) = file;
+	if (writer != NULL) {
+		FILE_HANDLE(ww) = writer;
 		return true;
 	}
 	else {
@@ -272,11 +273,11 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-	return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+	return blo_compress_writer_close(FILE_HANDLE(ww));
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-	return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+	return blo_compress_writer_write(FILE_HANDLE(ww), buf, buf_len) ? buf_len : 0;
 }
 #undef FILE_HANDLE
 
@@ -4088,9 +4089,12 @@ bool BLO_write_file(
 	}
 
 	/* actual file writing */
-	const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
+	bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
 
-	ww.close(&ww);
+	/* compressed data may only be written when closing */
+	if (ww.close(&ww) == false) {
+		err = true;
+	}
 
 	if (UNLIKELY(path_list_backup)) {
 		BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
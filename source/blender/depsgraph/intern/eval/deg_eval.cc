@@ -32,6 +32,8 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+
 #include "PIL_time.h"
 
 #include "BLI_utildefines.h"
@@ -64,20 +66,121 @@ namespace DEG {
 /* ********************** */
 /* Evaluation Entrypoints */
 
+/* Operations which took less than this many seconds on average are evaluated
+ * by the thread which made them ready, without going through the task pool.
+ * Drivers, transform copies and similar are much cheaper than pushing a task.
+ */
+#define DEG_INLINE_COST_MAX 5e-6
+/* Upper bound of time spent on inline evaluation within a single task, so
+ * that long chains of cheap operations do not serialize the graph.
+ */
+#define DEG_INLINE_BUDGET 1e-4
+
+/* Operations which became ready for evaluation. */
+typedef vector<OperationDepsNode *> ReadyOperations;
+
 /* Forward declarations. */
 static void schedule_children(TaskPool *pool,
                               Depsgraph *graph,
                               OperationDepsNode *node,
                               const unsigned int layers,
-                              const int thread_id);
+                              const int thread_id,
+                              ReadyOperations *ready);
 
 struct DepsgraphEvalState {
 	EvaluationContext *eval_ctx;
 	Depsgraph *graph;
 	unsigned int layers;
 	bool do_stats;
+	/* Per-thread storage for operations made ready by a task. */
+	vector<ReadyOperations> ready_operations;
 };
 
+static bool operation_need_update(const OperationDepsNode *node,
+                                  const unsigned int layers)
+{
+	return (node->owner->owner->layers & layers) != 0 &&
+	       (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0;
+}
+
+static bool operation_priority_greater(const OperationDepsNode *a,
+                                       const OperationDepsNode *b)
+{
+	return a->priority > b->priority;
+}
+
+static double deg_evaluate_operation(DepsgraphEvalState *state,
+                                     OperationDepsNode *node)
+{
+	/* Sanity checks. */
+	BLI_assert(!node->is_noop() && "NOOP nodes should not actually be scheduled");
+	/* Perform operation. Timing is always done, the scheduler uses it. */
+	const double start_time = PIL_check_seconds_timer();
+	node->evaluate(state->eval_ctx);
+	const double time = PIL_check_seconds_timer() - start_time;
+	node->stats.update_average(time);
+	if (state->do_stats) {
+		node->stats.current_time += time;
+	}
+	return time;
+}
+
+static void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id);
+
+/* Push operations which became ready to the pool, most critical first.
+ * Returns a cheap operation to be evaluated by the calling thread right away,
+ * or NULL.
+ */
+static OperationDepsNode *push_ready_operations(TaskPool *pool,
+                                                ReadyOperations *ready,
+                                                const bool allow_inline,
+                                                const int thread_id)
+{
+	if (ready->empty()) {
+		return NULL;
+	}
+	std::sort(ready->begin(), ready->end(), operation_priority_greater);
+	/* Continue with the most critical cheap operation on this thread. */
+	OperationDepsNode *inline_node = NULL;
+	if (allow_inline) {
+		for (ReadyOperations::iterator it = ready->begin(); it != ready->end(); ++it) {
+			const double average_time = (*it)->stats.average_time;
+			if (average_time >= 0.0 && average_time < DEG_INLINE_COST_MAX) {
+				inline_node = *it;
+				ready->erase(it);
+				break;
+			}
+		}
+	}
+	/* The first pushed task goes to the local queue of this thread, and the
+	 * remaining ones are put in front of the global queue in push order. So
+	 * push the most critical operation first, followed by the rest in
+	 * increasing priority. When this thread continues with an inline
+	 * operation, the least critical one is left for it instead.
+	 */
+	const int num_ready = ready->size();
+	int first = 0;
+	if (inline_node == NULL) {
+		BLI_task_pool_push_from_thread(pool,
+		                               deg_task_run_func,
+		                               (*ready)[0],
+		                               false,
+		                               TASK_PRIORITY_HIGH,
+		                               thread_id);
+		first = 1;
+	}
+	for (int i = num_ready - 1; i >= first; --i) {
+		BLI_task_pool_push_from_thread(pool,
+		                               deg_task_run_func,
+		                               (*ready)[i],
+		                               false,
+		                               TASK_PRIORITY_HIGH,
+		                               thread_id);
+	}
+	ready->clear();
+	return inline_node;
+}
+
 static void deg_task_run_func(TaskPool *pool,
                               void *taskdata,
                               int thread_id)
@@ -85,21 +188,24 @@ static void deg_task_run_func(TaskPool *pool,
 	void *userdata_v = BLI_task_pool_userdata(pool);
 	DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 	OperationDepsNode *node = (OperationDepsNode *)taskdata;
-	/* Sanity checks. */
-	BLI_assert(!node->is_noop() && "NOOP nodes should not actually be scheduled");
-	/* Perform operation. */
-	if (state->do_stats) {
-		const double start_time = PIL_check_seconds_timer();
-		node->evaluate(state->eval_ctx);
-		node->stats.current_time += PIL_check_seconds_timer() - start_time;
-	}
-	else {
-		node->evaluate(state->eval_ctx);
+	ReadyOperations *ready = &state->ready_operations[thread_id];
+	double inline_time = 0.0;
+	bool is_inline = false;
+	while (node != NULL) {
+		const double time = deg_evaluate_operation(state, node);
+		if (is_inline) {
+			inline_time += time;
+		}
+		/* Schedule children. */
+		BLI_task_pool_delayed_push_begin(pool, thread_id);
+		schedule_children(pool, state->graph, node, state->layers, thread_id, ready);
+		node = push_ready_operations(pool,
+		                             ready,
+		                             inline_time < DEG_INLINE_BUDGET,
+		                             thread_id);
+		BLI_task_pool_delayed_push_end(pool, thread_id);
+		is_inline = true;
 	}
-	/* Schedule children. */
-	BLI_task_pool_delayed_push_begin(pool, thread_id);
-	schedule_children(pool, state->graph, node, state->layers, thread_id);
-	BLI_task_pool_delayed_push_end(pool, thread_id);
 }
 
 typedef struct CalculatePengindData {
@@ -157,10 +263,66 @@ static void calculate_pending_parents(Depsgraph *graph, unsigned int layers)
 	                        &settings);
 }
 
+/* Calculate length of the critical path from every operation which needs
+ * update to the end of the graph, using evaluation times of previous updates.
+ * Operations which were never evaluated count as free.
+ */
+static void calculate_priorities(Depsgraph *graph, unsigned int layers)
+{
+	vector<OperationDepsNode *> stack;
+	/* Count children which need update, using the traversal tag as counter,
+	 * and start from the operations without any.
+	 */
+	foreach (OperationDepsNode *node, graph->operations) {
+		node->done = 0;
+		node->priority = std::max(node->stats.average_time, 0.0);
+		if (!operation_need_update(node, layers)) {
+			continue;
+		}
+		foreach (DepsRelation *rel, node->outlinks) {
+			OperationDepsNode *to = (OperationDepsNode *)rel->to;
+			BLI_assert(to->type == DEG_NODE_TYPE_OPERATION);
+			if ((rel->flag & DEPSREL_FLAG_CYCLIC) == 0 &&
+			    operation_need_update(to, layers))
+			{
+				++node->done;
+			}
+		}
+		if (node->done == 0) {
+			stack.push_back(node);
+		}
+	}
+	/* Walk towards the roots, each operation is visited once all of its
+	 * children are known.
+	 */
+	while (!stack.empty()) {
+		OperationDepsNode *node = stack.back();
+		stack.pop_back();
+		foreach (DepsRelation *rel, node->inlinks) {
+			if (rel->from->type != DEG_NODE_TYPE_OPERATION ||
+			    (rel->flag & DEPSREL_FLAG_CYCLIC) != 0)
+			{
+				continue;
+			}
+			OperationDepsNode *from = (OperationDepsNode *)rel->from;
+			if (!operation_need_update(from, layers)) {
+				continue;
+			}
+			const double priority =
+			        std::max(from->stats.average_time, 0.0) + node->priority;
+			from->priority = std::max(from->priority, priority);
+			if (--from->done == 0) {
+				stack.push_back(from);
+			}
+		}
+	}
+}
+
 static void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
 	const bool do_stats = state->do_stats;
 	calculate_pending_parents(graph, state->layers);
+	calculate_priorities(graph, state->layers);
 	/* Clear tags and other things which needs to be clear. */
 	foreach (OperationDepsNode *node, graph->operations) {
 		node->done = 0;
@@ -173,10 +335,12 @@ static void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 /* Schedule a node if it needs evaluation.
  *   dec_parents: Decrement pending parents count, true when child nodes are
  *                scheduled after a task has been completed.
+ *   ready: Operations which are ready for evaluation are added here, they
+ *          are pushed to the pool by the caller.
  */
 static void schedule_node(TaskPool *pool, Depsgraph *graph, unsigned int layers,
                           OperationDepsNode *node, bool dec_parents,
-                          const int thread_id)
+                          const int thread_id, ReadyOperations *ready)
 {
 	unsigned int id_layers = node->owner->owner->layers;
 
@@ -194,16 +358,11 @@ static void schedule_node(TaskPool *pool, Depsgraph *graph, unsigned int layers,
 			if (!is_scheduled) {
 				if (node->is_noop()) {
 					/* skip NOOP node, schedule children right away */
-					schedule_children(pool, graph, node, layers, thread_id);
+					schedule_children(pool, graph, node, layers, thread_id, ready);
 				}
 				else {
 					/* children are scheduled once this task is completed */
-					BLI_task_pool_push_from_thread(pool,
-					                               deg_task_run_func,
-					                               node,
-					                               false,
-					                               TASK_PRIORITY_HIGH,
-					                               thread_id);
+					ready->push_back(node);
 				}
 			}
 		}
@@ -212,18 +371,26 @@ static void schedule_node(TaskPool *pool, Depsgraph *graph, unsigned int layers,
 
 static void schedule_graph(TaskPool *pool,
                            Depsgraph *graph,
-                           const unsigned int layers)
+                           const unsigned int layers,
+                           ReadyOperations *ready)
 {
 	foreach (OperationDepsNode *node, graph->operations) {
-		schedule_node(pool, graph, layers, node, false, 0);
+		schedule_node(pool, graph, layers, node, false, 0, ready);
+	}
+	/* Pool is suspended, so tasks pushed last are the first to run. */
+	std::sort(ready->begin(), ready->end(), operation_priority_greater);
+	for (ReadyOperations::reverse_iterator it = ready->rbegin(); it != ready->rend(); ++it) {
+		BLI_task_pool_push(pool, deg_task_run_func, *it, false, TASK_PRIORITY_HIGH);
 	}
+	ready->clear();
 }
 
 static void schedule_children(TaskPool *pool,
                               Depsgraph *graph,
                               OperationDepsNode *node,
                               const unsigned int layers,
-                              const int thread_id)
+                              const int thread_id,
+                              ReadyOperations *ready)
 {
 	foreach (DepsRelation *rel, node->outlinks) {
 		OperationDepsNode *child = (OperationDepsNode *)rel->to;
@@ -237,7 +404,8 @@ static void schedule_children(TaskPool *pool,
 		              layers,
 		              child,
 		              (rel->flag & DEPSREL_FLAG_CYCLIC) == 0,
-		              thread_id);
+		              thread_id,
+		              ready);
 	}
 }
 
@@ -283,10 +451,11 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 		need_free_scheduler = false;
 	}
 	TaskPool *task_pool = BLI_task_pool_create_suspended(task_scheduler, &state);
+	state.ready_operations.resize(BLI_task_scheduler_num_threads(task_scheduler));
 	/* Prepare all nodes for evaluation. */
 	initialize_execution(&state, graph);
 	/* Do actual evaluation now. */
-	schedule_graph(task_pool, graph, layers);
+	schedule_graph(task_pool, graph, layers, &state.ready_operations[0]);
 	BLI_task_pool_work_and_wait(task_pool);
 	BLI_task_pool_free(task_pool);
 	/* Finalize statistics gathering. This is because we only gather single
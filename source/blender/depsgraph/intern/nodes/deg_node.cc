@@ -69,6 +69,7 @@ DepsNode::Stats::Stats()
 void DepsNode::Stats::reset()
 {
 	current_time = 0.0;
+	average_time = -1.0;
 }
 
 void DepsNode::Stats::reset_current()
@@ -76,6 +77,19 @@ void DepsNode::Stats::reset_current()
 	current_time = 0.0;
 }
 
+void DepsNode::Stats::update_average(double time)
+{
+	if (average_time < 0.0) {
+		average_time = time;
+	}
+	else {
+		/* Exponential moving average, so costs follow changes in the scene
+		 * (modifier stack, subdivision levels and such) within a few frames.
+		 */
+		average_time = average_time * 0.75 + time * 0.25;
+	}
+}
+
 /*******************************************************************************
  * Node itself.
  */
@@ -66,8 +66,14 @@ struct DepsNode {
 		 * touch averaging accumulators.
 		 */
 		void reset_current();
+		/* Fold time of a single evaluation into the running average. */
+		void update_average(double time);
 		/* Time spend on this node during current graph evaluation. */
 		double current_time;
+		/* Running average of evaluation time, negative if the node was never
+		 * evaluated. Used by the scheduler to prioritize operations.
+		 */
+		double average_time;
 	};
 	/* Relationships between nodes
 	 * The reason why all depsgraph nodes are descended from this type (apart
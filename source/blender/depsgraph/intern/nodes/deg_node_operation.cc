@@ -45,6 +45,7 @@ namespace DEG {
 /* Inner Nodes */
 
 OperationDepsNode::OperationDepsNode() :
+    priority(0.0),
     flag(0),
     customdata_mask(0)
 {
@@ -78,6 +78,12 @@ struct OperationDepsNode : public DepsNode {
 	uint32_t num_links_pending;
 	bool scheduled;
 
+	/* Estimated time needed to evaluate this operation and the longest chain
+	 * of operations depending on it. Ready operations with higher priority
+	 * are scheduled first.
+	 */
+	double priority;
+
 	/* Identifier for the operation being performed. */
 	eDepsOperation_Code opcode;
 
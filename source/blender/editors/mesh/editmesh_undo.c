@@ -27,6 +27,7 @@
 #include "DNA_mesh_types.h"
 #include "DNA_object_types.h"
 #include "DNA_key_types.h"
+#include "DNA_userdef_types.h"
 
 #include "BLI_listbase.h"
 #include "BLI_array_utils.h"
@@ -127,7 +128,11 @@ static struct {
 		TaskPool *task_pool;
 #endif
 
-} um_arraystore = {{NULL}};
+} um_arraystore = {
+	/* edits such as deleting or extruding insert and remove elements,
+	 * content defined chunks avoid these changing all data after the edit. */
+	.bs_stride = {.flag = BLI_ARRAY_STORE_CHUNK_BY_CONTENT},
+};
 
 static void um_arraystore_cd_compact(
         struct CustomData *cdata, const size_t data_len,
@@ -254,6 +259,20 @@ static void um_arraystore_cd_expand(
 	}
 }
 
+static size_t um_arraystore_cd_size_unique(const BArrayCustomData *bcd)
+{
+	size_t size_unique = 0;
+	while (bcd) {
+		for (int i = 0; i < bcd->states_len; i++) {
+			if (bcd->states[i]) {
+				size_unique += BLI_array_store_state_size_unique_get(bcd->states[i]);
+			}
+		}
+		bcd = bcd->next;
+	}
+	return size_unique;
+}
+
 static void um_arraystore_cd_free(BArrayCustomData *bcd)
 {
 	while (bcd) {
@@ -327,6 +346,22 @@ static void um_arraystore_compact_ex(
 
 	if (create) {
 		um_arraystore.users += 1;
+
+		/* only count memory this step added, unchanged data is shared with the reference */
+		size_t undo_size = sizeof(*um);
+		undo_size += um_arraystore_cd_size_unique(um->store.vdata);
+		undo_size += um_arraystore_cd_size_unique(um->store.edata);
+		undo_size += um_arraystore_cd_size_unique(um->store.ldata);
+		undo_size += um_arraystore_cd_size_unique(um->store.pdata);
+		if (um->store.keyblocks) {
+			for (int i = 0; i < me->key->totkey; i++) {
+				undo_size += BLI_array_store_state_size_unique_get(um->store.keyblocks[i]);
+			}
+		}
+		if (um->store.mselect) {
+			undo_size += BLI_array_store_state_size_unique_get(um->store.mselect);
+		}
+		um->undo_size = undo_size;
 	}
 
 	BKE_mesh_update_customdata_pointers(me, false);
@@ -753,7 +788,16 @@ static bool mesh_undosys_step_encode(struct bContext *C, UndoStep *us_p)
 	Mesh *me = us->obedit_ref.ptr->data;
 	undomesh_from_editmesh(&us->data, me->edit_btmesh, me->key);
 	mesh_undosys_step_encode_store_ids(us);
+#ifdef USE_ARRAY_STORE_THREAD
+	/* The size is only known once the arrays have been compacted,
+	 * only wait for this when it's needed to apply the undo memory limit. */
+	if (U.undomemory != 0) {
+		BLI_task_pool_work_and_wait(um_arraystore.task_pool);
+		us->step.data_size = us->data.undo_size;
+	}
+#else
 	us->step.data_size = us->data.undo_size;
+#endif
 	return true;
 }
 
@@ -777,6 +777,7 @@ static void ED_vgroup_nr_vert_add(
 	if ((vertnum < 0) || (vertnum >= tot))
 		return;
 
+	BKE_object_defgroup_data_changed(ob->data);
 
 	if (dvert) {
 		MDeformVert *dv = &dvert[vertnum];
@@ -888,6 +889,8 @@ void ED_vgroup_vert_remove(Object *ob, bDeformGroup *dg, int vertnum)
 
 			dw = defvert_find_index(dv, def_nr);
 			defvert_remove_group(dv, dw); /* dw can be NULL */
+
+			BKE_object_defgroup_data_changed(ob->data);
 		}
 	}
 }
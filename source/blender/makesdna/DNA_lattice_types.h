@@ -69,6 +69,9 @@ typedef struct Lattice {
 	char vgroup[64]; /* multiply the influence, MAX_VGROUP_NAME */
 
 	struct EditLatt *editlatt;
+
+	int dvert_update;  /* runtime, changes when the deform weights are edited */
+	int pad4;
 } Lattice;
 
 /* ***************** LATTICE ********************* */
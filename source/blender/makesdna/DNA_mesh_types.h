@@ -115,7 +115,7 @@ typedef struct Mesh {
 	int drawflag;
 	short texflag, flag;
 	float smoothresh;
-	int pad2;
+	int dvert_update;  /* runtime, changes when the deform weights are edited */
 
 	/* customdata flag, for bevel-weight and crease, which are now optional */
 	char cd_flag, pad;
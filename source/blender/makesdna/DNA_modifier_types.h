@@ -555,6 +555,7 @@ typedef struct ArmatureModifierData {
 	int pad2;
 	struct Object *object;
 	float *prevCos;           /* stored input of previous modifier, for vertexgroup blending */
+	struct ArmatureDeformBinding *bindcache;  /* runtime, vertex group weights resolved to bones */
 	char defgrp_name[64];     /* MAX_VGROUP_NAME */
 } ArmatureModifierData;
 
@@ -160,6 +160,29 @@ static void rna_Cache_toggle_disk_cache(Main *bmain, Scene *UNUSED(scene), Point
 	BLI_freelistN(&pidlist);
 }
 
+static void rna_Cache_toggle_disk_container(Main *bmain, Scene *UNUSED(scene), PointerRNA *ptr)
+{
+	Object *ob = (Object *)ptr->id.data;
+	PointCache *cache = (PointCache *)ptr->data;
+	PTCacheID *pid = NULL;
+	ListBase pidlist;
+
+	if (!ob)
+		return;
+
+	BKE_ptcache_ids_from_object(bmain, &pidlist, ob, NULL, 0);
+
+	for (pid = pidlist.first; pid; pid = pid->next) {
+		if (pid->cache == cache)
+			break;
+	}
+
+	if (pid)
+		BKE_ptcache_toggle_disk_container(pid);
+
+	BLI_freelistN(&pidlist);
+}
+
 static void rna_Cache_idname_change(Main *bmain, Scene *UNUSED(scene), PointerRNA *ptr)
 {
 	Object *ob = (Object *)ptr->id.data;
@@ -827,6 +850,13 @@ static void rna_def_pointcache_common(StructRNA *srna)
 	RNA_def_property_ui_text(prop, "Disk Cache", "Save cache files to disk (.blend file must be saved first)");
 	RNA_def_property_update(prop, NC_OBJECT, "rna_Cache_toggle_disk_cache");
 
+	prop = RNA_def_property(srna, "use_disk_container", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", PTCACHE_DISK_CONTAINER);
+	RNA_def_property_ui_text(prop, "Single File",
+	                         "Store all frames of the disk cache in one file, with frames stored as the difference "
+	                         "to the previous one, compressed in the background and read ahead during playback");
+	RNA_def_property_update(prop, NC_OBJECT, "rna_Cache_toggle_disk_container");
+
 	prop = RNA_def_property(srna, "is_outdated", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", PTCACHE_OUTDATED);
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
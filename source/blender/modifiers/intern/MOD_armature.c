@@ -71,6 +71,17 @@ static void copyData(const ModifierData *md, ModifierData *target)
 
 	modifier_copyData_generic(md, target);
 	tamd->prevCos = NULL;
+	tamd->bindcache = NULL;
+}
+
+static void freeData(ModifierData *md)
+{
+	ArmatureModifierData *amd = (ArmatureModifierData *) md;
+
+	if (amd->bindcache) {
+		armature_deform_binding_free(amd->bindcache);
+		amd->bindcache = NULL;
+	}
 }
 
 static CustomDataMask requiredDataMask(Object *UNUSED(ob), ModifierData *UNUSED(md))
@@ -132,8 +143,9 @@ static void deformVerts(
 
 	modifier_vgroup_cache(md, vertexCos); /* if next modifier needs original vertices */
 
-	armature_deform_verts(amd->object, ob, derivedData, vertexCos, NULL,
-	                      numVerts, amd->deformflag, (float(*)[3])amd->prevCos, amd->defgrp_name);
+	armature_deform_verts_ex(amd->object, ob, derivedData, vertexCos, NULL,
+	                         numVerts, amd->deformflag, (float(*)[3])amd->prevCos, amd->defgrp_name,
+	                         &amd->bindcache);
 
 	/* free cache */
 	if (amd->prevCos) {
@@ -153,8 +165,9 @@ static void deformVertsEM(
 
 	modifier_vgroup_cache(md, vertexCos); /* if next modifier needs original vertices */
 
-	armature_deform_verts(amd->object, ob, dm, vertexCos, NULL,
-	                      numVerts, amd->deformflag, (float(*)[3])amd->prevCos, amd->defgrp_name);
+	armature_deform_verts_ex(amd->object, ob, dm, vertexCos, NULL,
+	                         numVerts, amd->deformflag, (float(*)[3])amd->prevCos, amd->defgrp_name,
+	                         &amd->bindcache);
 
 	/* free cache */
 	if (amd->prevCos) {
@@ -175,8 +188,8 @@ static void deformMatricesEM(
 
 	if (!derivedData) dm = CDDM_from_editbmesh(em, false, false);
 
-	armature_deform_verts(amd->object, ob, dm, vertexCos, defMats, numVerts,
-	                      amd->deformflag, NULL, amd->defgrp_name);
+	armature_deform_verts_ex(amd->object, ob, dm, vertexCos, defMats, numVerts,
+	                         amd->deformflag, NULL, amd->defgrp_name, &amd->bindcache);
 
 	if (!derivedData) dm->release(dm);
 }
@@ -190,8 +203,8 @@ static void deformMatrices(
 
 	if (!derivedData) dm = CDDM_from_mesh((Mesh *)ob->data);
 
-	armature_deform_verts(amd->object, ob, dm, vertexCos, defMats, numVerts,
-	                      amd->deformflag, NULL, amd->defgrp_name);
+	armature_deform_verts_ex(amd->object, ob, dm, vertexCos, defMats, numVerts,
+	                         amd->deformflag, NULL, amd->defgrp_name, &amd->bindcache);
 
 	if (!derivedData) dm->release(dm);
 }
@@ -214,7 +227,7 @@ ModifierTypeInfo modifierType_Armature = {
 	/* applyModifierEM */   NULL,
 	/* initData */          initData,
 	/* requiredDataMask */  requiredDataMask,
-	/* freeData */          NULL,
+	/* freeData */          freeData,
 	/* isDisabled */        isDisabled,
 	/* updateDepgraph */    updateDepgraph,
 	/* updateDepsgraph */   updateDepsgraph,
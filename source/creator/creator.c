@@ -275,21 +275,31 @@ int main(
 	/* NOTE: Special exception for guarded allocator type switch:
 	 *       we need to perform switch from lock-free to fully
 	 *       guarded allocator before any allocation happened.
+	 *       Same goes for the thread caching allocator, the guarded
+	 *       allocator takes precedence when both are requested.
 	 */
 	{
 		int i;
+		bool use_cached_allocator = false;
 		for (i = 0; i < argc; i++) {
 			if (STREQ(argv[i], "--debug") || STREQ(argv[i], "-d") ||
 			    STREQ(argv[i], "--debug-memory") || STREQ(argv[i], "--debug-all"))
 			{
 				printf("Switching to fully guarded memory allocator.\n");
 				MEM_use_guarded_allocator();
+				use_cached_allocator = false;
 				break;
 			}
+			else if (STREQ(argv[i], "--enable-memory-cache")) {
+				use_cached_allocator = true;
+			}
 			else if (STREQ(argv[i], "--")) {
 				break;
 			}
 		}
+		if (use_cached_allocator) {
+			MEM_use_cached_allocator();
+		}
 	}
 
 #ifdef BUILD_DATE
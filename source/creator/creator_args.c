@@ -581,6 +581,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 
 	printf("\n");
 	printf("Misc Options:\n");
+	BLI_argsPrintArgDoc(ba, "--enable-memory-cache");
 	BLI_argsPrintArgDoc(ba, "--app-template");
 	BLI_argsPrintArgDoc(ba, "--factory-startup");
 	printf("\n");
@@ -701,6 +702,16 @@ static int arg_handle_crash_handler_disable(int UNUSED(argc), const char **UNUSE
 	return 0;
 }
 
+static const char arg_handle_memory_cache_enable_doc[] =
+"\n\tUse a memory allocator which caches small blocks per thread.\n"
+"\tReduces contention in heavily threaded work at the cost of some memory overhead."
+;
+static int arg_handle_memory_cache_enable(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	/* Allocator is switched in main(), before any allocation happened. */
+	return 0;
+}
+
 static const char arg_handle_abort_handler_disable_doc[] =
 "\n\tDisable the abort handler."
 ;
@@ -1994,6 +2005,7 @@ void main_args_setup(bContext *C, bArgs *ba, SYS_SystemHandle *syshandle)
 
 	BLI_argsAdd(ba, 1, NULL, "--disable-crash-handler", CB(arg_handle_crash_handler_disable), NULL);
 	BLI_argsAdd(ba, 1, NULL, "--disable-abort-handler", CB(arg_handle_abort_handler_disable), NULL);
+	BLI_argsAdd(ba, 1, NULL, "--enable-memory-cache", CB(arg_handle_memory_cache_enable), NULL);
 
 	BLI_argsAdd(ba, 1, "-b", "--background", CB(arg_handle_background_mode_set), NULL);
 
@@ -0,0 +1,259 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <math.h>
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DNA_object_force_types.h"
+
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_pointcache.h"
+}
+
+#define POINTS_NUM 500
+
+typedef struct TestSim {
+	/* Changes the written data, like tweaking a simulation setting. */
+	int run;
+	float co[POINTS_NUM][3];
+} TestSim;
+
+static void test_sim_co(int run, int index, int cfra, float r_co[3])
+{
+	r_co[0] = (float)index;
+	r_co[1] = sinf((float)cfra * 0.1f + (float)index * 0.01f);
+	r_co[2] = (float)run + (float)cfra * 0.001f;
+}
+
+static int test_sim_write_point(int index, void *calldata, void **data, int cfra)
+{
+	TestSim *sim = (TestSim *)calldata;
+	float co[3];
+
+	test_sim_co(sim->run, index, cfra, co);
+	memcpy(data[BPHYS_DATA_LOCATION], co, sizeof(co));
+
+	return 1;
+}
+
+static void test_sim_read_point(int index, void *calldata, void **data, float UNUSED(cfra), float *UNUSED(old_data))
+{
+	TestSim *sim = (TestSim *)calldata;
+
+	memcpy(sim->co[index], data[BPHYS_DATA_LOCATION], sizeof(sim->co[index]));
+}
+
+static int test_sim_totpoint(void *UNUSED(calldata), int UNUSED(cfra))
+{
+	return POINTS_NUM;
+}
+
+static void test_sim_error(void *UNUSED(calldata), const char *UNUSED(message))
+{
+}
+
+class PointCacheContainerTest : public testing::Test {
+protected:
+	TestSim sim;
+	ListBase ptcaches;
+	PTCacheID pid;
+	char dir[FILE_MAX];
+	char filepath[FILE_MAX];
+
+	virtual void SetUp()
+	{
+		BLI_threadapi_init();
+		BKE_tempdir_init(NULL);
+
+		G.main = BKE_main_new();
+		G.relbase_valid = 1;
+		BLI_join_dirfile(G.main->name, sizeof(G.main->name), BKE_tempdir_session(), "ptcache_test.blend");
+		BLI_join_dirfile(dir, sizeof(dir), BKE_tempdir_session(), PTCACHE_PATH "ptcache_test");
+		BLI_join_dirfile(filepath, sizeof(filepath), dir, "test_00" PTCACHE_CONTAINER_EXT);
+
+		memset(&sim, 0, sizeof(sim));
+		BLI_listbase_clear(&ptcaches);
+
+		PointCache *cache = BKE_ptcache_add(&ptcaches);
+		cache->flag |= PTCACHE_DISK_CACHE | PTCACHE_DISK_CONTAINER;
+		cache->compression = PTCACHE_COMPRESS_LZO;
+		cache->index = 0;
+		BLI_strncpy(cache->name, "test", sizeof(cache->name));
+
+		memset(&pid, 0, sizeof(pid));
+		pid.calldata = &sim;
+		pid.type = PTCACHE_TYPE_SOFTBODY;
+		pid.file_type = PTCACHE_FILE_PTCACHE;
+		pid.data_types = (1 << BPHYS_DATA_LOCATION);
+		pid.write_point = test_sim_write_point;
+		pid.read_point = test_sim_read_point;
+		pid.totpoint = test_sim_totpoint;
+		pid.totwrite = test_sim_totpoint;
+		pid.error = test_sim_error;
+		pid.cache = cache;
+		pid.ptcaches = &ptcaches;
+	}
+
+	virtual void TearDown()
+	{
+		BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+		BKE_ptcache_containers_exit();
+		BKE_ptcache_free_list(&ptcaches);
+		BLI_delete(dir, true, true);
+
+		BKE_main_free(G.main);
+		G.main = NULL;
+		G.relbase_valid = 0;
+
+		BLI_threadapi_exit();
+	}
+
+	void simulate(int run, int frame_start, int frame_end)
+	{
+		sim.run = run;
+		for (int cfra = frame_start; cfra <= frame_end; cfra++) {
+			EXPECT_TRUE(BKE_ptcache_write(&pid, (unsigned int)cfra));
+		}
+	}
+
+	void expect_frame(int run, int cfra)
+	{
+		float co[3];
+
+		memset(sim.co, 0, sizeof(sim.co));
+		ASSERT_TRUE(BKE_ptcache_id_exist(&pid, cfra));
+		ASSERT_EQ(BKE_ptcache_read(&pid, (float)cfra, false), PTCACHE_READ_EXACT);
+
+		for (int i = 0; i < POINTS_NUM; i++) {
+			test_sim_co(run, i, cfra, co);
+			EXPECT_EQ(co[0], sim.co[i][0]);
+			EXPECT_EQ(co[1], sim.co[i][1]);
+			EXPECT_EQ(co[2], sim.co[i][2]);
+		}
+	}
+
+	/* Drop the open containers, so the file is read again. */
+	void reopen()
+	{
+		BKE_ptcache_containers_exit();
+	}
+};
+
+TEST_F(PointCacheContainerTest, WriteRead)
+{
+	simulate(0, 1, 30);
+
+	for (int cfra = 1; cfra <= 30; cfra++) {
+		expect_frame(0, cfra);
+	}
+	EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 31));
+	EXPECT_TRUE(BLI_exists(filepath));
+
+	reopen();
+
+	for (int cfra = 30; cfra >= 1; cfra--) {
+		expect_frame(0, cfra);
+	}
+}
+
+TEST_F(PointCacheContainerTest, ClearAfter)
+{
+	simulate(0, 1, 30);
+
+	BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, 10);
+	for (int cfra = 11; cfra <= 30; cfra++) {
+		EXPECT_FALSE(BKE_ptcache_id_exist(&pid, cfra));
+	}
+
+	simulate(1, 11, 20);
+
+	reopen();
+
+	for (int cfra = 1; cfra <= 10; cfra++) {
+		expect_frame(0, cfra);
+	}
+	for (int cfra = 11; cfra <= 20; cfra++) {
+		expect_frame(1, cfra);
+	}
+	for (int cfra = 21; cfra <= 30; cfra++) {
+		EXPECT_FALSE(BKE_ptcache_id_exist(&pid, cfra));
+	}
+}
+
+TEST_F(PointCacheContainerTest, ClearAll)
+{
+	simulate(0, 1, 10);
+
+	BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+	EXPECT_FALSE(BLI_exists(filepath));
+	EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 1));
+}
+
+/* Resetting the simulation over and over must not grow the file without bounds. */
+TEST_F(PointCacheContainerTest, ClearCompacts)
+{
+	simulate(0, 1, 30);
+	expect_frame(0, 30);
+
+	const size_t file_len = BLI_file_size(filepath);
+
+	for (int run = 1; run <= 20; run++) {
+		BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, 10);
+		simulate(run, 11, 30);
+		expect_frame(run, 30);
+
+		EXPECT_LT(BLI_file_size(filepath), 3 * file_len);
+	}
+
+	reopen();
+
+	for (int cfra = 1; cfra <= 10; cfra++) {
+		expect_frame(0, cfra);
+	}
+	for (int cfra = 11; cfra <= 30; cfra++) {
+		expect_frame(20, cfra);
+	}
+}
+
+/* Frames stored as the difference to a removed frame stay readable. */
+TEST_F(PointCacheContainerTest, ClearFrameKeepsBase)
+{
+	simulate(0, 1, 20);
+
+	BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_FRAME, 5);
+	EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 5));
+
+	for (int run = 1; run <= 10; run++) {
+		BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, 10);
+		simulate(run, 11, 20);
+	}
+
+	for (int cfra = 6; cfra <= 10; cfra++) {
+		expect_frame(0, cfra);
+	}
+
+	reopen();
+
+	EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 5));
+	for (int cfra = 1; cfra <= 10; cfra++) {
+		if (cfra != 5) {
+			expect_frame(0, cfra);
+		}
+	}
+	for (int cfra = 11; cfra <= 20; cfra++) {
+		expect_frame(10, cfra);
+	}
+}
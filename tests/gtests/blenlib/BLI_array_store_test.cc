@@ -302,15 +302,22 @@ static void testbuffer_run_tests(
 	testbuffer_list_store_clear(bs, lb);
 }
 
-static void testbuffer_run_tests_simple(
+static void testbuffer_run_tests_simple_ex(
         ListBase *lb,
-        const int stride, const int chunk_count)
+        const int stride, const int chunk_count, const int flag)
 {
-	BArrayStore *bs = BLI_array_store_create(stride, chunk_count);
+	BArrayStore *bs = BLI_array_store_create_ex(stride, chunk_count, flag);
 	testbuffer_run_tests(bs, lb);
 	BLI_array_store_destroy(bs);
 }
 
+static void testbuffer_run_tests_simple(
+        ListBase *lb,
+        const int stride, const int chunk_count)
+{
+	testbuffer_run_tests_simple_ex(lb, stride, chunk_count, 0);
+}
+
 
 /* -------------------------------------------------------------------- */
 /* Basic Tests */
@@ -357,6 +364,9 @@ TEST(array_store, DoubleNop)
 	EXPECT_EQ(BLI_array_store_calc_size_compacted_get(bs), sizeof(data_src));
 	EXPECT_EQ(BLI_array_store_calc_size_expanded_get(bs), sizeof(data_src) * 2);
 
+	EXPECT_EQ(BLI_array_store_state_size_unique_get(state_a), sizeof(data_src));
+	EXPECT_EQ(BLI_array_store_state_size_unique_get(state_b), 0u);
+
 	size_t data_dst_len;
 
 	data_dst = (char *)BLI_array_store_state_data_get_alloc(state_a, &data_dst_len);
@@ -615,7 +625,7 @@ static void testbuffer_list_state_random_data(
 static void random_data_mutate_helper(
         const int items_size_min, const int items_size_max, const int items_total,
         const int stride, const int chunk_count,
-        const int random_seed, const int mutate)
+        const int random_seed, const int mutate, const int flag)
 {
 
 
@@ -633,16 +643,69 @@ static void random_data_mutate_helper(
 		BLI_rng_free(rng);
 	}
 
-	testbuffer_run_tests_simple(&lb, stride, chunk_count);
+	testbuffer_run_tests_simple_ex(&lb, stride, chunk_count, flag);
 
 	testbuffer_list_free(&lb);
 }
 
-TEST(array_store, TestData_Stride1_Chunk32_Mutate2)  { random_data_mutate_helper(0,   100,  400,  1,  32,  9779, 2); }
-TEST(array_store, TestData_Stride8_Chunk512_Mutate2) { random_data_mutate_helper(0,   128,  400,  8, 512,  1001, 2); }
-TEST(array_store, TestData_Stride12_Chunk48_Mutate2) { random_data_mutate_helper(200, 256,  400, 12,  48,  1331, 2); }
-TEST(array_store, TestData_Stride32_Chunk64_Mutate1) { random_data_mutate_helper(0,   256,  200, 32,  64,  3112, 1); }
-TEST(array_store, TestData_Stride32_Chunk64_Mutate8) { random_data_mutate_helper(0,   256,  200, 32,  64,  7117, 8); }
+TEST(array_store, TestData_Stride1_Chunk32_Mutate2)  { random_data_mutate_helper(0,   100,  400,  1,  32,  9779, 2, 0); }
+TEST(array_store, TestData_Stride8_Chunk512_Mutate2) { random_data_mutate_helper(0,   128,  400,  8, 512,  1001, 2, 0); }
+TEST(array_store, TestData_Stride12_Chunk48_Mutate2) { random_data_mutate_helper(200, 256,  400, 12,  48,  1331, 2, 0); }
+TEST(array_store, TestData_Stride32_Chunk64_Mutate1) { random_data_mutate_helper(0,   256,  200, 32,  64,  3112, 1, 0); }
+TEST(array_store, TestData_Stride32_Chunk64_Mutate8) { random_data_mutate_helper(0,   256,  200, 32,  64,  7117, 8, 0); }
+
+/* large enough to hash on multiple threads */
+TEST(array_store, TestDataLarge_Stride4_Chunk256_Mutate8) { random_data_mutate_helper(70000, 80000, 8, 4, 256, 4242, 8, 0); }
+
+
+/* -------------------------------------------------------------------- */
+/* Content Defined Chunks Test */
+
+#define BY_CONTENT BLI_ARRAY_STORE_CHUNK_BY_CONTENT
+
+TEST(array_store, TestDataByContent_Stride1_Chunk32_Mutate2)   { random_data_mutate_helper(0,    4000, 100,  1,  32,  9779, 2, BY_CONTENT); }
+TEST(array_store, TestDataByContent_Stride8_Chunk64_Mutate2)   { random_data_mutate_helper(0,    1000, 100,  8,  64,  1001, 2, BY_CONTENT); }
+TEST(array_store, TestDataByContent_Stride12_Chunk48_Mutate8)  { random_data_mutate_helper(200,  2000, 100, 12,  48,  1331, 8, BY_CONTENT); }
+TEST(array_store, TestDataByContent_Stride3_Chunk3_Mutate1)    { random_data_mutate_helper(0,     256, 200,  3,   3,  3112, 1, BY_CONTENT); }
+TEST(array_store, TestDataByContent_Stride4_Chunk256_Mutate8)  { random_data_mutate_helper(70000, 80000, 8,  4, 256,  4242, 8, BY_CONTENT); }
+
+TEST(array_store, ByContentInsert)
+{
+	const int chunk_count = 64;
+	BArrayStore *bs = BLI_array_store_create_ex(1, chunk_count, BY_CONTENT);
+	const size_t data_len = 1 << 16;
+	const size_t insert_len = 100;
+	char *data_a = (char *)MEM_mallocN(data_len, __func__);
+	char *data_b = (char *)MEM_mallocN(data_len + insert_len, __func__);
+
+	RNG *rng = BLI_rng_new(1234);
+	BLI_rng_get_char_n(rng, data_a, data_len);
+	BLI_rng_get_char_n(rng, data_b, insert_len);
+	BLI_rng_free(rng);
+	memcpy(&data_b[insert_len], data_a, data_len);
+
+	BArrayState *state_a = BLI_array_store_state_add(bs, data_a, data_len, NULL);
+	BArrayState *state_b = BLI_array_store_state_add(bs, data_b, data_len + insert_len, state_a);
+	EXPECT_TRUE(BLI_array_store_is_valid(bs));
+
+	EXPECT_EQ(BLI_array_store_state_size_unique_get(state_a), data_len);
+	/* only the inserted data and the chunks around it are new */
+	EXPECT_LE(BLI_array_store_state_size_unique_get(state_b), insert_len + (chunk_count * 4));
+	EXPECT_EQ(BLI_array_store_calc_size_compacted_get(bs),
+	          BLI_array_store_state_size_unique_get(state_a) + BLI_array_store_state_size_unique_get(state_b));
+
+	size_t data_test_len;
+	char *data_test = (char *)BLI_array_store_state_data_get_alloc(state_b, &data_test_len);
+	EXPECT_EQ(data_test_len, data_len + insert_len);
+	EXPECT_EQ(memcmp(data_test, data_b, data_test_len), 0);
+	MEM_freeN(data_test);
+
+	MEM_freeN(data_a);
+	MEM_freeN(data_b);
+	BLI_array_store_destroy(bs);
+}
+
+#undef BY_CONTENT
 
 
 /* -------------------------------------------------------------------- */
@@ -198,3 +198,192 @@ TEST(ghash, Pop)
 
 	BLI_ghash_free(ghash, NULL, NULL);
 }
+
+/* Same tests as above, using flat (open addressing) storage. */
+TEST(ghash, FlatInsertLookup)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_FLAT);
+	init_keys(keys, 40);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, POINTER_FROM_UINT(*k), POINTER_FROM_UINT(*k));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_lookup(ghash, POINTER_FROM_UINT(*k));
+		EXPECT_EQ(POINTER_AS_UINT(v), *k);
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, FlatInsertRemove)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	GHashIterator gh_iter;
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i, bkt_size, iter_len;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_FLAT);
+	init_keys(keys, 50);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, POINTER_FROM_UINT(*k), POINTER_FROM_UINT(*k));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE);
+	bkt_size = BLI_ghash_buckets_len(ghash);
+
+	/* Remove half of the keys, the other half must still be found. */
+	for (i = TESTCASE_SIZE / 2, k = keys; i--; k++) {
+		void *v = BLI_ghash_popkey(ghash, POINTER_FROM_UINT(*k), NULL);
+		EXPECT_EQ(POINTER_AS_UINT(v), *k);
+	}
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE - TESTCASE_SIZE / 2);
+
+	for (i = TESTCASE_SIZE - TESTCASE_SIZE / 2; i--; k++) {
+		void *v = BLI_ghash_lookup(ghash, POINTER_FROM_UINT(*k));
+		EXPECT_EQ(POINTER_AS_UINT(v), *k);
+	}
+
+	iter_len = 0;
+	GHASH_ITER (gh_iter, ghash) {
+		EXPECT_EQ(BLI_ghashIterator_getKey(&gh_iter), BLI_ghashIterator_getValue(&gh_iter));
+		iter_len++;
+	}
+	EXPECT_EQ(iter_len, TESTCASE_SIZE - TESTCASE_SIZE / 2);
+
+	for (k = &keys[TESTCASE_SIZE / 2], i = TESTCASE_SIZE - TESTCASE_SIZE / 2; i--; k++) {
+		EXPECT_TRUE(BLI_ghash_remove(ghash, POINTER_FROM_UINT(*k), NULL, NULL));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), 0);
+	EXPECT_EQ(BLI_ghash_buckets_len(ghash), bkt_size);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, FlatInsertRemoveShrink)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i, bkt_size;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_FLAT | GHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 60);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, POINTER_FROM_UINT(*k), POINTER_FROM_UINT(*k));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE);
+	bkt_size = BLI_ghash_buckets_len(ghash);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_popkey(ghash, POINTER_FROM_UINT(*k), NULL);
+		EXPECT_EQ(POINTER_AS_UINT(v), *k);
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), 0);
+	EXPECT_LT(BLI_ghash_buckets_len(ghash), bkt_size);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, FlatCopy)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	GHash *ghash_copy;
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_FLAT);
+	init_keys(keys, 70);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, POINTER_FROM_UINT(*k), POINTER_FROM_UINT(*k));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE);
+
+	ghash_copy = BLI_ghash_copy(ghash, NULL, NULL);
+
+	EXPECT_EQ(BLI_ghash_len(ghash_copy), TESTCASE_SIZE);
+	EXPECT_EQ(BLI_ghash_buckets_len(ghash_copy), BLI_ghash_buckets_len(ghash));
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_lookup(ghash_copy, POINTER_FROM_UINT(*k));
+		EXPECT_EQ(POINTER_AS_UINT(v), *k);
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+	BLI_ghash_free(ghash_copy, NULL, NULL);
+}
+
+TEST(ghash, FlatPop)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_FLAT | GHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 80);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, POINTER_FROM_UINT(*k), POINTER_FROM_UINT(*k));
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE);
+
+	GHashIterState pop_state = {0};
+
+	for (i = TESTCASE_SIZE / 2; i--; ) {
+		void *k, *v;
+		bool success = BLI_ghash_pop(ghash, &pop_state, &k, &v);
+		EXPECT_EQ(k, v);
+		EXPECT_TRUE(success);
+	}
+
+	EXPECT_EQ(BLI_ghash_len(ghash), TESTCASE_SIZE - TESTCASE_SIZE / 2);
+
+	{
+		void *k, *v;
+		while (BLI_ghash_pop(ghash, &pop_state, &k, &v)) {
+			EXPECT_EQ(k, v);
+		}
+	}
+	EXPECT_EQ(BLI_ghash_len(ghash), 0);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(gset, FlatEnsure)
+{
+	GSet *gset = BLI_gset_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_gset_flag_set(gset, GHASH_FLAG_FLAT);
+	init_keys(keys, 90);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void **key_p;
+		EXPECT_FALSE(BLI_gset_ensure_p_ex(gset, POINTER_FROM_UINT(*k), &key_p));
+		*key_p = POINTER_FROM_UINT(*k);
+	}
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_FALSE(BLI_gset_add(gset, POINTER_FROM_UINT(*k)));
+		EXPECT_TRUE(BLI_gset_haskey(gset, POINTER_FROM_UINT(*k)));
+	}
+
+	EXPECT_EQ(BLI_gset_len(gset), TESTCASE_SIZE);
+
+	BLI_gset_free(gset, NULL);
+}
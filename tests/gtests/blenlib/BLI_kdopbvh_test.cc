@@ -95,3 +95,88 @@ static void find_nearest_points_test(int points_len, float scale, int round, int
 TEST(kdopbvh, FindNearest_1)		{ find_nearest_points_test(1, 1.0, 1000, 1234); }
 TEST(kdopbvh, FindNearest_2)		{ find_nearest_points_test(2, 1.0, 1000, 123); }
 TEST(kdopbvh, FindNearest_500)		{ find_nearest_points_test(500, 1.0, 1000, 12); }
+
+/**
+ * Check the batch functions give the same results as the single query ones.
+ */
+static void find_nearest_batch_test(int points_len, float scale, int round, int random_seed)
+{
+	struct RNG *rng = BLI_rng_new(random_seed);
+	BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+	float (*co)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+	BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * points_len, __func__);
+
+	for (int i = 0; i < points_len; i++) {
+		rng_v3_round(points[i], 3, rng, round, scale);
+		BLI_bvhtree_insert(tree, i, points[i], 1);
+	}
+	BLI_bvhtree_balance(tree);
+
+	for (int i = 0; i < points_len; i++) {
+		rng_v3_round(co[i], 3, rng, round, scale * 2.0f);
+		nearest[i].index = -1;
+		nearest[i].dist_sq = FLT_MAX;
+	}
+
+	BLI_bvhtree_find_nearest_batch(tree, co, points_len, nearest, NULL, NULL);
+
+	for (int i = 0; i < points_len; i++) {
+		EXPECT_EQ(BLI_bvhtree_find_nearest(tree, co[i], NULL, NULL, NULL), nearest[i].index);
+	}
+
+	BLI_bvhtree_free(tree);
+	BLI_rng_free(rng);
+	MEM_freeN(points);
+	MEM_freeN(co);
+	MEM_freeN(nearest);
+}
+
+static void ray_cast_batch_test(int points_len, float scale, int round, int random_seed)
+{
+	struct RNG *rng = BLI_rng_new(random_seed);
+	BVHTree *tree = BLI_bvhtree_new(points_len, 0.1f, 8, 8);
+
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+	float (*co)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+	float (*dir)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+	BVHTreeRayHit *hit = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit) * points_len, __func__);
+
+	for (int i = 0; i < points_len; i++) {
+		rng_v3_round(points[i], 3, rng, round, scale);
+		BLI_bvhtree_insert(tree, i, points[i], 1);
+	}
+	BLI_bvhtree_balance(tree);
+
+	for (int i = 0; i < points_len; i++) {
+		rng_v3_round(co[i], 3, rng, round, scale * 2.0f);
+		sub_v3_v3v3(dir[i], points[i], co[i]);
+		normalize_v3(dir[i]);
+		hit[i].index = -1;
+		hit[i].dist = BVH_RAYCAST_DIST_MAX;
+	}
+
+	BLI_bvhtree_ray_cast_batch(tree, co, dir, points_len, 0.0f, hit, NULL, NULL);
+
+	for (int i = 0; i < points_len; i++) {
+		BVHTreeRayHit hit_single;
+		hit_single.index = -1;
+		hit_single.dist = BVH_RAYCAST_DIST_MAX;
+		BLI_bvhtree_ray_cast(tree, co[i], dir[i], 0.0f, &hit_single, NULL, NULL);
+		/* Every ray is aimed at a point. */
+		EXPECT_NE(-1, hit[i].index);
+		EXPECT_EQ(hit_single.index, hit[i].index);
+		EXPECT_EQ(hit_single.dist, hit[i].dist);
+	}
+
+	BLI_bvhtree_free(tree);
+	BLI_rng_free(rng);
+	MEM_freeN(points);
+	MEM_freeN(co);
+	MEM_freeN(dir);
+	MEM_freeN(hit);
+}
+
+TEST(kdopbvh, FindNearestBatch_5000)	{ find_nearest_batch_test(5000, 1.0, 1000, 12); }
+TEST(kdopbvh, RayCastBatch_5000)		{ ray_cast_batch_test(5000, 1.0, 1000, 12); }
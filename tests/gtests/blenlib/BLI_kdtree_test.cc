@@ -0,0 +1,130 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_compiler_attrs.h"
+#include "BLI_kdtree.h"
+#include "BLI_rand.h"
+#include "BLI_math_vector.h"
+#include "MEM_guardedalloc.h"
+}
+
+#include "stubs/bf_intern_eigen_stubs.h"
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void rng_v3_round(
+        float *coords, int coords_len,
+        struct RNG *rng, int round, float scale)
+{
+	for (int i = 0; i < coords_len; i++) {
+		float f = BLI_rng_get_float(rng) * 2.0f - 1.0f;
+		coords[i] = ((float)((int)(f * round)) / (float)round) * scale;
+	}
+}
+
+static KDTree *kdtree_random_new(int points_len, int round, int random_seed, float (**r_points)[3])
+{
+	struct RNG *rng = BLI_rng_new(random_seed);
+	KDTree *tree = BLI_kdtree_new((unsigned int)points_len);
+	float (*points)[3] = (float (*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+
+	for (int i = 0; i < points_len; i++) {
+		rng_v3_round(points[i], 3, rng, round, 1.0f);
+		BLI_kdtree_insert(tree, i, points[i]);
+	}
+	BLI_kdtree_balance(tree);
+	BLI_rng_free(rng);
+
+	*r_points = points;
+	return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+/**
+ * Large enough to balance the tree using threads.
+ */
+static void find_nearest_test(int points_len, int round, int random_seed)
+{
+	float (*points)[3];
+	KDTree *tree = kdtree_random_new(points_len, round, random_seed, &points);
+
+	for (int i = 0; i < points_len; i++) {
+		KDTreeNearest nearest;
+		const int j = BLI_kdtree_find_nearest(tree, points[i], &nearest);
+		EXPECT_GE(j, 0);
+		EXPECT_LT(j, points_len);
+		EXPECT_EQ(0.0f, nearest.dist);
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+}
+
+static void find_nearest_n_batch_test(int points_len, unsigned int n, int round, int random_seed)
+{
+	float (*points)[3];
+	KDTree *tree = kdtree_random_new(points_len, round, random_seed, &points);
+
+	KDTreeNearest *nearest = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest) * points_len * n, __func__);
+	int *found = (int *)MEM_mallocN(sizeof(*found) * points_len, __func__);
+
+	BLI_kdtree_find_nearest_n_batch(tree, points, (unsigned int)points_len, nearest, found, n);
+
+	for (int i = 0; i < points_len; i++) {
+		KDTreeNearest *nearest_single = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest_single) * n, __func__);
+		const int found_single = BLI_kdtree_find_nearest_n(tree, points[i], nearest_single, n);
+		EXPECT_EQ(found_single, found[i]);
+		for (int j = 0; j < found_single; j++) {
+			EXPECT_EQ(nearest_single[j].dist, nearest[i * n + j].dist);
+		}
+		MEM_freeN(nearest_single);
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+	MEM_freeN(nearest);
+	MEM_freeN(found);
+}
+
+static void range_search_batch_cb(
+        void *user_data, unsigned int co_index, const KDTreeNearest *nearest, unsigned int nearest_len)
+{
+	int *found = (int *)user_data;
+	found[co_index] = (int)nearest_len;
+	for (unsigned int i = 1; i < nearest_len; i++) {
+		EXPECT_LE(nearest[i - 1].dist, nearest[i].dist);
+	}
+}
+
+static void range_search_batch_test(int points_len, float range, int round, int random_seed)
+{
+	float (*points)[3];
+	KDTree *tree = kdtree_random_new(points_len, round, random_seed, &points);
+
+	int *found = (int *)MEM_mallocN(sizeof(*found) * points_len, __func__);
+
+	BLI_kdtree_range_search_batch(tree, points, (unsigned int)points_len, range, range_search_batch_cb, found);
+
+	for (int i = 0; i < points_len; i++) {
+		KDTreeNearest *nearest_single;
+		const int found_single = BLI_kdtree_range_search(tree, points[i], &nearest_single, range);
+		EXPECT_EQ(found_single, found[i]);
+		if (nearest_single) {
+			MEM_freeN(nearest_single);
+		}
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+	MEM_freeN(found);
+}
+
+TEST(kdtree, FindNearest_500)			{ find_nearest_test(500, 1000, 12); }
+TEST(kdtree, FindNearest_100000)		{ find_nearest_test(100000, 1000000, 12); }
+TEST(kdtree, FindNearestNBatch_50000)	{ find_nearest_n_batch_test(50000, 8, 1000000, 34); }
+TEST(kdtree, RangeSearchBatch_50000)	{ range_search_batch_test(50000, 0.05f, 1000000, 56); }
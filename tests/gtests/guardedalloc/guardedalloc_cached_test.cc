@@ -0,0 +1,126 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+#define CHECK_ALIGNMENT(ptr, align) EXPECT_EQ((size_t)ptr % align, 0)
+
+#define THREADS_NUM 8
+#define BLOCKS_NUM 10000
+
+namespace {
+
+void AllocBlocks(std::vector<void *> *blocks, int seed)
+{
+	for (int i = 0; i < BLOCKS_NUM; i++) {
+		/* Mix of slab sizes and system malloc sizes. */
+		const size_t len = (size_t)((i * 7 + seed * 13) % ((i % 10) ? 200 : 4000));
+		blocks->push_back(MEM_mallocN(len, __func__));
+	}
+}
+
+void FreeBlocks(std::vector<void *> *blocks)
+{
+	for (void *block : *blocks) {
+		MEM_freeN(block);
+	}
+	blocks->clear();
+}
+
+size_t BlocksLen(const std::vector<void *> &blocks)
+{
+	size_t len = 0;
+	for (void *block : blocks) {
+		len += MEM_allocN_len(block);
+	}
+	return len;
+}
+
+}  // namespace
+
+TEST(guardedalloc, CachedAlignedAlloc)
+{
+	MEM_use_cached_allocator();
+
+	int *foo = (int *) MEM_mallocN_aligned(sizeof(int) * 10, 16, "test");
+	CHECK_ALIGNMENT(foo, 16);
+
+	int *bar = (int *) MEM_dupallocN(foo);
+	CHECK_ALIGNMENT(bar, 16);
+	MEM_freeN(bar);
+
+	foo = (int *) MEM_reallocN(foo, sizeof(int) * 5);
+	CHECK_ALIGNMENT(foo, 16);
+
+	MEM_freeN(foo);
+	EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST(guardedalloc, CachedReallocClear)
+{
+	MEM_use_cached_allocator();
+
+	char *foo = (char *) MEM_callocN(20, "test");
+	for (int i = 0; i < 20; i++) {
+		EXPECT_EQ(foo[i], 0);
+	}
+	memset(foo, 1, 20);
+
+	/* Grows within the same size class, then into a larger one. */
+	foo = (char *) MEM_recallocN(foo, 24);
+	EXPECT_EQ(MEM_allocN_len(foo), 24);
+	EXPECT_EQ(MEM_get_memory_in_use(), 24);
+	foo = (char *) MEM_recallocN(foo, 500);
+	EXPECT_EQ(MEM_allocN_len(foo), 500);
+	EXPECT_EQ(MEM_get_memory_in_use(), 500);
+	for (int i = 0; i < 500; i++) {
+		EXPECT_EQ(foo[i], (i < 20) ? 1 : 0);
+	}
+
+	MEM_freeN(foo);
+	EXPECT_EQ(MEM_get_memory_in_use(), 0);
+	EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}
+
+TEST(guardedalloc, CachedThreadedCounters)
+{
+	MEM_use_cached_allocator();
+
+	std::vector<void *> blocks[THREADS_NUM];
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < THREADS_NUM; i++) {
+		threads.push_back(std::thread(AllocBlocks, &blocks[i], i));
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+
+	size_t len = 0;
+	for (int i = 0; i < THREADS_NUM; i++) {
+		len += BlocksLen(blocks[i]);
+	}
+	EXPECT_EQ(MEM_get_memory_in_use(), len);
+	EXPECT_EQ(MEM_get_memory_blocks_in_use(), THREADS_NUM * BLOCKS_NUM);
+	EXPECT_GE(MEM_get_peak_memory(), len);
+
+	/* Free blocks from other threads than the ones which allocated them. */
+	for (int i = 0; i < THREADS_NUM; i++) {
+		threads.push_back(std::thread(FreeBlocks, &blocks[(i + 1) % THREADS_NUM]));
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	EXPECT_EQ(MEM_get_memory_in_use(), 0);
+	EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0);
+}